@@ -34,7 +34,9 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <functional>
+#include <limits>
 #include <sstream>
 
 #include "Array.h"
@@ -45,13 +47,17 @@
 #include "D4EnumDefs.h"
 #include "D4Group.h"
 #include "D4Maps.h"
+#include "D4RequestContext.h"
+#include "D4StreamMarshaller.h"
 #include "DMR.h"
+#include "XDRStreamMarshaller.h"
 #include "XMLWriter.h"
 
 #include "DapIndent.h"
 #include "InternalErr.h"
 #include "debug.h"
 #include "escaping.h"
+#include "util.h"
 
 using namespace std;
 
@@ -61,8 +67,21 @@ namespace libdap {
 Array::dimension::dimension(D4Dimension *d)
     : size(d->size()), name(d->name()), dim(d), use_sdim_for_slice(true), stop(size - 1), c_size(size) {}
 
+namespace {
+
+// The number of elements in the constrained dimensions
+int64_t selected_elements(const std::vector<Array::dimension> &shape) {
+    uint64_t length = 1;
+    for (const auto &d : shape)
+        length *= d.c_size;
+    return length;
+}
+
+} // namespace
+
 void Array::_duplicate(const Array &a) {
-    _shape = a._shape;
+    _shape = a.m_shape();
+    d_slab_size = a.d_slab_size;
 
     // Deep copy the Maps if they are being used.
     if (a.d_maps) {
@@ -72,6 +91,44 @@ void Array::_duplicate(const Array &a) {
     }
 }
 
+/// The dimensions of this Array, or their copy in the current D4RequestContext
+const std::vector<Array::dimension> &Array::m_shape() const {
+    const std::vector<dimension> *shape = m_request_shape();
+    return shape ? *shape : _shape;
+}
+
+/// The copy of the dimensions held by the current D4RequestContext, or null
+std::vector<Array::dimension> *Array::m_request_shape() const {
+    D4RequestContext *context = D4RequestContext::current();
+    return context ? context->find<std::vector<dimension>>(this, m_request_serial()) : nullptr;
+}
+
+/**
+ * The dimensions to constrain. While a D4RequestContext is active, they are
+ * copied to the context the first time they are used, so that constraints
+ * change the copy. All the iterators used with one context must come from
+ * here.
+ */
+std::vector<Array::dimension> &Array::m_constrained_shape() {
+    D4RequestContext *context = D4RequestContext::current();
+    return context ? context->get(this, m_request_serial(), _shape) : _shape;
+}
+
+/**
+ * Change the dimensions themselves (not their constraints), and their copy
+ * in the current D4RequestContext if it has one, then update the length.
+ */
+void Array::m_change_shape(const std::function<void(std::vector<dimension> &)> &change) {
+    change(_shape);
+    if (std::vector<dimension> *shape = m_request_shape()) {
+        change(*shape);
+        // update_length() sets the length in the context
+        set_length_ll(selected_elements(_shape));
+    }
+
+    update_length();
+}
+
 // The first method of calculating length works when only one dimension is
 // constrained, and you want the others to appear in the total. This is important
 // when selecting from grids since users may not select from all dimensions
@@ -84,22 +141,13 @@ void Array::_duplicate(const Array &a) {
 
  Changes the length property of the array.
  */
-void Array::update_length(int) {
-    uint64_t length = 1;
-    for (Dim_citer i = _shape.begin(); i != _shape.end(); i++) {
-        length *= (*i).c_size;
-    }
-
-    set_length_ll(length);
-}
+void Array::update_length(int) { update_length_ll(); }
 
 void Array::update_length_ll(unsigned long long) {
-    unsigned long long length = 1;
-    for (const auto &i : _shape) {
-        length *= i.c_size;
-    }
-
-    set_length_ll(length);
+    if (const std::vector<dimension> *shape = m_request_shape())
+        m_set_constrained_length(selected_elements(*shape));
+    else
+        set_length_ll(selected_elements(_shape));
 }
 // Construct an instance of Array. The (BaseType *) is assumed to be
 // allocated using new - The dtor for Vector will delete this object.
@@ -148,7 +196,12 @@ Array::Array(const string &n, const string &d, BaseType *v, bool is_dap4 /* defa
 Array::Array(const Array &rhs) : Vector(rhs) { _duplicate(rhs); }
 
 /** @brief The Array destructor. */
-Array::~Array() { delete d_maps; }
+Array::~Array() {
+    delete d_maps;
+
+    if (D4RequestContext *context = D4RequestContext::current())
+        context->erase<std::vector<dimension>>(this, m_request_serial());
+}
 
 BaseType *Array::ptr_duplicate() { return new Array(*this); }
 
@@ -211,7 +264,8 @@ void Array::transform_to_dap4(D4Group *root, Constructor *container) {
     }
 
     // Copy the D2 attributes to D4 Attributes
-    dest->attributes()->transform_to_dap4(get_attr_table());
+    if (has_attr_table())
+        dest->attributes()->transform_to_dap4(get_attr_table());
     dest->set_is_dap4(true);
     container->add_var_nocopy(dest);
     DBG(cerr << __func__ << "() - END (array:" << name() << ")" << endl);
@@ -232,9 +286,9 @@ bool Array::is_dap2_grid() {
             D4Maps::D4MapsIter i = d4_maps->map_begin();
             D4Maps::D4MapsIter e = d4_maps->map_end();
             while (i != e) {
-                DBG(cerr << __func__ << "() - Map '" << (*i)->array()->name() << " has " << (*i)->array()->_shape.size()
+                DBG(cerr << __func__ << "() - Map '" << (*i)->array()->name() << " has " << (*i)->array()->m_shape().size()
                          << " dimension(s)." << endl);
-                if ((*i)->array(root)->_shape.size() > 1) {
+                if ((*i)->array(root)->m_shape().size() > 1) {
                     is_grid = false;
                     i = e;
                 } else {
@@ -387,37 +441,42 @@ std::vector<BaseType *> *Array::transform_to_dap2(AttrTable *, bool show_shared_
  * @param grp: The pointer to the new group.
  */
 void Array::update_dimension_pointers(D4Group *grp) {
-
-    D4Group *temp_grp = grp;
-
-    // Somehow the for loop doesn't work. use the iterator instead.
-    std::vector<dimension>::iterator i = _shape.begin(), e = _shape.end();
-    while (i != e) {
-        while (temp_grp) {
-            D4Dimensions *temp_dims = temp_grp->dims();
-
-            if ((*i).dim) {
-                // Here we need to use the dimension name, not the FQN
-                // to find if we have the dimension under this group.
-                string vd_dim_name = ((*i).dim)->name();
-                D4Dimension *temp_dim = temp_dims->find_dim(vd_dim_name);
-
-                // find, update this dimension of this array; go to the next dimension.
-                if (temp_dim) {
-                    (*i).dim = temp_dim;
-                    temp_grp = grp;
-                    break;
+    auto update = [grp](std::vector<dimension> &shape) {
+        D4Group *temp_grp = grp;
+
+        // Somehow the for loop doesn't work. use the iterator instead.
+        std::vector<dimension>::iterator i = shape.begin(), e = shape.end();
+        while (i != e) {
+            while (temp_grp) {
+                D4Dimensions *temp_dims = temp_grp->dims();
+
+                if ((*i).dim) {
+                    // Here we need to use the dimension name, not the FQN
+                    // to find if we have the dimension under this group.
+                    string vd_dim_name = ((*i).dim)->name();
+                    D4Dimension *temp_dim = temp_dims->find_dim(vd_dim_name);
+
+                    // find, update this dimension of this array; go to the next dimension.
+                    if (temp_dim) {
+                        (*i).dim = temp_dim;
+                        temp_grp = grp;
+                        break;
+                    }
                 }
-            }
 
-            // Not find under this group, go to its parent.
-            if (temp_grp->get_parent())
-                temp_grp = static_cast<D4Group *>(temp_grp->get_parent());
-            else
-                temp_grp = nullptr;
+                // Not find under this group, go to its parent.
+                if (temp_grp->get_parent())
+                    temp_grp = static_cast<D4Group *>(temp_grp->get_parent());
+                else
+                    temp_grp = nullptr;
+            }
+            ++i;
         }
-        ++i;
-    }
+    };
+
+    update(_shape);
+    if (std::vector<dimension> *shape = m_request_shape())
+        update(*shape);
 }
 
 /** @brief Add the BaseType pointer to this constructor type
@@ -494,21 +553,17 @@ void Array::add_var_nocopy(BaseType *v, Part) {
  @brief Add a dimension of a given size. */
 void Array::append_dim(int size, const string &name) {
     dimension d(size, www2id(name));
-    _shape.push_back(d);
-
-    update_length();
+    m_change_shape([&d](std::vector<dimension> &shape) { shape.push_back(d); });
 }
 
 void Array::append_dim_ll(int64_t size, const string &name) {
-    _shape.emplace_back(size, www2id(name));
-    update_length();
+    dimension d(size, www2id(name));
+    m_change_shape([&d](std::vector<dimension> &shape) { shape.push_back(d); });
 }
 
 void Array::append_dim(D4Dimension *dim) {
     dimension d(/*dim->size(), www2id(dim->name()),*/ dim);
-    _shape.push_back(d);
-
-    update_length();
+    m_change_shape([&d](std::vector<dimension> &shape) { shape.push_back(d); });
 }
 
 /** Creates a new OUTER dimension (slowest varying in rowmajor)
@@ -519,23 +574,23 @@ void Array::append_dim(D4Dimension *dim) {
 void Array::prepend_dim(int size, const string &name /* = "" */) {
     dimension d(size, www2id(name));
     // Shifts the whole array, but it's tiny in general
-    _shape.insert(_shape.begin(), d);
-
-    update_length(); // the number is ignored...
+    m_change_shape([&d](std::vector<dimension> &shape) { shape.insert(shape.begin(), d); });
 }
 
 void Array::prepend_dim(D4Dimension *dim) {
     dimension d(/*dim->size(), www2id(dim->name()),*/ dim);
     // Shifts the whole array, but it's tiny in general
-    _shape.insert(_shape.begin(), d);
-
-    update_length(); // the number is ignored...
+    m_change_shape([&d](std::vector<dimension> &shape) { shape.insert(shape.begin(), d); });
 }
 
 /** Remove all the dimensions currently set for the Array. This also
  * removes all constraint information.
  */
-void Array::clear_all_dims() { _shape.clear(); }
+void Array::clear_all_dims() {
+    _shape.clear();
+    if (std::vector<dimension> *shape = m_request_shape())
+        shape->clear();
+}
 
 /** Renames dimension to a new name
 
@@ -543,16 +598,18 @@ void Array::clear_all_dims() { _shape.clear(); }
  */
 
 void Array::rename_dim(const string &oldName, const string &newName) {
-    std::vector<dimension>::iterator i = _shape.begin(), e = _shape.end();
-    while (i != e) {
-        dimension &d = *i;
-        if (d.name == oldName) {
-            DBG(cerr << "Old name = " << d.name << " newName = " << newName << endl);
-            d.name = newName;
+    auto rename = [&oldName, &newName](std::vector<dimension> &shape) {
+        for (auto &d : shape) {
+            if (d.name == oldName) {
+                DBG(cerr << "Old name = " << d.name << " newName = " << newName << endl);
+                d.name = newName;
+            }
         }
+    };
 
-        ++i;
-    }
+    rename(_shape);
+    if (std::vector<dimension> *shape = m_request_shape())
+        rename(*shape);
 }
 
 /** Resets the dimension constraint information so that the entire
@@ -561,9 +618,9 @@ void Array::rename_dim(const string &oldName, const string &newName) {
  @brief Reset constraint to select entire array.
  */
 void Array::reset_constraint() {
-    set_length(-1);
+    m_set_constrained_length(-1);
 
-    for (Dim_iter i = _shape.begin(); i != _shape.end(); i++) {
+    for (Dim_iter i = dim_begin(); i != dim_end(); i++) {
         (*i).start = 0;
         (*i).stop = (*i).size - 1;
         (*i).stride = 1;
@@ -700,10 +757,10 @@ void Array::add_constraint(Dim_iter i, D4Dimension *dim) {
 }
 
 /** Returns an iterator to the first dimension of the Array. */
-Array::Dim_iter Array::dim_begin() { return _shape.begin(); }
+Array::Dim_iter Array::dim_begin() { return m_constrained_shape().begin(); }
 
 /** Returns an iterator past the last dimension of the Array. */
-Array::Dim_iter Array::dim_end() { return _shape.end(); }
+Array::Dim_iter Array::dim_end() { return m_constrained_shape().end(); }
 
 // TODO Many of these methods take a bool parameter that serves no use; remove.
 
@@ -715,7 +772,7 @@ Array::Dim_iter Array::dim_end() { return _shape.end(); }
  @param constrained A boolean flag to indicate whether the array is
  constrained or not.  Ignored.
  */
-unsigned int Array::dimensions(bool /*constrained*/) { return _shape.size(); }
+unsigned int Array::dimensions(bool /*constrained*/) { return m_shape().size(); }
 
 /** Return the size of the array dimension referred to by <i>i</i>.
  If the dimension is constrained the constrained size is returned if
@@ -737,7 +794,7 @@ unsigned int Array::dimensions(bool /*constrained*/) { return _shape.size(); }
 int Array::dimension_size(Dim_iter i, bool constrained) {
     int size = 0;
 
-    if (!_shape.empty()) {
+    if (!m_shape().empty()) {
         if (constrained) {
             if ((*i).c_size > DODS_INT_MAX) {
                 throw Error(malformed_expr, "The dimension size is too large. Use dimension_size_ll()");
@@ -776,7 +833,7 @@ int Array::dimension_start(Dim_iter i, bool /*constrained*/) {
     if ((*i).start > DODS_INT_MAX) {
         throw Error(malformed_expr, "The dimension start value is too large. Use dimension_start_ll()");
     }
-    return (!_shape.empty()) ? (*i).start : 0;
+    return (!m_shape().empty()) ? (*i).start : 0;
 }
 
 /** Use this function to return the stop index of an array
@@ -801,7 +858,7 @@ int Array::dimension_stop(Dim_iter i, bool /*constrained*/) {
     if ((*i).stop > DODS_INT_MAX) {
         throw Error(malformed_expr, "The dimension stop value is too large. Use dimension_stop_ll()");
     }
-    return (!_shape.empty()) ? (*i).stop : 0;
+    return (!m_shape().empty()) ? (*i).stop : 0;
 }
 
 /** Use this function to return the stride value of an array
@@ -827,13 +884,13 @@ int Array::dimension_stride(Dim_iter i, bool /*constrained*/) {
     if ((*i).stride > DODS_INT_MAX) {
         throw Error(malformed_expr, "The dimension stride value is too large. Use dimension_stride_ll()");
     }
-    return (!_shape.empty()) ? (*i).stride : 0;
+    return (!m_shape().empty()) ? (*i).stride : 0;
 }
 
 int64_t Array::dimension_size_ll(Dim_iter i, bool constrained) {
     int64_t size = 0;
 
-    if (!_shape.empty()) {
+    if (!m_shape().empty()) {
         if (constrained)
             size = (*i).c_size;
         else
@@ -842,11 +899,11 @@ int64_t Array::dimension_size_ll(Dim_iter i, bool constrained) {
     return size;
 }
 
-int64_t Array::dimension_start_ll(Dim_iter i, bool /*constrained*/) { return (!_shape.empty()) ? (*i).start : 0; }
+int64_t Array::dimension_start_ll(Dim_iter i, bool /*constrained*/) { return (!m_shape().empty()) ? (*i).start : 0; }
 
-int64_t Array::dimension_stop_ll(Dim_iter i, bool /*constrained*/) { return (!_shape.empty()) ? (*i).stop : 0; }
+int64_t Array::dimension_stop_ll(Dim_iter i, bool /*constrained*/) { return (!m_shape().empty()) ? (*i).stop : 0; }
 
-int64_t Array::dimension_stride_ll(Dim_iter i, bool /*constrained*/) { return (!_shape.empty()) ? (*i).stride : 0; }
+int64_t Array::dimension_stride_ll(Dim_iter i, bool /*constrained*/) { return (!m_shape().empty()) ? (*i).stride : 0; }
 
 /** This function returns the name of the dimension indicated with
  <i>p</i>.  Since this method is public, it is possible to call it
@@ -864,12 +921,12 @@ string Array::dimension_name(Dim_iter i) {
     // to call it before the Array object has been properly set
     // this will cause an exception which is the user's fault.
     // (User in this context is the developer of the surrogate library.)
-    if (_shape.empty())
+    if (m_shape().empty())
         throw InternalErr(__FILE__, __LINE__, "*This* array has no dimensions.");
     return (*i).name;
 }
 
-D4Dimension *Array::dimension_D4dim(Dim_iter i) { return (!_shape.empty()) ? (*i).dim : 0; }
+D4Dimension *Array::dimension_D4dim(Dim_iter i) { return (!m_shape().empty()) ? (*i).dim : 0; }
 
 D4Maps *Array::maps() {
     if (!d_maps)
@@ -942,7 +999,8 @@ void Array::print_dap4(XMLWriter &xml, bool constrained /* default: false*/) {
         print_dim_element(xml, d, constrained);
     }
 
-    attributes()->print_dap4(xml);
+    if (has_attributes())
+        attributes()->print_dap4(xml);
 
     auto print_d4_map = [&xml](D4Map *m) { m->print_dap4(xml); };
 
@@ -1001,7 +1059,7 @@ void Array::print_decl(ostream &out, string space, bool print_semi, bool constra
     // print it, but w/o semicolon
     var()->print_decl(out, space, false, constraint_info, constrained, is_root_grp, true);
 
-    for (Dim_citer i = _shape.begin(); i != _shape.end(); i++) {
+    for (Dim_citer i = m_shape().begin(); i != m_shape().end(); i++) {
         out << "[";
         if ((*i).name != "") {
             out << id2www((*i).name) << " = ";
@@ -1089,7 +1147,8 @@ void Array::print_xml_writer_core(XMLWriter &xml, bool constrained, string tag)
         xmlTextWriterWriteAttribute(xml.get_writer(), (const xmlChar *)"name", (const xmlChar *)name().c_str()) < 0)
         throw InternalErr(__FILE__, __LINE__, "Could not write attribute for name");
 
-    get_attr_table().print_xml_writer(xml);
+    if (has_attr_table())
+        get_attr_table().print_xml_writer(xml);
 
     BaseType *btp = var();
     string tmp_name = btp->name();
@@ -1216,7 +1275,7 @@ void Array::print_val(ostream &out, string space, bool print_decl_p, bool is_roo
 
     auto shape = new uint64_t[dimensions(true)];
     unsigned int index = 0;
-    for (auto i = _shape.begin(); i != _shape.end() && index < dimensions(true); ++i)
+    for (auto i = dim_begin(); i != dim_end() && index < dimensions(true); ++i)
         shape[index++] = dimension_size_ll(i, true);
 
     print_array(out, 0, dimensions(true), shape, is_root_grp);
@@ -1239,7 +1298,7 @@ void Array::print_val(ostream &out, string space, bool print_decl_p, bool is_roo
  */
 
 bool Array::check_semantics(string &msg, bool) {
-    bool sem = BaseType::check_semantics(msg) && !_shape.empty();
+    bool sem = BaseType::check_semantics(msg) && !m_shape().empty();
 
     if (!sem)
         msg = "An array variable must have dimensions";
@@ -1307,7 +1366,7 @@ void Array::dump(std::ostream &strm) const {
     DapIndent::Indent();
 
     unsigned int dim_num = 0;
-    for (const auto &dim : _shape) {
+    for (const auto &dim : m_shape()) {
         strm << DapIndent::LMarg << "dimension " << dim_num++ << ":\n";
         DapIndent::Indent();
 
@@ -1358,4 +1417,108 @@ void Array::set_var_storage_info(const var_storage_info &my_vs_info) {
     }
 }
 
+/**
+ * The default does not know how to read part of an array; handlers that call
+ * set_slab_size() must override this.
+ */
+int64_t Array::read_slab(char * /*buf*/, int64_t /*start*/, int64_t /*max_elements*/) {
+    throw InternalErr(__FILE__, __LINE__, "read_slab() is not implemented for '" + name() + "'.");
+}
+
+// private
+/// Call read_slab() and check the number of values it read.
+int64_t Array::m_read_slab(char *buf, int64_t start, int64_t max_elements) {
+    int64_t n = read_slab(buf, start, max_elements);
+    if (n <= 0 || n > max_elements)
+        throw InternalErr(__FILE__, __LINE__,
+                          "read_slab() returned " + long_to_string(n) + " values for '" + name() +
+                              "' (expected 1 to " + long_to_string(max_elements) + ").");
+    return n;
+}
+
+/**
+ * @brief Serialize an Array for DAP2, slab by slab if possible
+ * If set_slab_size() was used, the values have not been read, they are of a
+ * cardinal type and the marshaller is an XDRStreamMarshaller, read them
+ * using read_slab() and send each slab with put_vector_part(). The
+ * marshaller copies each slab to one of its two reusable buffers and writes
+ * it in its child thread, so the next slab is read while the last one is
+ * sent. The response is the same as Vector::serialize() makes; otherwise,
+ * this is Vector::serialize().
+ *
+ * @exception InternalErr if read_slab() returns a bad number of values.
+ */
+bool Array::serialize(ConstraintEvaluator &eval, DDS &dds, Marshaller &m, bool ce_eval /*= true*/) {
+    auto *xdr = dynamic_cast<XDRStreamMarshaller *>(&m);
+    const int64_t num = length_ll();
+    if (d_slab_size == 0 || read_p() || !xdr || is_dap4() || num <= 0 || num > std::numeric_limits<int>::max())
+        return Vector::serialize(eval, dds, m, ce_eval);
+
+    switch (var()->type()) {
+    case dods_byte_c:
+    case dods_int16_c:
+    case dods_uint16_c:
+    case dods_int32_c:
+    case dods_uint32_c:
+    case dods_float32_c:
+    case dods_float64_c:
+        break;
+    default:
+        return Vector::serialize(eval, dds, m, ce_eval);
+    }
+
+    if (ce_eval && !eval.eval_selection(dds, dataset()))
+        return true;
+
+    const int width = static_cast<int>(var()->width_ll());
+    const int64_t slab_size = std::min(d_slab_size, num);
+    vector<char> slab(slab_size * width);
+
+    xdr->put_vector_start(static_cast<int>(num));
+    int64_t start = 0;
+    while (start < num) {
+        int64_t n = m_read_slab(slab.data(), start, std::min(slab_size, num - start));
+        xdr->put_vector_part(slab.data(), static_cast<unsigned int>(n), width, var()->type());
+        start += n;
+    }
+    xdr->put_vector_end();
+
+    return true;
+}
+
+/**
+ * @brief Serialize an Array for DAP4, slab by slab if possible
+ * If set_slab_size() was used, the values have not been read and they are of
+ * a cardinal type, read them using read_slab() and write each slab as it is
+ * read. The checksum covers all the values, as usual. With an ostream the
+ * marshaller copies each slab to a reusable buffer and writes it in its
+ * child thread while the next slab is read. Otherwise this is
+ * Vector::serialize().
+ *
+ * @exception InternalErr if read_slab() returns a bad number of values.
+ */
+void Array::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter /*= false*/) {
+    if (d_slab_size == 0 || read_p() || !m_is_cardinal_type()) {
+        Vector::serialize(m, dmr, filter);
+        return;
+    }
+
+    const int64_t num = length_ll();
+    if (num <= 0)
+        return;
+
+    const int64_t slab_size = std::min(d_slab_size, num);
+    vector<char> slab(slab_size * var()->width_ll());
+
+    int64_t start = 0;
+    while (start < num) {
+        int64_t n = m_read_slab(slab.data(), start, std::min(slab_size, num - start));
+        m_serialize_cardinal(m, slab.data(), n);
+        // The slab buffer is reused; a marshaller writing to a file descriptor
+        // holds a pointer to it until it is flushed.
+        m.flush();
+        start += n;
+    }
+}
+
 } // namespace libdap
@@ -37,6 +37,7 @@
 #ifndef _array_h
 #define _array_h 1
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -208,8 +209,19 @@ private:
 
     float storage_size_ratio = 1;
 
+    int64_t d_slab_size = 0; // elements per read_slab() call; 0 turns streaming off
+
+    // The dimensions, or their copy in the current D4RequestContext. The
+    // dimensions themselves stay in _shape; a context copy holds the
+    // constraints of one request.
+    const std::vector<dimension> &m_shape() const;
+    std::vector<dimension> *m_request_shape() const;
+    std::vector<dimension> &m_constrained_shape();
+    void m_change_shape(const std::function<void(std::vector<dimension> &)> &change);
+
     void update_dimension_pointers(D4Group *grp);
     void print_dim_element(const XMLWriter &xml, const dimension &d, bool constrained);
+    int64_t m_read_slab(char *buf, int64_t start, int64_t max_elements);
 
     friend class ArrayTest;
     friend class D4Group;
@@ -244,7 +256,7 @@ protected:
     uint64_t print_array(ostream &out, uint64_t index, unsigned int dims, uint64_t shape[], bool is_root_grp);
 
     /** @brief Returns mutable access to the internal dimension list. */
-    std::vector<dimension> &shape() { return _shape; }
+    std::vector<dimension> &shape() { return m_constrained_shape(); }
 
 public:
     /** A constant iterator used to access the various dimensions of an
@@ -516,6 +528,39 @@ public:
      * @param the ratio of the logical size to the real storage size for this array.
      */
     void set_storage_size_ratio(float sr) { storage_size_ratio = sr; }
+
+    // The following methods are for streaming DAP4 responses slab by slab.
+
+    /** @brief Returns how many elements serialize() asks read_slab() for; 0 if it does not stream. */
+    int64_t get_slab_size() const { return d_slab_size; }
+
+    /**
+     * @brief Stream this array's values instead of reading them all at once.
+     * When set, and the values have not already been read, serialize()
+     * allocates a buffer of 'elements' values and fills it with successive
+     * calls to read_slab(), writing each slab before asking for the next.
+     * The response is the same as when read() loads the whole array. Only
+     * arrays of cardinal types (not String, Url or constructors) stream; for
+     * DAP2 the marshaller must be an XDRStreamMarshaller.
+     * @param elements The most elements per slab; 0 turns streaming off.
+     */
+    void set_slab_size(int64_t elements) { d_slab_size = elements < 0 ? 0 : elements; }
+
+    /**
+     * @brief Read the next slab of the constrained array's values.
+     * Handlers that use set_slab_size() override this. The values are those
+     * read() would put in the array's buffer, in the same (row-major) order.
+     * @param buf Store the values here, in this machine's byte order
+     * @param start The index of the first value to read, counting from 0
+     * within the constrained array
+     * @param max_elements Read at most this many values; at least one is needed
+     * @return The number of values read, between 1 and max_elements.
+     * @exception InternalErr if the handler does not implement it.
+     */
+    virtual int64_t read_slab(char *buf, int64_t start, int64_t max_elements);
+
+    bool serialize(ConstraintEvaluator &eval, DDS &dds, Marshaller &m, bool ce_eval = true) override;
+    void serialize(D4StreamMarshaller &m, DMR &dmr, bool filter = false) override;
 };
 
 } // namespace libdap
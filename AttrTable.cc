@@ -194,6 +194,7 @@ void AttrTable::clone(const AttrTable &at) {
         // this deep-copies containers recursively
         entry *e = new entry(*(*i));
         attr_map.push_back(e);
+        NameIndex<entry>::appended(d_index, attr_map);
 
         // If the entry being added was a container,
         // set its parent to this to maintain invariant.
@@ -217,6 +218,7 @@ void AttrTable::delete_attr_table() {
         delete *i;
     }
     attr_map.clear();
+    d_index.reset();
 }
 
 AttrTable::~AttrTable() { delete_attr_table(); }
@@ -336,6 +338,8 @@ unsigned int AttrTable::append_attr(const string &name, const string &type, cons
 
         attr_map.push_back(e);
 
+        NameIndex<entry>::appended(d_index, attr_map);
+
         return e->attr->size(); // return the length of the attr vector
     }
 }
@@ -390,6 +394,8 @@ unsigned int AttrTable::append_attr(const string &name, const string &type, vect
 
         attr_map.push_back(e);
 
+        NameIndex<entry>::appended(d_index, attr_map);
+
         return e->attr->size(); // return the length of the attr vector
     }
 }
@@ -445,6 +451,8 @@ unsigned int AttrTable::append_attr(const string &name, const string &type, cons
 
         attr_map.push_back(e);
 
+        NameIndex<entry>::appended(d_index, attr_map);
+
         return e->attr->size(); // return the length of the attr vector
     }
 }
@@ -501,6 +509,8 @@ unsigned int AttrTable::append_attr(const string &name, const string &type, vect
 
         attr_map.push_back(e);
 
+        NameIndex<entry>::appended(d_index, attr_map);
+
         return e->attr->size(); // return the length of the attr vector
     }
 }
@@ -564,6 +574,8 @@ AttrTable *AttrTable::append_container(AttrTable *at, const string &name) {
 
     attr_map.push_back(e);
 
+    NameIndex<entry>::appended(d_index, attr_map);
+
     at->d_parent = this;
 
     return e->attributes;
@@ -612,22 +624,19 @@ void AttrTable::find(const string &target, AttrTable **at, Attr_iter *iter) {
  if \e target is not found. In the latter case, the value of \e location is
  attr_end() for this AttrTable. */
 AttrTable *AttrTable::recurrsive_find(const string &target, Attr_iter *location) {
-    Attr_iter i = attr_begin();
-    while (i != attr_end()) {
-        if (target == (*i)->name) {
-            *location = i;
-            return this;
-        } else if ((*i)->type == Attr_container) {
+    // A match in a container that comes before the first attribute with the
+    // name wins, so only those need to be searched.
+    Attr_iter match = simple_find(target);
+    for (Attr_iter i = attr_begin(); i != match; ++i) {
+        if ((*i)->type == Attr_container) {
             AttrTable *at = (*i)->attributes->recurrsive_find(target, location);
             if (at)
                 return at;
         }
-
-        ++i;
     }
 
-    *location = i;
-    return 0;
+    *location = match;
+    return match == attr_end() ? 0 : this;
 }
 
 // Made public for callers that want non-recursive find.  [mjohnson 6 oct 09]
@@ -638,13 +647,7 @@ AttrTable *AttrTable::recurrsive_find(const string &target, Attr_iter *location)
  @param target The name of the attribute.
  @return An Attr_iter which references \c target. */
 AttrTable::Attr_iter AttrTable::simple_find(const string &target) {
-    Attr_iter i;
-    for (i = attr_map.begin(); i != attr_map.end(); ++i) {
-        if (target == (*i)->name) {
-            break;
-        }
-    }
-    return i;
+    return attr_map.begin() + NameIndex<entry>::find(d_index, attr_map, target.data(), target.size());
 }
 
 /** Look in this attribute table for an attribute container named
@@ -678,7 +681,8 @@ AttrTable *AttrTable::simple_find_container(const string &target) {
     if (get_name() == target)
         return this;
 
-    for (Attr_iter i = attr_map.begin(); i != attr_map.end(); ++i) {
+    // The first container with the name; usually the first attribute with it
+    for (Attr_iter i = simple_find(target); i != attr_map.end(); ++i) {
         if (is_container(i) && target == (*i)->name) {
             return (*i)->attributes;
         }
@@ -768,6 +772,7 @@ void AttrTable::del_attr(const string &name, int i) {
         if (i == -1) { // Delete the whole attribute
             entry *e = *iter;
             attr_map.erase(iter);
+            d_index.reset();
             delete e;
             e = 0;
         } else { // Delete one element from attribute array
@@ -865,6 +870,7 @@ AttrTable::Attr_iter AttrTable::del_attr_table(Attr_iter iter) {
 
     delete e;
 
+    d_index.reset();
     return attr_map.erase(iter);
 }
 
@@ -980,6 +986,8 @@ void AttrTable::add_container_alias(const string &name, AttrTable *src) {
     e->attributes = src;
 
     attr_map.push_back(e);
+
+    NameIndex<entry>::appended(d_index, attr_map);
 }
 
 /** Assume \e source names an attribute value in some container. Add an alias
@@ -1045,6 +1053,8 @@ void AttrTable::add_value_alias(AttrTable *das, const string &name, const string
         e->attr = (*iter)->attr;
 
     attr_map.push_back(e);
+
+    NameIndex<entry>::appended(d_index, attr_map);
 }
 
 // Deprecated
@@ -1109,6 +1119,7 @@ void AttrTable::erase() {
     }
 
     attr_map.erase(attr_map.begin(), attr_map.end());
+    d_index.reset();
 
     d_name = "";
 }
@@ -52,6 +52,10 @@ using std::vector;
 #include "XMLWriter.h"
 #endif
 
+#ifndef _name_index_h
+#include "NameIndex.h"
+#endif
+
 namespace libdap {
 
 /** <b>AttrType</b> identifies the data types which may appear in an
@@ -278,6 +282,9 @@ private:
     AttrTable *d_parent;
     std::vector<entry *> attr_map;
 
+    // Index of attr_map by name, built by simple_find() for large tables
+    std::shared_ptr<NameIndex<entry>> d_index;
+
     // Use this to mark container attributes. Look at the methods
     // is_global_attribute() and set_is_...., esp. at the versions that take
     // an iterator. This code is tricky because it has to track both whole
@@ -399,6 +406,9 @@ public:
     void dump(ostream &strm) const override;
 };
 
+/// @brief The name NameIndex uses for an attribute table entry.
+inline const string &index_name(const AttrTable::entry *e) { return e->name; }
+
 string remove_space_encoding(const string &s);
 string add_space_encoding(const string &s);
 
@@ -35,6 +35,7 @@
 
 #include "config.h"
 
+#include <atomic>
 #include <cstdio> // for stdin and stdout
 
 #include <sstream>
@@ -59,6 +60,7 @@
 
 #include "D4Attributes.h"
 #include "D4BaseTypeFactory.h"
+#include "D4RequestContext.h"
 #include "DMR.h"
 #include "XMLWriter.h"
 
@@ -91,11 +93,24 @@ void BaseType::m_duplicate(const BaseType &bt) {
     d_is_read = bt.d_is_read; // added, reza
     d_is_send = bt.d_is_send; // added, reza
     d_in_selection = bt.d_in_selection;
+    if (const RequestState *state = bt.m_request_state()) {
+        d_is_read = state->is_read;
+        d_is_send = state->is_send;
+        d_in_selection = state->in_selection;
+    }
     d_is_synthesized = bt.d_is_synthesized; // 5/11/2001 jhrg
 
     d_parent = bt.d_parent; // copy pointers 6/4/2001 jhrg
+    atomic_store(&d_fqn, shared_ptr<const FQNCache>());
 
-    d_attr = bt.d_attr; // Deep copy.
+    // Deep copy. Keep this variable's table if it has one; the parsers hold
+    // pointers to it.
+    if (bt.d_attr && d_attr)
+        *d_attr = *bt.d_attr;
+    else if (bt.d_attr)
+        d_attr = new AttrTable(*bt.d_attr);
+    else if (d_attr)
+        *d_attr = AttrTable();
 
     if (bt.d_attributes)
         d_attributes = new D4Attributes(*bt.d_attributes); // deep copy
@@ -122,7 +137,7 @@ void BaseType::m_duplicate(const BaseType &bt) {
     @param is_dap4 True if this is a DAP4 variable. Default is False
     @see Type */
 BaseType::BaseType(const string &n, const Type &t, bool is_dap4)
-    : d_name(n), d_type(t), d_dataset(""), d_is_read(false), d_is_send(false), d_parent(0), d_attributes(0),
+    : d_name(n), d_dataset(""), d_parent(0), d_attributes(0), d_type(t), d_is_read(false), d_is_send(false),
       d_is_dap4(is_dap4), d_in_selection(false), d_is_synthesized(false) {}
 
 /** The BaseType constructor needs a name, a dataset, and a type.
@@ -138,7 +153,7 @@ BaseType::BaseType(const string &n, const Type &t, bool is_dap4)
     @param is_dap4 True if this is a DAP4 variable.
     @see Type */
 BaseType::BaseType(const string &n, const string &d, const Type &t, bool is_dap4)
-    : d_name(n), d_type(t), d_dataset(d), d_is_read(false), d_is_send(false), d_parent(0), d_attributes(0),
+    : d_name(n), d_dataset(d), d_parent(0), d_attributes(0), d_type(t), d_is_read(false), d_is_send(false),
       d_is_dap4(is_dap4), d_in_selection(false), d_is_synthesized(false) {}
 
 /** @brief The BaseType copy constructor. */
@@ -150,9 +165,14 @@ BaseType::BaseType(const BaseType &copy_from) : DapObj() {
 BaseType::~BaseType() {
     DBG2(cerr << "Entering ~BaseType (" << this << ")" << endl);
 
+    delete d_attr;
+
     if (d_attributes)
         delete d_attributes;
 
+    if (D4RequestContext *context = D4RequestContext::current())
+        context->erase<RequestState>(this, d_request_serial);
+
     DBG2(cerr << "Exiting ~BaseType" << endl);
 }
 
@@ -160,6 +180,7 @@ BaseType &BaseType::operator=(const BaseType &rhs) {
     if (this == &rhs)
         return *this;
     m_duplicate(rhs);
+    m_path_changed(); // The variables this one holds may have new FQNs
     return *this;
 }
 
@@ -172,12 +193,12 @@ string BaseType::toString() {
     oss << "BaseType (" << this << "):" << endl
         << "          _name: " << name() << endl
         << "          _type: " << type_name() << endl
-        << "          _dataset: " << d_dataset << endl
+        << "          _dataset: " << d_dataset.str() << endl
         << "          _read_p: " << d_is_read << endl
         << "          _send_p: " << d_is_send << endl
         << "          _synthesized_p: " << d_is_synthesized << endl
         << "          d_parent: " << d_parent << endl
-        << "          d_attr: " << hex << &d_attr << dec << endl;
+        << "          d_attr: 0x" << hex << reinterpret_cast<uintptr_t>(d_attr) << dec << endl;
 
     return oss.str();
 }
@@ -201,7 +222,8 @@ void BaseType::transform_to_dap4(D4Group * /*root*/, Constructor *container) {
     BaseType *dest = ptr_duplicate();
     // If it's already a DAP4 object then we can just return it!
     if (!is_dap4()) {
-        dest->attributes()->transform_to_dap4(get_attr_table());
+        if (has_attr_table())
+            dest->attributes()->transform_to_dap4(get_attr_table());
         dest->set_is_dap4(true);
     }
     container->add_var_nocopy(dest);
@@ -274,7 +296,7 @@ void BaseType::dump(ostream &strm) const {
 
     strm << DapIndent::LMarg << "name: " << name() << endl;
     strm << DapIndent::LMarg << "type: " << type_name() << endl;
-    strm << DapIndent::LMarg << "dataset: " << d_dataset << endl;
+    strm << DapIndent::LMarg << "dataset: " << d_dataset.str() << endl;
     strm << DapIndent::LMarg << "read_p: " << d_is_read << endl;
     strm << DapIndent::LMarg << "send_p: " << d_is_send << endl;
     strm << DapIndent::LMarg << "synthesized_p: " << d_is_synthesized << endl;
@@ -285,8 +307,8 @@ void BaseType::dump(ostream &strm) const {
 
     if (d_attributes)
         d_attributes->dump(strm);
-    else
-        d_attr.dump(strm);
+    else if (d_attr)
+        d_attr->dump(strm);
 
     DapIndent::UnIndent();
 
@@ -297,6 +319,40 @@ void BaseType::dump(ostream &strm) const {
  */
 string BaseType::name() const { return d_name; }
 
+namespace {
+
+std::atomic<uint64_t> path_generations(0);
+
+} // namespace
+
+// Protected. The generation of the tree this variable is in. Every tree
+// gets a unique generation the first time it is used, so the FQNs and
+// indexes built in a tree are not used after it is added to another.
+uint64_t BaseType::m_path_generation() const {
+    const BaseType *root = this;
+    while (root->d_parent)
+        root = root->d_parent;
+
+    uint64_t generation = root->d_path_generation.load(std::memory_order_relaxed);
+    if (generation == 0) {
+        uint64_t first = path_generations.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (root->d_path_generation.compare_exchange_strong(generation, first, std::memory_order_relaxed))
+            generation = first;
+    }
+
+    return generation;
+}
+
+// Private. A variable in this tree was renamed or moved, so the FQNs and
+// name indexes built in it must be rebuilt. Every new generation is unique.
+void BaseType::m_path_changed() {
+    BaseType *root = this;
+    while (root->d_parent)
+        root = root->d_parent;
+    root->d_path_generation.store(path_generations.fetch_add(1, std::memory_order_relaxed) + 1,
+                                  std::memory_order_relaxed);
+}
+
 /**
  * Return the FQN for this variable. This will include the D4 Group
  * component of the name.
@@ -304,18 +360,43 @@ string BaseType::name() const { return d_name; }
  * @return The FQN in a string
  */
 string BaseType::FQN() const {
-    if (get_parent() == 0)
-        return name();
-    else if (get_parent()->type() == dods_group_c)
-        return get_parent()->FQN() + name();
-    else
-        return get_parent()->FQN() + "." + name();
+    return m_cached_fqn([this]() {
+        if (get_parent() == 0)
+            return name();
+        else if (get_parent()->type() == dods_group_c)
+            return get_parent()->FQN() + name();
+        else
+            return get_parent()->FQN() + "." + name();
+    });
+}
+
+/**
+ * The FQN of this variable, built by build the first time it is used and
+ * kept until this variable or one of its parents is renamed or moved. The
+ * FQN() methods use this; threads that only read a DMR may call it at the
+ * same time.
+ *
+ * @param build Builds the FQN
+ * @return The FQN
+ */
+string BaseType::m_cached_fqn(const std::function<string()> &build) const {
+    uint64_t generation = m_path_generation();
+    shared_ptr<const FQNCache> cache = atomic_load(&d_fqn);
+    if (cache && cache->generation == generation)
+        return cache->fqn;
+
+    cache = make_shared<FQNCache>(FQNCache{generation, build()});
+    atomic_store(&d_fqn, cache);
+    return cache->fqn;
 }
 
 /** @brief Sets the name of the class instance. */
 void BaseType::set_name(const string &n) {
-    string name = n;
-    d_name = www2id(name); // www2id writes into its param.
+    string name = www2id(n);
+    if (d_name != name) {
+        d_name = name;
+        m_path_changed();
+    }
 }
 
 /** @brief Returns the name of the dataset used to create this instance
@@ -409,7 +490,10 @@ void BaseType::set_synthesized_p(bool state) { d_is_synthesized = state; }
 
     @brief Has this variable been read?
     @return True if the variable's value(s) have been read, false otherwise. */
-bool BaseType::read_p() { return d_is_read; }
+bool BaseType::read_p() {
+    const RequestState *state = m_request_state();
+    return state ? state->is_read : d_is_read;
+}
 
 /** Sets the value of the <tt>read_p</tt> property. This indicates that the
     value(s) of this variable has/have been read. An implementation of the
@@ -460,7 +544,10 @@ void BaseType::set_read_p(bool state) {
 
 #if 1
     if (!d_is_synthesized) {
-        d_is_read = state;
+        if (RequestState *request = m_changed_request_state())
+            request->is_read = state;
+        else
+            d_is_read = state;
     }
 #else
     d_is_read = state;
@@ -477,7 +564,10 @@ void BaseType::set_read_p(bool state) {
     @brief Should this variable be sent?
     @return True if the variable should be sent to the client, false
     otherwise. */
-bool BaseType::send_p() { return d_is_send; }
+bool BaseType::send_p() {
+    const RequestState *state = m_request_state();
+    return state ? state->is_send : d_is_send;
+}
 
 /** Sets the value of the <tt>send_p</tt> flag.  This
     function is meant to be called from within the constraint evaluator of
@@ -489,19 +579,34 @@ bool BaseType::send_p() { return d_is_send; }
  */
 void BaseType::set_send_p(bool state) {
     DBG2(cerr << "Calling BaseType::set_send_p() for: " << this->name() << endl);
-    d_is_send = state;
+    if (RequestState *request = m_changed_request_state())
+        request->is_send = state;
+    else
+        d_is_send = state;
 }
 
 /** Get this variable's AttrTable. It's generally a bad idea to return a
     reference to a contained object, but in this case it seems that building
     an interface inside BaseType is overkill.
 
-    Use the AttrTable methods to manipulate the table. */
-AttrTable &BaseType::get_attr_table() { return d_attr; }
+    Use the AttrTable methods to manipulate the table.
+
+    @note The table is made the first time this is called; use
+    has_attr_table() to test for attributes without making one. */
+AttrTable &BaseType::get_attr_table() {
+    if (!d_attr)
+        d_attr = new AttrTable;
+    return *d_attr;
+}
 
 /** Set this variable's attribute table.
     @param at Source of the attributes. */
-void BaseType::set_attr_table(const AttrTable &at) { d_attr = at; }
+void BaseType::set_attr_table(const AttrTable &at) {
+    if (d_attr)
+        *d_attr = at;
+    else
+        d_attr = new AttrTable(at);
+}
 
 /** DAP4 Attribute methods
  * @{
@@ -599,7 +704,10 @@ void BaseType::transfer_attributes(AttrTable *at_container) {
     See the grid (func_grid_select()) for an example.
     @see BaseType::read()
     @brief Is this variable part of the current selection? */
-bool BaseType::is_in_selection() { return d_in_selection; }
+bool BaseType::is_in_selection() {
+    const RequestState *state = m_request_state();
+    return state ? state->in_selection : d_in_selection;
+}
 
 /** Set the \e in_selection property to \e state. This property indicates
     that the variable is used as a parameter to a constraint expression
@@ -610,7 +718,30 @@ bool BaseType::is_in_selection() { return d_in_selection; }
     @param state Set the \e in_selection property to this state.
     @see BaseType::read()
     @see BaseType::is_in_selection() for more information. */
-void BaseType::set_in_selection(bool state) { d_in_selection = state; }
+void BaseType::set_in_selection(bool state) {
+    if (RequestState *request = m_changed_request_state())
+        request->in_selection = state;
+    else
+        d_in_selection = state;
+}
+
+/// The state held for this variable by the current D4RequestContext, or null.
+const BaseType::RequestState *BaseType::m_request_state() const {
+    D4RequestContext *context = D4RequestContext::current();
+    return context ? context->find<RequestState>(this, d_request_serial) : nullptr;
+}
+
+/**
+ * The state held for this variable by the current D4RequestContext, to be
+ * changed. The variable's own state is copied to the context first, if
+ * needed. Returns null if there is no context.
+ */
+BaseType::RequestState *BaseType::m_changed_request_state() {
+    D4RequestContext *context = D4RequestContext::current();
+    if (!context)
+        return nullptr;
+    return &context->get(this, d_request_serial, RequestState{d_is_read, d_is_send, d_in_selection});
+}
 
 // Protected method.
 /** Set the <tt>parent</tt> property for this variable.
@@ -625,7 +756,18 @@ void BaseType::set_parent(BaseType *parent) {
     if (!dynamic_cast<Constructor *>(parent) && !dynamic_cast<Vector *>(parent) && parent != 0)
         throw InternalErr("Call to set_parent with incorrect variable type.");
 
-    d_parent = parent;
+    if (d_parent != parent) {
+        // The variables this one holds have FQNs and indexes built for the
+        // tree it leaves, or for the generation it has as a tree of its own.
+        // A variable that holds none only needs its own FQN dropped, so
+        // adding one to a tree leaves the tree's indexes alone.
+        if (d_parent && (is_constructor_type() || is_vector_type()))
+            m_path_changed();
+        d_parent = parent;
+        if (!d_parent)
+            m_path_changed(); // Not a generation it had before
+        atomic_store(&d_fqn, shared_ptr<const FQNCache>());
+    }
 }
 
 // Public method.
@@ -1014,11 +1156,11 @@ void BaseType::print_xml_writer(XMLWriter &xml, bool constrained) {
         if (xmlTextWriterWriteAttribute(xml.get_writer(), (const xmlChar *)"name", (const xmlChar *)name().c_str()) < 0)
             throw InternalErr(__FILE__, __LINE__, "Could not write attribute for name");
 
-    if (is_dap4())
+    if (is_dap4() && has_attributes())
         attributes()->print_dap4(xml);
 
-    if (!is_dap4() && get_attr_table().get_size() > 0)
-        get_attr_table().print_xml_writer(xml);
+    if (!is_dap4() && d_attr && d_attr->get_size() > 0)
+        d_attr->print_xml_writer(xml);
 
     if (xmlTextWriterEndElement(xml.get_writer()) < 0)
         throw InternalErr(__FILE__, __LINE__, "Could not end " + type_name() + " element");
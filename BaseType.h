@@ -42,7 +42,11 @@
 #ifndef _basetype_h
 #define _basetype_h 1
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <stack>
 #include <string>
 #include <vector>
@@ -50,8 +54,10 @@
 #include "AttrTable.h"
 #include "D4AttributeType.h"
 #include "D4Attributes.h"
+#include "D4RequestContext.h"
 
 #include "InternalErr.h"
+#include "StringPool.h"
 
 #include "Type.h"
 #include "dods-datatypes.h"
@@ -117,12 +123,10 @@ class D4Attributes;
 
 class BaseType : public DapObj {
 private:
-    string d_name;    // name of the instance
-    Type d_type;      // instance's type
-    string d_dataset; // name of the dataset used to create this BaseType
-
-    bool d_is_read; // true if the value has been read
-    bool d_is_send; // Is the variable in the projection?
+    // The fields are ordered to keep BaseType small; there can be millions
+    // of them (e.g., the rows of a Sequence).
+    InternedString d_name;    // name of the instance
+    InternedString d_dataset; // name of the dataset used to create this BaseType
 
     // d_parent points to the Constructor or Vector which holds a particular
     // variable. It is null for simple variables. The Vector and Constructor
@@ -130,21 +134,60 @@ private:
     BaseType *d_parent;
 
     // Attributes for this variable. Added 05/20/03 jhrg
-    AttrTable d_attr;
+    // DAP2 attributes; made by get_attr_table() the first time it is called.
+    AttrTable *d_attr = nullptr;
 
     D4Attributes *d_attributes;
 
-    bool d_is_dap4; // True if this is a DAP4 variable, false ... DAP2
+    Type d_type; // instance's type
+
+    // Identifies this variable's state in a D4RequestContext
+    D4RequestContext::Serial d_request_serial;
 
-    // These are non-empty only for DAP4 variables. Added 9/27/12 jhrg
+    bool d_is_read; // true if the value has been read
+    bool d_is_send; // Is the variable in the projection?
+
+    bool d_is_dap4; // True if this is a DAP4 variable, false ... DAP2
 
     // These were/are used for DAP2 CEs, but not for DAP4 ones
     bool d_in_selection;   // Is the variable in the selection?
     bool d_is_synthesized; // true if the variable is synthesized
 
+    // The read_p, send_p and in_selection properties held in a
+    // D4RequestContext.
+    struct RequestState {
+        bool is_read;
+        bool is_send;
+        bool in_selection;
+    };
+
+    const RequestState *m_request_state() const;
+    RequestState *m_changed_request_state();
+
+    // The FQN and the path generation of the tree it was built in; see FQN()
+    struct FQNCache {
+        uint64_t generation;
+        std::string fqn;
+    };
+    mutable std::shared_ptr<const FQNCache> d_fqn;
+
+    // Changed when a variable in the tree is renamed or moved. Only the
+    // value held by the root of a tree is used; 0 until it is first used.
+    mutable std::atomic<uint64_t> d_path_generation{0};
+
+    void m_path_changed();
+
 protected:
     void m_duplicate(const BaseType &bt);
 
+    // Changes when a variable in the tree this one is in is renamed or moved
+    uint64_t m_path_generation() const;
+
+    /// The serial number of this variable's state in a D4RequestContext
+    const D4RequestContext::Serial &m_request_serial() const { return d_request_serial; }
+
+    std::string m_cached_fqn(const std::function<std::string()> &build) const;
+
 public:
     /** @brief Stack type used to record traversal paths through constructor variables. */
     typedef stack<BaseType *> btp_stack;
@@ -270,12 +313,16 @@ public:
     virtual void set_send_p(bool state);
 
     virtual AttrTable &get_attr_table();
+    /// @brief True if this variable has an AttrTable; get_attr_table() makes one if not.
+    bool has_attr_table() const { return d_attr != nullptr; }
     virtual void set_attr_table(const AttrTable &at);
 
     // DAP4 attributes
     virtual D4Attributes *attributes();
     virtual void set_attributes(D4Attributes *);
     virtual void set_attributes_nocopy(D4Attributes *);
+    /// @brief True if this variable has a D4Attributes object; attributes() makes one if not.
+    bool has_attributes() const { return d_attributes != nullptr; }
 
     virtual bool is_in_selection();
     virtual void set_in_selection(bool state);
@@ -66,7 +66,9 @@ void Constructor::m_duplicate(const Constructor &c) {
     // Clear out any spurious vars in Constructor::d_vars
     // Moved from Grid::m_duplicate. jhrg 4/3/13
     d_vars.clear(); // [mjohnson 10 Sep 2009]
+    m_vars_changed();
 
+    d_vars.reserve(c.d_vars.size());
     for (auto var : c.d_vars) {
         BaseType *btp = var->ptr_duplicate();
         btp->set_parent(this);
@@ -91,19 +93,22 @@ void Constructor::transform_to_dap4(D4Group *root, Constructor *dest) {
             (*i)->transform_to_dap4(root /*group*/, dest /*container*/);
         }
     }
-    dest->attributes()->transform_to_dap4(get_attr_table());
+    if (has_attr_table())
+        dest->attributes()->transform_to_dap4(get_attr_table());
     dest->set_is_dap4(true);
 }
 
 string Constructor::FQN() const {
-    if (get_parent() == 0)
-        return name();
-    else if (get_parent()->type() == dods_group_c)
-        return get_parent()->FQN() + name();
-    else if (get_parent()->type() == dods_array_c)
-        return get_parent()->FQN();
-    else
-        return get_parent()->FQN() + "." + name();
+    return m_cached_fqn([this]() {
+        if (get_parent() == 0)
+            return name();
+        else if (get_parent()->type() == dods_group_c)
+            return get_parent()->FQN() + name();
+        else if (get_parent()->type() == dods_array_c)
+            return get_parent()->FQN();
+        else
+            return get_parent()->FQN() + "." + name();
+    });
 }
 
 int Constructor::element_count(bool leaves) {
@@ -212,13 +217,11 @@ BaseType *Constructor::var(const string &n, btp_stack &s) {
 
 // Protected method
 BaseType *Constructor::m_leaf_match(const string &name, btp_stack *s) {
-    for (auto var : d_vars) {
-        if (var->name() == name) {
-            if (s) {
-                s->push(static_cast<BaseType *>(this));
-            }
-            return var;
-        }
+    // A match in a Constructor that comes before the first variable with
+    // the name wins, so only those need to be searched.
+    size_t match = NameIndex<BaseType>::find(d_name_index, d_vars, name.data(), name.size(), m_path_generation());
+    for (size_t i = 0; i < match; ++i) {
+        BaseType *var = d_vars[i];
         if (var->is_constructor_type()) {
             BaseType *btp = var->var(name, false, s);
             if (btp) {
@@ -230,29 +233,34 @@ BaseType *Constructor::m_leaf_match(const string &name, btp_stack *s) {
         }
     }
 
+    if (match < d_vars.size()) {
+        if (s) {
+            s->push(static_cast<BaseType *>(this));
+        }
+        return d_vars[match];
+    }
+
     return nullptr;
 }
 
 // Protected method
 BaseType *Constructor::m_exact_match(const string &name, btp_stack *s) {
     // Look for name at the top level first.
-    for (auto var : d_vars) {
-        if (var->name() == name) {
-            if (s)
-                s->push(static_cast<BaseType *>(this));
+    BaseType *btp = find_child(name);
+    if (btp) {
+        if (s)
+            s->push(static_cast<BaseType *>(this));
 
-            return var;
-        }
+        return btp;
     }
 
     // If it was not found using the simple search, look for a dot and
     // search the hierarchy.
     string::size_type dot_pos = name.find("."); // zero-based index of `.'
     if (dot_pos != string::npos) {
-        string aggregate = name.substr(0, dot_pos);
         string field = name.substr(dot_pos + 1);
 
-        BaseType *agg_ptr = var(aggregate);
+        BaseType *agg_ptr = find_child(name.data(), dot_pos);
         if (agg_ptr) {
             if (s)
                 s->push(static_cast<BaseType *>(this));
@@ -265,6 +273,21 @@ BaseType *Constructor::m_exact_match(const string &name, btp_stack *s) {
     return nullptr;
 }
 
+/**
+ * @brief Find a variable of this Constructor (not its descendants) by name
+ *
+ * Large Constructors keep an index of their variables' names so this does
+ * not have to compare every name; see NameIndex.
+ *
+ * @param name The name, not encoded; need not be null terminated
+ * @param length The length of name
+ * @return The first variable with that name, or null
+ */
+BaseType *Constructor::find_child(const char *name, size_t length) {
+    size_t i = NameIndex<BaseType>::find(d_name_index, d_vars, name, length, m_path_generation());
+    return i < d_vars.size() ? d_vars[i] : nullptr;
+}
+
 /** Returns an iterator referencing the first structure element. */
 Constructor::Vars_iter Constructor::var_begin() { return d_vars.begin(); }
 
@@ -313,6 +336,7 @@ void Constructor::set_var_index(BaseType *bt, int i) {
         set_is_dap4(true);
 
     d_vars[i] = bt;
+    m_vars_changed();
 }
 
 /** Adds an element to a Constructor.
@@ -343,6 +367,7 @@ void Constructor::add_var_nocopy(BaseType *bt, Part) {
 
     bt->set_parent(this);
     d_vars.push_back(bt);
+    NameIndex<BaseType>::appended(d_name_index, d_vars, m_path_generation());
 
     // Update the is_dap4 property
     if (bt->is_dap4())
@@ -360,6 +385,7 @@ void Constructor::del_var(const string &n) {
     auto to_remove = stable_partition(d_vars.begin(), d_vars.end(), [n](BaseType *btp) { return btp->name() != n; });
     for_each(to_remove, d_vars.end(), [](BaseType *btp) { delete btp; });
     d_vars.erase(to_remove, d_vars.end());
+    m_vars_changed();
 }
 
 /**
@@ -370,6 +396,7 @@ void Constructor::del_var(const string &n) {
 void Constructor::del_var(Vars_iter i) {
     delete *i;
     d_vars.erase(i);
+    m_vars_changed();
 }
 
 /**
@@ -590,14 +617,14 @@ void Constructor::print_xml_writer(XMLWriter &xml, bool constrained) {
 
     // DAP2 prints attributes first. For some reason we decided that DAP4 should
     // print them second. No idea why... jhrg 8/15/14
-    if (!is_dap4() && get_attr_table().get_size() > 0)
+    if (!is_dap4() && has_attr_table() && get_attr_table().get_size() > 0)
         get_attr_table().print_xml_writer(xml);
 
     if (!d_vars.empty())
         for_each(d_vars.begin(), d_vars.end(),
                  [&xml, constrained](BaseType *btp) { btp->print_xml_writer(xml, constrained); });
 
-    if (is_dap4())
+    if (is_dap4() && has_attributes())
         attributes()->print_dap4(xml);
 
     if (xmlTextWriterEndElement(xml.get_writer()) < 0)
@@ -619,7 +646,8 @@ void Constructor::print_dap4(XMLWriter &xml, bool constrained) {
         for_each(d_vars.begin(), d_vars.end(),
                  [&xml, constrained](BaseType *btp) { btp->print_dap4(xml, constrained); });
 
-    attributes()->print_dap4(xml);
+    if (has_attributes())
+        attributes()->print_dap4(xml);
 
     if (xmlTextWriterEndElement(xml.get_writer()) < 0)
         throw InternalErr(__FILE__, __LINE__, "Could not end " + type_name() + " element");
@@ -690,7 +718,7 @@ AttrTable *Constructor::make_dropped_vars_attr_table(vector<BaseType *> *dropped
         for (; dvIter != dvEnd; dvIter++, i++) {
             BaseType *bt = (*dvIter);
 
-            AttrTable *bt_attr_table = new AttrTable(bt->get_attr_table());
+            AttrTable *bt_attr_table = bt->has_attr_table() ? new AttrTable(bt->get_attr_table()) : new AttrTable;
             bt_attr_table->set_name(bt->name());
             string type_name = bt->type_name();
 
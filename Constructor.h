@@ -29,6 +29,7 @@
 #include <vector>
 
 #include "BaseType.h"
+#include "NameIndex.h"
 
 class Crc32;
 
@@ -43,6 +44,9 @@ class Constructor : public BaseType {
 private:
     void m_duplicate(const Constructor &s);
 
+    // Index of d_vars by name, built by find_child() for large constructors
+    std::shared_ptr<NameIndex<BaseType>> d_name_index;
+
 protected:
     /** @brief Child variables owned by this constructor instance. */
     std::vector<BaseType *> d_vars;
@@ -62,6 +66,9 @@ protected:
      */
     BaseType *m_exact_match(const string &name, btp_stack *s = nullptr);
 
+    /// @brief Drop the index of d_vars; call after changing d_vars directly.
+    void m_vars_changed() { d_name_index.reset(); }
+
     /**
      * @brief Constructs a constructor type with name and explicit type.
      * @param name Variable name.
@@ -132,6 +139,14 @@ public:
     /// @deprecated
     BaseType *var(const string &n, btp_stack &s) override;
 
+    BaseType *find_child(const char *name, size_t length);
+    /**
+     * @brief Find a variable of this Constructor (not its descendants) by name
+     * @param name The name, not encoded
+     * @return The first variable with that name, or null
+     */
+    BaseType *find_child(const string &name) { return find_child(name.data(), name.size()); }
+
     Vars_iter var_begin();
     Vars_iter var_end();
     Vars_riter var_rbegin();
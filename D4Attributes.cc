@@ -25,6 +25,7 @@
 #include "config.h"
 
 #include <algorithm>
+#include <cstring>
 
 #include "D4AttributeType.h"
 #include "D4Attributes.h"
@@ -163,7 +164,10 @@ D4Attribute::~D4Attribute() { delete d_attributes; }
 D4Attribute &D4Attribute::operator=(const D4Attribute &rhs) {
     if (this == &rhs)
         return *this;
+    bool renamed = d_name != rhs.d_name;
     m_duplicate(rhs);
+    if (renamed)
+        m_renamed();
     return *this;
 }
 
@@ -425,61 +429,134 @@ AttrTable *D4Attributes::get_AttrTable(const string name)
 }
 #endif
 
-D4Attribute *D4Attributes::find_depth_first(const string &name, D4AttributesIter i) {
-    if (i == attribute_end())
-        return 0;
-    else if ((*i)->name() == name)
-        return *i;
-    else if ((*i)->type() == attr_container_c) {
-        // We cannot just pass (*i)->attributes()->attribute_begin() to the second parameter of
-        // the find_depth_first().
-        // (*i)->attributes() creates a new D4Attributes object if d_attributes is nullptr(see the method attributes()).
-        // This new D4Attributes object doesn't contain any D4Attribute. When the attribute_begin() of this new
-        // D4Attributes passes to find_depth_first, it will compare with the original D4Attributes object's
-        // attribute_end(). If it doesn't match and there is no attribute in this container, it will call (*i)->name()
-        // and cause segmentation fault. We need to obtain the instance of (*i)->attributes() and use this instance to
-        // call find_depth_first. KY 2026-06-03
-        auto container_d4_attrs = (*i)->attributes();
-
-        return container_d4_attrs->find_depth_first(name, container_d4_attrs->attribute_begin());
-    } else
-        return find_depth_first(name, ++i);
+void D4Attributes::m_duplicate(const D4Attributes &src) {
+    if (!src.d_storage)
+        return;
+
+    if (src.frozen() && empty()) {
+        d_storage = src.d_storage;
+        return;
+    }
+
+    m_attrs();
+    for (const auto attr : src.d_storage->attrs)
+        m_adopt(*d_storage, new D4Attribute(*attr)); // deep copy
+}
+
+/**
+ * The attributes, for changing. If they are shared with copies of this
+ * object, they are copied first.
+ */
+vector<D4Attribute *> &D4Attributes::m_attrs() {
+    if (!d_storage) {
+        d_storage = make_shared<Storage>();
+    } else if (d_storage->frozen) {
+        if (d_storage.use_count() == 1) {
+            d_storage->frozen = false;
+        } else {
+            auto storage = make_shared<Storage>();
+            for (const auto attr : d_storage->attrs)
+                m_adopt(*storage, new D4Attribute(*attr));
+            d_storage = storage;
+        }
+    }
+
+    return d_storage->attrs;
+}
+
+void D4Attributes::m_add(D4Attribute *attr) {
+    m_attrs();
+    m_adopt(*d_storage, attr);
+    NameIndex<D4Attribute>::appended(d_storage->index, d_storage->attrs);
+}
+
+// Private. Add an attribute to the end of storage, which then owns it.
+void D4Attributes::m_adopt(Storage &storage, D4Attribute *attr) {
+    storage.attrs.push_back(attr);
+    attr->d_container_index = &storage.index;
+}
+
+const vector<D4Attribute *> &D4Attributes::attributes() const {
+    static const vector<D4Attribute *> no_attributes;
+    return d_storage ? d_storage->attrs : no_attributes;
+}
+
+/**
+ * @brief Share these attributes with copies of this object
+ *
+ * Copies of a frozen D4Attributes (including those made when a variable or
+ * a DMR is copied) share its attributes instead of copying them. The first
+ * call to a method that can change the attributes of a copy (including
+ * attribute_begin(), find() and get(), which return pointers that can be
+ * used to change them) makes a private copy for it. The same goes for the
+ * frozen object itself, so that its attributes stay the same while they are
+ * shared. Nested attribute containers are frozen too.
+ *
+ * Shared attributes may be read by several threads at once.
+ *
+ * @see DMR::freeze()
+ */
+void D4Attributes::freeze() {
+    if (!d_storage || d_storage->frozen)
+        return;
+
+    for (auto attr : d_storage->attrs) {
+        // attributes() makes the container for an empty container attribute;
+        // do that now, not while the attribute is shared.
+        if (attr->type() == attr_container_c)
+            attr->attributes()->freeze();
+    }
+
+    d_storage->frozen = true;
 }
 
-D4Attribute *D4Attributes::find(const string &name) { return find_depth_first(name, attribute_begin()); }
+/**
+ * @brief Finds an attribute by name, looking in containers too
+ *
+ * The first attribute that either has the name or is a container decides
+ * the result: it is returned, or the search continues in the container and
+ * ends there.
+ *
+ * @param name Attribute name.
+ * @return Matching attribute or null.
+ */
+D4Attribute *D4Attributes::find(const string &name) {
+    vector<D4Attribute *> &attrs = m_attrs();
+    size_t match = NameIndex<D4Attribute>::find(d_storage->index, attrs, name.data(), name.size());
+    for (size_t i = 0; i < match; ++i) {
+        if (attrs[i]->type() == attr_container_c)
+            return attrs[i]->attributes()->find(name);
+    }
+
+    return match < attrs.size() ? attrs[match] : nullptr;
+}
 
 /** Return a pointer to the D4Attribute object that has the given FQN.
  * @note A FQN for an attribute is a series of names separated by dots.
  */
-D4Attribute *D4Attributes::get(const string &fqn) {
+D4Attribute *D4Attributes::get(const string &fqn) { return m_get(fqn.data(), fqn.size()); }
+
+// Private. Looks up each part of the FQN without copying it.
+D4Attribute *D4Attributes::m_get(const char *fqn, size_t length) {
     // name1.name2.name3
     // name1
     // name1.name2
-    size_t pos = fqn.find('.');
-    string part = fqn.substr(0, pos);
-    string rest = "";
+    auto dot = static_cast<const char *>(memchr(fqn, '.', length));
+    size_t part = dot ? dot - fqn : length;
+    size_t rest = dot ? length - part - 1 : 0;
 
-    if (pos != string::npos)
-        rest = fqn.substr(pos + 1);
+    if (part == 0)
+        return 0;
 
-    DBG(cerr << "part: '" << part << "'; rest: '" << rest << "'" << endl);
+    vector<D4Attribute *> &attrs = m_attrs();
+    size_t i = NameIndex<D4Attribute>::find(d_storage->index, attrs, fqn, part);
+    if (rest == 0)
+        return i < attrs.size() ? attrs[i] : 0;
 
-    if (!part.empty()) {
-        if (!rest.empty()) {
-            D4AttributesIter i = attribute_begin();
-            while (i != attribute_end()) {
-                if ((*i)->name() == part && (*i)->type() == attr_container_c)
-                    return (*i)->attributes()->get(rest);
-                ++i;
-            }
-        } else {
-            D4AttributesIter i = attribute_begin();
-            while (i != attribute_end()) {
-                if ((*i)->name() == part)
-                    return (*i);
-                ++i;
-            }
-        }
+    // The first container with the name; usually the first attribute with it
+    for (; i < attrs.size(); ++i) {
+        if (attrs[i]->type() == attr_container_c && attrs[i]->name().compare(0, string::npos, fqn, part) == 0)
+            return attrs[i]->attributes()->m_get(dot + 1, rest);
     }
 
     return 0;
@@ -494,13 +571,15 @@ D4Attribute *D4Attributes::get(const string &fqn) {
  * searches for a fully qualified attribute name and erases it.
  */
 void D4Attributes::erase_named_attribute(const string &name) {
-    for (auto &attr : d_attrs) {
+    vector<D4Attribute *> &attrs = m_attrs();
+    for (auto &attr : attrs) {
         if (attr->name() == name) {
             delete attr;
             attr = nullptr;
         }
     }
-    d_attrs.erase(remove(d_attrs.begin(), d_attrs.end(), nullptr), d_attrs.end());
+    attrs.erase(remove(attrs.begin(), attrs.end(), nullptr), attrs.end());
+    d_storage->index.reset();
 }
 
 /**
@@ -522,7 +601,7 @@ void D4Attributes::erase(const string &fqn) {
         if (!rest.empty()) {
             // in this case, we are not looking for a leaf node, so descend the
             // attribute container hierarchy.
-            for (auto &a : d_attrs) {
+            for (auto &a : m_attrs()) {
                 if (a->name() == part && a->type() == attr_container_c) {
                     a->attributes()->erase(rest);
                 }
@@ -628,10 +707,8 @@ void D4Attributes::print_dap4(XMLWriter &xml) const {
     if (empty())
         return;
 
-    D4AttributesCIter i = d_attrs.begin();
-    while (i != d_attrs.end()) {
-        (*i++)->print_dap4(xml);
-    }
+    for (const auto attr : attributes())
+        attr->print_dap4(xml);
 }
 
 /**
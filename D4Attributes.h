@@ -26,11 +26,14 @@
 #ifndef _d4attributes_h
 #define _d4attributes_h 1
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "D4AttributeType.h"
 #include "DapObj.h"
+#include "NameIndex.h"
+#include "StringPool.h"
 #include "XMLWriter.h"
 
 using namespace std;
@@ -42,7 +45,7 @@ class D4Attributes;
 
 /** @brief Represents one DAP4 attribute value or container node. */
 class D4Attribute : public DapObj {
-    string d_name;
+    InternedString d_name;
     D4AttributeType d_type; // Attributes are limited to the simple types
     bool is_utf8_str = false;
 
@@ -55,6 +58,17 @@ class D4Attribute : public DapObj {
     // XML, otherwise, the strings hold attributes of type d_type.
     vector<string> d_values;
 
+    // The name index of the D4Attributes that holds this attribute, dropped
+    // when this is renamed. Set by that D4Attributes; not copied.
+    std::shared_ptr<NameIndex<D4Attribute>> *d_container_index = nullptr;
+
+    void m_renamed() {
+        if (d_container_index)
+            std::atomic_store(d_container_index, std::shared_ptr<NameIndex<D4Attribute>>());
+    }
+
+    friend class D4Attributes;
+
     // perform a deep copy
     void m_duplicate(const D4Attribute &src);
 
@@ -94,7 +108,12 @@ public:
      * @brief Sets the attribute name.
      * @param name Attribute name.
      */
-    void set_name(const string &name) { d_name = name; }
+    void set_name(const string &name) {
+        if (d_name != name) {
+            d_name = name;
+            m_renamed();
+        }
+    }
 
     /** @brief Returns the attribute type. */
     D4AttributeType type() const { return d_type; }
@@ -167,32 +186,42 @@ public:
     typedef vector<D4Attribute *>::const_iterator D4AttributesCIter;
 
 private:
-    vector<D4Attribute *> d_attrs;
-
-    void m_duplicate(const D4Attributes &src) {
-        D4AttributesCIter i = src.d_attrs.begin();
-        while (i != src.d_attrs.end()) {
-            d_attrs.push_back(new D4Attribute(**i++)); // deep copy
+    // The attributes. Copies of a frozen D4Attributes share them until one
+    // of the copies is changed; see freeze().
+    struct Storage {
+        vector<D4Attribute *> attrs;
+        bool frozen = false;
+        std::shared_ptr<NameIndex<D4Attribute>> index; // built by find() and get() when there are many attrs
+
+        Storage() = default;
+        Storage(const Storage &) = delete;
+        Storage &operator=(const Storage &) = delete;
+        ~Storage() {
+            for (auto attr : attrs)
+                delete attr;
         }
-    }
+    };
+
+    std::shared_ptr<Storage> d_storage; // null when there are no attributes
+
+    void m_duplicate(const D4Attributes &src);
+    vector<D4Attribute *> &m_attrs();
+    void m_add(D4Attribute *attr);
+    static void m_adopt(Storage &storage, D4Attribute *attr);
 
-    D4Attribute *find_depth_first(const string &name, D4AttributesIter i);
+    D4Attribute *m_get(const char *fqn, size_t length);
 
 public:
     D4Attributes() {}
 
     /**
      * @brief Copy-constructs an attribute collection.
+     * If \e rhs is frozen, the copy shares its attributes.
      * @param rhs Source collection.
      */
     D4Attributes(const D4Attributes &rhs) { m_duplicate(rhs); }
 
-    ~D4Attributes() override {
-        D4AttributesIter i = d_attrs.begin();
-        while (i != d_attrs.end()) {
-            delete *i++;
-        }
-    }
+    ~D4Attributes() override = default;
 
     /**
      * @brief Assigns this collection from another collection.
@@ -206,29 +235,33 @@ public:
         return *this;
     }
 
+    void freeze();
+    /// @brief True if copies of this object share its attributes. @see freeze()
+    bool frozen() const { return d_storage && d_storage->frozen; }
+
     void transform_to_dap4(AttrTable &at);
     void transform_attrs_to_dap2(AttrTable *d2_attr_table);
 
     /** @brief Returns true when this collection has no attributes. */
-    bool empty() const { return d_attrs.empty(); }
+    bool empty() const { return !d_storage || d_storage->attrs.empty(); }
 
     /**
      * @brief Appends a deep copy of an attribute.
      * @param attr Source attribute.
      */
-    void add_attribute(D4Attribute *attr) { d_attrs.push_back(new D4Attribute(*attr)); }
+    void add_attribute(D4Attribute *attr) { m_add(new D4Attribute(*attr)); }
 
     /**
      * @brief Appends an attribute pointer without copying.
      * @param attr Attribute pointer to store.
      */
-    void add_attribute_nocopy(D4Attribute *attr) { d_attrs.push_back(attr); }
+    void add_attribute_nocopy(D4Attribute *attr) { m_add(attr); }
 
     /// Get an iterator to the start of the enumerations
-    D4AttributesIter attribute_begin() { return d_attrs.begin(); }
+    D4AttributesIter attribute_begin() { return m_attrs().begin(); }
 
     /// Get an iterator to the end of the enumerations
-    D4AttributesIter attribute_end() { return d_attrs.end(); }
+    D4AttributesIter attribute_end() { return m_attrs().end(); }
 
     /**
      * @brief Finds an attribute by name.
@@ -243,9 +276,12 @@ public:
     /**
      * Get a const reference to the vector of D$attribute pointers.
      * @note Use this in range-based for loops to iterate over the variables.
+     * The attributes may be shared with copies of this object, so do not
+     * change them through these pointers; use attribute_begin(), find() or
+     * get() for that.
      * @return A const reference to the vector of D4Attribute pointers.
      */
-    const vector<D4Attribute *> &attributes() const { return d_attrs; }
+    const vector<D4Attribute *> &attributes() const;
 
     bool has_dap4_types(const std::string &path, std::vector<std::string> &inventory) const;
 
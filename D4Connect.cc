@@ -245,6 +245,7 @@ D4Connect::D4Connect(const string &url, string uname, string password)
         DBG(cerr << "Connect: The identifier is an http URL" << endl);
         d_http = new HTTPConnect(RCReader::instance());
         d_http->set_use_cpp_streams(true);
+        d_http->set_accept_chunk_compression(true);
 
         d_URL = name;
 
@@ -486,6 +487,16 @@ void D4Connect::set_accept_deflate(bool deflate) {
         d_http->set_accept_deflate(deflate);
 }
 
+/** Set the \e accept chunk compression property. The chunked_istream used
+ to read DAP4 data responses inflates compressed chunks, so this is on by
+ default.
+ @param compression True if the client should tell servers it can read
+ compressed chunks, False otherwise. */
+void D4Connect::set_accept_chunk_compression(bool compression) {
+    if (d_http)
+        d_http->set_accept_chunk_compression(compression);
+}
+
 /** Set the \e XDAP-Accept property/header. This is used to send to a server
  the (highest) DAP protocol version number that this client understands.
 
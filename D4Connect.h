@@ -79,6 +79,7 @@ public:
 
     void set_credentials(std::string u, std::string p);
     void set_accept_deflate(bool deflate);
+    void set_accept_chunk_compression(bool compression);
     void set_xdap_protocol(int major, int minor);
 
     void set_cache_enabled(bool enabled);
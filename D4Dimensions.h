@@ -28,6 +28,9 @@
 #include <string>
 #include <vector>
 
+#include "D4RequestContext.h"
+#include "DapArena.h"
+
 using namespace std;
 
 namespace libdap {
@@ -48,11 +51,37 @@ class D4Dimension {
 
     bool d_used_by_projected_var;
 
+    // Identifies this dimension's slice in a D4RequestContext
+    D4RequestContext::Serial d_request_serial;
+
+    // The slice held in a D4RequestContext
+    struct RequestSlice {
+        bool constrained;
+        int64_t c_start, c_stride, c_stop;
+        bool used_by_projected_var;
+    };
+
+    const RequestSlice *m_request_slice() const {
+        D4RequestContext *context = D4RequestContext::current();
+        return context ? context->find<RequestSlice>(this, d_request_serial) : nullptr;
+    }
+
+    RequestSlice &m_changed_request_slice(D4RequestContext *context) {
+        return context->get(this, d_request_serial,
+                            RequestSlice{d_constrained, d_c_start, d_c_stride, d_c_stop, d_used_by_projected_var});
+    }
+
 public:
     D4Dimension()
         : d_name(""), d_size(0), d_parent(0), d_constrained(false), d_c_start(0), d_c_stride(0), d_c_stop(0),
           d_used_by_projected_var(false) {}
 
+    // Allocated in the current DapArena, if there is one; see DapObj.
+    static void *operator new(size_t size) { return DapArena::allocate_object(size); }
+    static void *operator new(size_t, void *place) noexcept { return place; }
+    static void operator delete(void *ptr) noexcept { DapArena::free_object(ptr); }
+    static void operator delete(void *, void *) noexcept {}
+
     /**
      * @brief Builds a named shared dimension.
      * @param name Dimension name.
@@ -63,6 +92,11 @@ public:
         : d_name(name), d_size(size), d_parent(d), d_constrained(false), d_c_start(0), d_c_stride(0), d_c_stop(0),
           d_used_by_projected_var(false) {}
 
+    ~D4Dimension() {
+        if (D4RequestContext *context = D4RequestContext::current())
+            context->erase<RequestSlice>(this, d_request_serial);
+    }
+
     /** @brief Returns the dimension name. */
     string name() const { return d_name; }
     /** @brief Sets the dimension name. @param name Dimension name. */
@@ -83,18 +117,38 @@ public:
     void set_parent(D4Dimensions *d) { d_parent = d; }
 
     /** @brief Returns true when this dimension is constrained by a slice. */
-    bool constrained() const { return d_constrained; }
+    bool constrained() const {
+        const RequestSlice *slice = m_request_slice();
+        return slice ? slice->constrained : d_constrained;
+    }
     /** @brief Returns the constrained start index. */
-    int64_t c_start() const { return d_c_start; }
+    int64_t c_start() const {
+        const RequestSlice *slice = m_request_slice();
+        return slice ? slice->c_start : d_c_start;
+    }
     /** @brief Returns the constrained stride. */
-    int64_t c_stride() const { return d_c_stride; }
+    int64_t c_stride() const {
+        const RequestSlice *slice = m_request_slice();
+        return slice ? slice->c_stride : d_c_stride;
+    }
     /** @brief Returns the constrained stop index. */
-    int64_t c_stop() const { return d_c_stop; }
+    int64_t c_stop() const {
+        const RequestSlice *slice = m_request_slice();
+        return slice ? slice->c_stop : d_c_stop;
+    }
 
     /** @brief Returns whether any projected variable uses this shared dimension. */
-    bool used_by_projected_var() const { return d_used_by_projected_var; }
+    bool used_by_projected_var() const {
+        const RequestSlice *slice = m_request_slice();
+        return slice ? slice->used_by_projected_var : d_used_by_projected_var;
+    }
     /** @brief Sets whether any projected variable uses this shared dimension. @param state Usage flag. */
-    void set_used_by_projected_var(bool state) { d_used_by_projected_var = state; }
+    void set_used_by_projected_var(bool state) {
+        if (D4RequestContext *context = D4RequestContext::current())
+            m_changed_request_slice(context).used_by_projected_var = state;
+        else
+            d_used_by_projected_var = state;
+    }
 
     /**
      * Set this Shared Dimension's constraint. While an Array Dimension object uses a
@@ -105,6 +159,15 @@ public:
      * @param stop The stopping index (never greater than size -1)
      */
     void set_constraint(int64_t start, int64_t stride, int64_t stop) {
+        if (D4RequestContext *context = D4RequestContext::current()) {
+            RequestSlice &slice = m_changed_request_slice(context);
+            slice.c_start = start;
+            slice.c_stride = stride;
+            slice.c_stop = stop;
+            slice.constrained = true;
+            return;
+        }
+
         d_c_start = start;
         d_c_stride = stride;
         d_c_stop = stop;
@@ -621,9 +621,10 @@ void D4Enum::print_xml_writer(XMLWriter &xml, bool constrained) {
     if (xmlTextWriterWriteAttribute(xml.get_writer(), (const xmlChar *)"enum", (const xmlChar *)path.c_str()) < 0)
         throw InternalErr(__FILE__, __LINE__, "Could not write attribute for enum");
 
-    attributes()->print_dap4(xml);
+    if (has_attributes())
+        attributes()->print_dap4(xml);
 
-    if (get_attr_table().get_size() > 0)
+    if (has_attr_table() && get_attr_table().get_size() > 0)
         get_attr_table().print_xml_writer(xml);
 
     if (xmlTextWriterEndElement(xml.get_writer()) < 0)
@@ -24,7 +24,10 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <future>
 
 #include <iomanip>
 #include <iostream>
@@ -32,6 +35,7 @@
 #include <sstream>
 
 #include <cstdint>
+#include <cstring>
 
 #include "crc.h"
 
@@ -48,6 +52,7 @@
 #include "D4StreamMarshaller.h"
 #include "D4StreamUnMarshaller.h"
 #include "DMR.h"
+#include "MarshallerStats.h"
 
 #include "debug.h"
 #include "escaping.h"
@@ -168,33 +173,73 @@ void D4Group::update_variables_d4dimension_pointers() {
  * @return The FQN in a string
  */
 string D4Group::FQN() const {
-    // The root group is named "/" (always)
-    if (get_parent())
-        return (name() == "/") ? "/" : static_cast<D4Group *>(get_parent())->FQN() + name() + "/";
-    else
-        return name();
+    return m_cached_fqn([this]() {
+        // The root group is named "/" (always)
+        if (get_parent())
+            return (name() == "/") ? "/" : static_cast<D4Group *>(get_parent())->FQN() + name() + "/";
+        else
+            return name();
+    });
 }
 
-D4Group *D4Group::find_child_grp(const string &grp_name) {
-    auto g = find_if(grp_begin(), grp_end(), [grp_name](const D4Group *g) { return g->name() == grp_name; });
-    return (g == grp_end()) ? nullptr : *g;
+/**
+ * @brief Finds an immediate child group by name.
+ * @param grp_name Child group name; need not be null terminated.
+ * @param length The length of grp_name
+ * @return Matching child group or null.
+ */
+D4Group *D4Group::find_child_grp(const char *grp_name, size_t length) {
+    size_t i = NameIndex<D4Group>::find(d_groups_index, d_groups, grp_name, length, m_path_generation());
+    return i < d_groups.size() ? d_groups[i] : nullptr;
 }
 
 // This is a private method. The grp_path is not supposed to start with the '/'.
 D4Group *D4Group::find_grp_internal(const string &grp_path) {
+    const char *grp_name = grp_path.data();
+    size_t length = grp_path.size();
+    D4Group *grp = this;
+    while (grp) {
+        auto slash = static_cast<const char *>(memchr(grp_name, '/', length));
+        if (!slash)
+            return grp->find_child_grp(grp_name, length);
 
-    string::size_type pos = grp_path.find('/');
-    if (pos == string::npos) {
-        D4Group *d4_grp = this->find_child_grp(grp_path);
-        return d4_grp;
-    } else {
-        string top_grp_path = grp_path.substr(0, pos);
-        string rest_grp_path = grp_path.substr(pos + 1);
-        D4Group *d4_grp = this->find_child_grp(top_grp_path);
-        if (d4_grp != nullptr) {
-            return d4_grp->find_grp_internal(rest_grp_path);
-        } else
+        size_t n = slash - grp_name;
+        grp = grp->find_child_grp(grp_name, n);
+        grp_name = slash + 1;
+        length -= n + 1;
+    }
+
+    return nullptr;
+}
+
+// Private method. Find the group that holds the last part of path, a FQN or a
+// path relative to this group, without copying the parts of the path. Sets
+// leaf and length to that last part.
+// @return The group or null if one of the groups on the path does not exist
+D4Group *D4Group::m_find_leaf_group(const string &path, const char *&leaf, size_t &length) {
+    leaf = path.data();
+    length = path.size();
+    D4Group *grp = this;
+    while (true) {
+        // special-case for the root group
+        if (length > 0 && *leaf == '/') {
+            if (grp->name() != "/")
+                throw InternalErr(__FILE__, __LINE__, "Lookup of a FQN starting in non-root group.");
+            ++leaf;
+            --length;
+        }
+
+        // name looks like foo/bar/baz where foo and bar must be groups
+        auto slash = static_cast<const char *>(memchr(leaf, '/', length));
+        if (!slash)
+            return grp;
+
+        size_t n = slash - leaf;
+        grp = grp->find_child_grp(leaf, n);
+        if (!grp)
             return nullptr;
+        leaf = slash + 1;
+        length -= n + 1;
     }
 }
 // Add constraint param? jhrg 11/17/13
@@ -266,28 +311,10 @@ BaseType *D4Group::find_first_var_that_uses_enumeration(D4EnumDef *enum_def) {
  * @return A pointer to the D4Dimension object.
  */
 D4Dimension *D4Group::find_dim(const string &path) {
-    string lpath = path; // get a mutable copy
-
-    // special-case for the root group
-    if (lpath[0] == '/') {
-        if (name() != "/")
-            throw InternalErr(__FILE__, __LINE__, "Lookup of a FQN starting in non-root group.");
-        else
-            lpath = lpath.substr(1);
-    }
-
-    string::size_type pos = lpath.find('/');
-    if (pos == string::npos) {
-        // name looks like 'bar'
-        return dims()->find_dim(lpath);
-    }
-
-    // name looks like foo/bar/baz where foo and bar must be groups
-    string grp_name = lpath.substr(0, pos);
-    lpath = lpath.substr(pos + 1);
-
-    D4Group *grp = find_child_grp(grp_name);
-    return (grp == 0) ? 0 : grp->find_dim(lpath);
+    const char *leaf;
+    size_t length;
+    D4Group *grp = m_find_leaf_group(path, leaf, length);
+    return (grp == 0) ? 0 : grp->dims()->find_dim(string(leaf, length));
 }
 
 /**
@@ -310,47 +337,11 @@ Array *D4Group::find_map_source(const string &path) {
  * @return A pinter to the variable named by the path
  */
 BaseType *D4Group::m_find_map_source_helper(const string &path) {
-    string lpath = path; // get a mutable copy
-
-    // special-case for the root group
-    if (lpath[0] == '/') {
-        if (name() != "/")
-            throw InternalErr(__FILE__, __LINE__, "Lookup of a FQN starting in non-root group.");
-        else
-            lpath = lpath.substr(1);
-    }
-    string::size_type pos = lpath.find('/');
-    if (pos == string::npos) {
-        // name looks like 'bar'
-        return var(lpath);
-    }
-
-    // name looks like foo/bar/baz where foo and bar must be groups
-    string grp_name = lpath.substr(0, pos);
-
-    D4Group *grp = find_child_grp(grp_name);
-    lpath = lpath.substr(pos + 1);
-
-    // We need to resolve the case that
-    // many group layers are involved such as /foo/bar/bar2/bar3/.../baz
-    // The following code handles this.
-    // KY 2023-05-21
-    //
-    pos = lpath.find('/');
-
-    if (pos == string::npos)
-        return (grp == nullptr) ? nullptr : grp->var(lpath);
-
-    // Recursively check the child groups until we hit the leaf.
-    while (pos != string::npos) {
-
-        grp_name = lpath.substr(0, pos);
-        grp = grp->find_child_grp(grp_name);
-        lpath = lpath.substr(pos + 1);
-        pos = lpath.find('/');
-    }
-
-    return (grp == nullptr) ? nullptr : grp->var(lpath);
+    // The path may run through many groups, e.g., /foo/bar/bar2/bar3/.../baz
+    const char *leaf;
+    size_t length;
+    D4Group *grp = m_find_leaf_group(path, leaf, length);
+    return (grp == nullptr) ? nullptr : grp->var(string(leaf, length));
 }
 
 D4EnumDef *D4Group::find_enum_def(const string &path) {
@@ -399,40 +390,23 @@ D4EnumDef *D4Group::find_enum_def(const string &path) {
  * @see BaseType::FQN()
  */
 BaseType *D4Group::find_var(const string &path) {
-    string lpath = path; // get a mutable copy
-
-    // special-case for the root group
-    if (lpath[0] == '/') {
-        if (name() != "/")
-            throw InternalErr(__FILE__, __LINE__, "Lookup of a FQN starting in non-root group.");
-        else
-            lpath = lpath.substr(1);
-    }
-
-    string::size_type pos = lpath.find('/');
-    if (pos == string::npos) {
-        // New behavior to accommodate cases where the path ends in a group - the
-        // CE is being used to request all the variables in a Group. So, first check
-        // if this is the name of a Group and if so, return that. Otherwise, look in
-        // the Group's Constructor for a matching variable. jhrg 8/3/22
-        D4Group *grp = find_child_grp(lpath);
-        if (grp != nullptr)
-            return grp;
-        else
-            return var(lpath);
-    }
-
-    // name looks like foo/bar/baz where foo and bar must be groups
-    string grp_name = lpath.substr(0, pos);
-    lpath = lpath.substr(pos + 1);
-
-    D4Group *grp = find_child_grp(grp_name);
+    const char *leaf;
+    size_t length;
+    D4Group *grp = m_find_leaf_group(path, leaf, length);
     if (grp == nullptr)
         return nullptr;
-    else if (lpath.empty())
+    else if (length == 0 && grp != this) // the path ends in a group, e.g., foo/bar/
         return grp;
+
+    // New behavior to accommodate cases where the path ends in a group - the
+    // CE is being used to request all the variables in a Group. So, first check
+    // if this is the name of a Group and if so, return that. Otherwise, look in
+    // the Group's Constructor for a matching variable. jhrg 8/3/22
+    D4Group *child = grp->find_child_grp(leaf, length);
+    if (child != nullptr)
+        return child;
     else
-        return grp->find_var(lpath);
+        return grp->var(string(leaf, length));
 }
 
 /**
@@ -528,6 +502,14 @@ void D4Group::intern_data(/*Crc32 &checksum, DMR &dmr, ConstraintEvaluator &eval
  * @exception Error is thrown if the value needs to be read and that operation fails.
  */
 void D4Group::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter) {
+    if (dmr.read_ahead_threads() > 0) {
+        m_serialize_read_ahead(m, dmr, filter);
+        for (auto g : d_groups) {
+            g->serialize(m, dmr, filter);
+        }
+        return;
+    }
+
     // Specialize how the top-level variables in any Group are sent; include
     // a checksum for them. A subset operation might make an interior set of
     // variables, but the parent structure will still be present and the checksum
@@ -535,6 +517,7 @@ void D4Group::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter) {
     // to sort out which variables are the 'real' top-level variables and instead
     // simply computes the CRC for whatever appears as a variable in the root
     // group.
+    MarshallerStats *stats = m.get_stats();
     for (auto i : d_vars) {
         // Only send the stuff in the current subset.
         if (i->send_p()) {
@@ -542,11 +525,15 @@ void D4Group::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter) {
                 m.reset_checksum();
 
             DBG(cerr << "Serializing variable " << i->type_name() << " " << i->name() << endl);
+            if (stats)
+                stats->start_variable(i->FQN());
             i->serialize(m, dmr, filter);
             if (dmr.use_checksums()) {
                 m.put_checksum();
                 DBG(cerr << "Wrote CRC32: " << m.get_checksum() << " for " << i->name() << endl);
             }
+            if (stats)
+                stats->end_variable();
         }
     }
 
@@ -555,6 +542,142 @@ void D4Group::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter) {
     }
 }
 
+namespace {
+
+/// A variable in the current Group and, if it is read ahead, its read-ahead task
+struct ReadAhead {
+    BaseType *var = nullptr;
+    uint64_t bytes = 0;
+    std::future<Crc32::checksum> crc; // valid() iff the variable is read ahead
+    bool has_crc = false;
+    double read_seconds = 0; // time spent by the read-ahead thread, if timed
+    double crc_seconds = 0;
+};
+
+// Only scalars and Arrays of them are read ahead: their serialize() reads the
+// variable and then writes its values. Constructors (and Sequences in
+// particular) and Arrays that stream slabs read as they serialize.
+bool can_read_ahead(BaseType *var) {
+    if (var->is_simple_type())
+        return true;
+    return var->type() == dods_array_c && var->var() && var->var()->is_simple_type() &&
+           static_cast<Array *>(var)->get_slab_size() == 0;
+}
+
+} // namespace
+
+/**
+ * @brief Serialize the variables of this Group, reading ahead
+ * The same as the first part of serialize(), but the next projected
+ * variables are read, and their checksums computed, by up to
+ * dmr.read_ahead_threads() threads while the current variable is written.
+ * The read-ahead stops while more than dmr.read_ahead_bytes() bytes have been
+ * read but not yet written, unless nothing is being read ahead. Variables are
+ * written in the order they appear in the DMR. An exception thrown by read()
+ * on another thread is rethrown here when that variable is to be written.
+ */
+void D4Group::m_serialize_read_ahead(D4StreamMarshaller &m, DMR &dmr, bool filter) {
+    std::vector<ReadAhead> vars;
+    for (auto i : d_vars) {
+        if (i->send_p()) {
+            vars.emplace_back();
+            vars.back().var = i;
+        }
+    }
+
+    // Computing the checksum means serializing a variable twice. Handlers that
+    // use direct I/O write their own values, so only read those ahead.
+    const bool precompute_crc = dmr.use_checksums() && !dmr.get_global_dio_flag();
+
+    const unsigned int crc_threads = m.checksum_threads();
+    // The read-ahead threads keep their times in the ReadAhead; they are added
+    // to the marshaller's stats when the variable is written.
+    const bool timed = m.get_stats() != nullptr;
+    auto read_ahead = [&dmr, filter, precompute_crc, crc_threads, timed](ReadAhead *ra) -> Crc32::checksum {
+        using clock = std::chrono::steady_clock;
+        clock::time_point start;
+        if (timed)
+            start = clock::now();
+        if (!ra->var->read_p())
+            ra->var->read();
+        if (timed) {
+            clock::time_point read_done = clock::now();
+            ra->read_seconds = std::chrono::duration<double>(read_done - start).count();
+            start = read_done;
+        }
+        if (!precompute_crc)
+            return 0;
+
+        std::ostringstream null_sink;
+        D4StreamMarshaller crc_only(null_sink, false, true);
+        crc_only.set_checksum_threads(crc_threads);
+        crc_only.reset_checksum();
+        ra->var->serialize(crc_only, dmr, filter);
+        if (timed)
+            ra->crc_seconds = std::chrono::duration<double>(clock::now() - start).count();
+        return crc_only.get_checksum_value();
+    };
+
+    size_t next = 0;         // the next variable that might be read ahead
+    size_t running = 0;      // variables read ahead but not yet written
+    uint64_t bytes_held = 0; // and their size
+    for (size_t i = 0; i < vars.size(); ++i) {
+        // Start reading the next variables, within the thread and byte limits.
+        next = std::max(next, i + 1);
+        while (next < vars.size() && running < dmr.read_ahead_threads()) {
+            ReadAhead &ra = vars[next];
+            if (can_read_ahead(ra.var)) {
+                ra.bytes = ra.var->width_ll(true);
+                if (running > 0 && bytes_held + ra.bytes > dmr.read_ahead_bytes())
+                    break;
+                ra.crc = std::async(std::launch::async, read_ahead, &ra);
+                ra.has_crc = precompute_crc;
+                ++running;
+                bytes_held += ra.bytes;
+            }
+            ++next;
+        }
+
+        ReadAhead &ra = vars[i];
+        Crc32::checksum crc = 0;
+        if (ra.crc.valid()) {
+            crc = ra.crc.get(); // waits, and rethrows any exception from read()
+            --running;
+            bytes_held -= ra.bytes;
+        }
+
+        if (dmr.use_checksums())
+            m.reset_checksum();
+
+        MarshallerStats *stats = m.get_stats();
+        if (stats) {
+            stats->start_variable(ra.var->FQN());
+            stats->add_time(MarshallerStats::read_time, ra.read_seconds);
+            stats->add_time(MarshallerStats::encode_time, ra.crc_seconds);
+        }
+
+        DBG(cerr << "Serializing variable " << ra.var->type_name() << " " << ra.var->name() << endl);
+        if (ra.has_crc) {
+            m.pause_checksum(true);
+            try {
+                ra.var->serialize(m, dmr, filter);
+            } catch (...) {
+                m.pause_checksum(false);
+                throw;
+            }
+            m.pause_checksum(false);
+            m.put_checksum(crc);
+        } else {
+            ra.var->serialize(m, dmr, filter);
+            if (dmr.use_checksums())
+                m.put_checksum();
+        }
+
+        if (stats)
+            stats->end_variable();
+    }
+}
+
 void D4Group::deserialize(D4StreamUnMarshaller &um, DMR &dmr) {
     // Specialize how the top-level variables in any Group are received; read
     // their checksum and store the value in a magic attribute of the variable
@@ -601,12 +724,12 @@ void D4Group::print_dap4(XMLWriter &xml, bool constrained) {
     }
 
     // dims
-    if (!dims()->empty())
-        dims()->print_dap4(xml, constrained);
+    if (d_dims && !d_dims->empty())
+        d_dims->print_dap4(xml, constrained);
 
     // enums
-    if (!enum_defs()->empty())
-        enum_defs()->print_dap4(xml, constrained);
+    if (d_enum_defs && !d_enum_defs->empty())
+        d_enum_defs->print_dap4(xml, constrained);
 
     // variables
     Constructor::Vars_iter v = var_begin();
@@ -614,7 +737,8 @@ void D4Group::print_dap4(XMLWriter &xml, bool constrained) {
         (*v++)->print_dap4(xml, constrained);
 
     // attributes
-    attributes()->print_dap4(xml);
+    if (has_attributes())
+        attributes()->print_dap4(xml);
 
     // groups
     groupsIter g = d_groups.begin();
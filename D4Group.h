@@ -59,8 +59,14 @@ private:
     // work as expected when making Groups.
     vector<D4Group *> d_groups;
 
+    // Index of d_groups by name, built by find_child_grp() for large groups
+    std::shared_ptr<NameIndex<D4Group>> d_groups_index;
+
     BaseType *m_find_map_source_helper(const string &name);
     D4Group *find_grp_internal(const string &grp_path);
+    D4Group *m_find_leaf_group(const string &path, const char *&leaf, size_t &length);
+
+    void m_serialize_read_ahead(D4StreamMarshaller &m, DMR &dmr, bool filter);
 
 protected:
     /**
@@ -167,6 +173,7 @@ public:
     void add_group_nocopy(D4Group *g) {
         g->set_parent(this);
         d_groups.push_back(g);
+        NameIndex<D4Group>::appended(d_groups_index, d_groups, m_path_generation());
     }
 
     /**
@@ -177,6 +184,7 @@ public:
     void insert_group_nocopy(D4Group *g, groupsIter i) {
         g->set_parent(this);
         d_groups.insert(i, g);
+        d_groups_index.reset();
     }
 
     /**
@@ -184,7 +192,8 @@ public:
      * @param grp_name Child group name.
      * @return Matching child group or null.
      */
-    D4Group *find_child_grp(const string &grp_name);
+    D4Group *find_child_grp(const string &grp_name) { return find_child_grp(grp_name.data(), grp_name.size()); }
+    D4Group *find_child_grp(const char *grp_name, size_t length);
 
     long request_size(bool constrained);
     uint64_t request_size_kb(bool constrained);
@@ -1257,6 +1257,7 @@ void D4ParserSax2::intern(istream &f, DMR *dest_dmr, bool debug) {
         throw InternalErr(__FILE__, __LINE__, "DMR object is null");
 
     d_dmr = dest_dmr; // dump values here
+    DapArena::Scope scope(d_dmr->arena());
 #if 0
     int line_num = 1;
     string line;
@@ -1377,6 +1378,7 @@ void D4ParserSax2::intern(const char *buffer, int size, DMR *dest_dmr, bool debu
     if (!dest_dmr)
         throw InternalErr(__FILE__, __LINE__, "DMR object is null");
     d_dmr = dest_dmr; // dump values in dest_dmr
+    DapArena::Scope scope(d_dmr->arena());
 
     push_state(parser_start);
     d_context = xmlCreatePushParserCtxt(&d_dmr_sax_parser, this, buffer, size, "stream");
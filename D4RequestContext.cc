@@ -0,0 +1,65 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <atomic>
+
+#include "D4RequestContext.h"
+
+namespace libdap {
+
+namespace {
+
+thread_local D4RequestContext *current_context = nullptr;
+
+// Each thread takes serial numbers from the shared counter in blocks.
+const uint32_t serial_block = 1024;
+std::atomic<uint32_t> next_serial_block(0);
+thread_local uint32_t next_serial = 0;
+thread_local uint32_t serial_block_end = 0;
+
+} // namespace
+
+D4RequestContext::Serial::Serial() {
+    if (next_serial == serial_block_end) {
+        next_serial = next_serial_block.fetch_add(serial_block, std::memory_order_relaxed);
+        serial_block_end = next_serial + serial_block;
+    }
+    d_value = next_serial++;
+}
+
+/// @brief The context of the innermost active Scope on this thread, or null.
+D4RequestContext *D4RequestContext::current() { return current_context; }
+
+/**
+ * @brief Use a context for the projection state changed on this thread
+ * @param context The context; null means the variables themselves
+ */
+D4RequestContext::Scope::Scope(D4RequestContext *context) : d_previous(current_context) {
+    current_context = context;
+}
+
+D4RequestContext::Scope::~Scope() { current_context = d_previous; }
+
+} // namespace libdap
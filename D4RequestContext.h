@@ -0,0 +1,171 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _d4_request_context_h
+#define _d4_request_context_h 1
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+
+namespace libdap {
+
+/**
+ * @brief The projection state of one request, kept outside the variables
+ *
+ * Evaluating a constraint changes the variables of a DMR: their send_p,
+ * read_p and in_selection properties, the constraints on the dimensions of
+ * Arrays (and so their lengths) and the slices of shared dimensions. While a
+ * D4RequestContext::Scope is active on a thread, those changes, and the
+ * accessors that read them, use the context instead of the variables. Each
+ * object's state is copied into the context the first time it is changed;
+ * until then the object's own state is used.
+ *
+ * So several threads can each evaluate a constraint (D4ConstraintEvaluator)
+ * and build a DMR response (DMR::print_dap4() with constrained true) using
+ * one DMR, as long as each has its own context and nothing else changes the
+ * DMR.
+ *
+ * The values of variables are not part of the context: read() stores them
+ * in the variables. A data response, or a constraint with a filter or a
+ * function (which change the DMR itself), still needs its own copy of the
+ * DMR; see DMR::freeze() for making those copies cheaper.
+ *
+ * Only that state is held in a context. Building or changing the structure
+ * of a variable (adding dimensions, setting the length of a Vector, and so
+ * on) changes the variable itself, even while a Scope is active.
+ *
+ * A context must only be used by one thread at a time.
+ */
+class D4RequestContext {
+public:
+    D4RequestContext() = default;
+    D4RequestContext(const D4RequestContext &) = delete;
+    D4RequestContext &operator=(const D4RequestContext &) = delete;
+
+    static D4RequestContext *current();
+
+    /**
+     * @brief Tells apart objects made at the same address
+     * State is held for an object under its address and serial number, so an
+     * object made where another was deleted does not see the state the
+     * deleted one left in a context. A copy gets a new number; assignment
+     * keeps the number of the target. The numbers are 32 bits so they fit in
+     * the padding of BaseType; one is used again only after four billion
+     * more objects have been made.
+     */
+    class Serial {
+        uint32_t d_value;
+
+    public:
+        Serial();
+        Serial(const Serial &) : Serial() {}
+        Serial &operator=(const Serial &) { return *this; }
+
+        uint32_t value() const { return d_value; }
+    };
+
+    /// @brief Make a context the current context of this thread for the life of the Scope
+    class Scope {
+        D4RequestContext *d_previous;
+
+    public:
+        explicit Scope(D4RequestContext *context);
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        ~Scope();
+    };
+
+    /**
+     * @brief The state of type T for an object, if it has been changed
+     * @param object The object the state belongs to
+     * @param serial The object's serial number
+     * @return The state or null
+     */
+    template <typename T> T *find(const void *object, const Serial &serial) const {
+        auto i = d_state.find(Key{object, serial.value(), typeid(T)});
+        return i == d_state.end() ? nullptr : &static_cast<Slot<T> *>(i->second.get())->value;
+    }
+
+    /**
+     * @brief The state of type T for an object, adding it if needed
+     * @param object The object the state belongs to
+     * @param serial The object's serial number
+     * @param initial The state to add; usually the object's own state
+     * @return The state in this context
+     */
+    template <typename T> T &get(const void *object, const Serial &serial, const T &initial) {
+        auto &slot = d_state[Key{object, serial.value(), typeid(T)}];
+        if (!slot)
+            slot.reset(new Slot<T>(initial));
+        return static_cast<Slot<T> *>(slot.get())->value;
+    }
+
+    /// @brief Forget the state of type T for an object (e.g., because it was deleted).
+    template <typename T> void erase(const void *object, const Serial &serial) {
+        d_state.erase(Key{object, serial.value(), typeid(T)});
+    }
+
+    /// @brief The number of states held
+    size_t size() const { return d_state.size(); }
+
+    /// @brief Forget all the state, e.g., to reuse the context for another request.
+    void clear() { d_state.clear(); }
+
+private:
+    struct SlotBase {
+        virtual ~SlotBase() = default;
+    };
+
+    template <typename T> struct Slot : SlotBase {
+        T value;
+        explicit Slot(const T &v) : value(v) {}
+    };
+
+    struct Key {
+        const void *object;
+        uint32_t serial;
+        std::type_index type;
+
+        bool operator==(const Key &rhs) const {
+            return object == rhs.object && serial == rhs.serial && type == rhs.type;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &k) const {
+            return std::hash<const void *>()(k.object) ^ (size_t(k.serial) * 0x9e3779b97f4a7c15ULL) ^
+                   k.type.hash_code();
+        }
+    };
+
+    std::unordered_map<Key, std::unique_ptr<SlotBase>, KeyHash> d_state;
+};
+
+} // namespace libdap
+
+#endif // _d4_request_context_h
@@ -0,0 +1,584 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "D4SeqColumns.h"
+
+#include "Byte.h"
+#include "D4Sequence.h"
+#include "D4StreamMarshaller.h"
+#include "D4StreamUnMarshaller.h"
+#include "Float32.h"
+#include "Float64.h"
+#include "Int16.h"
+#include "Int32.h"
+#include "Int64.h"
+#include "Int8.h"
+#include "Str.h"
+#include "UInt16.h"
+#include "UInt32.h"
+#include "UInt64.h"
+
+using namespace std;
+
+namespace libdap {
+
+namespace {
+
+// The bytes per value of a numeric type; 0 for other types.
+unsigned int value_width(Type type) {
+    switch (type) {
+    case dods_byte_c:
+    case dods_char_c:
+    case dods_uint8_c:
+    case dods_int8_c:
+        return 1;
+    case dods_int16_c:
+    case dods_uint16_c:
+        return 2;
+    case dods_int32_c:
+    case dods_uint32_c:
+    case dods_float32_c:
+        return 4;
+    case dods_int64_c:
+    case dods_uint64_c:
+    case dods_float64_c:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+template <typename T> inline void push(vector<char> &data, T value) {
+    const char *bytes = reinterpret_cast<const char *>(&value);
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+
+// memcpy() because the values in a column are not necessarily aligned for T.
+template <typename T> inline T get(const vector<char> &data, uint64_t row) {
+    T value;
+    memcpy(&value, data.data() + row * sizeof(T), sizeof(T));
+    return value;
+}
+
+} // namespace
+
+D4SeqColumns::Column::Column(const Column &rhs)
+    : name(rhs.name), type(rhs.type), width(rhs.width), data(rhs.data), offsets(rhs.offsets),
+      child(rhs.child ? new D4SeqColumns(*rhs.child) : nullptr) {}
+
+D4SeqColumns::Column &D4SeqColumns::Column::operator=(const Column &rhs) {
+    if (this != &rhs) {
+        Column tmp(rhs);
+        *this = std::move(tmp);
+    }
+    return *this;
+}
+
+/**
+ * @brief Make empty columns for the members of a sequence
+ * @param seq The sequence
+ * @param projected If true, only members with send_p() set get a column (the
+ * members serialize() sends); if false, every member does (the members
+ * deserialize() receives). Nested sequences follow the same rule.
+ * @exception InternalErr if a member cannot be stored in a column
+ */
+D4SeqColumns::D4SeqColumns(D4Sequence &seq, bool projected) {
+    for (auto i = seq.var_begin(), e = seq.var_end(); i != e; ++i) {
+        BaseType *var = *i;
+        if (projected && !var->send_p())
+            continue;
+        if (!supported(var))
+            throw InternalErr(__FILE__, __LINE__,
+                              "The sequence member '" + var->name() + "' cannot be stored in columns.");
+
+        Column c;
+        c.name = var->name();
+        c.type = var->type();
+        c.width = value_width(var->type());
+        if (var->type() == dods_sequence_c)
+            c.child.reset(new D4SeqColumns(static_cast<D4Sequence &>(*var), projected));
+        d_columns.push_back(std::move(c));
+    }
+}
+
+/**
+ * @brief Can this variable be stored in a column?
+ * Numeric scalars, String, Url and sequences of those can.
+ */
+bool D4SeqColumns::supported(BaseType *var) {
+    if (value_width(var->type()) > 0 || var->type() == dods_str_c || var->type() == dods_url_c)
+        return true;
+
+    if (var->type() == dods_sequence_c) {
+        auto seq = static_cast<D4Sequence *>(var);
+        return all_of(seq->var_begin(), seq->var_end(), [](BaseType *v) { return supported(v); });
+    }
+
+    return false;
+}
+
+/// @brief The column holding the named member, or -1.
+int D4SeqColumns::find(const string &name) const {
+    for (size_t i = 0; i < d_columns.size(); ++i)
+        if (d_columns[i].name == name)
+            return static_cast<int>(i);
+    return -1;
+}
+
+/// @brief The number of complete rows; the length of the shortest column.
+uint64_t D4SeqColumns::rows() const {
+    if (d_columns.empty())
+        return 0;
+
+    uint64_t n = d_columns[0].size();
+    for (const auto &c : d_columns)
+        n = min(n, c.size());
+    return n;
+}
+
+/// @brief The memory allocated for the values, including nested sequences.
+uint64_t D4SeqColumns::bytes() const {
+    uint64_t n = 0;
+    for (const auto &c : d_columns) {
+        n += c.data.capacity() + c.offsets.capacity() * sizeof(uint64_t);
+        if (c.child)
+            n += c.child->bytes();
+    }
+    return n;
+}
+
+/**
+ * @brief Append the value of a variable to a column
+ * Use this after read() has loaded a member variable's value. For a nested
+ * sequence, all of its rows (whether it stores them in columns or not) become
+ * one value of the column.
+ * @param col The column
+ * @param var The member variable; it must have the column's type
+ */
+void D4SeqColumns::append(size_t col, BaseType &var) {
+    Column &c = m_column(col);
+    if (var.type() != c.type)
+        throw InternalErr(__FILE__, __LINE__, "The type of '" + var.name() + "' does not match its sequence column.");
+
+    switch (c.type) {
+    case dods_byte_c:
+    case dods_char_c:
+    case dods_uint8_c:
+        push(c.data, static_cast<Byte &>(var).value());
+        break;
+    case dods_int8_c:
+        push(c.data, static_cast<Int8 &>(var).value());
+        break;
+    case dods_int16_c:
+        push(c.data, static_cast<Int16 &>(var).value());
+        break;
+    case dods_uint16_c:
+        push(c.data, static_cast<UInt16 &>(var).value());
+        break;
+    case dods_int32_c:
+        push(c.data, static_cast<Int32 &>(var).value());
+        break;
+    case dods_uint32_c:
+        push(c.data, static_cast<UInt32 &>(var).value());
+        break;
+    case dods_int64_c:
+        push(c.data, static_cast<Int64 &>(var).value());
+        break;
+    case dods_uint64_c:
+        push(c.data, static_cast<UInt64 &>(var).value());
+        break;
+    case dods_float32_c:
+        push(c.data, static_cast<Float32 &>(var).value());
+        break;
+    case dods_float64_c:
+        push(c.data, static_cast<Float64 &>(var).value());
+        break;
+    case dods_str_c:
+    case dods_url_c:
+        append_string(col, static_cast<Str &>(var).value());
+        break;
+    case dods_sequence_c: {
+        auto &seq = static_cast<D4Sequence &>(var);
+        if (seq.columnar()) {
+            const D4SeqColumns &rows = seq.columns();
+            c.child->append_rows(rows, 0, rows.rows());
+        } else {
+            for (auto row : seq.value_ref()) {
+                if (row->size() != c.child->num_columns())
+                    throw InternalErr(__FILE__, __LINE__,
+                                      "The rows of '" + var.name() + "' do not match its sequence column.");
+                for (size_t j = 0; j < row->size(); ++j)
+                    c.child->append(j, *(*row)[j]);
+            }
+        }
+        end_sequence(col);
+        break;
+    }
+    default:
+        throw InternalErr(__FILE__, __LINE__, "Unsupported sequence column type.");
+    }
+}
+
+/**
+ * @brief Append a batch of numeric values to a column
+ * @param col The column
+ * @param values The values
+ * @param num The number of values
+ * @param width The size of each value in bytes; must match the column's type
+ */
+void D4SeqColumns::append_values(size_t col, const void *values, uint64_t num, unsigned int width) {
+    Column &c = m_column(col);
+    if (c.width == 0 || c.width != width)
+        throw InternalErr(__FILE__, __LINE__, "The column '" + c.name + "' does not hold values of that size.");
+
+    auto bytes = static_cast<const char *>(values);
+    c.data.insert(c.data.end(), bytes, bytes + num * width);
+}
+
+/// @brief Append a value to a String or Url column.
+void D4SeqColumns::append_string(size_t col, const string &value) {
+    Column &c = m_column(col);
+    if (c.type != dods_str_c && c.type != dods_url_c)
+        throw InternalErr(__FILE__, __LINE__, "The column '" + c.name + "' does not hold strings.");
+
+    c.data.insert(c.data.end(), value.begin(), value.end());
+    c.offsets.push_back(c.data.size());
+}
+
+/**
+ * @brief The rows of every instance of a nested sequence
+ * To append one value to a sequence column, append its rows to the child
+ * and then call end_sequence().
+ */
+D4SeqColumns &D4SeqColumns::child(size_t col) {
+    Column &c = m_column(col);
+    if (c.type != dods_sequence_c)
+        throw InternalErr(__FILE__, __LINE__, "The column '" + c.name + "' does not hold sequences.");
+    return *c.child;
+}
+
+/// @brief The child rows appended since the last call are one value of the column.
+void D4SeqColumns::end_sequence(size_t col) { m_column(col).offsets.push_back(child(col).rows()); }
+
+/**
+ * @brief Append rows copied from other columns
+ * @param src Columns with the same members as these
+ * @param begin The first row to copy
+ * @param end One past the last row to copy
+ */
+void D4SeqColumns::append_rows(const D4SeqColumns &src, uint64_t begin, uint64_t end) {
+    if (src.d_columns.size() != d_columns.size() || end < begin || end > src.rows())
+        throw InternalErr(__FILE__, __LINE__, "Cannot copy those sequence rows.");
+
+    for (size_t i = 0; i < d_columns.size(); ++i) {
+        Column &c = d_columns[i];
+        const Column &s = src.d_columns[i];
+        if (c.type != s.type)
+            throw InternalErr(__FILE__, __LINE__, "Cannot copy the rows of sequence column '" + s.name + "'.");
+
+        if (c.width) {
+            c.data.insert(c.data.end(), s.data.begin() + begin * c.width, s.data.begin() + end * c.width);
+            continue;
+        }
+
+        const uint64_t base = c.offsets.back();
+        if (c.child)
+            c.child->append_rows(*s.child, s.offsets[begin], s.offsets[end]);
+        else
+            c.data.insert(c.data.end(), s.data.begin() + s.offsets[begin], s.data.begin() + s.offsets[end]);
+        for (uint64_t r = begin + 1; r <= end; ++r)
+            c.offsets.push_back(base + s.offsets[r] - s.offsets[begin]);
+    }
+}
+
+/// @brief A value of a String or Url column.
+string D4SeqColumns::string_value(size_t col, uint64_t row) const {
+    const Column &c = m_column(col);
+    if ((c.type != dods_str_c && c.type != dods_url_c) || row >= c.size())
+        throw InternalErr(__FILE__, __LINE__, "No such string in the column '" + c.name + "'.");
+
+    return string(c.data.data() + c.offsets[row], c.offsets[row + 1] - c.offsets[row]);
+}
+
+/**
+ * @brief The rows of child() that hold one value of a sequence column
+ * @param col The column
+ * @param row The row of these columns
+ * @param begin Value-result parameter; the first child row
+ * @param end Value-result parameter; one past the last child row
+ */
+void D4SeqColumns::sequence_rows(size_t col, uint64_t row, uint64_t &begin, uint64_t &end) const {
+    const Column &c = m_column(col);
+    if (c.type != dods_sequence_c || row >= c.size())
+        throw InternalErr(__FILE__, __LINE__, "No such sequence in the column '" + c.name + "'.");
+
+    begin = c.offsets[row];
+    end = c.offsets[row + 1];
+}
+
+/**
+ * @brief Load a value into a variable
+ * A nested sequence gets a copy of its rows, stored in columns.
+ * @param col The column
+ * @param row The row
+ * @param var A variable of the column's type
+ */
+void D4SeqColumns::value(size_t col, uint64_t row, BaseType &var) const {
+    const Column &c = m_column(col);
+    if (var.type() != c.type || row >= c.size())
+        throw InternalErr(__FILE__, __LINE__, "No such value in the column '" + c.name + "'.");
+
+    switch (c.type) {
+    case dods_byte_c:
+    case dods_char_c:
+    case dods_uint8_c:
+        static_cast<Byte &>(var).set_value(get<dods_byte>(c.data, row));
+        break;
+    case dods_int8_c:
+        static_cast<Int8 &>(var).set_value(get<dods_int8>(c.data, row));
+        break;
+    case dods_int16_c:
+        static_cast<Int16 &>(var).set_value(get<dods_int16>(c.data, row));
+        break;
+    case dods_uint16_c:
+        static_cast<UInt16 &>(var).set_value(get<dods_uint16>(c.data, row));
+        break;
+    case dods_int32_c:
+        static_cast<Int32 &>(var).set_value(get<dods_int32>(c.data, row));
+        break;
+    case dods_uint32_c:
+        static_cast<UInt32 &>(var).set_value(get<dods_uint32>(c.data, row));
+        break;
+    case dods_int64_c:
+        static_cast<Int64 &>(var).set_value(get<dods_int64>(c.data, row));
+        break;
+    case dods_uint64_c:
+        static_cast<UInt64 &>(var).set_value(get<dods_uint64>(c.data, row));
+        break;
+    case dods_float32_c:
+        static_cast<Float32 &>(var).set_value(get<dods_float32>(c.data, row));
+        break;
+    case dods_float64_c:
+        static_cast<Float64 &>(var).set_value(get<dods_float64>(c.data, row));
+        break;
+    case dods_str_c:
+    case dods_url_c:
+        static_cast<Str &>(var).set_value(string_value(col, row));
+        break;
+    case dods_sequence_c: {
+        auto rows = new D4SeqColumns(c.child->m_layout());
+        rows->append_rows(*c.child, c.offsets[row], c.offsets[row + 1]);
+        static_cast<D4Sequence &>(var).set_columns(rows);
+        var.set_read_p(true);
+        break;
+    }
+    default:
+        throw InternalErr(__FILE__, __LINE__, "Unsupported sequence column type.");
+    }
+}
+
+/// @brief Remove all the values; the columns remain.
+void D4SeqColumns::clear() {
+    for (auto &c : d_columns) {
+        c.data.clear();
+        c.offsets.assign(1, 0);
+        if (c.child)
+            c.child->clear();
+    }
+}
+
+/**
+ * @brief Write rows the way D4Sequence::serialize() writes them
+ * Values are written row by row. Each nested sequence is written as its
+ * row count (not included in the checksum) followed by its rows.
+ * @param m Write to this marshaller
+ * @param begin The first row
+ * @param end One past the last row
+ */
+void D4SeqColumns::serialize(D4StreamMarshaller &m, uint64_t begin, uint64_t end) const {
+    if (end < begin || end > rows())
+        throw InternalErr(__FILE__, __LINE__, "Cannot serialize those sequence rows.");
+
+    for (uint64_t r = begin; r < end; ++r) {
+        for (const auto &c : d_columns) {
+            switch (c.type) {
+            case dods_byte_c:
+            case dods_char_c:
+            case dods_uint8_c:
+                m.put_byte(get<dods_byte>(c.data, r));
+                break;
+            case dods_int8_c:
+                m.put_int8(get<dods_int8>(c.data, r));
+                break;
+            case dods_int16_c:
+                m.put_int16(get<dods_int16>(c.data, r));
+                break;
+            case dods_uint16_c:
+                m.put_uint16(get<dods_uint16>(c.data, r));
+                break;
+            case dods_int32_c:
+                m.put_int32(get<dods_int32>(c.data, r));
+                break;
+            case dods_uint32_c:
+                m.put_uint32(get<dods_uint32>(c.data, r));
+                break;
+            case dods_int64_c:
+                m.put_int64(get<dods_int64>(c.data, r));
+                break;
+            case dods_uint64_c:
+                m.put_uint64(get<dods_uint64>(c.data, r));
+                break;
+            case dods_float32_c:
+                m.put_float32(get<dods_float32>(c.data, r));
+                break;
+            case dods_float64_c:
+                m.put_float64(get<dods_float64>(c.data, r));
+                break;
+            case dods_str_c:
+            case dods_url_c:
+                m.put_str(string(c.data.data() + c.offsets[r], c.offsets[r + 1] - c.offsets[r]));
+                break;
+            case dods_sequence_c:
+                m.put_count(c.offsets[r + 1] - c.offsets[r]);
+                c.child->serialize(m, c.offsets[r], c.offsets[r + 1]);
+                break;
+            default:
+                throw InternalErr(__FILE__, __LINE__, "Unsupported sequence column type.");
+            }
+        }
+    }
+}
+
+/**
+ * @brief Append rows read the way D4Sequence::deserialize() reads them
+ * @param um Read from this unmarshaller
+ * @param num_rows The number of rows to read
+ */
+void D4SeqColumns::deserialize(D4StreamUnMarshaller &um, uint64_t num_rows) {
+    for (uint64_t r = 0; r < num_rows; ++r) {
+        for (auto &c : d_columns) {
+            switch (c.type) {
+            case dods_byte_c:
+            case dods_char_c:
+            case dods_uint8_c: {
+                dods_byte v;
+                um.get_byte(v);
+                push(c.data, v);
+                break;
+            }
+            case dods_int8_c: {
+                dods_int8 v;
+                um.get_int8(v);
+                push(c.data, v);
+                break;
+            }
+            case dods_int16_c: {
+                dods_int16 v;
+                um.get_int16(v);
+                push(c.data, v);
+                break;
+            }
+            case dods_uint16_c: {
+                dods_uint16 v;
+                um.get_uint16(v);
+                push(c.data, v);
+                break;
+            }
+            case dods_int32_c: {
+                dods_int32 v;
+                um.get_int32(v);
+                push(c.data, v);
+                break;
+            }
+            case dods_uint32_c: {
+                dods_uint32 v;
+                um.get_uint32(v);
+                push(c.data, v);
+                break;
+            }
+            case dods_int64_c: {
+                dods_int64 v;
+                um.get_int64(v);
+                push(c.data, v);
+                break;
+            }
+            case dods_uint64_c: {
+                dods_uint64 v;
+                um.get_uint64(v);
+                push(c.data, v);
+                break;
+            }
+            case dods_float32_c: {
+                dods_float32 v;
+                um.get_float32(v);
+                push(c.data, v);
+                break;
+            }
+            case dods_float64_c: {
+                dods_float64 v;
+                um.get_float64(v);
+                push(c.data, v);
+                break;
+            }
+            case dods_str_c:
+            case dods_url_c: {
+                string v;
+                um.get_str(v);
+                c.data.insert(c.data.end(), v.begin(), v.end());
+                c.offsets.push_back(c.data.size());
+                break;
+            }
+            case dods_sequence_c: {
+                const int64_t count = um.get_count();
+                c.child->deserialize(um, count);
+                c.offsets.push_back(c.offsets.back() + count);
+                break;
+            }
+            default:
+                throw InternalErr(__FILE__, __LINE__, "Unsupported sequence column type.");
+            }
+        }
+    }
+}
+
+// The same columns, without values.
+D4SeqColumns D4SeqColumns::m_layout() const {
+    D4SeqColumns layout;
+    for (const auto &c : d_columns) {
+        Column l;
+        l.name = c.name;
+        l.type = c.type;
+        l.width = c.width;
+        if (c.child)
+            l.child.reset(new D4SeqColumns(c.child->m_layout()));
+        layout.d_columns.push_back(std::move(l));
+    }
+    return layout;
+}
+
+} // namespace libdap
@@ -0,0 +1,157 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _d4seqcolumns_h
+#define _d4seqcolumns_h 1
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "InternalErr.h"
+#include "Type.h"
+
+namespace libdap {
+
+class BaseType;
+class D4Sequence;
+class D4StreamMarshaller;
+class D4StreamUnMarshaller;
+
+/**
+ * @brief The values of a D4Sequence, stored one column per member
+ *
+ * Each member of the sequence is a column. Numeric members hold their values
+ * in one contiguous array; String and Url members hold their characters in
+ * one array plus the offset where each value starts; a nested D4Sequence is
+ * a child D4SeqColumns holding the rows of all its instances, plus the offset
+ * of the first row of each instance. No BaseType is allocated per value.
+ *
+ * Handlers can fill the columns a row at a time, with append() (which copies
+ * the value of a member variable after read()), or a batch at a time, with
+ * append_values(), append_string() and child()/end_sequence(). A row exists
+ * once every column has a value for it.
+ *
+ * Structure, Array, Opaque and Enum members are not supported; see
+ * supported().
+ *
+ * @see D4Sequence::set_columnar()
+ */
+class D4SeqColumns {
+public:
+    D4SeqColumns() = default;
+    D4SeqColumns(D4Sequence &seq, bool projected);
+
+    static bool supported(BaseType *var);
+
+    /// @brief The number of columns
+    size_t num_columns() const { return d_columns.size(); }
+    /// @brief The name of the member held in column \e col
+    const std::string &name(size_t col) const { return m_column(col).name; }
+    /// @brief The type of the member held in column \e col
+    Type type(size_t col) const { return m_column(col).type; }
+    int find(const std::string &name) const;
+
+    uint64_t rows() const;
+    uint64_t size(size_t col) const { return m_column(col).size(); }
+    uint64_t bytes() const;
+
+    // Appending values
+    void append(size_t col, BaseType &var);
+    void append_values(size_t col, const void *values, uint64_t num, unsigned int width);
+
+    /**
+     * @brief Append a batch of numeric values to a column
+     * @param col The column
+     * @param values The values; T must have the size of the column's type
+     * @param num The number of values
+     */
+    template <typename T> void append_values(size_t col, const T *values, uint64_t num) {
+        append_values(col, values, num, sizeof(T));
+    }
+
+    void append_string(size_t col, const std::string &value);
+    D4SeqColumns &child(size_t col);
+    void end_sequence(size_t col);
+    void append_rows(const D4SeqColumns &src, uint64_t begin, uint64_t end);
+
+    // Reading values
+    /**
+     * @brief The values of a numeric column
+     * @param col The column
+     * @return A pointer to size(col) values; T must have the size of the column's type
+     */
+    template <typename T> const T *values(size_t col) const {
+        const Column &c = m_column(col);
+        if (c.width != sizeof(T))
+            throw InternalErr(__FILE__, __LINE__, "The column '" + c.name + "' does not hold values of that size.");
+        return reinterpret_cast<const T *>(c.data.data());
+    }
+
+    std::string string_value(size_t col, uint64_t row) const;
+    void sequence_rows(size_t col, uint64_t row, uint64_t &begin, uint64_t &end) const;
+    void value(size_t col, uint64_t row, BaseType &var) const;
+
+    void clear();
+
+    void serialize(D4StreamMarshaller &m, uint64_t begin, uint64_t end) const;
+    void deserialize(D4StreamUnMarshaller &um, uint64_t num_rows);
+
+private:
+    struct Column {
+        std::string name;
+        Type type = dods_null_c;
+        unsigned int width = 0;              // bytes per value; 0 for strings and sequences
+        std::vector<char> data;              // the values, or the characters of the strings
+        std::vector<uint64_t> offsets{0};    // strings and sequences: value i is [offsets[i], offsets[i+1])
+        std::unique_ptr<D4SeqColumns> child; // sequences: the rows of every instance
+
+        Column() = default;
+        Column(const Column &rhs);
+        Column(Column &&) = default;
+        Column &operator=(const Column &rhs);
+        Column &operator=(Column &&) = default;
+
+        uint64_t size() const { return width ? data.size() / width : offsets.size() - 1; }
+    };
+
+    std::vector<Column> d_columns;
+
+    const Column &m_column(size_t col) const {
+        if (col >= d_columns.size())
+            throw InternalErr(__FILE__, __LINE__, "No such sequence column.");
+        return d_columns[col];
+    }
+    Column &m_column(size_t col) {
+        if (col >= d_columns.size())
+            throw InternalErr(__FILE__, __LINE__, "No such sequence column.");
+        return d_columns[col];
+    }
+
+    D4SeqColumns m_layout() const;
+};
+
+} // namespace libdap
+
+#endif // _d4seqcolumns_h
@@ -30,8 +30,10 @@
 
 #include "D4Sequence.h"
 
+#include "D4SeqColumns.h"
 #include "D4StreamMarshaller.h"
 #include "D4StreamUnMarshaller.h"
+#include "MarshallerSpool.h"
 
 #include "D4FilterClause.h" // also contains D4FilterClauseList
 #include "D4RValue.h"
@@ -79,6 +81,16 @@ void D4Sequence::m_duplicate(const D4Sequence &s) {
 
     d_copy_clauses = s.d_copy_clauses;
     d_clauses = (s.d_clauses != nullptr) ? new D4FilterClauseList(*s.d_clauses) : nullptr; // deep copy if != 0
+
+    d_columnar = s.d_columnar;
+    d_columns = (s.d_columns != nullptr) ? new D4SeqColumns(*s.d_columns) : nullptr;
+    d_streaming = s.d_streaming;
+}
+
+void D4Sequence::m_clear_row_cache() {
+    for (auto var : d_row_cache)
+        delete var;
+    d_row_cache.clear();
 }
 
 // Public member functions
@@ -92,7 +104,8 @@ void D4Sequence::m_duplicate(const D4Sequence &s) {
 
  @brief The Sequence constructor. */
 D4Sequence::D4Sequence(const string &n)
-    : Constructor(n, dods_sequence_c, true /* is dap4 */), d_clauses(0), d_copy_clauses(true), d_length(0) {}
+    : Constructor(n, dods_sequence_c, true /* is dap4 */), d_clauses(0), d_copy_clauses(true), d_columnar(false),
+      d_columns(0), d_streaming(false), d_length(0) {}
 
 /** The Sequence server-side constructor requires the name of the variable
  to be created and the dataset name from which this variable is being
@@ -105,7 +118,8 @@ D4Sequence::D4Sequence(const string &n)
 
  @brief The Sequence server-side constructor. */
 D4Sequence::D4Sequence(const string &n, const string &d)
-    : Constructor(n, d, dods_sequence_c, true /* is dap4 */), d_clauses(0), d_copy_clauses(true), d_length(0) {}
+    : Constructor(n, d, dods_sequence_c, true /* is dap4 */), d_clauses(0), d_copy_clauses(true), d_columnar(false),
+      d_columns(0), d_streaming(false), d_length(0) {}
 
 /** @brief The Sequence copy constructor. */
 D4Sequence::D4Sequence(const D4Sequence &rhs) : Constructor(rhs) { m_duplicate(rhs); }
@@ -131,6 +145,11 @@ void D4Sequence::clear_local_data() {
         d_values.resize(0);
     }
 
+    // The columns are rebuilt when next needed, since the projection may change.
+    delete d_columns;
+    d_columns = nullptr;
+    m_clear_row_cache();
+
     set_read_p(false);
 }
 
@@ -138,6 +157,8 @@ D4Sequence &D4Sequence::operator=(const D4Sequence &rhs) {
     if (this == &rhs)
         return *this;
     Constructor::operator=(rhs);
+    delete d_columns;
+    m_clear_row_cache();
     m_duplicate(rhs);
     return *this;
 }
@@ -220,6 +241,11 @@ void D4Sequence::read_sequence_values(bool filter) {
     if (read_p())
         return;
 
+    if (d_columnar) {
+        m_read_sequence_columns(filter);
+        return;
+    }
+
     // Read the data values, then serialize. NB: read_next_instance sets d_length
     // evaluates the filter expression
     while (read_next_instance(filter)) {
@@ -236,6 +262,8 @@ void D4Sequence::read_sequence_values(bool filter) {
                     row->push_back(d4s->ptr_duplicate());
                     d4s->d_copy_clauses = true; // Must be sure to not break the object in general
                     row->back()->set_read_p(true);
+                    // Make room for the next row's instance of the child sequence
+                    d4s->clear_local_data();
                 } else {
                     // store the variable's value.
                     row->push_back(var->ptr_duplicate());
@@ -257,6 +285,39 @@ void D4Sequence::read_sequence_values(bool filter) {
     DBGN(cerr << __PRETTY_FUNCTION__ << " END added " << d_values.size() << endl);
 }
 
+// The columnar version of read_sequence_values(): copy the value of each
+// projected member into its column instead of duplicating the member.
+void D4Sequence::m_read_sequence_columns(bool filter) {
+    D4SeqColumns &cols = columns();
+
+    while (read_next_instance(filter)) {
+        size_t col = 0;
+        for (auto &var : d_vars) {
+            if (!var->send_p())
+                continue;
+
+            if (var->type() == dods_sequence_c) {
+                const auto d4s = static_cast<D4Sequence *>(var);
+                d4s->read_sequence_values(filter);
+                cols.append(col++, *d4s);
+                // Make room for the next row's instance of the child sequence. Keep
+                // its columns, but otherwise reset it as clear_local_data() does.
+                if (d4s->d_columns) {
+                    d4s->d_columns->clear();
+                    d4s->m_clear_row_cache();
+                    d4s->set_read_p(false);
+                } else {
+                    d4s->clear_local_data();
+                }
+            } else {
+                cols.append(col++, *var);
+            }
+        }
+    }
+
+    set_length(cols.rows());
+}
+
 /**
  * @brief Serialize the values of a D4Sequence
  * This method assumes that the underlying data store cannot/does not return a count
@@ -279,10 +340,23 @@ void D4Sequence::read_sequence_values(bool filter) {
 void D4Sequence::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter) {
     DBGN(cerr << __PRETTY_FUNCTION__ << " BEGIN" << endl);
 
+    if (d_streaming && !read_p()) {
+        m_serialize_streaming(m, dmr, filter);
+        return;
+    }
+
     // Read the data values, then serialize. NB: read_next_instance sets d_length
     // evaluates the filter expression
     read_sequence_values(filter);
 
+    if (d_columnar) {
+        const uint64_t rows = columns().rows();
+        set_length(rows);
+        m.put_count(rows);
+        d_columns->serialize(m, 0, rows);
+        return;
+    }
+
     // write D4Sequence::length(); don't include the length in the checksum
     m.put_count(d_length);
 
@@ -297,11 +371,90 @@ void D4Sequence::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter) {
     DBGN(cerr << __PRETTY_FUNCTION__ << " END" << endl);
 }
 
+namespace {
+// Restore the marshaller's previous spool, even if serializing a row throws.
+class SpoolGuard {
+    D4StreamMarshaller &d_m;
+    MarshallerSpool *d_previous;
+
+public:
+    SpoolGuard(D4StreamMarshaller &m, MarshallerSpool *spool) : d_m(m), d_previous(m.set_spool(spool)) {}
+    ~SpoolGuard() { d_m.set_spool(d_previous); }
+};
+} // namespace
+
+// Write each instance as it is read instead of holding them all. If the
+// number of instances is known (filtered_length()) it is written first;
+// otherwise the instances are spooled and the count written when the last
+// one has been read. This applies the filter the way read_next_instance()
+// does, but writes the member values before they are reset for the next
+// call to read().
+void D4Sequence::m_serialize_streaming(D4StreamMarshaller &m, DMR &dmr, bool filter) {
+    const int64_t count = filtered_length(filter);
+
+    unique_ptr<MarshallerSpool> spool;
+    unique_ptr<SpoolGuard> guard;
+    if (count < 0) {
+        spool.reset(new MarshallerSpool());
+        guard.reset(new SpoolGuard(m, spool.get()));
+    } else {
+        m.put_count(count);
+    }
+
+    int64_t rows = 0;
+    while (!read()) {
+        if (!filter || !d_clauses || d_clauses->value()) {
+            for (auto &var : d_vars) {
+                if (var->send_p())
+                    var->serialize(m, dmr, filter);
+            }
+            ++rows;
+
+            // Writing to a file descriptor, array values are sent from the
+            // members' buffers, which the next read() replaces. Other values
+            // are copied and sent when the marshaller's staging buffer fills.
+            if (!spool && m.holds_references())
+                m.flush();
+        }
+
+        // Set up the next call to get another row's worth of data
+        set_read_p(false);
+    }
+    set_read_p(false);
+
+    set_length(rows);
+
+    if (count < 0) {
+        guard.reset();
+        m.put_count(rows);
+        m.put_spool(*spool);
+    } else if (rows != count) {
+        throw InternalErr(__FILE__, __LINE__,
+                          "The sequence '" + name() + "' had " + long_to_string(rows) + " rows, not the " +
+                              long_to_string(count) + " given by filtered_length().");
+    }
+}
+
 void D4Sequence::deserialize(D4StreamUnMarshaller &um, DMR &dmr) {
     const int64_t um_count = um.get_count();
 
     set_length(um_count);
 
+    if (d_columnar) {
+        // The sender's projection is the set of members in the client's DMR.
+        m_clear_row_cache();
+        delete d_columns;
+        d_columns = nullptr;
+        d_columns = new D4SeqColumns(*this, false);
+        d_columns->deserialize(um, um_count);
+        return;
+    }
+
+    // Replace any values from an earlier call (e.g., the previous instance of
+    // a nested sequence).
+    for_each(d_values.begin(), d_values.end(), delete_rows);
+    d_values.clear();
+
     for (int64_t i = 0; i < d_length; ++i) {
         auto row = make_unique<D4SeqRow>();
         for (const auto &var : d_vars) {
@@ -328,6 +481,94 @@ D4FilterClauseList &D4Sequence::clauses() {
     return *d_clauses;
 }
 
+/**
+ * @brief Store the values in columns
+ *
+ * A columnar sequence keeps one contiguous column per member (see
+ * D4SeqColumns) instead of a row of BaseType copies per instance, which
+ * takes a small fraction of the memory for long sequences of scalars.
+ * read_sequence_values(), serialize() and deserialize() use the columns,
+ * and row_value() and var_value() load values from them; value(),
+ * value_ref() and set_value() are not used. Handlers may also fill the
+ * columns directly using columns() or set_columns().
+ *
+ * The setting applies to the nested sequences too. Any values held are
+ * removed.
+ *
+ * @param state True to store values in columns, false to store them in rows
+ * @exception InternalErr if a member cannot be stored in a column
+ * @see D4SeqColumns::supported()
+ */
+void D4Sequence::set_columnar(bool state) {
+    if (state && !D4SeqColumns::supported(this))
+        throw InternalErr(__FILE__, __LINE__, "The members of '" + name() + "' cannot be stored in columns.");
+
+    clear_local_data();
+    d_columnar = state;
+
+    for (auto var : d_vars)
+        if (var->type() == dods_sequence_c)
+            static_cast<D4Sequence *>(var)->set_columnar(state);
+}
+
+/**
+ * @brief Write rows as they are read
+ *
+ * A streaming sequence's serialize() writes each instance as soon as read()
+ * returns it, so the values are not held in memory. The DAP4 row count
+ * precedes the rows: if filtered_length() knows it, it is written first;
+ * otherwise the rows are written to a MarshallerSpool (memory, then a
+ * temporary file) and copied to the marshaller after the count. The bytes
+ * sent, and their checksum, are the same either way.
+ *
+ * Because the values are not kept, intern_data() and the value accessors
+ * are not affected. A sequence whose values are already held (read_p() is
+ * true) serializes them as usual. The setting applies to the nested
+ * sequences too.
+ *
+ * @param state True to stream the rows, false to read them all first
+ */
+void D4Sequence::set_streaming(bool state) {
+    d_streaming = state;
+
+    for (auto var : d_vars)
+        if (var->type() == dods_sequence_c)
+            static_cast<D4Sequence *>(var)->set_streaming(state);
+}
+
+/**
+ * @brief The columns holding the values of a columnar sequence
+ * If there are none yet, empty columns are made for the projected members.
+ * A handler can append rows to them and then call set_read_p(true) so
+ * serialize() does not call read(). serialize() sets the length to the
+ * number of complete rows.
+ * @exception InternalErr if the sequence is not columnar
+ */
+D4SeqColumns &D4Sequence::columns() {
+    if (!d_columnar)
+        throw InternalErr(__FILE__, __LINE__, "The sequence '" + name() + "' does not store its values in columns.");
+
+    if (!d_columns)
+        d_columns = new D4SeqColumns(*this, true);
+    return *d_columns;
+}
+
+/**
+ * @brief Set the values of the sequence using columns
+ * This makes the sequence columnar. Like set_value(), this sets the length
+ * but not the read_p property.
+ * @param columns The values, one column per projected member. This sequence
+ * takes ownership of the object.
+ */
+void D4Sequence::set_columns(D4SeqColumns *columns) {
+    m_clear_row_cache();
+    if (columns != d_columns)
+        delete d_columns;
+    d_columns = columns;
+    d_columnar = true;
+    set_length(d_columns->rows());
+}
+
 #if INDEX_SUBSETTING
 /** Set the start, stop and stride for a row-number type constraint.
  This should be used only when the sequence is constrained using the
@@ -348,10 +589,33 @@ virtual void set_row_number_constraint(int start, int stop, int stride) {
 #endif
 
 /** @brief Get a whole row from the sequence.
+ For a columnar sequence the row is loaded from the columns into variables
+ owned by this sequence; they hold the values until the next call.
  @param row Get row number <i>row</i> from the sequence.
  @return A BaseTypeRow object (vector<BaseType *>). Null if there's no such
  row number as \e row. */
 D4SeqRow *D4Sequence::row_value(size_t row) {
+    if (d_columnar) {
+        if (!d_columns || row >= d_columns->rows())
+            return nullptr;
+
+        if (d_row_cache.empty()) {
+            for (size_t col = 0; col < d_columns->num_columns(); ++col) {
+                auto member = find_if(d_vars.begin(), d_vars.end(),
+                                      [this, col](const BaseType *btp) { return btp->name() == d_columns->name(col); });
+                if (member == d_vars.end())
+                    throw InternalErr(__FILE__, __LINE__, "No member for the sequence column " + d_columns->name(col));
+                d_row_cache.push_back((*member)->ptr_duplicate());
+            }
+        }
+
+        for (size_t col = 0; col < d_row_cache.size(); ++col) {
+            d_columns->value(col, row, *d_row_cache[col]);
+            d_row_cache[col]->set_read_p(true);
+        }
+        return &d_row_cache;
+    }
+
     if (row >= d_values.size())
         return nullptr;
     return d_values[row];
@@ -472,6 +736,7 @@ void D4Sequence::dump(ostream &strm) const {
     DapIndent::Indent();
     Constructor::dump(strm);
     strm << DapIndent::LMarg << "# rows deserialized: " << d_length << endl;
+    strm << DapIndent::LMarg << "columnar: " << (d_columnar ? "true" : "false") << endl;
     strm << DapIndent::LMarg << "bracket notation information:" << endl;
 
     DapIndent::Indent();
@@ -36,6 +36,7 @@ class Crc32;
 namespace libdap {
 class BaseType;
 class D4FilterClauseList;
+class D4SeqColumns;
 
 /** The type BaseTypeRow is used to store single rows of values in an
     instance of D4Sequence. Values are stored in instances of BaseType. */
@@ -141,6 +142,21 @@ private:
     // that. ...purely an optimization.
     bool d_copy_clauses;
 
+    // When true the values are stored in d_columns instead of d_values; see
+    // set_columnar(). d_columns is built when first needed.
+    bool d_columnar;
+    D4SeqColumns *d_columns;
+
+    // When true serialize() writes rows as they are read; see set_streaming().
+    bool d_streaming;
+
+    // The row last returned by row_value() for a columnar sequence.
+    D4SeqRow d_row_cache;
+
+    void m_clear_row_cache();
+    void m_read_sequence_columns(bool filter);
+    void m_serialize_streaming(D4StreamMarshaller &m, DMR &dmr, bool filter);
+
 protected:
     // This holds the values of the sequence. Values are stored in
     // instances of BaseTypeRow objects which hold instances of BaseType.
@@ -223,6 +239,28 @@ public:
 
     D4FilterClauseList &clauses();
 
+    void set_columnar(bool state);
+    /// @brief Are the values stored in columns? @see set_columnar()
+    bool columnar() const { return d_columnar; }
+    D4SeqColumns &columns();
+    void set_columns(D4SeqColumns *columns);
+
+    void set_streaming(bool state);
+    /// @brief Does serialize() write rows as they are read? @see set_streaming()
+    bool streaming() const { return d_streaming; }
+
+    /**
+     * @brief The number of rows serialize() will send, if known before reading them
+     * Specialize this if the data store can tell how many rows satisfy the
+     * filter (e.g., the table has no filter clauses and its size is known).
+     * A streaming sequence then writes each row as it is read; otherwise the
+     * rows are spooled until the count is known.
+     * @param filter True if the filter clauses will be evaluated
+     * @return The number of rows, or -1 if it is not known (the default)
+     * @see set_streaming()
+     */
+    virtual int64_t filtered_length(bool /*filter*/) { return -1; }
+
 #if INDEX_SUBSETTING
     /** Return the starting row number if the sequence was constrained using
         row numbers (instead of, or in addition to, a relational constraint).
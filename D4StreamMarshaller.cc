@@ -27,20 +27,31 @@
 #include "config.h"
 
 #include <cassert>
+#include <cerrno>
+#include <climits>
 #include <cstring>
 
+#include <algorithm>
+
 #include <iomanip>
 #include <limits>
+#include <memory>
 #include <sstream>
 
 #ifdef HAVE_PTHREAD_H
 #include <pthread.h>
 #endif
 
+#include <sys/uio.h>
+#include <unistd.h>
+
 #include "D4StreamMarshaller.h"
 #ifdef USE_POSIX_THREADS
 #include "MarshallerThread.h"
 #endif
+#include "MarshallerSpool.h"
+#include "MarshallerStats.h"
+#include "UringSink.h"
 
 #if USE_XDR_FOR_IEEE754_ENCODING
 #include "XDRUtils.h"
@@ -87,7 +98,7 @@ void D4StreamMarshaller::m_serialize_reals(char *val, unsigned int num, int widt
             }
         }
 #ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 
         tm->increment_child_thread_count();
         tm->start_thread(MarshallerThread::write_thread, d_out, buf, size);
@@ -135,7 +146,47 @@ D4StreamMarshaller::D4StreamMarshaller(ostream &out, bool write_data, bool compu
     out.exceptions(ostream::failbit | ostream::badbit);
 }
 
+/** Build an instance of D4StreamMarshaller that writes to a file descriptor.
+ *
+ * In this mode the marshaller never copies array values. Values are
+ * gathered as a list of iovecs - small values (counts, scalars, checksums)
+ * are copied to a small staging buffer, while the memory passed to
+ * put_vector() and friends is referenced in place - and written with
+ * writev(2). The pending values are written when put_checksum() is
+ * called (so a top-level variable's values and its checksum go out in one
+ * call), at the end of each put_vector() call when checksums are not being
+ * computed, when flush() is called and by the destructor.
+ *
+ * @note The memory passed to put_vector*() and put_opaque_dap4() must stay
+ * valid until it has been written. Vector::serialize() and D4Group::serialize()
+ * satisfy this because a Vector's buffer outlives the serialization of the
+ * top-level variable that holds it.
+ *
+ * @param fd Write to this file descriptor. The caller owns it.
+ * @param write_data If true, write data values. True by default
+ * @param compute_checksums If true, compute checksums. False by default
+ */
+D4StreamMarshaller::D4StreamMarshaller(int fd, bool write_data, bool compute_checksums)
+    : d_out(std::cerr), d_out_fd(fd), d_write_data(write_data), d_compute_checksum(compute_checksums) {
+    assert(fd >= 0);
+
+#if USE_XDR_FOR_IEEE754_ENCODING
+    xdrmem_create(&d_scalar_sink, d_ieee754_buf, sizeof(dods_float64), XDR_ENCODE);
+#endif
+
+    // Reserve once; the iovecs point into this storage, so it must not be reallocated.
+    d_staged.reserve(staging_size);
+}
+
 D4StreamMarshaller::~D4StreamMarshaller() {
+    if (d_out_fd != -1) {
+        try {
+            flush();
+        } catch (...) {
+            // Destructors must not throw
+        }
+        delete d_sink;
+    }
 #if USE_XDR_FOR_IEEE754_ENCODING
     xdr_destroy(&d_scalar_sink);
 #endif
@@ -144,6 +195,222 @@ D4StreamMarshaller::~D4StreamMarshaller() {
 #endif
 }
 
+// private
+/**
+ * Write a small value. With a file descriptor, the bytes are copied to the
+ * staging buffer and sent with the next writev(); otherwise they are
+ * written to the ostream once any child-thread write has finished.
+ */
+void D4StreamMarshaller::m_write(const void *data, std::streamsize num_bytes) {
+    MarshallerTimer timer(d_stats);
+    if (d_spool) {
+        d_spool->write(data, num_bytes);
+        return;
+    }
+
+    if (d_stats)
+        d_stats->add_bytes(num_bytes);
+
+    if (d_sink) {
+        d_sink->write(data, num_bytes);
+        return;
+    }
+
+    if (d_out_fd != -1) {
+        if (num_bytes > static_cast<std::streamsize>(staging_size)) {
+            // Too big to stage; reference it and send it now, while it is still valid.
+            m_write_iov(const_cast<void *>(data), num_bytes);
+            flush();
+            return;
+        }
+
+        // Flush before copying: m_write_iov() flushes when the iovec list is
+        // full, and that would clear d_staged under the new value.
+        if (d_staged.size() + num_bytes > d_staged.capacity() || d_iov.size() >= static_cast<size_t>(IOV_MAX))
+            flush();
+
+        char *dest = d_staged.data() + d_staged.size();
+        d_staged.insert(d_staged.end(), static_cast<const char *>(data), static_cast<const char *>(data) + num_bytes);
+        m_write_iov(dest, num_bytes);
+        return;
+    }
+
+#ifdef USE_POSIX_THREADS
+    // make sure that a child thread is not writing to d_out.
+    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
+    m_release_vec_buf();
+#endif
+    d_out.write(static_cast<const char *>(data), num_bytes);
+}
+
+// private
+/**
+ * Write the values of a vector. With a file descriptor, reference the
+ * caller's memory in place (no copy). With an ostream and threads, copy
+ * the values so that a child thread can write them while the caller moves
+ * on to the next variable (or reads the next slab of this one).
+ *
+ * The copy is made after waiting for the previous write, so the caller's
+ * values and one copy are all that is in memory at once; the write still
+ * overlaps the caller's work on what comes next. The buffer is reused
+ * unless it grew past vec_buf_keep bytes.
+ */
+void D4StreamMarshaller::m_write_vector(const char *val, int64_t num_bytes) {
+    MarshallerTimer timer(d_stats);
+    if (d_spool) {
+        d_spool->write(val, num_bytes);
+        return;
+    }
+
+    if (d_stats)
+        d_stats->add_bytes(num_bytes);
+
+    if (d_sink) {
+        d_sink->write(val, num_bytes);
+        return;
+    }
+
+    if (d_out_fd != -1) {
+        m_write_iov(const_cast<char *>(val), num_bytes);
+        d_iov_refs = true;
+        // Without a checksum there's no trailer to wait for.
+        if (!d_compute_checksum)
+            flush();
+        return;
+    }
+
+#ifdef USE_POSIX_THREADS
+    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
+    m_release_vec_buf();
+    if (d_vec_buf.size() < static_cast<size_t>(num_bytes))
+        d_vec_buf.resize(num_bytes);
+    memcpy(d_vec_buf.data(), val, num_bytes);
+
+    tm->increment_child_thread_count();
+    tm->start_thread(MarshallerThread::write_thread, d_out, d_vec_buf.data(), num_bytes, false);
+#else
+    segmented_write(d_out, val, num_bytes);
+#endif
+}
+
+#ifdef USE_POSIX_THREADS
+// private
+/// Free the vector copy if it is large; call with a Locker held, so it has been written.
+void D4StreamMarshaller::m_release_vec_buf() {
+    if (d_vec_buf.capacity() > vec_buf_keep)
+        vector<char>().swap(d_vec_buf);
+}
+#endif
+
+// private
+/// Add a region to the pending writev() list, merging it with the previous one if they are adjacent.
+void D4StreamMarshaller::m_write_iov(void *data, int64_t num_bytes) {
+    if (num_bytes == 0)
+        return;
+
+    if (!d_iov.empty()) {
+        struct iovec &last = d_iov.back();
+        if (static_cast<char *>(last.iov_base) + last.iov_len == data) {
+            last.iov_len += num_bytes;
+            return;
+        }
+    }
+
+    if (d_iov.size() >= static_cast<size_t>(IOV_MAX))
+        flush();
+
+    struct iovec v;
+    v.iov_base = data;
+    v.iov_len = num_bytes;
+    d_iov.push_back(v);
+}
+
+/**
+ * @brief Use io_uring to write to the file descriptor
+ *
+ * The io_uring sink copies values to its buffers, so once this is called
+ * the memory passed to put_vector() and friends need not outlive the call.
+ * A buffer is written when it is full, while the next one is filled; flush()
+ * and the destructor write the rest and wait for all the writes to finish.
+ *
+ * @param depth The number of buffers, and so the most writes in flight.
+ * Writes to a socket or pipe are made one at a time so they stay in order.
+ * @return True if io_uring is used. False if this marshaller writes to an
+ * ostream or the host cannot use io_uring; the marshaller is unchanged.
+ * @see UringSink
+ */
+bool D4StreamMarshaller::use_uring(unsigned int depth) {
+    if (d_out_fd == -1)
+        return false;
+    if (d_sink)
+        return true;
+    if (!UringSink::available())
+        return false;
+
+    flush(); // send anything gathered for writev()
+
+    unique_ptr<UringSink> sink(new UringSink(d_out_fd, depth));
+    if (!sink->using_uring())
+        return false;
+
+    d_sink = sink.release();
+    return true;
+}
+
+/**
+ * @brief The number of system calls made to write to the file descriptor
+ * This counts the writev(2) calls, plus the io_uring_enter(2) calls once
+ * use_uring() has been called. It is always zero with an ostream.
+ */
+uint64_t D4StreamMarshaller::write_syscalls() const { return d_writev_calls + (d_sink ? d_sink->syscalls() : 0); }
+
+/**
+ * @brief Write any values waiting to be sent to the file descriptor.
+ *
+ * This does nothing when the marshaller writes to an ostream.
+ *
+ * @exception Error if writev(2) or an io_uring write fails
+ */
+void D4StreamMarshaller::flush() {
+    MarshallerTimer timer(d_stats);
+
+    if (d_sink) {
+        d_sink->flush();
+        return;
+    }
+
+    size_t first = 0;
+    while (first < d_iov.size()) {
+        int count = static_cast<int>(std::min(d_iov.size() - first, static_cast<size_t>(IOV_MAX)));
+        ssize_t bytes = writev(d_out_fd, &d_iov[first], count);
+        ++d_writev_calls;
+        if (bytes < 0) {
+            if (errno == EINTR)
+                continue;
+            d_iov.clear();
+            d_staged.clear();
+            d_iov_refs = false;
+            throw Error(string("Network I/O Error. Could not write data: ") + strerror(errno));
+        }
+
+        // Skip past what was written; a short write may end mid-iovec.
+        while (bytes > 0 && first < d_iov.size()) {
+            if (static_cast<size_t>(bytes) >= d_iov[first].iov_len) {
+                bytes -= d_iov[first].iov_len;
+                ++first;
+            } else {
+                d_iov[first].iov_base = static_cast<char *>(d_iov[first].iov_base) + bytes;
+                d_iov[first].iov_len -= bytes;
+                bytes = 0;
+            }
+        }
+    }
+
+    d_iov.clear();
+    d_staged.clear();
+    d_iov_refs = false;
+}
+
 /** Initialize the checksum buffer. This resets the checksum calculation.
  */
 void D4StreamMarshaller::reset_checksum() { d_checksum.Reset(); }
@@ -159,16 +426,26 @@ void D4StreamMarshaller::reset_checksum() { d_checksum.Reset(); }
  * @return The checksum in a string object that always has eight characters.
  */
 string D4StreamMarshaller::get_checksum() {
+    ostringstream oss;
+    oss.setf(ios::hex, ios::basefield);
+    oss << setfill('0') << setw(8) << get_checksum_value();
+
+    return oss.str();
+}
+
+/**
+ * Get the current checksum as a number, the value put_checksum() writes.
+ * Use this instead of parsing the string from get_checksum().
+ *
+ * @return The checksum of the data since the last call to reset_checksum()
+ */
+Crc32::checksum D4StreamMarshaller::get_checksum_value() const {
     if (!d_compute_checksum) {
         string errmsg = "Cannot get a checksum when checksums are not being computed! ";
         errmsg.append("(d_compute_checksum: false)");
         throw InternalErr(__FILE__, __LINE__, errmsg);
     }
-    ostringstream oss;
-    oss.setf(ios::hex, ios::basefield);
-    oss << setfill('0') << setw(8) << d_checksum.GetCrc32();
-
-    return oss.str();
+    return d_checksum.GetCrc32();
 }
 
 /**
@@ -185,10 +462,31 @@ void D4StreamMarshaller::put_checksum() {
     }
 
     Crc32::checksum chk = d_checksum.GetCrc32();
-#ifdef USE_POSIX_THREADS
-    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-    d_out.write(reinterpret_cast<char *>(&chk), sizeof(Crc32::checksum));
+    m_write(&chk, sizeof(Crc32::checksum));
+
+    // The checksum ends a top-level variable; send it and the values it covers.
+    if (d_out_fd != -1 && !d_sink)
+        flush();
+}
+
+/**
+ * @brief Write a checksum computed elsewhere
+ * Like put_checksum(), but write the given value instead of the one computed
+ * by this marshaller.
+ * @param crc The checksum of the values sent since the last call to reset_checksum()
+ * @see pause_checksum()
+ */
+void D4StreamMarshaller::put_checksum(Crc32::checksum crc) {
+    if (!d_compute_checksum) {
+        string errmsg = "Cannot put a checksum when checksums are not being computed! ";
+        errmsg.append("(d_compute_checksum: false)");
+        throw InternalErr(__FILE__, __LINE__, errmsg);
+    }
+
+    m_write(&crc, sizeof(Crc32::checksum));
+
+    if (d_out_fd != -1 && !d_sink)
+        flush();
 }
 
 /**
@@ -196,7 +494,8 @@ void D4StreamMarshaller::put_checksum() {
  * zero has no effect on the checksum value.
  */
 void D4StreamMarshaller::checksum_update(const void *data, unsigned long len) {
-    if (d_compute_checksum) {
+    if (d_compute_checksum && !d_checksum_paused) {
+        MarshallerTimer timer(d_stats);
         d_checksum.AddData(static_cast<const uint8_t *>(data), len);
     }
 }
@@ -206,11 +505,7 @@ void D4StreamMarshaller::put_byte(dods_byte val) {
 
     if (d_write_data) {
         DBG(std::cerr << "put_byte: " << val << std::endl);
-#ifdef USE_POSIX_THREADS
-        // make sure that a child thread is not writing to d_out.
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-        d_out.write(reinterpret_cast<char *>(&val), sizeof(dods_byte));
+        m_write(&val, sizeof(dods_byte));
     }
 }
 
@@ -219,10 +514,7 @@ void D4StreamMarshaller::put_int8(dods_int8 val) {
 
     if (d_write_data) {
         DBG(std::cerr << "put_int8: " << val << std::endl);
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-        d_out.write(reinterpret_cast<char *>(&val), sizeof(dods_int8));
+        m_write(&val, sizeof(dods_int8));
     }
 }
 
@@ -230,10 +522,7 @@ void D4StreamMarshaller::put_int16(dods_int16 val) {
     checksum_update(&val, sizeof(dods_int16));
 
     if (d_write_data) {
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-        d_out.write(reinterpret_cast<char *>(&val), sizeof(dods_int16));
+        m_write(&val, sizeof(dods_int16));
     }
 }
 
@@ -241,10 +530,7 @@ void D4StreamMarshaller::put_int32(dods_int32 val) {
     checksum_update(&val, sizeof(dods_int32));
 
     if (d_write_data) {
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-        d_out.write(reinterpret_cast<char *>(&val), sizeof(dods_int32));
+        m_write(&val, sizeof(dods_int32));
     }
 }
 
@@ -252,10 +538,7 @@ void D4StreamMarshaller::put_int64(dods_int64 val) {
     checksum_update(&val, sizeof(dods_int64));
 
     if (d_write_data) {
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-        d_out.write(reinterpret_cast<const char *>(&val), sizeof(dods_int64));
+        m_write(&val, sizeof(dods_int64));
     }
 }
 
@@ -266,10 +549,7 @@ void D4StreamMarshaller::put_float32(dods_float32 val) {
     checksum_update(&val, sizeof(dods_float32));
 
     if (d_write_data) {
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-        d_out.write(reinterpret_cast<const char *>(&val), sizeof(dods_float32));
+        m_write(&val, sizeof(dods_float32));
     }
 
 #else
@@ -280,10 +560,7 @@ void D4StreamMarshaller::put_float32(dods_float32 val) {
 
     if (d_write_data) {
         if (std::numeric_limits<float>::is_iec559) {
-#ifdef USE_POSIX_THREADS
-            Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-            d_out.write(reinterpret_cast<char *>(&val), sizeof(dods_float32));
+            m_write(&val, sizeof(dods_float32));
         } else {
             if (!xdr_setpos(&d_scalar_sink, 0))
                 throw InternalErr(__FILE__, __LINE__, "Error serializing a Float32 variable");
@@ -301,7 +578,7 @@ void D4StreamMarshaller::put_float32(dods_float32 val) {
                 *i = bswap_32(*i);
             }
 #ifdef USE_POSIX_THREADS
-            Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+            Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 #endif
             d_out.write(d_ieee754_buf, sizeof(dods_float32));
         }
@@ -316,20 +593,14 @@ void D4StreamMarshaller::put_float64(dods_float64 val) {
     checksum_update(&val, sizeof(dods_float64));
 
     if (d_write_data) {
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-        d_out.write(reinterpret_cast<const char *>(&val), sizeof(dods_float64));
+        m_write(&val, sizeof(dods_float64));
     }
 
 #else
     // See the comment above in put_float32()
     if (d_write_data) {
         if (std::numeric_limits<double>::is_iec559) {
-#ifdef USE_POSIX_THREADS
-            Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-            d_out.write(reinterpret_cast<char *>(&val), sizeof(dods_float64));
+            m_write(&val, sizeof(dods_float64));
         }
     } else {
         if (!xdr_setpos(&d_scalar_sink, 0))
@@ -349,7 +620,7 @@ void D4StreamMarshaller::put_float64(dods_float64 val) {
         }
 
 #ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 #endif
         d_out.write(d_ieee754_buf, sizeof(dods_float64));
     }
@@ -361,10 +632,7 @@ void D4StreamMarshaller::put_uint16(dods_uint16 val) {
     checksum_update(&val, sizeof(dods_uint16));
 
     if (d_write_data) {
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-        d_out.write(reinterpret_cast<char *>(&val), sizeof(dods_uint16));
+        m_write(&val, sizeof(dods_uint16));
     }
 }
 
@@ -372,10 +640,7 @@ void D4StreamMarshaller::put_uint32(dods_uint32 val) {
     checksum_update(&val, sizeof(dods_uint32));
 
     if (d_write_data) {
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-        d_out.write(reinterpret_cast<char *>(&val), sizeof(dods_uint32));
+        m_write(&val, sizeof(dods_uint32));
     }
 }
 
@@ -383,13 +648,37 @@ void D4StreamMarshaller::put_uint64(dods_uint64 val) {
     checksum_update(&val, sizeof(dods_uint64));
 
     if (d_write_data) {
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-        d_out.write(reinterpret_cast<char *>(&val), sizeof(dods_uint64));
+        m_write(&val, sizeof(dods_uint64));
     }
 }
 
+/**
+ * @brief Divert the output to a spool
+ * While a spool is set, everything written goes to it instead of the
+ * stream or file descriptor; checksums are computed as usual. Write the
+ * spooled bytes with put_spool() once the spool is unset. Spools nest: the
+ * previous spool is returned so the caller can restore it.
+ * @param spool The spool, or null to write to the stream or file descriptor
+ * @return The spool that was set
+ */
+MarshallerSpool *D4StreamMarshaller::set_spool(MarshallerSpool *spool) {
+    MarshallerSpool *previous = d_spool;
+    d_spool = spool;
+    return previous;
+}
+
+/**
+ * @brief Write the bytes held in a spool
+ * They are written as they are; they were added to the checksum when they
+ * were spooled.
+ */
+void D4StreamMarshaller::put_spool(MarshallerSpool &spool) {
+    if (&spool == d_spool)
+        throw InternalErr(__FILE__, __LINE__, "Cannot write a spool to itself.");
+
+    spool.read([this](const char *data, size_t num_bytes) { m_write(data, num_bytes); });
+}
+
 /**
  * Used only for Sequences, where the count must be added to the stream
  * and then the fields sent using separate calls to methods here. The
@@ -398,23 +687,15 @@ void D4StreamMarshaller::put_uint64(dods_uint64 val) {
  *
  * @param count The number of elements that will follow in the stream.
  */
-void D4StreamMarshaller::put_count(int64_t count) {
-#ifdef USE_POSIX_THREADS
-    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-    d_out.write(reinterpret_cast<const char *>(&count), sizeof(int64_t));
-}
+void D4StreamMarshaller::put_count(int64_t count) { m_write(&count, sizeof(int64_t)); }
 
 void D4StreamMarshaller::put_str(const string &val) {
     checksum_update(val.c_str(), val.length());
 
     if (d_write_data) {
         const auto len = static_cast<int64_t>(val.length());
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-#endif
-        d_out.write(reinterpret_cast<const char *>(&len), sizeof(int64_t));
-        d_out.write(val.data(), static_cast<std::streamsize>(val.length()));
+        m_write(&len, sizeof(int64_t));
+        m_write(val.data(), static_cast<std::streamsize>(val.length()));
     }
 }
 
@@ -427,20 +708,8 @@ void D4StreamMarshaller::put_opaque_dap4(const char *val, int64_t num_bytes) {
     checksum_update(val, num_bytes);
 
     if (d_write_data) {
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-
-        d_out.write(reinterpret_cast<const char *>(&num_bytes), sizeof(int64_t));
-
-        char *byte_buf = new char[num_bytes];
-        memcpy(byte_buf, val, num_bytes);
-
-        tm->increment_child_thread_count();
-        tm->start_thread(MarshallerThread::write_thread, d_out, byte_buf, num_bytes);
-#else
-        d_out.write(reinterpret_cast<const char *>(&num_bytes), sizeof(int64_t));
-        segmented_write(d_out, val, num_bytes);
-#endif
+        m_write(&num_bytes, sizeof(int64_t));
+        m_write_vector(val, num_bytes);
     }
 }
 
@@ -457,17 +726,7 @@ void D4StreamMarshaller::put_vector(char *val, int64_t num_bytes) {
     checksum_update(val, num_bytes);
 
     if (d_write_data) {
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-
-        char *buf = new char[num_bytes];
-        memcpy(buf, val, num_bytes);
-
-        tm->increment_child_thread_count();
-        tm->start_thread(MarshallerThread::write_thread, d_out, buf, num_bytes);
-#else
-        segmented_write(d_out, val, num_bytes);
-#endif
+        m_write_vector(val, num_bytes);
     }
 }
 
@@ -502,17 +761,7 @@ void D4StreamMarshaller::put_vector(char *val, int64_t num_elem, int elem_size)
     checksum_update(val, num_bytes);
 
     if (d_write_data) {
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-
-        char *buf = new char[num_bytes];
-        memcpy(buf, val, num_bytes);
-
-        tm->increment_child_thread_count();
-        tm->start_thread(MarshallerThread::write_thread, d_out, buf, num_bytes);
-#else
-        segmented_write(d_out, val, num_bytes);
-#endif
+        m_write_vector(val, num_bytes);
     }
 }
 
@@ -540,17 +789,7 @@ void D4StreamMarshaller::put_vector_float32(char *val, int64_t num_elem) {
     checksum_update(val, num_bytes);
 
     if (d_write_data) {
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-
-        char *buf = new char[num_bytes];
-        memcpy(buf, val, num_bytes);
-
-        tm->increment_child_thread_count();
-        tm->start_thread(MarshallerThread::write_thread, d_out, buf, num_bytes);
-#else
-        segmented_write(d_out, val, num_bytes);
-#endif
+        m_write_vector(val, num_bytes);
     }
 
 #else
@@ -572,7 +811,7 @@ void D4StreamMarshaller::put_vector_float32(char *val, int64_t num_elem) {
             m_serialize_reals(val, num_elem, 4, type);
         } else {
 #ifdef USE_POSIX_THREADS
-            Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+            Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 
             char *buf = new char[bytes];
             memcpy(buf, val, bytes);
@@ -606,17 +845,7 @@ void D4StreamMarshaller::put_vector_float64(char *val, int64_t num_elem) {
     checksum_update(val, num_bytes);
 
     if (d_write_data) {
-#ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-
-        char *buf = new char[num_bytes];
-        memcpy(buf, val, num_bytes);
-
-        tm->increment_child_thread_count();
-        tm->start_thread(MarshallerThread::write_thread, d_out, buf, num_bytes);
-#else
-        segmented_write(d_out, val, num_bytes);
-#endif
+        m_write_vector(val, num_bytes);
     }
 #else
     assert(val);
@@ -637,7 +866,7 @@ void D4StreamMarshaller::put_vector_float64(char *val, int64_t num_elem) {
             m_serialize_reals(val, num_elem, 8, type);
         } else {
 #ifdef USE_POSIX_THREADS
-            Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+            Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 
             char *buf = new char[bytes];
             memcpy(buf, val, bytes);
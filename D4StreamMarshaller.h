@@ -45,6 +45,10 @@
 #endif
 #endif
 
+#include <sys/uio.h>
+
+#include <vector>
+
 #include "crc.h"
 
 #include "InternalErr.h"
@@ -53,7 +57,9 @@
 namespace libdap {
 
 class Vector;
+class MarshallerSpool;
 class MarshallerThread;
+class UringSink;
 
 /** @brief Marshaller that knows how to marshal/serialize dap data objects
  * to a C++ iostream using DAP4's receiver-makes-right scheme. This code
@@ -73,13 +79,34 @@ class D4StreamMarshaller : public Marshaller {
 #endif
 
     ostream &d_out;
+    int d_out_fd = -1;               // if not -1, write to this using writev(); d_out is unused
     bool d_write_data = true;        // jhrg 1/27/12
     bool d_compute_checksum = false; // ndp 08/03/25
+    bool d_checksum_paused = false;  // see pause_checksum()
 
     Crc32 d_checksum;
 
     MarshallerThread *tm = nullptr;
 
+    // Used only with the child thread; a reusable copy of a vector, see m_write_vector()
+    static const size_t vec_buf_keep = 16 * 1024 * 1024;
+    std::vector<char> d_vec_buf;
+
+    // Used only when writing to a file descriptor
+    static const size_t staging_size = 64 * 1024;
+    std::vector<struct iovec> d_iov; // pending writes, in order
+    std::vector<char> d_staged;      // copies of small values referenced by d_iov
+    bool d_iov_refs = false;         // d_iov also references the caller's memory
+    UringSink *d_sink = nullptr;     // if not null, write with io_uring instead; see use_uring()
+    uint64_t d_writev_calls = 0;
+
+    MarshallerSpool *d_spool = nullptr; // if not null, output goes here instead; see set_spool()
+
+    void m_write(const void *data, std::streamsize num_bytes);
+    void m_write_vector(const char *val, int64_t num_bytes);
+    void m_release_vec_buf();
+    void m_write_iov(void *data, int64_t num_bytes);
+
 #if USE_XDR_FOR_IEEE754_ENCODING
     void m_serialize_reals(char *val, int64_t num, int width, Type type);
 #endif
@@ -92,6 +119,7 @@ public:
      * @param compute_checksums True to update/emit checksums while writing.
      */
     explicit D4StreamMarshaller(std::ostream &out, bool write_data = true, bool compute_checksums = false);
+    explicit D4StreamMarshaller(int fd, bool write_data = true, bool compute_checksums = false);
 
     D4StreamMarshaller() = delete;
     D4StreamMarshaller(const D4StreamMarshaller &) = delete;
@@ -103,11 +131,64 @@ public:
 
     virtual void reset_checksum();
     virtual string get_checksum();
+    Crc32::checksum get_checksum_value() const;
     virtual void checksum_update(const void *data, unsigned long len);
 
     virtual void put_checksum();
+    virtual void put_checksum(Crc32::checksum crc);
+
+    /**
+     * @brief Stop (or restart) updating the checksum.
+     * Use this with put_checksum(Crc32::checksum) when the checksum of a
+     * variable was computed elsewhere (e.g., by D4Group's read-ahead threads)
+     * so that it is not computed twice.
+     * @param pause True to stop updating the checksum, false to restart.
+     */
+    void pause_checksum(bool pause) { d_checksum_paused = pause; }
+
+    /**
+     * @brief Compute the checksums of large vectors using several threads.
+     * Each vector is split into segments whose CRCs are computed in parallel
+     * and then combined; the checksum is the same as the serial one. This also
+     * works when the marshaller only computes checksums (write_data is false).
+     * @param threads The most threads to use; 1 (the default) turns this off.
+     */
+    void set_checksum_threads(unsigned int threads) { d_checksum.SetThreads(threads); }
+
+    /// @brief How many threads the checksum of a large vector may use.
+    unsigned int checksum_threads() const { return d_checksum.GetThreads(); }
+
+    /**
+     * @brief Write to the file descriptor using io_uring.
+     * Values are copied to a few large buffers that are written while the
+     * next ones are filled, instead of being written with writev(2) once per
+     * variable. Only a marshaller built with a file descriptor can do this.
+     * @param depth The number of buffers, and so the most writes in flight
+     * @return True if io_uring will be used, false if it is not available
+     * (writev(2) is used, as before).
+     */
+    bool use_uring(unsigned int depth = 4);
+
+    /// @brief True if use_uring() was called and io_uring is in use.
+    bool using_uring() const { return d_sink != nullptr; }
+
+    uint64_t write_syscalls() const;
+
+    /**
+     * @brief Are values waiting to be written still in the caller's memory?
+     * Writing to a file descriptor, the values of a vector are sent from the
+     * caller's buffer when flush() is next called; until then the buffer
+     * must not change. Other values are copied.
+     */
+    bool holds_references() const { return d_iov_refs; }
+
+    MarshallerSpool *set_spool(MarshallerSpool *spool);
+    void put_spool(MarshallerSpool &spool);
+
     virtual void put_count(int64_t count);
 
+    virtual void flush();
+
     /** @copydoc Marshaller::put_byte */
     void put_byte(dods_byte val) override;
     /** @brief Serialize one DAP4 `Int8` value.
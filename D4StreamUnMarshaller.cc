@@ -41,6 +41,7 @@
 #include "D4StreamUnMarshaller.h"
 #include "DapIndent.h"
 #include "InternalErr.h"
+#include "byte_order.h"
 #include "debug.h"
 #include "util.h"
 
@@ -279,35 +280,32 @@ void D4StreamUnMarshaller::m_deserialize_reals(char *val, int64_t num, int width
 #endif
 
 void D4StreamUnMarshaller::m_twidle_vector_elements(char *vals, int64_t num, int width) {
-    switch (width) {
-    case 2: {
-        dods_int16 *local = reinterpret_cast<dods_int16 *>(vals);
-        while (num--) {
-            *local = bswap_16(*local);
-            local++;
-        }
-        break;
-    }
-    case 4: {
-        dods_int32 *local = reinterpret_cast<dods_int32 *>(vals);
-        ;
-        while (num--) {
-            *local = bswap_32(*local);
-            local++;
-        }
-        break;
-    }
-    case 8: {
-        dods_int64 *local = reinterpret_cast<dods_int64 *>(vals);
-        ;
-        while (num--) {
-            *local = bswap_64(*local);
-            local++;
-        }
-        break;
-    }
-    default:
+    if (width != 2 && width != 4 && width != 8)
         throw InternalErr(__FILE__, __LINE__, "Unrecognized word size.");
+
+    byte_swap(vals, vals, num, width);
+}
+
+// private
+/**
+ * Read num elements, each width bytes, into val and swap them if the sender's
+ * byte order differs from ours. When swapping, the vector is read in pieces
+ * small enough to still be in the cache when they are swapped, so the swap
+ * does not make a second pass over the whole vector in memory.
+ */
+void D4StreamUnMarshaller::m_read_vector(char *val, int64_t num, int width) {
+    if (!d_twiddle_bytes) {
+        d_in.read(val, num * width);
+        return;
+    }
+
+    const int64_t block = swap_block_size / width; // elements
+    while (num > 0) {
+        int64_t n = min(num, block);
+        d_in.read(val, n * width);
+        m_twidle_vector_elements(val, n, width);
+        val += n * width;
+        num -= n;
     }
 }
 
@@ -343,10 +341,10 @@ void D4StreamUnMarshaller::get_vector(char *val, int64_t num_elem, int elem_size
         break;
     }
 
-    d_in.read(val, bytes);
-
     if (d_twiddle_bytes)
-        m_twidle_vector_elements(val, num_elem, elem_size);
+        m_read_vector(val, num_elem, elem_size);
+    else
+        d_in.read(val, bytes);
 }
 
 void D4StreamUnMarshaller::get_vector_float32(char *val, int64_t num_elem) {
@@ -356,12 +354,7 @@ void D4StreamUnMarshaller::get_vector_float32(char *val, int64_t num_elem) {
     assert(num_elem >= 0);
     assert(!(num_elem & 0x6000000000000000)); // 0x 60 00 --> 0110 0000
 
-    int64_t bytes = num_elem << 2;
-
-    d_in.read(val, bytes);
-
-    if (d_twiddle_bytes)
-        m_twidle_vector_elements(val, num_elem, sizeof(dods_float32));
+    m_read_vector(val, num_elem, sizeof(dods_float32));
 
 #else
     if (type == dods_float32_c && !std::numeric_limits<float>::is_iec559) {
@@ -384,12 +377,7 @@ void D4StreamUnMarshaller::get_vector_float64(char *val, int64_t num_elem) {
     assert(num_elem >= 0);
     assert(!(num_elem & 0x7000000000000000)); // 0x 70 00 --> 0111 0000
 
-    int64_t bytes = num_elem << 3;
-
-    d_in.read(val, bytes);
-
-    if (d_twiddle_bytes)
-        m_twidle_vector_elements(val, num_elem, sizeof(dods_float64));
+    m_read_vector(val, num_elem, sizeof(dods_float64));
 
 #else
     if (type == dods_float32_c && !std::numeric_limits<float>::is_iec559) {
@@ -71,6 +71,9 @@ private:
     istream &d_in;
     bool d_twiddle_bytes;
 
+    // When swapping, read vectors in pieces of about this many bytes
+    static const int64_t swap_block_size = 32 * 1024;
+
 #if USE_XDR_FOR_IEEE754_ENCODING
     // These are used for reals that need to be converted from IEEE 754
     XDR d_source;
@@ -84,6 +87,7 @@ private:
     void m_deserialize_reals(char *val, int64_t num, int width, Type type);
 #endif
     void m_twidle_vector_elements(char *vals, int64_t num, int width);
+    void m_read_vector(char *val, int64_t num, int width);
 
 public:
     /**
@@ -496,6 +496,7 @@ void DDS::add_var(BaseType *bt) {
         btp = 0;
     } else {
         vars.push_back(btp);
+        d_vars_index.reset();
     }
 }
 
@@ -511,6 +512,7 @@ void DDS::add_var_nocopy(BaseType *bt) {
         d_container->add_var_nocopy(bt);
     } else {
         vars.push_back(bt);
+        d_vars_index.reset();
     }
 }
 
@@ -530,6 +532,7 @@ void DDS::del_var(const string &n) {
         if ((*i)->name() == n) {
             BaseType *bt = *i;
             vars.erase(i);
+            d_vars_index.reset();
             delete bt;
             bt = 0;
             return;
@@ -545,6 +548,7 @@ void DDS::del_var(Vars_iter i) {
     if (i != vars.end()) {
         BaseType *bt = *i;
         vars.erase(i);
+        d_vars_index.reset();
         delete bt;
         bt = 0;
     }
@@ -563,6 +567,7 @@ void DDS::del_var(Vars_iter i1, Vars_iter i2) {
         bt = 0;
     }
     vars.erase(i1, i2);
+    d_vars_index.reset();
 }
 
 /** Search for for variable <i>n</i> as above but record all
@@ -605,17 +610,33 @@ BaseType *DDS::var(const string &n, BaseType::btp_stack *s) {
     return leaf_match(name, s);
 }
 
+// Private. The position of the first top-level variable with the name, or
+// vars.size(). These variables have no parent to tell this DDS when one is
+// renamed, so a name the index does not have is looked for without it.
+size_t DDS::m_find_var(const string &name) {
+    size_t match = NameIndex<BaseType>::find(d_vars_index, vars, name.data(), name.size());
+    if (match < vars.size() || vars.size() < NameIndexBase::min_size)
+        return match;
+
+    for (size_t i = 0; i < vars.size(); ++i) {
+        if (vars[i]->name() == name) {
+            d_vars_index.reset();
+            return i;
+        }
+    }
+
+    return match;
+}
+
 BaseType *DDS::leaf_match(const string &n, BaseType::btp_stack *s) {
     DBG(cerr << "DDS::leaf_match: Looking for " << n << endl);
 
-    for (Vars_iter i = vars.begin(); i != vars.end(); i++) {
-        BaseType *btp = *i;
+    // A match in a constructor that comes before the first top-level
+    // variable with the name wins, so only those need to be searched.
+    size_t match = m_find_var(n);
+    for (size_t i = 0; i < match; i++) {
+        BaseType *btp = vars[i];
         DBG(cerr << "DDS::leaf_match: Looking for " << n << " in: " << btp->name() << endl);
-        // Look for the d_name in the dataset's top-level
-        if (btp->name() == n) {
-            DBG(cerr << "Found " << n << " in: " << btp->name() << endl);
-            return btp;
-        }
 
         if (btp->is_constructor_type()) {
             BaseType *found = btp->var(n, false, s);
@@ -636,18 +657,21 @@ BaseType *DDS::leaf_match(const string &n, BaseType::btp_stack *s) {
 #endif
     }
 
+    // Look for the d_name in the dataset's top-level
+    if (match < vars.size()) {
+        DBG(cerr << "Found " << n << " in: " << vars[match]->name() << endl);
+        return vars[match];
+    }
+
     return 0; // It is not here.
 }
 
 BaseType *DDS::exact_match(const string &name, BaseType::btp_stack *s) {
-    for (Vars_iter i = vars.begin(); i != vars.end(); i++) {
-        BaseType *btp = *i;
-        DBG2(cerr << "Looking for " << d_name << " in: " << btp << endl);
-        // Look for the d_name in the current ctor type or the top level
-        if (btp->name() == name) {
-            DBG2(cerr << "Found " << d_name << " in: " << btp << endl);
-            return btp;
-        }
+    // Look for the d_name in the current ctor type or the top level
+    size_t match = m_find_var(name);
+    if (match < vars.size()) {
+        DBG2(cerr << "Found " << d_name << " in: " << vars[match] << endl);
+        return vars[match];
     }
 
     string::size_type dot_pos = name.find(".");
@@ -670,7 +694,10 @@ BaseType *DDS::exact_match(const string &name, BaseType::btp_stack *s) {
  * @param i The iterator that marks the position
  * @param ptr The BaseType object to copy and insert
  */
-void DDS::insert_var(Vars_iter i, BaseType *ptr) { vars.insert(i, ptr->ptr_duplicate()); }
+void DDS::insert_var(Vars_iter i, BaseType *ptr) {
+    vars.insert(i, ptr->ptr_duplicate());
+    d_vars_index.reset();
+}
 
 /** Insert the BaseType before the position given.
  * @note Does not copy the BaseType object - that caller must not
@@ -679,7 +706,10 @@ void DDS::insert_var(Vars_iter i, BaseType *ptr) { vars.insert(i, ptr->ptr_dupli
  * @param i The iterator that marks the position
  * @param ptr The BaseType object to insert
  */
-void DDS::insert_var_nocopy(Vars_iter i, BaseType *ptr) { vars.insert(i, ptr); }
+void DDS::insert_var_nocopy(Vars_iter i, BaseType *ptr) {
+    vars.insert(i, ptr);
+    d_vars_index.reset();
+}
 
 /** @brief Returns the number of variables in the DDS. */
 int DDS::num_var() { return vars.size(); }
@@ -793,6 +823,7 @@ void DDS::parse(FILE *in) {
     dds_switch_to_buffer(buffer);
 
     parser_arg arg(this);
+    DapArena::Scope scope(arena());
 
     bool status = ddsparse(&arg) == 0;
 
@@ -855,7 +886,7 @@ bool has_dap2_attributes(AttrTable &a) {
  * otherwise false.
  */
 bool has_dap2_attributes(BaseType *btp) {
-    if (btp->get_attr_table().get_size() && has_dap2_attributes(btp->get_attr_table())) {
+    if (btp->has_attr_table() && btp->get_attr_table().get_size() && has_dap2_attributes(btp->get_attr_table())) {
         return true;
     }
 
@@ -39,6 +39,7 @@
 
 #include <cstdio>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -50,6 +51,10 @@
 #include "Constructor.h"
 #endif
 
+#ifndef _name_index_h
+#include "NameIndex.h"
+#endif
+
 #ifndef base_type_factory_h
 #include "BaseTypeFactory.h"
 #endif
@@ -193,12 +198,23 @@ private:
 
     vector<BaseType *> vars; // Variables at the top level
 
+    // Index of vars by name, built by exact_match() and leaf_match() when
+    // there are many variables. Reset whenever vars changes.
+    std::shared_ptr<NameIndex<BaseType>> d_vars_index;
+
+    size_t m_find_var(const string &name);
+
     int d_timeout; // alarm time in seconds. If greater than
                    // zero, raise the alarm signal if more than
                    // d_timeout seconds are spent reading data.
 
     uint64_t d_max_response_size_kb; // In kilobytes...
 
+    // Where the parser allocates variables, if use_arena() was called. This
+    // is destroyed after the variables.
+    std::unique_ptr<DapArena> d_arena;
+    bool d_use_arena = false;
+
     friend class DDSTest;
 
 protected:
@@ -268,6 +284,25 @@ public:
         return t;
     }
 
+    /**
+     * @brief Allocate the parsed variables in an arena
+     * With this set, parse() allocates the variables it builds in a
+     * DapArena owned by this DDS. They are freed all at once when the DDS is
+     * destroyed. Variables from the arena must not outlive the DDS; copies
+     * made with ptr_duplicate() use the heap.
+     * @param state True to use an arena; false stops using it (the objects
+     * already in it are freed with the DDS).
+     * @see DMR::use_arena()
+     */
+    void use_arena(bool state = true) {
+        if (state && !d_arena)
+            d_arena.reset(new DapArena());
+        d_use_arena = state;
+    }
+
+    /// @brief The arena to allocate new variables in, or null. @see use_arena()
+    DapArena *arena() const { return d_use_arena ? d_arena.get() : nullptr; }
+
     virtual AttrTable &get_attr_table();
 
     string filename() const;
@@ -36,11 +36,13 @@
 
 #include "Array.h"
 #include "BaseType.h"
+#include "Constructor.h"
 #include "D4Attributes.h"
 #include "D4BaseTypeFactory.h"
 #include "D4Group.h"
 #include "DMR.h"
 #include "Grid.h"
+#include "Vector.h"
 #include "XMLWriter.h"
 
 #include "DDS.h" // Included so DMRs can be built using a DDS for 'legacy' handlers
@@ -75,10 +77,13 @@ void DMR::m_duplicate(const DMR &dmr) {
 
     d_max_response_size_kb = dmr.d_max_response_size_kb;
 
-    d_ce_empty = dmr.d_ce_empty;
+    d_ce_empty = dmr.get_ce_empty();
 
     d_use_dap4_checksums = dmr.d_use_dap4_checksums;
 
+    d_read_ahead_threads = dmr.d_read_ahead_threads;
+    d_read_ahead_bytes = dmr.d_read_ahead_bytes;
+
     // Deep copy, using ptr_duplicate()
     // d_root can only be a D4Group, so the thing returned by ptr_duplicate() must be a D4Group.
     d_root = static_cast<D4Group *>(dmr.d_root->ptr_duplicate());
@@ -134,7 +139,12 @@ DMR::DMR(const DMR &rhs) : DapObj() { m_duplicate(rhs); }
 /** Delete a DMR. The BaseType factory is not freed, while the contained
  * group is.
  */
-DMR::~DMR() { delete d_root; }
+DMR::~DMR() {
+    delete d_root;
+
+    if (D4RequestContext *context = D4RequestContext::current())
+        context->erase<RequestState>(this, d_request_serial);
+}
 
 DMR &DMR::operator=(const DMR &rhs) {
     if (this == &rhs)
@@ -240,6 +250,44 @@ D4Group *DMR::root() {
     return d_root;
 }
 
+namespace {
+
+void freeze_attributes(BaseType *btp) {
+    if (btp->has_attributes())
+        btp->attributes()->freeze();
+
+    if (btp->type() == dods_group_c) {
+        auto grp = static_cast<D4Group *>(btp);
+        for (auto var : grp->variables())
+            freeze_attributes(var);
+        for (auto child : grp->groups())
+            freeze_attributes(child);
+    } else if (btp->is_constructor_type()) {
+        for (auto var : static_cast<Constructor *>(btp)->variables())
+            freeze_attributes(var);
+    } else if (btp->is_vector_type() && static_cast<Vector *>(btp)->var()) {
+        freeze_attributes(static_cast<Vector *>(btp)->var());
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Share the attributes of this DMR with its copies
+ *
+ * Use this for a DMR that is kept (e.g., in a cache) and copied for each
+ * request. Copies made afterwards share the DAP4 attributes of the
+ * variables and groups instead of copying them, which is most of the work
+ * of copying a typical DMR. The variables themselves are still copied,
+ * since they hold the per-request state (send_p, read_p, constraints and
+ * values). A copy gets its own attributes for a variable the first time
+ * they are changed; see D4Attributes::freeze().
+ *
+ * Once frozen, the DMR may be copied by several threads at once, as long as
+ * none of them changes it.
+ */
+void DMR::freeze() { freeze_attributes(root()); }
+
 /**
  * Given the DAP protocol version, parse that string and set the DMR fields.
  *
@@ -29,10 +29,12 @@
 
 #include <cstdint>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "BaseType.h"
+#include "D4RequestContext.h"
 #include "DapObj.h"
 
 namespace libdap {
@@ -85,6 +87,12 @@ private:
     /// Whether transferring the whole DMR(the expression constraint is empty)
     bool d_ce_empty = false;
 
+    // The per-request flags held in a D4RequestContext
+    struct RequestState {
+        bool ce_empty;
+    };
+    D4RequestContext::Serial d_request_serial;
+
     /// The root group; holds dimensions, enums, variables, groups, ...
     D4Group *d_root = nullptr;
 
@@ -95,6 +103,15 @@ private:
 
     bool d_use_dap4_checksums = false;
 
+    /// Read-ahead serialization; see D4Group::serialize(). Zero threads is off.
+    unsigned int d_read_ahead_threads = 0;
+    uint64_t d_read_ahead_bytes = 0;
+
+    /// Where the parser allocates variables, if use_arena() was called. This
+    /// is destroyed after d_root.
+    std::unique_ptr<DapArena> d_arena;
+    bool d_use_arena = false;
+
     friend class DMRTest;
     friend class MockDMR;
 
@@ -232,10 +249,19 @@ public:
     bool too_big() { return d_max_response_size_kb != 0 && request_size_kb(true) > d_max_response_size_kb; }
 
     /// Set the flag that marks the expression constraint as empty.
-    void set_ce_empty(bool ce_empty) { d_ce_empty = ce_empty; }
+    void set_ce_empty(bool ce_empty) {
+        if (D4RequestContext *context = D4RequestContext::current())
+            context->get(this, d_request_serial, RequestState{d_ce_empty}).ce_empty = ce_empty;
+        else
+            d_ce_empty = ce_empty;
+    }
 
     /// Get the flag that marks the expression constraint as empty.
-    bool get_ce_empty() const { return d_ce_empty; }
+    bool get_ce_empty() const {
+        D4RequestContext *context = D4RequestContext::current();
+        const RequestState *state = context ? context->find<RequestState>(this, d_request_serial) : nullptr;
+        return state ? state->ce_empty : d_ce_empty;
+    }
 
     /** Return the root group of this Dataset. If no root group has been
      * set, use the D4BaseType factory to make it.
@@ -243,6 +269,8 @@ public:
      */
     D4Group *root();
 
+    void freeze();
+
     virtual DDS *getDDS(bool show_shared_dims);
     /**
      * @brief version of getDDS() that includes the shared dimensions 'by default."
@@ -284,6 +312,49 @@ public:
      * @param value True to include checksums.
      */
     void use_checksums(bool value) { d_use_dap4_checksums = value; }
+
+    /** @brief Returns how many variables D4Group::serialize() may read ahead; 0 if it doesn't. */
+    unsigned int read_ahead_threads() const { return d_read_ahead_threads; }
+
+    /** @brief Returns the most data (in bytes) that may be read ahead but not yet sent. */
+    uint64_t read_ahead_bytes() const { return d_read_ahead_bytes; }
+
+    /**
+     * @brief Read variables ahead of serializing them.
+     * With this set, D4Group::serialize() reads (and computes the checksums
+     * of) the next projected scalar and Array variables in a Group using a
+     * pool of up to 'threads' threads while it writes the current one. Output
+     * stays in DMR order.
+     * @note The handler's read() methods must be safe to call from different
+     * threads for different variables.
+     * @param threads How many variables to read ahead at most; 0 turns this off.
+     * @param bytes The most data read ahead but not yet sent. A variable larger
+     * than this is still read ahead when nothing else is.
+     */
+    void set_read_ahead(unsigned int threads, uint64_t bytes = 256 * 1024 * 1024) {
+        d_read_ahead_threads = threads;
+        d_read_ahead_bytes = bytes;
+    }
+
+    /**
+     * @brief Allocate the parsed variables in an arena
+     * With this set, D4ParserSax2::intern() allocates the variables,
+     * attributes and dimensions it builds in a DapArena owned by this DMR.
+     * They are freed all at once when the DMR is destroyed, which is much
+     * faster for large DMRs. Variables from the arena must not outlive the
+     * DMR; copies made with ptr_duplicate() use the heap. Copies of the DMR
+     * do not use the arena.
+     * @param state True to use an arena; false stops using it (the objects
+     * already in it are freed with the DMR).
+     */
+    void use_arena(bool state = true) {
+        if (state && !d_arena)
+            d_arena.reset(new DapArena());
+        d_use_arena = state;
+    }
+
+    /// @brief The arena to allocate new variables in, or null. @see use_arena()
+    DapArena *arena() const { return d_use_arena ? d_arena.get() : nullptr; }
 };
 
 } // namespace libdap
@@ -68,6 +68,7 @@
 #include "DDS.h"
 #include "DODSFilter.h"
 #include "InternalErr.h"
+#include "MarshallerStats.h"
 #include "XDRStreamMarshaller.h"
 #include "debug.h"
 #include "escaping.h"
@@ -530,6 +531,17 @@ void DODSFilter::set_timeout(int t) { d_timeout = t; }
 /** Get the server's timeout value. */
 int DODSFilter::get_timeout() const { return d_timeout; }
 
+/** Count the bytes written and time the work done for each variable sent
+    in a data response. The caller owns the counters and can read or dump
+    them once the response has been sent.
+
+    @param stats Add to these counters; null (the default) turns this off.
+    @see MarshallerStats */
+void DODSFilter::set_marshaller_stats(MarshallerStats *stats) { d_marshaller_stats = stats; }
+
+/** Get the counters set with set_marshaller_stats(), or null. */
+MarshallerStats *DODSFilter::get_marshaller_stats() const { return d_marshaller_stats; }
+
 /** Use values of this instance to establish a timeout alarm for the server.
     If the timeout value is zero, do nothing.
 
@@ -722,10 +734,15 @@ void DODSFilter::functional_constraint(BaseType &var, DDS &dds, ConstraintEvalua
 
     // Grab a stream that encodes using XDR.
     XDRStreamMarshaller m(out);
+    m.set_stats(d_marshaller_stats);
 
     try {
         // In the following call to serialize, suppress CE evaluation.
+        if (d_marshaller_stats)
+            d_marshaller_stats->start_variable(var.name());
         var.serialize(eval, dds, m, false);
+        if (d_marshaller_stats)
+            d_marshaller_stats->end_variable();
     } catch (Error &e) {
         throw;
     }
@@ -745,13 +762,18 @@ void DODSFilter::dataset_constraint(DDS &dds, ConstraintEvaluator &eval, ostream
 
     // Grab a stream that encodes using XDR.
     XDRStreamMarshaller m(out);
+    m.set_stats(d_marshaller_stats);
 
     try {
         // Send all variables in the current projection (send_p())
         for (DDS::Vars_iter i = dds.var_begin(); i != dds.var_end(); i++)
             if ((*i)->send_p()) {
                 DBG(cerr << "Sending " << (*i)->name() << endl);
+                if (d_marshaller_stats)
+                    d_marshaller_stats->start_variable((*i)->name());
                 (*i)->serialize(eval, dds, m, ce_eval);
+                if (d_marshaller_stats)
+                    d_marshaller_stats->end_variable();
             }
     } catch (Error &e) {
         throw;
@@ -782,13 +804,18 @@ void DODSFilter::dataset_constraint_ddx(DDS &dds, ConstraintEvaluator &eval, ost
 
     // Grab a stream that encodes using XDR.
     XDRStreamMarshaller m(out);
+    m.set_stats(d_marshaller_stats);
 
     try {
         // Send all variables in the current projection (send_p())
         for (DDS::Vars_iter i = dds.var_begin(); i != dds.var_end(); i++)
             if ((*i)->send_p()) {
                 DBG(cerr << "Sending " << (*i)->name() << endl);
+                if (d_marshaller_stats)
+                    d_marshaller_stats->start_variable((*i)->name());
                 (*i)->serialize(eval, dds, m, ce_eval);
+                if (d_marshaller_stats)
+                    d_marshaller_stats->end_variable();
             }
     } catch (Error &e) {
         throw;
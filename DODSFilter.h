@@ -48,6 +48,8 @@
 
 namespace libdap {
 
+class MarshallerStats;
+
 /** When a DODS server receives a request from a DODS client, the
     server CGI script dispatches the request to one of several
     ``filter'' programs.  Each filter is responsible for returning a
@@ -111,6 +113,8 @@ protected:
     time_t d_anc_dds_lmt;       ///< Last-modified time of ancillary DDS.
     time_t d_if_modified_since; ///< `If-Modified-Since` request timestamp.
 
+    MarshallerStats *d_marshaller_stats = nullptr; ///< If not null, count the data responses' bytes and times.
+
     void initialize();
     void initialize(int argc, char *argv[]);
 
@@ -173,6 +177,10 @@ public:
 
     int get_timeout() const;
 
+    void set_marshaller_stats(MarshallerStats *stats);
+
+    MarshallerStats *get_marshaller_stats() const;
+
     /**
      * @brief Arms timeout handling for stream writes.
      * @param stream Output stream associated with response generation.
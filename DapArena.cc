@@ -0,0 +1,178 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "DapArena.h"
+
+using namespace std;
+
+namespace libdap {
+
+namespace {
+
+thread_local DapArena *current_arena = nullptr;
+
+// Blocks are made of whole granules and aligned to them, so no granule
+// holds both arena and heap memory. A pointer is in an arena if its granule
+// is marked in a four level table indexed by the granule number; the table
+// is read without a lock and its nodes are never freed.
+const unsigned granule_bits = 16;
+const size_t granule = size_t(1) << granule_bits;
+const unsigned level_bits = 12; // 4 levels cover the 48 bits above a granule
+const size_t fanout = size_t(1) << level_bits;
+const size_t level_mask = fanout - 1;
+
+struct Leaf {
+    atomic<bool> marked[fanout];
+};
+
+template <typename Child> struct Node {
+    atomic<Child *> children[fanout];
+
+    Child *find(size_t i) const { return children[i].load(memory_order_acquire); }
+
+    Child *make(size_t i) {
+        Child *child = find(i);
+        if (child)
+            return child;
+        auto made = new Child(); // zeroed
+        if (children[i].compare_exchange_strong(child, made, memory_order_acq_rel))
+            return made;
+        delete made; // another thread made it first
+        return child;
+    }
+};
+
+Node<Node<Node<Leaf>>> granules; // zeroed; never destroyed, it has a trivial destructor
+
+size_t level(uintptr_t g, unsigned n) { return (g >> (level_bits * (3 - n))) & level_mask; }
+
+atomic<bool> &mark(const char *p) {
+    uintptr_t g = reinterpret_cast<uintptr_t>(p) >> granule_bits;
+    return granules.make(level(g, 0))->make(level(g, 1))->make(level(g, 2))->marked[level(g, 3)];
+}
+
+bool in_arena(const void *p) {
+    uintptr_t g = reinterpret_cast<uintptr_t>(p) >> granule_bits;
+    auto n1 = granules.find(level(g, 0));
+    if (!n1)
+        return false;
+    auto n2 = n1->find(level(g, 1));
+    if (!n2)
+        return false;
+    auto leaf = n2->find(level(g, 2));
+    return leaf && leaf->marked[level(g, 3)].load(memory_order_acquire);
+}
+
+size_t whole_granules(size_t size) { return (size + granule - 1) & ~(granule - 1); }
+
+} // namespace
+
+atomic<size_t> DapArena::d_arenas(0);
+
+/**
+ * @brief Make an empty arena
+ * @param block_size Allocate memory in blocks of this many bytes, rounded up
+ * to a multiple of 64k. Requests bigger than a quarter of this get a block of
+ * their own.
+ */
+DapArena::DapArena(size_t block_size) : d_block_size(whole_granules(block_size ? block_size : 1)) { ++d_arenas; }
+
+DapArena::~DapArena() {
+    for (size_t i = 0; i < d_blocks.size(); ++i) {
+        for (size_t offset = 0; offset < d_block_sizes[i]; offset += granule)
+            mark(d_blocks[i] + offset).store(false, memory_order_release);
+        free(d_blocks[i]);
+    }
+    --d_arenas;
+}
+
+// Private. Allocate a block of at least size bytes and mark its granules.
+char *DapArena::m_add_block(size_t size) {
+    size = whole_granules(size);
+    void *block = nullptr;
+    if (posix_memalign(&block, granule, size) != 0)
+        throw bad_alloc();
+
+    auto b = static_cast<char *>(block);
+    d_blocks.push_back(b);
+    d_block_sizes.push_back(size);
+    d_capacity += size;
+    for (size_t offset = 0; offset < size; offset += granule)
+        mark(b + offset).store(true, memory_order_release);
+
+    return b;
+}
+
+/**
+ * @brief Allocate memory that lasts as long as the arena
+ * @param size The number of bytes
+ * @param alignment A power of two, no more than alignof(std::max_align_t)
+ * @return The memory; never null
+ */
+void *DapArena::allocate(size_t size, size_t alignment) {
+    auto aligned = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(d_next) + alignment - 1) & ~(alignment - 1));
+    if (!d_next || aligned + size > d_end) {
+        if (size > d_block_size / 4) {
+            // Don't waste the rest of the current block on a big request.
+            return m_add_block(size);
+        }
+
+        d_next = m_add_block(d_block_size);
+        d_end = d_next + d_block_size;
+        aligned = d_next; // blocks are aligned for any type
+    }
+
+    d_next = aligned + size;
+    return aligned;
+}
+
+DapArena *DapArena::current() { return current_arena; }
+
+/**
+ * @brief Use an arena for the objects allocated on this thread
+ * @param arena The arena; null means the heap
+ */
+DapArena::Scope::Scope(DapArena *arena) : d_previous(current_arena) { current_arena = arena; }
+
+DapArena::Scope::~Scope() { current_arena = d_previous; }
+
+void *DapArena::m_allocate_object(size_t size) {
+    if (!current_arena)
+        return ::operator new(size);
+
+    ++current_arena->d_objects;
+    return current_arena->allocate(size);
+}
+
+void DapArena::m_free_object(void *ptr) noexcept {
+    if (ptr && !in_arena(ptr))
+        ::operator delete(ptr);
+}
+
+} // namespace libdap
@@ -0,0 +1,122 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _dap_arena_h
+#define _dap_arena_h 1
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace libdap {
+
+/**
+ * @brief A monotonic memory arena for the objects of one DMR or DDS
+ *
+ * Memory is handed out from large blocks and is only released, all at once,
+ * when the arena is destroyed.
+ *
+ * While a DapArena::Scope is active on a thread, objects of classes that use
+ * DapArena::allocate_object() for their operator new (DapObj and its
+ * descendants, including BaseType, AttrTable, D4Attribute and D4Attributes,
+ * and D4Dimension) are allocated in that arena. Deleting such an object runs
+ * its destructor but does not free its memory; the arena does that. Members
+ * that allocate for themselves (strings longer than the small string buffer,
+ * vectors) still use the heap.
+ *
+ * Objects carry nothing to say where they were allocated. While no arena
+ * exists, allocate_object() and free_object() are the global operator new
+ * and delete; otherwise free_object() checks whether the 64k granule the
+ * object is in belongs to an arena, in a table it reads without a lock.
+ *
+ * DMR::use_arena() and DDS::use_arena() make the parsers allocate the
+ * variables they build in an arena owned by the DMR or DDS. Those objects
+ * must not outlive it; copy a variable (ptr_duplicate()) to keep it.
+ */
+class DapArena {
+public:
+    explicit DapArena(size_t block_size = 64 * 1024);
+    DapArena(const DapArena &) = delete;
+    DapArena &operator=(const DapArena &) = delete;
+    ~DapArena();
+
+    void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    /// @brief The bytes in the blocks allocated so far
+    size_t capacity() const { return d_capacity; }
+    /// @brief The number of objects allocated with allocate_object()
+    size_t objects() const { return d_objects; }
+
+    static DapArena *current();
+
+    /// @brief Make an arena the current arena of this thread for the life of the Scope
+    class Scope {
+        DapArena *d_previous;
+
+    public:
+        explicit Scope(DapArena *arena);
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        ~Scope();
+    };
+
+    /// @brief Allocate an object in the current arena, or on the heap if there is none
+    /// Classes use this for their operator new.
+    static void *allocate_object(size_t size) {
+        if (d_arenas.load(std::memory_order_relaxed) == 0)
+            return ::operator new(size);
+        return m_allocate_object(size);
+    }
+
+    /// @brief Free an object allocated by allocate_object()
+    /// Objects in an arena are freed with the arena.
+    static void free_object(void *ptr) noexcept {
+        if (d_arenas.load(std::memory_order_relaxed) == 0)
+            ::operator delete(ptr);
+        else
+            m_free_object(ptr);
+    }
+
+private:
+    // While there are no arenas, objects are allocated and freed as if
+    // allocate_object() and free_object() were not there.
+    static std::atomic<size_t> d_arenas;
+
+    static void *m_allocate_object(size_t size);
+    static void m_free_object(void *ptr) noexcept;
+
+    char *m_add_block(size_t size);
+
+    std::vector<char *> d_blocks;
+    std::vector<size_t> d_block_sizes;
+    char *d_next = nullptr;
+    char *d_end = nullptr;
+    size_t d_block_size;
+    size_t d_capacity = 0;
+    size_t d_objects = 0;
+};
+
+} // namespace libdap
+
+#endif // _dap_arena_h
@@ -36,8 +36,11 @@
 #ifndef A_DapObj_h
 #define A_DapObj_h 1
 
+#include <cstddef>
 #include <iostream>
 
+#include "DapArena.h"
+
 namespace libdap {
 
 /** @brief libdap base object for common functionality of libdap objects
@@ -50,6 +53,15 @@ class DapObj {
 public:
     virtual ~DapObj() = default;
 
+    /// @name Allocation
+    /// Objects are allocated in the current DapArena, if there is one.
+    ///@{
+    static void *operator new(size_t size) { return DapArena::allocate_object(size); }
+    static void *operator new(size_t, void *place) noexcept { return place; }
+    static void operator delete(void *ptr) noexcept { DapArena::free_object(ptr); }
+    static void operator delete(void *, void *) noexcept {}
+    ///@}
+
     /** @brief dump the contents of this object to the specified ostream
      *
      * This method is implemented by all derived classes to dump their
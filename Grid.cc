@@ -168,7 +168,8 @@ void Grid::transform_to_dap4(D4Group *root, Constructor *container) {
     DBG(cerr << __func__ << "() - Transformed and added DAP4 coverage Array '" << coverage->name()
              << "' to parent container: '" << container->name() << "'" << endl;);
 
-    coverage->attributes()->transform_to_dap4(get_attr_table());
+    if (has_attr_table())
+        coverage->attributes()->transform_to_dap4(get_attr_table());
 
     DBG(cerr << __func__ << "() - " << "Coverage Array '" << coverage->name() << "' attributes: " << endl;
         XMLWriter xmlw; coverage->get_attr_table().print_dap4(xmlw); cerr << xmlw.get_doc() << endl;);
@@ -249,6 +250,7 @@ void Grid::add_var(BaseType *bt, Part part) {
         bt_clone = bt->ptr_duplicate();
         bt_clone->set_parent(this);
         d_vars.push_back(bt_clone);
+        m_vars_changed();
     } break;
 
     default: {
@@ -260,6 +262,7 @@ void Grid::add_var(BaseType *bt, Part part) {
             bt_clone = bt->ptr_duplicate();
             bt_clone->set_parent(this);
             d_vars.push_back(bt_clone);
+            m_vars_changed();
         }
     } break;
     }
@@ -314,6 +317,7 @@ void Grid::add_var_nocopy(BaseType *bt, Part part) {
         // FIXME Why is this commented out?
         // bt->set_parent(this);
         d_vars.push_back(bt);
+        m_vars_changed();
     } break;
 
     default: {
@@ -323,6 +327,7 @@ void Grid::add_var_nocopy(BaseType *bt, Part part) {
             set_array(static_cast<Array *>(bt));
         } else {
             d_vars.push_back(bt);
+            m_vars_changed();
         }
     } break;
     }
@@ -366,6 +371,7 @@ void Grid::set_array(Array *p_new_arr) {
         delete get_array();
         d_vars[0] = p_new_arr;
     }
+    m_vars_changed();
 
     d_is_array_set = true;
 }
@@ -406,6 +412,7 @@ Array *Grid::add_map(Array *p_new_map, bool add_as_copy) {
     p_new_map->set_parent(this);
 
     d_vars.push_back(p_new_map);
+    m_vars_changed();
 
     // return the one that got put into the Grid.
     return p_new_map;
@@ -430,6 +437,7 @@ Array *Grid::prepend_map(Array *p_new_map, bool add_copy) {
 
     p_new_map->set_parent(this);
     d_vars.insert(map_begin(), p_new_map);
+    m_vars_changed();
 
     return p_new_map;
 }
@@ -718,7 +726,8 @@ void Grid::print_xml_writer(XMLWriter &xml, bool constrained) {
             xmlTextWriterWriteAttribute(xml.get_writer(), (const xmlChar *)"name", (const xmlChar *)name().c_str()) < 0)
             throw InternalErr(__FILE__, __LINE__, "Could not write attribute for name");
 
-        get_attr_table().print_xml_writer(xml);
+        if (has_attr_table())
+            get_attr_table().print_xml_writer(xml);
 
         get_array()->print_xml_writer(xml, constrained);
 
@@ -744,7 +753,8 @@ void Grid::print_xml_writer(XMLWriter &xml, bool constrained) {
                                             (const xmlChar *)name().c_str()) < 0)
                 throw InternalErr(__FILE__, __LINE__, "Could not write attribute for name");
 
-        get_attr_table().print_xml_writer(xml);
+        if (has_attr_table())
+            get_attr_table().print_xml_writer(xml);
 
         get_array()->print_xml_writer(xml, constrained);
 
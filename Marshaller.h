@@ -43,11 +43,26 @@
 namespace libdap {
 
 class Vector;
+class MarshallerStats;
 
 /** @brief abstract base class used to marshal/serialize dap data objects
  */
 class Marshaller : public DapObj {
+protected:
+    MarshallerStats *d_stats = nullptr; // see set_stats()
+
 public:
+    /**
+     * @brief Count the bytes written and time the work done for each variable.
+     * @param stats Add to these counters; the caller owns them and they must
+     * outlive the marshaller. Null, the default, turns the counting off.
+     * @see MarshallerStats
+     */
+    void set_stats(MarshallerStats *stats) { d_stats = stats; }
+
+    /// @brief The counters set with set_stats(), or null.
+    MarshallerStats *get_stats() const { return d_stats; }
+
     /** @brief Serialize one `Byte` value.
      * @param val Value to serialize.
      */
@@ -0,0 +1,102 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+#include "MarshallerSpool.h"
+
+#include "Error.h"
+#include "TempFile.h"
+
+using namespace std;
+
+namespace libdap {
+
+/**
+ * @brief Make an empty spool
+ * @param memory_limit Keep this many bytes in memory before using a file
+ * @param dir Make the temporary file here; the default is $TMPDIR or /tmp
+ */
+MarshallerSpool::MarshallerSpool(size_t memory_limit, const string &dir) : d_memory_limit(memory_limit), d_dir(dir) {
+    if (d_dir.empty()) {
+        const char *tmpdir = getenv("TMPDIR");
+        d_dir = (tmpdir && *tmpdir) ? tmpdir : "/tmp";
+    }
+}
+
+// Out of line so that TempFile is complete where the unique_ptr deletes it.
+MarshallerSpool::~MarshallerSpool() = default;
+
+/// @brief Append bytes to the spool.
+void MarshallerSpool::write(const void *data, size_t num_bytes) {
+    auto bytes = static_cast<const char *>(data);
+
+    if (!d_file && d_memory.size() + num_bytes <= d_memory_limit) {
+        d_memory.insert(d_memory.end(), bytes, bytes + num_bytes);
+        return;
+    }
+
+    if (!d_file) {
+        try {
+            d_file.reset(new TempFile(d_dir + "/dap_spool_XXXXXX"));
+        } catch (const runtime_error &e) {
+            throw Error(internal_error, string("Could not make a spool file in ") + d_dir + ": " + e.what());
+        }
+    }
+
+    d_file->stream().write(bytes, num_bytes);
+    if (!d_file->stream())
+        throw Error(internal_error, "Could not write to the spool file " + d_file->path());
+    d_file_bytes += num_bytes;
+}
+
+/**
+ * @brief Pass the spooled bytes, in order, to a function
+ * The bytes in the file are read in blocks.
+ * @param consumer Called with each block of bytes
+ */
+void MarshallerSpool::read(const function<void(const char *, size_t)> &consumer) {
+    if (!d_memory.empty())
+        consumer(d_memory.data(), d_memory.size());
+
+    if (!d_file)
+        return;
+
+    d_file->flush();
+    ifstream in(d_file->path(), ios::binary);
+    vector<char> block(d_memory_limit > 0 ? min<size_t>(d_memory_limit, 1024 * 1024) : 64 * 1024);
+    uint64_t remaining = d_file_bytes;
+    while (remaining > 0) {
+        in.read(block.data(), min<uint64_t>(block.size(), remaining));
+        if (in.gcount() <= 0)
+            throw Error(internal_error, "Could not read the spool file " + d_file->path());
+        consumer(block.data(), in.gcount());
+        remaining -= in.gcount();
+    }
+}
+
+} // namespace libdap
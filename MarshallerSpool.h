@@ -0,0 +1,77 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef MARSHALLER_SPOOL_H_
+#define MARSHALLER_SPOOL_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace libdap {
+
+class TempFile;
+
+/**
+ * @brief Hold serialized data until it can be written
+ *
+ * A D4StreamMarshaller can divert its output to a spool (see
+ * D4StreamMarshaller::set_spool()) and later write the spooled bytes with
+ * D4StreamMarshaller::put_spool(). D4Sequence uses this to write its row
+ * count before its rows when the count is not known until the rows are read.
+ *
+ * The first memory_limit bytes are kept in memory; the rest go to a
+ * temporary file, which is removed when the spool is destroyed.
+ */
+class MarshallerSpool {
+public:
+    /// The default number of bytes kept in memory
+    static const size_t default_memory_limit = 4 * 1024 * 1024;
+
+    explicit MarshallerSpool(size_t memory_limit = default_memory_limit, const std::string &dir = "");
+    MarshallerSpool(const MarshallerSpool &) = delete;
+    MarshallerSpool &operator=(const MarshallerSpool &) = delete;
+    ~MarshallerSpool();
+
+    void write(const void *data, size_t num_bytes);
+
+    /// @brief The number of bytes written to the spool
+    uint64_t size() const { return d_memory.size() + d_file_bytes; }
+    /// @brief Did the spool overflow to a temporary file?
+    bool spilled() const { return d_file != nullptr; }
+
+    void read(const std::function<void(const char *, size_t)> &consumer);
+
+private:
+    size_t d_memory_limit;
+    std::string d_dir;
+    std::vector<char> d_memory;
+    std::unique_ptr<TempFile> d_file;
+    uint64_t d_file_bytes = 0;
+};
+
+} // namespace libdap
+
+#endif // MARSHALLER_SPOOL_H_
@@ -0,0 +1,174 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "MarshallerStats.h"
+
+using namespace std;
+
+namespace libdap {
+
+namespace {
+
+void write_json_string(ostream &out, const string &s) {
+    out << '"';
+    for (unsigned char c : s) {
+        switch (c) {
+        case '"':
+            out << "\\\"";
+            break;
+        case '\\':
+            out << "\\\\";
+            break;
+        case '\n':
+            out << "\\n";
+            break;
+        case '\t':
+            out << "\\t";
+            break;
+        default:
+            if (c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out << buf;
+            } else {
+                out << c;
+            }
+        }
+    }
+    out << '"';
+}
+
+void write_json_variable(ostream &out, const MarshallerStats::Variable &v, bool with_name) {
+    out << "{";
+    if (with_name) {
+        out << "\"name\": ";
+        write_json_string(out, v.name);
+        out << ", ";
+    }
+    out << "\"bytes\": " << v.bytes << ", \"seconds\": " << v.seconds << ", \"read_seconds\": " << v.read_seconds
+        << ", \"encode_seconds\": " << v.encode_seconds << ", \"wait_seconds\": " << v.wait_seconds << "}";
+}
+
+} // namespace
+
+/**
+ * @brief The next bytes and times are for this variable
+ * If the previous variable was not ended (e.g., its serialize() threw an
+ * exception), it is ended first.
+ * @param name The variable's name; D4Group uses its fully qualified name
+ */
+void MarshallerStats::start_variable(const string &name) {
+    if (d_in_variable)
+        end_variable();
+
+    d_variables.emplace_back();
+    d_variables.back().name = name;
+    d_in_variable = true;
+    d_marshal_seconds = 0;
+    d_start = chrono::steady_clock::now();
+}
+
+/**
+ * @brief The current variable has been serialized
+ * The time not spent in the marshaller is counted as read time.
+ */
+void MarshallerStats::end_variable() {
+    if (!d_in_variable)
+        return;
+
+    Variable &v = d_variables.back();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - d_start;
+    v.seconds = elapsed.count();
+    v.encode_seconds += max(0.0, d_marshal_seconds - v.wait_seconds);
+    v.read_seconds += max(0.0, v.seconds - d_marshal_seconds);
+    d_in_variable = false;
+}
+
+/**
+ * @brief Add time to one of the clocks of the current variable
+ * Time added outside a variable is only counted in the totals.
+ */
+void MarshallerStats::add_time(Clock clock, double seconds) {
+    Variable &v = m_current();
+    switch (clock) {
+    case marshal_time:
+        (d_in_variable ? d_marshal_seconds : d_outside_marshal_seconds) += seconds;
+        break;
+    case read_time:
+        v.read_seconds += seconds;
+        break;
+    case encode_time:
+        v.encode_seconds += seconds;
+        break;
+    case wait_time:
+        v.wait_seconds += seconds;
+        break;
+    }
+}
+
+/// @brief The sums over all variables, plus anything written outside them.
+MarshallerStats::Variable MarshallerStats::totals() const {
+    Variable t = d_outside;
+    t.encode_seconds += max(0.0, d_outside_marshal_seconds - d_outside.wait_seconds);
+    for (const auto &v : d_variables) {
+        t.bytes += v.bytes;
+        t.seconds += v.seconds;
+        t.read_seconds += v.read_seconds;
+        t.encode_seconds += v.encode_seconds;
+        t.wait_seconds += v.wait_seconds;
+    }
+    return t;
+}
+
+void MarshallerStats::clear() {
+    d_variables.clear();
+    d_outside = Variable();
+    d_in_variable = false;
+    d_marshal_seconds = 0;
+    d_outside_marshal_seconds = 0;
+    d_marshal_depth = 0;
+}
+
+/**
+ * @brief Write the counters as a JSON object
+ * The object has a "variables" array, in the order they were serialized,
+ * and a "totals" object. Times are in seconds.
+ */
+void MarshallerStats::dump_json(ostream &out) const {
+    out << "{\"variables\": [";
+    for (size_t i = 0; i < d_variables.size(); ++i) {
+        if (i > 0)
+            out << ", ";
+        write_json_variable(out, d_variables[i], true);
+    }
+    out << "], \"totals\": ";
+    write_json_variable(out, totals(), false);
+    out << "}";
+}
+
+} // namespace libdap
@@ -0,0 +1,144 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef MARSHALLER_STATS_H_
+#define MARSHALLER_STATS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace libdap {
+
+/**
+ * @brief Where the time goes when a response is serialized
+ *
+ * Give an instance to a marshaller with Marshaller::set_stats() and it
+ * counts, for each top-level variable, the bytes written and the time spent
+ * reading values, encoding them (including computing checksums and copying
+ * them for the writer thread) and waiting for the previous write to finish.
+ * D4Group::serialize() and DODSFilter mark where each variable starts and
+ * ends. Marshallers without an instance (the default) only test a null
+ * pointer.
+ *
+ * The read time of a variable is the time its serialize() method spent
+ * outside the marshaller; for scalars and arrays that is read(). Variables
+ * read ahead by other threads (see DMR::set_read_ahead()) record the time
+ * those threads spent, so the times can add up to more than the elapsed time.
+ *
+ * An instance must only be used by one thread.
+ */
+class MarshallerStats {
+public:
+    /// @brief The counters for one top-level variable
+    struct Variable {
+        std::string name;
+        uint64_t bytes = 0;        ///< Bytes written
+        double seconds = 0;        ///< Time to serialize the variable
+        double read_seconds = 0;   ///< Time reading values
+        double encode_seconds = 0; ///< Time encoding values, computing checksums and copying them
+        double wait_seconds = 0;   ///< Time waiting for earlier writes to finish
+    };
+
+    /// @brief The clocks a MarshallerTimer can run
+    enum Clock {
+        marshal_time, ///< Time in the marshaller; the encode time is this less the wait time
+        read_time,
+        encode_time,
+        wait_time
+    };
+
+    MarshallerStats() = default;
+
+    void start_variable(const std::string &name);
+    void end_variable();
+
+    /// @brief Count bytes written for the current variable.
+    void add_bytes(uint64_t num_bytes) { m_current().bytes += num_bytes; }
+    void add_time(Clock clock, double seconds);
+
+    /// @brief The variables, in the order they were serialized.
+    const std::vector<Variable> &variables() const { return d_variables; }
+    Variable totals() const;
+    void clear();
+
+    void dump_json(std::ostream &out) const;
+
+private:
+    friend class MarshallerTimer;
+
+    std::vector<Variable> d_variables;
+    Variable d_outside; // bytes and time not inside a variable
+    bool d_in_variable = false;
+    std::chrono::steady_clock::time_point d_start;
+    double d_marshal_seconds = 0; // for the current variable
+    double d_outside_marshal_seconds = 0;
+    int d_marshal_depth = 0;      // marshal_time timers running; only the outermost counts
+
+    Variable &m_current() { return d_in_variable ? d_variables.back() : d_outside; }
+};
+
+/**
+ * @brief Add the time from construction to stop() (or destruction) to a clock
+ * With a null MarshallerStats pointer this does nothing. Timers of
+ * marshal_time may nest (e.g., put_vector() calling put_int()); only the
+ * outermost one counts.
+ */
+class MarshallerTimer {
+public:
+    MarshallerTimer(MarshallerStats *stats, MarshallerStats::Clock clock = MarshallerStats::marshal_time)
+        : d_stats(stats), d_clock(clock) {
+        if (d_stats) {
+            if (d_clock == MarshallerStats::marshal_time && d_stats->d_marshal_depth++ > 0)
+                d_stats = nullptr;
+            else
+                d_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    MarshallerTimer(const MarshallerTimer &) = delete;
+    MarshallerTimer &operator=(const MarshallerTimer &) = delete;
+
+    ~MarshallerTimer() { stop(); }
+
+    void stop() {
+        if (d_stats) {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - d_start;
+            d_stats->add_time(d_clock, elapsed.count());
+            if (d_clock == MarshallerStats::marshal_time)
+                d_stats->d_marshal_depth = 0;
+            d_stats = nullptr;
+        }
+    }
+
+private:
+    MarshallerStats *d_stats;
+    MarshallerStats::Clock d_clock;
+    std::chrono::steady_clock::time_point d_start;
+};
+
+} // namespace libdap
+
+#endif // MARSHALLER_STATS_H_
@@ -41,6 +41,7 @@
 
 #include "Error.h"
 #include "InternalErr.h"
+#include "MarshallerStats.h"
 #include "MarshallerThread.h"
 #include "debug.h"
 #include "util.h"
@@ -91,8 +92,12 @@ static double time_diff_to_hundredths(struct timeval *stop, struct timeval *star
  * This is used to lock the main thread and ensure that a second child
  * (writer) thread is not started until any current child thread completes,
  * which keeps the write operations in the correct order.
+ *
+ * @param stats If not null, add the time spent here to its wait time
  */
-Locker::Locker(pthread_mutex_t &lock, pthread_cond_t &cond, int &count) : m_mutex(lock) {
+Locker::Locker(pthread_mutex_t &lock, pthread_cond_t &cond, int &count, MarshallerStats *stats) : m_mutex(lock) {
+    MarshallerTimer wait(stats, MarshallerStats::wait_time);
+
     int status = pthread_mutex_lock(&m_mutex);
 
     DBG(cerr << "Locking the mutex! (waiting; " << pthread_self() << ")" << endl);
@@ -152,33 +157,63 @@ ChildLocker::~ChildLocker() {
     (void)pthread_mutex_unlock(&m_mutex);
 }
 
-MarshallerThread::MarshallerThread() {
-    if (pthread_attr_init(&d_thread_attr) != 0)
-        throw Error(internal_error, "Failed to initialize pthread attributes.");
-    if (pthread_attr_setdetachstate(&d_thread_attr, PTHREAD_CREATE_DETACHED /*PTHREAD_CREATE_JOINABLE*/) != 0)
-        throw Error(internal_error, "Failed to complete pthread attribute initialization.");
-
+MarshallerThread::MarshallerThread(unsigned int max_queued) : d_max_queued(max_queued ? max_queued : 1) {
     if (pthread_mutex_init(&d_out_mutex, nullptr) != 0)
         throw Error(internal_error, "Failed to initialize mutex.");
     if (pthread_cond_init(&d_out_cond, nullptr) != 0)
         throw Error(internal_error, "Failed to initialize cond.");
+    if (pthread_cond_init(&d_work_cond, nullptr) != 0)
+        throw Error(internal_error, "Failed to initialize cond.");
 }
 
 MarshallerThread::~MarshallerThread() {
     (void)pthread_mutex_lock(&d_out_mutex);
-    // d_child_thread_count is passed into the thread in a structure (see write_thread())
-    // and is decremented by the ChildLocker dtor when write_thread() exits. jhrg 2/7/19
-    if (d_child_thread_count != 0) {
-        (void)pthread_cond_wait(&d_out_cond, &d_out_mutex);
-        d_child_thread_count = 0;
+    // Let the writer finish whatever has been queued, then tell it to exit.
+    while (d_thread_started && d_child_thread_count != 0) {
+        if (pthread_cond_wait(&d_out_cond, &d_out_mutex) != 0)
+            break;
     }
-
+    d_shutdown = true;
+    (void)pthread_cond_signal(&d_work_cond);
     (void)pthread_mutex_unlock(&d_out_mutex);
 
+    if (d_thread_started)
+        (void)pthread_join(d_thread, nullptr);
+
+    // Only reached if the writer never ran; free anything left behind.
+    for (auto &args : d_queue)
+        if (args.d_owned)
+            delete[] args.d_buf;
+
     pthread_mutex_destroy(&d_out_mutex);
     pthread_cond_destroy(&d_out_cond);
+    pthread_cond_destroy(&d_work_cond);
+}
 
-    pthread_attr_destroy(&d_thread_attr);
+// private
+/**
+ * Queue a buffer for the writer thread, starting that thread if this is the
+ * first buffer. The caller must hold the mutex (see Locker) and must have
+ * already incremented the child thread count. If the queue is full, this
+ * waits (releasing the mutex) until the writer makes room.
+ */
+void MarshallerThread::m_enqueue(const write_args &args) {
+    if (!d_thread_started) {
+        int status = pthread_create(&d_thread, nullptr, writer, this);
+        if (status != 0) {
+            --d_child_thread_count;
+            throw InternalErr(__FILE__, __LINE__, "Could not start child thread");
+        }
+        d_thread_started = true;
+    }
+
+    while (d_queue.size() >= d_max_queued) {
+        if (pthread_cond_wait(&d_out_cond, &d_out_mutex) != 0)
+            throw InternalErr(__FILE__, __LINE__, "Could not wait on d_out_cond");
+    }
+
+    d_queue.push_back(args);
+    (void)pthread_cond_signal(&d_work_cond);
 }
 
 // not a static method
@@ -186,58 +221,98 @@ MarshallerThread::~MarshallerThread() {
  * Start the child thread, using the arguments given. This will write 'bytes'
  * bytes from 'byte_buf' to the output stream 'out'
  *
+ * @note By default the writer thread takes ownership of byte_buf and deletes
+ * it. If take_ownership is false, the caller keeps the buffer and must not
+ * change or free it until the child thread count is back to zero.
  */
-void MarshallerThread::start_thread(void *(*thread)(void *arg), ostream &out, char *byte_buf, std::streamsize bytes) {
-    auto *args = new write_args(d_out_mutex, d_out_cond, d_child_thread_count, d_thread_error, out, byte_buf, bytes);
-    int status = pthread_create(&d_thread, &d_thread_attr, thread, args);
-    if (status != 0)
-        throw InternalErr(__FILE__, __LINE__, "Could not start child thread");
+void MarshallerThread::start_thread(void *(*thread)(void *arg), ostream &out, char *byte_buf, std::streamsize bytes,
+                                    bool take_ownership) {
+    m_enqueue(write_args(thread, &out, -1, byte_buf, bytes, take_ownership));
 }
 
 /**
  * Write 'bytes' bytes from 'byte_buf' to the file descriptor 'fd'.
  */
-void MarshallerThread::start_thread(void *(*thread)(void *arg), int fd, char *byte_buf, std::streamsize bytes) {
-    auto *args = new write_args(d_out_mutex, d_out_cond, d_child_thread_count, d_thread_error, fd, byte_buf, bytes);
-    int status = pthread_create(&d_thread, &d_thread_attr, thread, args);
-    if (status != 0)
-        throw InternalErr(__FILE__, __LINE__, "Could not start child thread");
+void MarshallerThread::start_thread(void *(*thread)(void *arg), int fd, char *byte_buf, std::streamsize bytes,
+                                    bool take_ownership) {
+    m_enqueue(write_args(thread, nullptr, fd, byte_buf, bytes, take_ownership));
+}
+
+/**
+ * The body of the long-lived writer thread. Take buffers off the queue in
+ * order, write them without holding the mutex (the main thread does not
+ * touch the output until the child thread count drops to zero), then
+ * update the count and signal whoever waits in a Locker.
+ */
+void *MarshallerThread::writer(void *arg) {
+    auto *mt = static_cast<MarshallerThread *>(arg);
+
+    (void)pthread_mutex_lock(&mt->d_out_mutex);
+    while (true) {
+        while (mt->d_queue.empty() && !mt->d_shutdown)
+            (void)pthread_cond_wait(&mt->d_work_cond, &mt->d_out_mutex);
+
+        if (mt->d_queue.empty())
+            break; // d_shutdown is true
+
+        write_args args = mt->d_queue.front();
+        mt->d_queue.pop_front();
+        (void)pthread_mutex_unlock(&mt->d_out_mutex);
+
+        void *status;
+        try {
+            status = args.d_thread(&args);
+        } catch (std::exception &e) { // includes libdap::Error and ios::failure
+            args.d_error = e.what();
+            status = (void *)-1;
+        }
+        if (args.d_owned)
+            delete[] args.d_buf;
+
+        (void)pthread_mutex_lock(&mt->d_out_mutex);
+        if (status != nullptr && mt->d_thread_error.empty())
+            mt->d_thread_error = args.d_error.empty() ? string("Could not write data") : args.d_error;
+        --mt->d_child_thread_count;
+        (void)pthread_cond_broadcast(&mt->d_out_cond);
+    }
+    (void)pthread_mutex_unlock(&mt->d_out_mutex);
+
+    return nullptr;
 }
 
 /**
  * This static method is used to write data to the ostream referenced
- * by the ostream element of write_args. This is used by start_thread()
- * and passed to pthread_create()
+ * by the ostream element of write_args. It is run by the writer thread
+ * for buffers queued with it by start_thread().
  *
  * @note The write_args argument may contain either a file descriptor
- * (d_out_file) or an ostream& (d_out). If the file descriptor is not
- * -1, then use that, else use the ostream reference.
+ * (d_out_file) or an ostream* (d_out). If the file descriptor is not
+ * -1, then use that, else use the ostream.
+ *
+ * @return 0 if successful, -1 otherwise.
  */
 void *MarshallerThread::write_thread(void *arg) {
     auto *args = reinterpret_cast<write_args *>(arg);
 
-    ChildLocker lock(args->d_mutex, args->d_cond, args->d_count); // RAII; will unlock on exit
-
 #if TIMING
     struct timeval tp_s;
     if (print_time && gettimeofday(&tp_s, 0) != 0)
         cerr << "could not read time" << endl;
 #endif
 
-    // force an error
-    // return (void*)-1;
-
     if (args->d_out_file != -1) {
         auto bytes_written = write(args->d_out_file, args->d_buf, args->d_num);
-        if (bytes_written != args->d_num)
+        if (bytes_written != args->d_num) {
+            args->d_error = "Could not write data to the file descriptor.";
             return (void *)-1;
+        }
     } else {
 #if USE_SEGMENTED_WRITE
-        segmented_write(args->d_out, args->d_buf, args->d_num);
+        segmented_write(*args->d_out, args->d_buf, args->d_num);
 #else
-        args->d_out.write(args->d_buf, args->d_num);
+        args->d_out->write(args->d_buf, args->d_num);
 #endif
-        if (args->d_out.fail()) {
+        if (args->d_out->fail()) {
             ostringstream oss;
             oss << "Could not write data: " << __FILE__ << ":" << __LINE__;
             args->d_error = oss.str();
@@ -245,9 +320,6 @@ void *MarshallerThread::write_thread(void *arg) {
         }
     }
 
-    delete[] args->d_buf;
-    delete args;
-
 #if TIMING
     struct timeval tp_e;
     if (print_time) {
@@ -263,8 +335,8 @@ void *MarshallerThread::write_thread(void *arg) {
 
 /**
  * This static method is used to write data to the ostream referenced
- * by the ostream element of write_args. This is used by start_thread()
- * and passed to pthread_create()
+ * by the ostream element of write_args. It is run by the writer thread
+ * for buffers queued with it by start_thread().
  *
  * @note This differs from MarshallerThread::write_thread() in that it
  * writes data starting _after_ the four-byte length prefix that XDR
@@ -276,19 +348,19 @@ void *MarshallerThread::write_thread(void *arg) {
 void *MarshallerThread::write_thread_part(void *arg) {
     auto *args = reinterpret_cast<write_args *>(arg);
 
-    ChildLocker lock(args->d_mutex, args->d_cond, args->d_count); // RAII; will unlock on exit
-
     if (args->d_out_file != -1) {
         auto bytes_written = write(args->d_out_file, args->d_buf, args->d_num);
-        if (bytes_written != args->d_num)
+        if (bytes_written != args->d_num) {
+            args->d_error = "Could not write data to the file descriptor.";
             return (void *)-1;
+        }
     } else {
 #if USE_SEGMENTED_WRITE
-        segmented_write(args->d_out, args->d_buf + 4, args->d_num);
+        segmented_write(*args->d_out, args->d_buf + 4, args->d_num);
 #else
-        args->d_out.write(args->d_buf + 4, args->d_num);
+        args->d_out->write(args->d_buf + 4, args->d_num);
 #endif
-        if (args->d_out.fail()) {
+        if (args->d_out->fail()) {
             ostringstream oss;
             oss << "Could not write data: " << __FILE__ << ":" << __LINE__;
             args->d_error = oss.str();
@@ -296,8 +368,5 @@ void *MarshallerThread::write_thread_part(void *arg) {
         }
     }
 
-    delete[] args->d_buf;
-    delete args;
-
     return nullptr;
 }
@@ -35,25 +35,29 @@
 
 #include <pthread.h>
 
+#include <deque>
 #include <iostream>
 #include <ostream>
 #include <string>
 
 namespace libdap {
 
+class MarshallerStats;
+
 /**
  * RAII for the MarshallerThread mutex and condition variable. Used by the
  * Main thread. The constructor locks the mutex and then, if the count of
  * child threads is not zero, blocks on the associated condition variable.
  * When signaled by the child thread using the condition variable (the child
  * thread count should then be zero), the mutex is (re)locked and the ctor
- * returns. The destructor unlocks the mutex.
+ * returns. The destructor unlocks the mutex. If given MarshallerStats, the
+ * time the constructor waits is added to its wait time.
  */
 class Locker {
 public:
     Locker() = delete;
     Locker(const Locker &rhs) = delete;
-    Locker(pthread_mutex_t &lock, pthread_cond_t &cond, int &count);
+    Locker(pthread_mutex_t &lock, pthread_cond_t &cond, int &count, MarshallerStats *stats = nullptr);
     virtual ~Locker();
 
 private:
@@ -89,54 +93,60 @@ private:
  * The main thread can be used to read the next chunk of data
  * while whatever has been read to this point is sent over the wire.
  *
- * This code is used by XDRStreamMarshaller and (soon) D4StreamMarshaller.
+ * Each instance owns one long-lived writer thread, started the first time
+ * start_thread() is called and joined by the destructor. Buffers passed to
+ * start_thread() are queued (the queue is bounded) and written in the order
+ * they were submitted; the writer thread deletes each buffer once it has
+ * been written, unless the caller keeps ownership (then the caller must not
+ * reuse the buffer until a Locker has seen the count drop to zero). The
+ * child thread count is the number of buffers queued or being written, so a
+ * Locker still blocks until all pending output is done.
+ *
+ * This code is used by XDRStreamMarshaller and D4StreamMarshaller.
  */
 class MarshallerThread {
 private:
     pthread_t d_thread;
-    pthread_attr_t d_thread_attr;
+    bool d_thread_started = false;
+    bool d_shutdown = false;
 
     pthread_mutex_t d_out_mutex;
-    pthread_cond_t d_out_cond;
+    pthread_cond_t d_out_cond;  // signaled when the child thread count changes
+    pthread_cond_t d_work_cond; // signaled when work is queued or at shutdown
 
-    int d_child_thread_count = 0; // 0 or 1
+    int d_child_thread_count = 0; // number of buffers queued or being written
     std::string d_thread_error;   // non-null indicates an error
 
+    unsigned int d_max_queued;
+
     /**
-     * Used to pass information into the static methods that run the
-     * simple stream writer threads. This can pass both an ostream or
-     * a file descriptor. If a fd is passed, the ostream reference is
-     * set to stderr (i.e., std::cerr).
+     * One queued write. This can hold both an ostream or a file descriptor.
+     * If a fd is passed, the ostream pointer is null.
      */
     struct write_args {
-        pthread_mutex_t &d_mutex;
-        pthread_cond_t &d_cond;
-        int &d_count;
-        std::string &d_error;
-        std::ostream &d_out;   // The output stream protected by the mutex, ...
-        int d_out_file;        // file descriptor; if not -1, use this.
-        char *d_buf;           // The data to write to the stream
-        std::streamsize d_num; // The size of d_buf
-
-        /**
-         * Build args for an ostream. The file descriptor is set to -1
-         */
-        write_args(pthread_mutex_t &m, pthread_cond_t &c, int &count, std::string &e, std::ostream &s, char *vals,
-                   std::streamsize num)
-            : d_mutex(m), d_cond(c), d_count(count), d_error(e), d_out(s), d_out_file(-1), d_buf(vals), d_num(num) {}
-
-        /**
-         * Build args for a file descriptr. The ostream is set to cerr (because it is
-         * a reference and has to be initialized to something).
-         */
-        write_args(pthread_mutex_t &m, pthread_cond_t &c, int &count, std::string &e, int fd, char *vals,
-                   std::streamsize num)
-            : d_mutex(m), d_cond(c), d_count(count), d_error(e), d_out(std::cerr), d_out_file(fd), d_buf(vals),
-              d_num(num) {}
+        void *(*d_thread)(void *arg); // write_thread() or write_thread_part()
+        std::ostream *d_out;          // The output stream, ...
+        int d_out_file;               // file descriptor; if not -1, use this.
+        char *d_buf;                  // The data to write to the stream
+        std::streamsize d_num;        // The size of d_buf
+        bool d_owned;                 // If true, delete d_buf once it is written
+        std::string d_error;          // Set by d_thread when the write fails
+
+        write_args(void *(*thread)(void *), std::ostream *s, int fd, char *vals, std::streamsize num, bool owned)
+            : d_thread(thread), d_out(s), d_out_file(fd), d_buf(vals), d_num(num), d_owned(owned) {}
     };
 
+    std::deque<write_args> d_queue;
+
+    void m_enqueue(const write_args &args);
+
+    static void *writer(void *arg);
+
 public:
-    MarshallerThread();
+    /// The number of buffers that can wait for the writer before start_thread() blocks.
+    static const unsigned int default_max_queued = 4;
+
+    explicit MarshallerThread(unsigned int max_queued = default_max_queued);
     virtual ~MarshallerThread();
 
     /** @brief Returns the mutex guarding shared output state. */
@@ -144,16 +154,21 @@ public:
     /** @brief Returns the condition variable used to signal child-thread completion. */
     pthread_cond_t &get_cond() { return d_out_cond; }
 
-    /** @brief Returns the current number of active child threads. */
+    /** @brief Returns the current number of pending child-thread writes. */
     int &get_child_thread_count() { return d_child_thread_count; }
-    /** @brief Increments the active child-thread count. */
+    /** @brief Increments the pending child-thread write count. */
     void increment_child_thread_count() { ++d_child_thread_count; }
 
-    void start_thread(void *(*thread)(void *arg), std::ostream &out, char *byte_buf, std::streamsize bytes_written);
-    void start_thread(void *(*thread)(void *arg), int fd, char *byte_buf, std::streamsize bytes_written);
+    /** @brief The first error reported by the writer thread; empty if none. Read while holding the mutex. */
+    const std::string &get_thread_error() const { return d_thread_error; }
+
+    void start_thread(void *(*thread)(void *arg), std::ostream &out, char *byte_buf, std::streamsize bytes_written,
+                      bool take_ownership = true);
+    void start_thread(void *(*thread)(void *arg), int fd, char *byte_buf, std::streamsize bytes_written,
+                      bool take_ownership = true);
 
-    // These are static, so they will have c-linkage - required because they
-    // are passed to pthread_create()
+    // These are run by the writer thread, once for each queued buffer. The
+    // one passed to start_thread() determines how the buffer is written.
     static void *write_thread(void *arg);
     static void *write_thread_part(void *arg);
 };
@@ -0,0 +1,187 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _name_index_h
+#define _name_index_h 1
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace libdap {
+
+/// @brief The part of NameIndex that does not depend on the item type
+class NameIndexBase {
+public:
+    /// Containers with fewer items than this are searched without an index.
+    static const size_t min_size = 16;
+
+    /// @brief A name that is not copied: a pointer and a length.
+    struct Ref {
+        const char *data;
+        size_t size;
+
+        bool operator==(const Ref &rhs) const { return size == rhs.size && memcmp(data, rhs.data, size) == 0; }
+    };
+
+    struct RefHash {
+        size_t operator()(const Ref &r) const;
+    };
+};
+
+/// @brief The name NameIndex uses for an item; overload this for items without a name() method.
+template <typename T> std::string index_name(const T *item) { return item->name(); }
+
+/**
+ * @brief A hash index of the names of the items in a vector
+ *
+ * Constructor, D4Group and DDS hold their variables (or groups) in vectors
+ * and find them by name; so do D4Attributes and AttrTable with their
+ * attributes. With tens of thousands of items in one container, the linear
+ * searches made lookups in the CE parsers, the DMR parser's map resolution
+ * and attribute merging quadratic.
+ *
+ * An index maps each name to the position of the first item with that name,
+ * so lookups find the same item a linear search would. It is built the
+ * first time a container of at least min_size items is searched and is
+ * used until the container changes. The containers update their index with
+ * appended() when they add an item at the end and drop it in the methods
+ * that otherwise add or remove items; as a backstop, find() also rebuilds an
+ * index built for a vector of a different size, and checks the name of the
+ * item it finds.
+ *
+ * An item can be renamed without its container knowing. Constructor and
+ * D4Group pass find() the path generation of the tree they are in, which
+ * BaseType::set_name() changes, and an index built for another generation
+ * is rebuilt. A D4Attribute drops the index of the container that holds it
+ * when it is renamed. The top-level variables of a DDS have no parent, so
+ * DDS checks a name that is not found with a linear search. Renaming an
+ * item in one DMR or DDS does not affect the indexes of another.
+ *
+ * The index is held by a std::shared_ptr that is read and replaced with the
+ * atomic shared_ptr functions, so threads that only search a container
+ * (e.g., evaluating constraints in different D4RequestContext objects) can
+ * build it at the same time.
+ *
+ * @note Replacing an item through an iterator (e.g., *Vars_iter = btp) is
+ * not seen by the index unless the item's name is checked; use the
+ * container's methods instead.
+ */
+template <typename T> class NameIndex : public NameIndexBase {
+    std::deque<std::string> d_names; // The Refs point into these; a deque does not move them
+    std::unordered_map<Ref, size_t, RefHash> d_positions;
+
+    size_t d_size;
+    uint64_t d_generation;
+
+    void m_add(const T *item) {
+        d_names.push_back(index_name(item));
+        d_positions.emplace(Ref{d_names.back().data(), d_names.back().size()}, d_size++); // keeps the first
+    }
+
+public:
+    NameIndex(const std::vector<T *> &items, uint64_t generation) : d_size(0), d_generation(generation) {
+        d_positions.reserve(items.size());
+        for (auto item : items)
+            m_add(item);
+    }
+
+    /// @brief Was this index built for the current contents of items?
+    bool valid_for(const std::vector<T *> &items, uint64_t generation) const {
+        return d_size == items.size() && d_generation == generation;
+    }
+
+    /// @brief The position of the first item with the name, or the number of items.
+    size_t position(const char *name, size_t length) const {
+        auto i = d_positions.find(Ref{name, length});
+        return i == d_positions.end() ? d_size : i->second;
+    }
+
+    /**
+     * @brief Find the first item in a vector with a name
+     *
+     * @param index The index for items; built or rebuilt as needed
+     * @param items The items
+     * @param name The name, which need not be null terminated
+     * @param length The length of name
+     * @param generation Changes when an item is renamed; 0 for containers
+     * whose items are only renamed by the container itself
+     * @return The position of the item or items.size() if there is none
+     */
+    static size_t find(std::shared_ptr<NameIndex> &index, const std::vector<T *> &items, const char *name,
+                       size_t length, uint64_t generation = 0) {
+        if (items.size() < min_size) {
+            for (size_t i = 0; i < items.size(); ++i) {
+                const std::string &n = index_name(items[i]);
+                if (n.size() == length && memcmp(n.data(), name, length) == 0)
+                    return i;
+            }
+            return items.size();
+        }
+
+        std::shared_ptr<NameIndex> current = std::atomic_load(&index);
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            if (!current || !current->valid_for(items, generation)) {
+                current = std::make_shared<NameIndex>(items, generation);
+                std::atomic_store(&index, current);
+            }
+
+            size_t p = current->position(name, length);
+            if (p == items.size())
+                return p;
+
+            const std::string &n = index_name(items[p]);
+            if (n.size() == length && memcmp(n.data(), name, length) == 0)
+                return p;
+
+            current.reset(); // an item was replaced without telling us
+        }
+
+        return items.size();
+    }
+
+    /**
+     * @brief Update an index after an item was added to the end of a vector
+     *
+     * Adding items one at a time and searching in between (e.g., to check
+     * for duplicates) does not rebuild the index each time.
+     *
+     * @param index The index for items; dropped if it cannot be updated
+     * @param items The items, including the new one
+     * @param generation As for find()
+     */
+    static void appended(std::shared_ptr<NameIndex> &index, const std::vector<T *> &items, uint64_t generation = 0) {
+        if (index && index->d_size + 1 == items.size() && index->d_generation == generation)
+            index->m_add(items.back());
+        else
+            index.reset();
+    }
+};
+
+} // namespace libdap
+
+#endif // _name_index_h
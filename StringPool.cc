@@ -0,0 +1,122 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <mutex>
+#include <unordered_map>
+
+#include "NameIndex.h"
+#include "StringPool.h"
+
+namespace libdap {
+
+namespace {
+
+// The text of a node and its hash, which picks the shard, so it is
+// computed once. The text points into the node the key maps to.
+struct Key {
+    NameIndexBase::Ref text;
+    size_t hash;
+
+    explicit Key(const std::string &t) : text{t.data(), t.size()}, hash(NameIndexBase::RefHash()(text)) {}
+
+    bool operator==(const Key &rhs) const { return text == rhs.text; }
+};
+
+struct KeyHash {
+    size_t operator()(const Key &k) const { return k.hash; }
+};
+
+struct Shard {
+    std::mutex mutex;
+    std::unordered_map<Key, void *, KeyHash> nodes;
+};
+
+// The pool is split by the hash of the text so that threads making handles
+// for different names seldom wait for the same lock.
+const size_t shard_count = 64;
+
+// Never destroyed, so InternedStrings in static objects can be destroyed
+// after it would have been.
+Shard *shards() {
+    static Shard *s = new Shard[shard_count];
+    return s;
+}
+
+Shard &shard(const Key &key) { return shards()[key.hash % shard_count]; }
+
+} // namespace
+
+InternedString::Node *InternedString::m_intern(const std::string &text) {
+    Key key(text);
+    Shard &s = shard(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    auto i = s.nodes.find(key);
+    if (i != s.nodes.end()) {
+        auto node = static_cast<Node *>(i->second);
+        // A node whose count reached zero is being released by another
+        // thread, which is waiting for the lock; replace it.
+        size_t refs = node->refs.load(std::memory_order_relaxed);
+        while (refs != 0) {
+            if (node->refs.compare_exchange_weak(refs, refs + 1, std::memory_order_relaxed))
+                return node;
+        }
+        s.nodes.erase(i);
+    }
+
+    auto node = new Node(text);
+    key.text.data = node->text.data();
+    s.nodes.emplace(key, node);
+    return node;
+}
+
+void InternedString::m_release(Node *node) {
+    {
+        Key key(node->text);
+        Shard &s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto i = s.nodes.find(key);
+        if (i != s.nodes.end() && i->second == node)
+            s.nodes.erase(i);
+    }
+    delete node;
+}
+
+const std::string &InternedString::empty_string() {
+    static const std::string *empty = new std::string;
+    return *empty;
+}
+
+size_t StringPool::size() {
+    size_t size = 0;
+    for (size_t i = 0; i < shard_count; ++i) {
+        Shard &s = shards()[i];
+        std::lock_guard<std::mutex> lock(s.mutex);
+        size += s.nodes.size();
+    }
+    return size;
+}
+
+} // namespace libdap
@@ -0,0 +1,110 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _string_pool_h
+#define _string_pool_h 1
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+namespace libdap {
+
+/**
+ * @brief A handle to a string held once for the whole process
+ *
+ * Variable names, dataset names and attribute names repeat a lot: a DMR
+ * with a million attributes holds tens of thousands of copies of "units" or
+ * "long_name", and every ptr_duplicate() copies the names again. An
+ * InternedString points to the one copy of its text in the process-wide
+ * pool, so it is the size of a pointer and copying it only increments a
+ * reference count.
+ *
+ * Reading or copying a handle takes no lock. Making an InternedString from
+ * a std::string locks one of the shards the pool is split into, chosen by
+ * the hash of the text, as does dropping the last handle to a string, which
+ * removes the string from the pool. The empty string is not pooled.
+ */
+class InternedString {
+    struct Node {
+        std::atomic<size_t> refs;
+        const std::string text;
+
+        explicit Node(const std::string &t) : refs(1), text(t) {}
+    };
+
+    Node *d_node = nullptr;
+
+    static Node *m_intern(const std::string &text);
+    static void m_release(Node *node);
+
+    friend class StringPool;
+
+public:
+    InternedString() = default;
+    InternedString(const std::string &text) : d_node(text.empty() ? nullptr : m_intern(text)) {}
+    InternedString(const char *text) : InternedString(std::string(text)) {}
+
+    InternedString(const InternedString &rhs) : d_node(rhs.d_node) {
+        if (d_node)
+            d_node->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    InternedString(InternedString &&rhs) noexcept : d_node(rhs.d_node) { rhs.d_node = nullptr; }
+
+    InternedString &operator=(InternedString rhs) noexcept {
+        std::swap(d_node, rhs.d_node);
+        return *this;
+    }
+
+    ~InternedString() {
+        if (d_node && d_node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            m_release(d_node);
+    }
+
+    /// @brief The text
+    const std::string &str() const { return d_node ? d_node->text : empty_string(); }
+    operator const std::string &() const { return str(); }
+
+    bool empty() const { return !d_node; }
+
+    static const std::string &empty_string();
+
+    /// @brief Two handles to the same text hold the same pointer.
+    bool operator==(const InternedString &rhs) const { return d_node == rhs.d_node; }
+    bool operator!=(const InternedString &rhs) const { return d_node != rhs.d_node; }
+    bool operator==(const std::string &rhs) const { return str() == rhs; }
+    bool operator!=(const std::string &rhs) const { return str() != rhs; }
+};
+
+/// @brief The pool of InternedString text; for statistics and tests.
+class StringPool {
+public:
+    /// @brief The number of distinct strings in the pool
+    static size_t size();
+};
+
+} // namespace libdap
+
+#endif // _string_pool_h
@@ -0,0 +1,433 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+/*
+ * The io_uring code talks to the kernel directly (io_uring_setup(2),
+ * io_uring_enter(2) and the shared rings) so that liburing is not needed;
+ * only the kernel's linux/io_uring.h header is. See io_uring(7).
+ */
+
+#include "config.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define URING_SINK_HAVE_URING 1
+#endif
+#endif
+
+#include "Error.h"
+#include "UringSink.h"
+
+using namespace std;
+
+namespace libdap {
+
+#if URING_SINK_HAVE_URING
+namespace {
+
+int sys_io_uring_setup(unsigned int entries, struct io_uring_params *p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int sys_io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+} // namespace
+#endif
+
+/**
+ * @brief Can this host use io_uring?
+ * The answer is found once, by making a small ring. Besides the kernel
+ * version, io_uring can be turned off (kernel.io_uring_disabled) or blocked
+ * by a container's seccomp policy.
+ */
+bool UringSink::available() {
+#if URING_SINK_HAVE_URING
+    static const bool ok = []() {
+        struct io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        int fd = sys_io_uring_setup(1, &p);
+        if (fd < 0)
+            return false;
+        close(fd);
+        // Writes at the current position came with IORING_OP_WRITE in Linux 5.6
+        return (p.features & IORING_FEAT_RW_CUR_POS) != 0;
+    }();
+    return ok;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Make a sink for a file descriptor
+ * @param fd Write to this; the caller owns it
+ * @param depth The number of buffers, and so the most writes in flight
+ * @param buffer_size The size of each buffer; each write(2) or io_uring
+ * write sends at most this many bytes
+ */
+UringSink::UringSink(int fd, unsigned int depth, size_t buffer_size)
+    : d_fd(fd), d_buffers(depth ? depth : 1), d_buffer_size(buffer_size ? buffer_size : default_buffer_size) {
+    // Writes to a regular file can go in parallel since each has its own
+    // offset. That does not hold with O_APPEND, where the kernel ignores it.
+    struct stat sb;
+    int flags = fcntl(fd, F_GETFL);
+    if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && flags != -1 && !(flags & O_APPEND)) {
+        off_t pos = lseek(fd, 0, SEEK_CUR);
+        if (pos >= 0) {
+            d_seekable = true;
+            d_offset = pos;
+        }
+    }
+    d_max_in_flight = d_seekable ? d_buffers.size() : 1;
+
+    if (available() && !m_setup_ring(d_buffers.size()))
+        m_close_ring();
+}
+
+UringSink::~UringSink() {
+    try {
+        flush();
+    } catch (...) {
+        // Destructors must not throw
+    }
+    m_close_ring();
+}
+
+/**
+ * @brief Copy bytes to the sink
+ * Full buffers are sent; the bytes left over stay in the sink until more are
+ * written or submit() or flush() is called.
+ * @exception Error if an earlier write failed
+ */
+void UringSink::write(const void *data, size_t num_bytes) {
+    m_check_error();
+
+    auto *src = static_cast<const char *>(data);
+    while (num_bytes > 0) {
+        if (d_current == -1)
+            d_current = m_acquire_buffer();
+
+        Buffer &b = d_buffers[d_current];
+        size_t n = std::min(num_bytes, b.data.size() - b.size);
+        memcpy(b.data.data() + b.size, src, n);
+        b.size += n;
+        src += n;
+        num_bytes -= n;
+
+        if (b.size == b.data.size()) {
+            int full = d_current;
+            d_current = -1;
+            m_submit_buffer(full);
+        }
+    }
+}
+
+/**
+ * @brief Start writing whatever has been written to the sink
+ * This does not wait for the writes to finish; see flush().
+ */
+void UringSink::submit() {
+    if (d_current != -1 && d_buffers[d_current].size > 0) {
+        int partial = d_current;
+        d_current = -1;
+        m_submit_buffer(partial);
+    }
+}
+
+/**
+ * @brief Write everything and wait until it has been written
+ * @exception Error if any write failed
+ */
+void UringSink::flush() {
+    submit();
+
+    while (d_in_flight > 0) {
+        m_reap();
+        if (d_in_flight > 0)
+            m_enter(1);
+    }
+
+    // Leave a regular file's offset where write(2) would have.
+    if (d_seekable) {
+        (void)lseek(d_fd, d_offset, SEEK_SET);
+        d_reread_offset = true;
+    }
+
+    m_check_error();
+}
+
+// private
+/// Return a buffer that is not being written, waiting for one if needed.
+int UringSink::m_acquire_buffer() {
+    for (;;) {
+        for (size_t i = 0; i < d_buffers.size(); ++i) {
+            if (!d_buffers[i].in_flight) {
+                if (d_buffers[i].data.empty())
+                    d_buffers[i].data.resize(d_buffer_size);
+                d_buffers[i].size = 0;
+                return static_cast<int>(i);
+            }
+        }
+
+        m_reap();
+        if (d_in_flight == d_buffers.size())
+            m_enter(1);
+    }
+}
+
+// private
+/// Send a buffer; with io_uring this returns once the kernel has the request.
+void UringSink::m_submit_buffer(int index) {
+    Buffer &b = d_buffers[index];
+    if (d_reread_offset) {
+        off_t pos = lseek(d_fd, 0, SEEK_CUR);
+        if (pos >= 0)
+            d_offset = pos;
+        d_reread_offset = false;
+    }
+    b.offset = d_offset;
+    if (d_seekable)
+        d_offset += b.size;
+
+    if (d_ring_fd == -1) {
+        m_write_all(b.data.data(), b.size, b.offset);
+        b.size = 0;
+        return;
+    }
+
+#if URING_SINK_HAVE_URING
+    while (d_in_flight >= d_max_in_flight) {
+        m_reap();
+        if (d_in_flight >= d_max_in_flight)
+            m_enter(1);
+    }
+
+    // This is the only thread that adds to the SQ ring, so the tail can be
+    // read without a barrier; the store publishes the entry to the kernel.
+    unsigned int tail = *d_sq_tail;
+    unsigned int idx = tail & *d_sq_mask;
+    auto *sqe = static_cast<struct io_uring_sqe *>(d_sqes) + idx;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = d_fd;
+    sqe->addr = reinterpret_cast<uint64_t>(b.data.data());
+    sqe->len = static_cast<uint32_t>(b.size);
+    sqe->off = d_seekable ? b.offset : static_cast<uint64_t>(-1); // -1: the current position
+    sqe->user_data = static_cast<uint64_t>(index);
+    d_sq_array[idx] = idx;
+    __atomic_store_n(d_sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    b.in_flight = true;
+    ++d_in_flight;
+    ++d_to_submit;
+
+    // Hand it to the kernel now so it is written while the next buffer is
+    // filled. If every buffer is in flight the next write must wait anyway,
+    // and that io_uring_enter(2) call submits this one too.
+    if (d_in_flight < d_buffers.size())
+        m_enter(0);
+#endif
+}
+
+// private
+/**
+ * Submit the queued requests and, if 'wait_for' is not zero, wait for that
+ * many to complete. Completed requests are then reaped.
+ */
+void UringSink::m_enter(unsigned int wait_for) {
+#if URING_SINK_HAVE_URING
+    if (d_to_submit == 0 && wait_for == 0)
+        return;
+
+    for (;;) {
+        int ret = sys_io_uring_enter(d_ring_fd, d_to_submit, wait_for, wait_for ? IORING_ENTER_GETEVENTS : 0);
+        ++d_syscalls;
+        if (ret >= 0) {
+            d_to_submit -= std::min(d_to_submit, static_cast<unsigned int>(ret));
+            break;
+        }
+        if (errno != EINTR)
+            throw Error(string("Network I/O Error. Could not write data: ") + strerror(errno));
+    }
+
+    m_reap();
+#endif
+}
+
+// private
+/// Process the completions in the CQ ring.
+void UringSink::m_reap() {
+#if URING_SINK_HAVE_URING
+    if (d_ring_fd == -1)
+        return;
+
+    unsigned int head = *d_cq_head;
+    unsigned int tail = __atomic_load_n(d_cq_tail, __ATOMIC_ACQUIRE);
+    auto *cqes = static_cast<struct io_uring_cqe *>(d_cqes);
+    while (head != tail) {
+        const struct io_uring_cqe &cqe = cqes[head & *d_cq_mask];
+        m_complete(static_cast<int>(cqe.user_data), cqe.res);
+        ++head;
+    }
+    __atomic_store_n(d_cq_head, head, __ATOMIC_RELEASE);
+#endif
+}
+
+// private
+/// A write finished; send the rest of a short write and note any error.
+void UringSink::m_complete(int index, int64_t result) {
+    Buffer &b = d_buffers[index];
+    b.in_flight = false;
+    --d_in_flight;
+
+    if (result < 0) {
+        if (d_error.empty())
+            d_error = strerror(static_cast<int>(-result));
+    } else if (static_cast<size_t>(result) < b.size) {
+        // With a socket or pipe this is the only write in flight, so the
+        // rest still goes out in order.
+        try {
+            m_write_all(b.data.data() + result, b.size - result, b.offset + result);
+        } catch (Error &e) {
+            if (d_error.empty())
+                d_error = e.get_error_message();
+        }
+    }
+    b.size = 0;
+}
+
+// private
+/// Write all the bytes using write(2), or pwrite(2) for a regular file.
+void UringSink::m_write_all(const char *data, size_t num_bytes, uint64_t offset) {
+    while (num_bytes > 0) {
+        ssize_t n = d_seekable ? pwrite(d_fd, data, num_bytes, static_cast<off_t>(offset))
+                               : ::write(d_fd, data, num_bytes);
+        ++d_syscalls;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw Error(string("Network I/O Error. Could not write data: ") + strerror(errno));
+        }
+        data += n;
+        num_bytes -= n;
+        offset += n;
+    }
+}
+
+// private
+void UringSink::m_check_error() {
+    if (!d_error.empty())
+        throw Error("Network I/O Error. Could not write data: " + d_error);
+}
+
+// private
+/// Make the rings; false if that fails, in which case write(2) is used.
+bool UringSink::m_setup_ring(unsigned int entries) {
+#if URING_SINK_HAVE_URING
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    d_ring_fd = sys_io_uring_setup(entries, &p);
+    if (d_ring_fd < 0) {
+        d_ring_fd = -1;
+        return false;
+    }
+
+    d_sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    d_cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        d_sq_size = d_cq_size = std::max(d_sq_size, d_cq_size);
+
+    d_sq_ptr = mmap(nullptr, d_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, d_ring_fd,
+                    IORING_OFF_SQ_RING);
+    if (d_sq_ptr == MAP_FAILED) {
+        d_sq_ptr = nullptr;
+        return false;
+    }
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        d_cq_ptr = d_sq_ptr;
+    } else {
+        d_cq_ptr = mmap(nullptr, d_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, d_ring_fd,
+                        IORING_OFF_CQ_RING);
+        if (d_cq_ptr == MAP_FAILED) {
+            d_cq_ptr = nullptr;
+            return false;
+        }
+    }
+
+    d_sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    d_sqes = mmap(nullptr, d_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, d_ring_fd, IORING_OFF_SQES);
+    if (d_sqes == MAP_FAILED) {
+        d_sqes = nullptr;
+        return false;
+    }
+
+    auto *sq = static_cast<char *>(d_sq_ptr);
+    d_sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    d_sq_mask = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    d_sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+
+    auto *cq = static_cast<char *>(d_cq_ptr);
+    d_cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    d_cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    d_cq_mask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    d_cqes = cq + p.cq_off.cqes;
+
+    return true;
+#else
+    (void)entries;
+    return false;
+#endif
+}
+
+// private
+void UringSink::m_close_ring() {
+#if URING_SINK_HAVE_URING
+    if (d_sqes)
+        munmap(d_sqes, d_sqes_size);
+    if (d_cq_ptr && d_cq_ptr != d_sq_ptr)
+        munmap(d_cq_ptr, d_cq_size);
+    if (d_sq_ptr)
+        munmap(d_sq_ptr, d_sq_size);
+#endif
+    if (d_ring_fd != -1)
+        close(d_ring_fd);
+
+    d_sqes = d_cq_ptr = d_sq_ptr = nullptr;
+    d_ring_fd = -1;
+}
+
+} // namespace libdap
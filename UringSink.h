@@ -0,0 +1,123 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef URING_SINK_H_
+#define URING_SINK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace libdap {
+
+/**
+ * @brief Write to a file descriptor using io_uring
+ *
+ * Bytes passed to write() are copied to one of 'depth' buffers. A full
+ * buffer is handed to the kernel with io_uring and the caller goes on to fill
+ * the next one, so up to 'depth' writes can be in flight without a thread.
+ * Writes to regular files use explicit offsets and may complete in any
+ * order; for sockets and pipes only one write is in flight at a time so the
+ * bytes stay in order.
+ *
+ * When io_uring is not available (it needs Linux 5.6 or later, and it may be
+ * disabled or blocked by a seccomp policy) the same buffers are written with
+ * blocking write(2) calls. The output is identical either way.
+ *
+ * @note The file descriptor must be blocking. On return from flush(), a
+ * regular file's offset is just past the bytes written, and the caller may
+ * write to the file itself before using the sink again.
+ */
+class UringSink {
+public:
+    static const unsigned int default_depth = 4;
+    static const size_t default_buffer_size = 1024 * 1024;
+
+    explicit UringSink(int fd, unsigned int depth = default_depth, size_t buffer_size = default_buffer_size);
+    ~UringSink();
+
+    UringSink(const UringSink &) = delete;
+    UringSink &operator=(const UringSink &) = delete;
+
+    static bool available();
+
+    /// @brief True if writes go through io_uring, false if they use write(2).
+    bool using_uring() const { return d_ring_fd != -1; }
+
+    void write(const void *data, size_t num_bytes);
+    void submit();
+    void flush();
+
+    /// @brief The number of system calls made to write data (io_uring_enter(2) or write(2)).
+    uint64_t syscalls() const { return d_syscalls; }
+
+private:
+    struct Buffer {
+        std::vector<char> data;
+        size_t size = 0;     // bytes used
+        uint64_t offset = 0; // file offset, for regular files
+        bool in_flight = false;
+    };
+
+    int d_fd;
+    bool d_seekable = false;
+    uint64_t d_offset = 0; // the offset of the next byte, for regular files
+    bool d_reread_offset = false; // the caller may have moved the offset since flush()
+
+    std::vector<Buffer> d_buffers; // allocated as they are first used
+    size_t d_buffer_size;
+    int d_current = -1; // the buffer being filled, -1 if none
+    unsigned int d_in_flight = 0;
+    unsigned int d_max_in_flight = 1;
+    unsigned int d_to_submit = 0; // queued in the SQ ring, not yet passed to the kernel
+    std::string d_error;          // the first write error
+    uint64_t d_syscalls = 0;
+
+    // The io_uring instance; d_ring_fd is -1 when write(2) is used instead.
+    int d_ring_fd = -1;
+    void *d_sq_ptr = nullptr;
+    size_t d_sq_size = 0;
+    void *d_cq_ptr = nullptr;
+    size_t d_cq_size = 0;
+    void *d_sqes = nullptr;
+    size_t d_sqes_size = 0;
+    unsigned *d_sq_tail = nullptr, *d_sq_mask = nullptr, *d_sq_array = nullptr;
+    unsigned *d_cq_head = nullptr, *d_cq_tail = nullptr, *d_cq_mask = nullptr;
+    void *d_cqes = nullptr;
+
+    bool m_setup_ring(unsigned int entries);
+    void m_close_ring();
+
+    int m_acquire_buffer();
+    void m_submit_buffer(int index);
+    void m_enter(unsigned int wait_for);
+    void m_reap();
+    void m_complete(int index, int64_t result);
+    void m_write_all(const char *data, size_t num_bytes, uint64_t offset);
+    void m_check_error();
+};
+
+} // namespace libdap
+
+#endif // URING_SINK_H_
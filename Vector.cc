@@ -50,6 +50,7 @@
 #include "UnMarshaller.h"
 #include "Vector.h"
 
+#include "D4RequestContext.h"
 #include "D4StreamMarshaller.h"
 #include "D4StreamUnMarshaller.h"
 
@@ -71,8 +72,10 @@ using std::endl;
 namespace libdap {
 
 void Vector::m_duplicate(const Vector &v) {
-    d_length = v.d_length;
-    d_length_ll = v.d_length_ll;
+    // The copy has the length v has in the current D4RequestContext, if any
+    Vector::set_length_ll(v.length_ll());
+    const RequestLength *request = v.m_request_length();
+    d_too_big_for_dap2 = request ? request->too_big_for_dap2 : v.d_too_big_for_dap2;
 
     // _var holds the type of the elements. That is, it holds a BaseType
     // which acts as a template for the type of each element.
@@ -90,23 +93,26 @@ void Vector::m_duplicate(const Vector &v) {
     // d_compound_buf is used when the Vector holds non-numeric data (including strings,
     // although it used to be that was not the case jhrg 2/10/05) while d_buf
     // holds numeric values.
-    if (v.d_compound_buf.empty()) {
-        d_compound_buf = v.d_compound_buf;
-    } else {
-        // Failure to set the size will make the [] operator barf on the LHS
-        // of the assignment inside the loop.
-        d_compound_buf.resize(d_length);
-        for (int i = 0; i < d_length; ++i) {
-            // There's no need to call set_parent() for each element; we
-            // maintain the back pointer using the d_proto member. These
-            // instances are used to hold _values_ only while the d_proto
-            // field holds the type information for the elements.
-            d_compound_buf[i] = v.d_compound_buf[i]->ptr_duplicate();
+    // Both are held in d_values, which Vectors of numbers do not have.
+    d_values.reset();
+    if (v.d_values) {
+        d_values.reset(new NonCardinalValues);
+        if (!v.d_values->compound_buf.empty()) {
+            // Failure to set the size will make the [] operator barf on the LHS
+            // of the assignment inside the loop.
+            d_values->compound_buf.resize(length());
+            for (int i = 0; i < length(); ++i) {
+                // There's no need to call set_parent() for each element; we
+                // maintain the back pointer using the d_proto member. These
+                // instances are used to hold _values_ only while the d_proto
+                // field holds the type information for the elements.
+                d_values->compound_buf[i] = v.d_values->compound_buf[i]->ptr_duplicate();
+            }
         }
-    }
 
-    // copy the strings. This copies the values.
-    d_str = v.d_str;
+        // copy the strings. This copies the values.
+        d_values->str = v.d_values->str;
+    }
 
     // copy numeric values if there are any.
     d_buf = 0;            // init to null
@@ -117,6 +123,55 @@ void Vector::m_duplicate(const Vector &v) {
     d_capacity_ll = v.d_capacity_ll;
 }
 
+/// The length held for this Vector by the current D4RequestContext, or null.
+Vector::RequestLength *Vector::m_request_length() const {
+    D4RequestContext *context = D4RequestContext::current();
+    return context ? context->find<RequestLength>(this, m_request_serial()) : nullptr;
+}
+
+/**
+ * @brief Set the number of elements selected by a constraint
+ * While a D4RequestContext is active, the length is held by the context;
+ * otherwise this is set_length_ll().
+ * @param l The number of elements
+ */
+void Vector::m_set_constrained_length(int64_t l) {
+    D4RequestContext *context = D4RequestContext::current();
+    if (!context) {
+        set_length_ll(l);
+        return;
+    }
+
+    RequestLength &request =
+        context->get(this, m_request_serial(), RequestLength{d_length_ll, d_length, d_too_big_for_dap2});
+    request.length_ll = l;
+    request.length = l <= DODS_INT_MAX ? (int)l : -1;
+    request.too_big_for_dap2 |= l > DODS_INT_MAX;
+}
+
+// Private. The storage for strings and compound values, made when first used.
+vector<string> &Vector::m_str() {
+    if (!d_values)
+        d_values.reset(new NonCardinalValues);
+    return d_values->str;
+}
+
+const vector<string> &Vector::m_str() const {
+    static const vector<string> empty;
+    return d_values ? d_values->str : empty;
+}
+
+vector<BaseType *> &Vector::m_compound_buf() {
+    if (!d_values)
+        d_values.reset(new NonCardinalValues);
+    return d_values->compound_buf;
+}
+
+const vector<BaseType *> &Vector::m_compound_buf() const {
+    static const vector<BaseType *> empty;
+    return d_values ? d_values->compound_buf : empty;
+}
+
 /**
  * @return whether the type of this Vector is a cardinal type
  * (i.e., stored in d_buf)
@@ -309,6 +364,9 @@ Vector::~Vector() {
     delete d_proto;
     d_proto = nullptr;
 
+    if (D4RequestContext *context = D4RequestContext::current())
+        context->erase<RequestLength>(this, m_request_serial());
+
     // Clears all buffers
     try {
         Vector::clear_local_data();
@@ -369,10 +427,10 @@ void Vector::set_send_p(bool state) {
         case dods_structure_c:
         case dods_sequence_c:
         case dods_grid_c:
-            if (d_compound_buf.size() > 0) {
-                for (unsigned long long i = 0; i < (unsigned)d_length; ++i) {
-                    if (d_compound_buf[i])
-                        d_compound_buf[i]->set_send_p(state);
+            if (m_compound_buf().size() > 0) {
+                for (unsigned long long i = 0; i < (unsigned)length(); ++i) {
+                    if (m_compound_buf()[i])
+                        m_compound_buf()[i]->set_send_p(state);
                 }
             }
             break;
@@ -400,10 +458,10 @@ void Vector::set_read_p(bool state) {
         case dods_structure_c:
         case dods_sequence_c:
         case dods_grid_c:
-            if (d_compound_buf.size() > 0) {
-                for (unsigned long long i = 0; i < (unsigned)d_length; ++i) {
-                    if (d_compound_buf[i])
-                        d_compound_buf[i]->set_read_p(state);
+            if (m_compound_buf().size() > 0) {
+                for (unsigned long long i = 0; i < (unsigned)length(); ++i) {
+                    if (m_compound_buf()[i])
+                        m_compound_buf()[i]->set_read_p(state);
                 }
             }
             break;
@@ -442,6 +500,13 @@ void Vector::set_length_ll(int64_t l) {
         d_length = -1;
         d_too_big_for_dap2 = true;
     }
+
+    // A length held by the current D4RequestContext would hide this one.
+    if (RequestLength *request = m_request_length()) {
+        request->length_ll = d_length_ll;
+        request->length = d_length;
+        request->too_big_for_dap2 |= d_too_big_for_dap2;
+    }
 }
 
 void Vector::set_value_capacity(uint64_t l) {
@@ -551,7 +616,7 @@ BaseType *Vector::var(unsigned int i)
 
         case dods_str_c:
         case dods_url_c:
-            d_proto->val2buf(&d_str[i]);
+            d_proto->val2buf(&m_str()[i]);
             return d_proto;
 
         case dods_opaque_c:
@@ -559,7 +624,7 @@ BaseType *Vector::var(unsigned int i)
         case dods_structure_c:
         case dods_sequence_c:
         case dods_grid_c:
-            return d_compound_buf[i];
+            return m_compound_buf()[i];
 
         default:
             throw Error ("Vector::var: Unrecognized type");
@@ -592,7 +657,7 @@ BaseType *Vector::var_ll(uint64_t i) {
 
     case dods_str_c:
     case dods_url_c:
-        d_proto->val2buf(&d_str[i]);
+        d_proto->val2buf(&m_str()[i]);
         return d_proto;
 
     case dods_opaque_c:
@@ -600,7 +665,7 @@ BaseType *Vector::var_ll(uint64_t i) {
     case dods_structure_c:
     case dods_sequence_c:
     case dods_grid_c:
-        return d_compound_buf[i];
+        return m_compound_buf()[i];
 
     default:
         throw Error("Vector::var: Unrecognized type");
@@ -623,11 +688,11 @@ void Vector::vec_resize(int l) {
     // Use resize() since other parts of the code use operator[]. Note that size() should
     // be used when resize() is used. Using capacity() creates problems as noted in the
     // comment in set_vec_nocopy(). jhrg 5/19/17
-    d_compound_buf.resize(l, 0); // Fill with NULLs
+    m_compound_buf().resize(l, 0); // Fill with NULLs
 #if 0
-    d_capacity = d_compound_buf.size(); // size in terms of number of elements.
+    d_capacity = m_compound_buf().size(); // size in terms of number of elements.
 #endif
-    set_value_capacity(d_compound_buf.size());
+    set_value_capacity(m_compound_buf().size());
 }
 
 void Vector::vec_resize_ll(int64_t l) {
@@ -638,11 +703,11 @@ void Vector::vec_resize_ll(int64_t l) {
     // Use resize() since other parts of the code use operator[]. Note that size() should
     // be used when resize() is used. Using capacity() creates problems as noted in the
     // comment in set_vec_nocopy(). jhrg 5/19/17
-    d_compound_buf.resize(l, nullptr); // Fill with NULLs
+    m_compound_buf().resize(l, nullptr); // Fill with NULLs
 #if 0
-    d_capacity = d_compound_buf.size(); // size in terms of number of elements.
+    d_capacity = m_compound_buf().size(); // size in terms of number of elements.
 #endif
-    set_value_capacity(d_compound_buf.size());
+    set_value_capacity(m_compound_buf().size());
 }
 /** @brief read data into a variable for later use
 
@@ -705,11 +770,11 @@ void Vector::intern_data(ConstraintEvaluator &eval, DDS &dds) {
         //
         // I changed the test here from '... = 0' to '... < num' to accommodate
         // the case where the array is zero-length.
-        if (d_compound_buf.capacity() < (unsigned)num)
+        if (m_compound_buf().capacity() < (unsigned)num)
             throw InternalErr(__FILE__, __LINE__, "The capacity of this Vector is less than the number of elements.");
 
         for (int i = 0; i < num; ++i)
-            d_compound_buf[i]->intern_data(eval, dds);
+            m_compound_buf()[i]->intern_data(eval, dds);
 
         break;
 
@@ -737,7 +802,8 @@ bool Vector::serialize(ConstraintEvaluator &eval, DDS &dds, Marshaller &m, bool
                         .append(")."),
                     __FILE__, __LINE__);
 
-    if (d_too_big_for_dap2)
+    const RequestLength *request = m_request_length();
+    if (request ? request->too_big_for_dap2 : d_too_big_for_dap2)
         throw Error("Trying to send a variable that is too large for DAP2.", __FILE__, __LINE__);
 
     // Added to streamline zero-length arrays. Not needed for correct function,
@@ -778,13 +844,13 @@ bool Vector::serialize(ConstraintEvaluator &eval, DDS &dds, Marshaller &m, bool
 
     case dods_str_c:
     case dods_url_c:
-        if (d_str.capacity() == 0)
+        if (m_str().capacity() == 0)
             throw InternalErr(__FILE__, __LINE__, "The capacity of the string vector is 0");
 
         m.put_int(num);
 
         for (int i = 0; i < num; ++i)
-            m.put_str(d_str[i]);
+            m.put_str(m_str()[i]);
 
         status = true;
         break;
@@ -795,13 +861,13 @@ bool Vector::serialize(ConstraintEvaluator &eval, DDS &dds, Marshaller &m, bool
     case dods_grid_c:
         // Jose Garcia
         //  Not setting the capacity of d_compound_buf is an internal error.
-        if (d_compound_buf.capacity() == 0)
+        if (m_compound_buf().capacity() == 0)
             throw InternalErr(__FILE__, __LINE__, "The capacity of *this* vector is 0.");
 
         m.put_int(num);
         status = true;
         for (int i = 0; i < num && status; ++i)
-            status = status && d_compound_buf[i]->serialize(eval, dds, m, false);
+            status = status && m_compound_buf()[i]->serialize(eval, dds, m, false);
 
         break;
 
@@ -895,7 +961,7 @@ bool Vector::deserialize(UnMarshaller &um, DDS *dds, bool reuse) {
         if (num != (unsigned int)length())
             throw InternalErr(__FILE__, __LINE__, "The client sent declarations and data with mismatched sizes.");
 
-        d_str.resize((num > 0) ? num : 0); // Fill with NULLs
+        m_str().resize((num > 0) ? num : 0); // Fill with NULLs
 #if 0
             d_capacity = num; // capacity is number of strings we can fit.
 #endif
@@ -904,7 +970,7 @@ bool Vector::deserialize(UnMarshaller &um, DDS *dds, bool reuse) {
         for (i = 0; i < num; ++i) {
             string str;
             um.get_str(str);
-            d_str[i] = str;
+            m_str()[i] = str;
         }
 
         break;
@@ -928,8 +994,8 @@ bool Vector::deserialize(UnMarshaller &um, DDS *dds, bool reuse) {
         vec_resize(num);
 
         for (i = 0; i < num; ++i) {
-            d_compound_buf[i] = d_proto->ptr_duplicate();
-            d_compound_buf[i]->deserialize(um, dds);
+            m_compound_buf()[i] = d_proto->ptr_duplicate();
+            m_compound_buf()[i]->deserialize(um, dds);
         }
 
         break;
@@ -966,7 +1032,7 @@ void Vector::compute_checksum(Crc32 &checksum) {
     case dods_str_c:
     case dods_url_c:
         for (int64_t i = 0, e = length(); i < e; ++i)
-            checksum.AddData(reinterpret_cast<const uint8_t *>(d_str[i].data()), d_str[i].size());
+            checksum.AddData(reinterpret_cast<const uint8_t *>(m_str()[i].data()), m_str()[i].size());
         break;
 
     case dods_opaque_c:
@@ -1015,10 +1081,10 @@ void Vector::intern_data(/*Crc32 &checksum, DMR &dmr, ConstraintEvaluator &eval*
     case dods_sequence_c:
         // Modified the assertion here from '... != 0' to '... >= length())
         // to accommodate the case of a zero-length array. jhrg 1/28/16
-        assert(d_compound_buf.capacity() >= (unsigned)length());
+        assert(m_compound_buf().capacity() >= (unsigned)length());
 
         for (int i = 0, e = length(); i < e; ++i)
-            d_compound_buf[i]->intern_data(/*checksum, dmr, eval*/);
+            m_compound_buf()[i]->intern_data(/*checksum, dmr, eval*/);
         break;
 
     case dods_array_c: // No Array of Array in DAP4 either...
@@ -1028,6 +1094,50 @@ void Vector::intern_data(/*Crc32 &checksum, DMR &dmr, ConstraintEvaluator &eval*
     }
 }
 
+/**
+ * @brief Write cardinal values as serialize() does
+ * @param m Write the values using this marshaller
+ * @param buf The values; at least 'num' elements of this Vector's type
+ * @param num The number of values to write
+ */
+void Vector::m_serialize_cardinal(D4StreamMarshaller &m, char *buf, int64_t num) {
+    switch (d_proto->type()) {
+    case dods_byte_c:
+    case dods_char_c:
+    case dods_int8_c:
+    case dods_uint8_c:
+        m.put_vector(buf, num);
+        break;
+
+    case dods_int16_c:
+    case dods_uint16_c:
+    case dods_int32_c:
+    case dods_uint32_c:
+    case dods_int64_c:
+    case dods_uint64_c:
+        m.put_vector(buf, num, (int)d_proto->width_ll());
+        break;
+
+    case dods_enum_c:
+        if (d_proto->width_ll() == 1)
+            m.put_vector(buf, num);
+        else
+            m.put_vector(buf, num, (int)d_proto->width_ll());
+        break;
+
+    case dods_float32_c:
+        m.put_vector_float32(buf, num);
+        break;
+
+    case dods_float64_c:
+        m.put_vector_float64(buf, num);
+        break;
+
+    default:
+        throw InternalErr(__FILE__, __LINE__, "Not a cardinal datatype (" + d_proto->type_name() + ").");
+    }
+}
+
 void Vector::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter /*= false*/) {
     if (!read_p())
         read(); // read() throws Error and InternalErr
@@ -1048,39 +1158,24 @@ void Vector::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter /*= false*/)
     case dods_char_c:
     case dods_int8_c:
     case dods_uint8_c:
-        m.put_vector(d_buf, num);
-        break;
-
     case dods_int16_c:
     case dods_uint16_c:
     case dods_int32_c:
     case dods_uint32_c:
     case dods_int64_c:
     case dods_uint64_c:
-        m.put_vector(d_buf, num, (int)d_proto->width_ll());
-        break;
-
     case dods_enum_c:
-        if (d_proto->width_ll() == 1)
-            m.put_vector(d_buf, num);
-        else
-            m.put_vector(d_buf, num, (int)d_proto->width_ll());
-        break;
-
     case dods_float32_c:
-        m.put_vector_float32(d_buf, num);
-        break;
-
     case dods_float64_c:
-        m.put_vector_float64(d_buf, num);
+        m_serialize_cardinal(m, d_buf, num);
         break;
 
     case dods_str_c:
     case dods_url_c:
-        assert((int64_t)d_str.capacity() >= num);
+        assert((int64_t)m_str().capacity() >= num);
 
         for (int64_t i = 0; i < num; ++i)
-            m.put_str(d_str[i]);
+            m.put_str(m_str()[i]);
 
         break;
 
@@ -1090,11 +1185,11 @@ void Vector::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter /*= false*/)
     case dods_opaque_c:
     case dods_structure_c:
     case dods_sequence_c:
-        assert(d_compound_buf.capacity() >= 0);
+        assert(m_compound_buf().capacity() >= 0);
 
         for (int64_t i = 0; i < num; ++i) {
-            DBG(cerr << __func__ << "d_compound_buf[" << i << "] " << d_compound_buf[i] << endl);
-            d_compound_buf[i]->serialize(m, dmr, filter);
+            DBG(cerr << __func__ << "m_compound_buf()[" << i << "] " << m_compound_buf()[i] << endl);
+            m_compound_buf()[i]->serialize(m, dmr, filter);
         }
 
         break;
@@ -1160,7 +1255,7 @@ void Vector::deserialize(D4StreamUnMarshaller &um, DMR &dmr) {
     case dods_str_c:
     case dods_url_c: {
         int64_t len = length_ll();
-        d_str.resize((len > 0) ? len : 0); // Fill with NULLs
+        m_str().resize((len > 0) ? len : 0); // Fill with NULLs
         if (len < 0)
             throw InternalErr(__FILE__, __LINE__, "The number of string length is less than 0 ");
 #if 0
@@ -1168,7 +1263,7 @@ void Vector::deserialize(D4StreamUnMarshaller &um, DMR &dmr) {
 #endif
         set_value_capacity(len);
         for (int64_t i = 0; i < len; ++i) {
-            um.get_str(d_str[i]);
+            um.get_str(m_str()[i]);
         }
 
         break;
@@ -1183,8 +1278,8 @@ void Vector::deserialize(D4StreamUnMarshaller &um, DMR &dmr) {
         vec_resize(length());
 
         for (int64_t i = 0, end = length(); i < end; ++i) {
-            d_compound_buf[i] = d_proto->ptr_duplicate();
-            d_compound_buf[i]->deserialize(um, dmr);
+            m_compound_buf()[i] = d_proto->ptr_duplicate();
+            m_compound_buf()[i]->deserialize(um, dmr);
         }
 
         break;
@@ -1280,18 +1375,18 @@ unsigned int Vector::val2buf(void *val, bool reuse)
             // them into the vector<string> field of this object.
             // Note: d_length is the number of elements in the Vector
 #if 0
-            d_str.resize(d_length);
+            m_str().resize(d_length);
             d_capacity = d_length;
             for (int i = 0; i < d_length; ++i)
-                d_str[i] = *(static_cast<string *> (val) + i);
+                m_str()[i] = *(static_cast<string *> (val) + i);
 #endif
             int64_t str_len = length_ll();
             if (str_len <0)
                 throw InternalErr(__FILE__,__LINE__,"The number of string length is less than 0 ");
-            d_str.resize(str_len);
+            m_str().resize(str_len);
             set_value_capacity(str_len);
             for (int64_t i = 0; i < str_len; ++i)
-                d_str[i] = *(static_cast<string *> (val) + i);
+                m_str()[i] = *(static_cast<string *> (val) + i);
           }
 
             break;
@@ -1363,18 +1458,18 @@ int64_t Vector::val2buf_ll(void *val, bool reuse) {
         // them into the vector<string> field of this object.
         // Note: d_length is the number of elements in the Vector
 #if 0
-            d_str.resize(d_length);
+            m_str().resize(d_length);
             d_capacity = d_length;
             for (int i = 0; i < d_length; ++i)
-                d_str[i] = *(static_cast<string *> (val) + i);
+                m_str()[i] = *(static_cast<string *> (val) + i);
 #endif
         int64_t str_len = length_ll();
         if (str_len < 0)
             throw InternalErr(__FILE__, __LINE__, "The number of string length is less than 0 ");
-        d_str.resize(str_len);
+        m_str().resize(str_len);
         set_value_capacity(str_len);
         for (int64_t i = 0; i < str_len; ++i)
-            d_str[i] = *(static_cast<string *>(val) + i);
+            m_str()[i] = *(static_cast<string *>(val) + i);
     }
 
     break;
@@ -1464,14 +1559,14 @@ unsigned int Vector::buf2val(void **val) {
 
     case dods_str_c:
     case dods_url_c: {
-        if (d_str.empty())
+        if (m_str().empty())
             throw InternalErr(__FILE__, __LINE__,
                               "Vector::buf2val: Logic error: called when string data buffer was empty!");
         if (!*val)
-            *val = new string[d_length];
+            *val = new string[length()];
 
-        for (int i = 0; i < d_length; ++i)
-            *(static_cast<string *>(*val) + i) = d_str[i];
+        for (int i = 0; i < length(); ++i)
+            *(static_cast<string *>(*val) + i) = m_str()[i];
 
         return (unsigned int)width_ll();
     }
@@ -1521,14 +1616,14 @@ int64_t Vector::buf2val_ll(void **val) {
 
     case dods_str_c:
     case dods_url_c: {
-        if (d_str.empty())
+        if (m_str().empty())
             throw InternalErr(__FILE__, __LINE__,
                               "Vector::buf2val: Logic error: called when string data buffer was empty!");
         if (!*val)
-            *val = new string[d_length_ll];
+            *val = new string[length_ll()];
 
-        for (int64_t i = 0; i < d_length_ll; ++i)
-            *(static_cast<string *>(*val) + i) = d_str[i];
+        for (int64_t i = 0; i < length_ll(); ++i)
+            *(static_cast<string *>(*val) + i) = m_str()[i];
 
         return width_ll();
     }
@@ -1578,7 +1673,7 @@ void Vector::set_vec_nocopy(unsigned int i, BaseType *val) {
     // This is a public method which allows users to set the elements
     // of *this* vector. Passing an invalid index, a NULL pointer or
     // mismatching the vector type are internal errors.
-    if (i >= static_cast<unsigned int>(d_length))
+    if (i >= static_cast<unsigned int>(length()))
         throw InternalErr(__FILE__, __LINE__, "Invalid data: index too large.");
     if (!val)
         throw InternalErr(__FILE__, __LINE__, "Invalid data: null pointer to BaseType object.");
@@ -1594,11 +1689,11 @@ void Vector::set_vec_nocopy(unsigned int i, BaseType *val) {
     // blocks of memory on successive calls, which has the strange affect of erasing
     // values already in the vector in the parts just added.
     // jhrg 5/18/17
-    if (i >= d_compound_buf.size()) {
-        vec_resize(d_compound_buf.size() + 100);
+    if (i >= m_compound_buf().size()) {
+        vec_resize(m_compound_buf().size() + 100);
     }
 
-    d_compound_buf[i] = val;
+    m_compound_buf()[i] = val;
 }
 
 void Vector::set_vec_nocopy_ll(uint64_t i, BaseType *val) {
@@ -1622,11 +1717,11 @@ void Vector::set_vec_nocopy_ll(uint64_t i, BaseType *val) {
     // blocks of memory on successive calls, which has the strange affect of erasing
     // values already in the vector in the parts just added.
     // jhrg 5/18/17
-    if (i >= d_compound_buf.size()) {
-        vec_resize_ll(d_compound_buf.size() + 100);
+    if (i >= m_compound_buf().size()) {
+        vec_resize_ll(m_compound_buf().size() + 100);
     }
 
-    d_compound_buf[i] = val;
+    m_compound_buf()[i] = val;
 }
 
 /**
@@ -1644,14 +1739,16 @@ void Vector::clear_local_data() {
         d_buf = 0;
     }
 
-    for (unsigned int i = 0; i < d_compound_buf.size(); ++i) {
-        delete d_compound_buf[i];
-        d_compound_buf[i] = 0;
-    }
+    if (d_values) {
+        for (unsigned int i = 0; i < d_values->compound_buf.size(); ++i) {
+            delete d_values->compound_buf[i];
+            d_values->compound_buf[i] = 0;
+        }
 
-    // Force memory to be reclaimed.
-    d_compound_buf.resize(0);
-    d_str.resize(0);
+        // Force memory to be reclaimed.
+        d_values->compound_buf.resize(0);
+        d_values->str.resize(0);
+    }
 
     d_capacity = 0;
     d_capacity_ll = 0;
@@ -1705,7 +1802,7 @@ void Vector::reserve_value_capacity(unsigned int numElements) {
     case dods_url_c:
         // Make sure the d_str has enough room for all the strings.
         // Technically not needed, but it will speed things up for large arrays.
-        d_str.reserve(numElements);
+        m_str().reserve(numElements);
 #if 0
             d_capacity = numElements;
 #endif
@@ -1720,7 +1817,7 @@ void Vector::reserve_value_capacity(unsigned int numElements) {
     case dods_sequence_c:
     case dods_grid_c:
         // not clear anyone will go this path, but best to be complete.
-        d_compound_buf.reserve(numElements);
+        m_compound_buf().reserve(numElements);
 #if 0
             d_capacity = numElements;
 #endif
@@ -1778,7 +1875,7 @@ void Vector::reserve_value_capacity_ll(uint64_t numElements) {
     case dods_url_c:
         // Make sure the d_str has enough room for all the strings.
         // Technically not needed, but it will speed things up for large arrays.
-        d_str.reserve(numElements);
+        m_str().reserve(numElements);
 #if 0
             d_capacity = numElements;
 #endif
@@ -1793,7 +1890,7 @@ void Vector::reserve_value_capacity_ll(uint64_t numElements) {
     case dods_sequence_c:
     case dods_grid_c:
         // not clear anyone will go this path, but best to be complete.
-        d_compound_buf.reserve(numElements);
+        m_compound_buf().reserve(numElements);
 #if 0
             d_capacity = numElements;
 #endif
@@ -1928,7 +2025,7 @@ uint64_t Vector::set_value_slice_from_row_major_vector(const Vector &rowMajorDat
     case dods_url_c:
         // Strings need to be copied directly
         for (uint64_t i = 0; i < static_cast<uint64_t>(rowMajorData.length_ll()); ++i) {
-            d_str[startElement + i] = rowMajorData.d_str[i];
+            m_str()[startElement + i] = rowMajorData.m_str()[i];
         }
         break;
 
@@ -2052,13 +2149,13 @@ bool Vector::set_value_ll(dods_float64 *val, int64_t sz) { return set_value_ll_w
  */
 bool Vector::set_value(string *val, int sz) {
     if ((var()->type() == dods_str_c || var()->type() == dods_url_c) && val) {
-        d_str.resize(sz);
+        m_str().resize(sz);
 #if 0
         d_capacity = sz;
 #endif
         set_value_capacity(sz);
         for (int t = 0; t < sz; t++) {
-            d_str[t] = val[t];
+            m_str()[t] = val[t];
         }
         set_length(sz);
         set_read_p(true);
@@ -2070,13 +2167,13 @@ bool Vector::set_value(string *val, int sz) {
 
 bool Vector::set_value_ll(string *val, int64_t sz) {
     if ((var()->type() == dods_str_c || var()->type() == dods_url_c) && val) {
-        d_str.resize(sz);
+        m_str().resize(sz);
 #if 0
         d_capacity_ll = sz;
 #endif
         set_value_capacity(sz);
         for (int64_t t = 0; t < sz; t++) {
-            d_str[t] = val[t];
+            m_str()[t] = val[t];
         }
         set_length_ll(sz);
         set_read_p(true);
@@ -2115,10 +2212,10 @@ bool Vector::set_value_ll(vector<dods_float64> &val, int64_t sz) { return set_va
 /** @brief set the value of a string or url array */
 bool Vector::set_value(vector<string> &val, int sz) {
     if (var()->type() == dods_str_c || var()->type() == dods_url_c) {
-        d_str.resize(sz);
+        m_str().resize(sz);
         d_capacity = sz;
         for (int t = 0; t < sz; t++) {
-            d_str[t] = val[t];
+            m_str()[t] = val[t];
         }
         set_length(sz);
         set_read_p(true);
@@ -2130,10 +2227,10 @@ bool Vector::set_value(vector<string> &val, int sz) {
 
 bool Vector::set_value_ll(vector<string> &val, int64_t sz) {
     if (var()->type() == dods_str_c || var()->type() == dods_url_c) {
-        d_str.resize(sz);
+        m_str().resize(sz);
         d_capacity_ll = sz;
         for (int64_t t = 0; t < sz; t++) {
-            d_str[t] = val[t];
+            m_str()[t] = val[t];
         }
         set_length_ll(sz);
         set_read_p(true);
@@ -2267,7 +2364,7 @@ void Vector::value(vector<unsigned int> *subsetIndex, vector<string> &b) const {
                   << "'. ";
                 throw Error(s.str());
             }
-            b[i] = d_str[currentIndex];
+            b[i] = m_str()[currentIndex];
         }
     }
 }
@@ -2285,7 +2382,7 @@ void Vector::value_ll(vector<uint64_t> *subsetIndex, vector<string> &b) const {
                   << name() << "'. ";
                 throw Error(s.str());
             }
-            b[i] = d_str[currentIndex];
+            b[i] = m_str()[currentIndex];
         }
     }
 }
@@ -2324,7 +2421,7 @@ template void Vector::value(dods_float64 *v) const;
 /** @brief Get a copy of the data held by this variable. */
 void Vector::value(vector<string> &b) const {
     if (d_proto->type() == dods_str_c || d_proto->type() == dods_url_c)
-        b = d_str;
+        b = m_str();
 }
 
 /** Allocate memory and copy data into the new buffer. Return the new
@@ -2458,7 +2555,7 @@ void Vector::dump(ostream &strm) const {
     strm << DapIndent::LMarg << "Vector::dump - (" << (void *)this << ")" << endl;
     DapIndent::Indent();
     BaseType::dump(strm);
-    strm << DapIndent::LMarg << "# elements in vector: " << d_length << endl;
+    strm << DapIndent::LMarg << "# elements in vector: " << length() << endl;
     if (d_proto) {
         strm << DapIndent::LMarg << "base type:" << endl;
         DapIndent::Indent();
@@ -2469,17 +2566,17 @@ void Vector::dump(ostream &strm) const {
     }
     strm << DapIndent::LMarg << "vector contents:" << endl;
     DapIndent::Indent();
-    for (unsigned i = 0; i < d_compound_buf.size(); ++i) {
-        if (d_compound_buf[i])
-            d_compound_buf[i]->dump(strm);
+    for (unsigned i = 0; i < m_compound_buf().size(); ++i) {
+        if (m_compound_buf()[i])
+            m_compound_buf()[i]->dump(strm);
         else
             strm << DapIndent::LMarg << "vec[" << i << "] is null" << endl;
     }
     DapIndent::UnIndent();
     strm << DapIndent::LMarg << "strings:" << endl;
     DapIndent::Indent();
-    for (unsigned i = 0; i < d_str.size(); i++) {
-        strm << DapIndent::LMarg << d_str[i] << endl;
+    for (unsigned i = 0; i < m_str().size(); i++) {
+        strm << DapIndent::LMarg << m_str()[i] << endl;
     }
     DapIndent::UnIndent();
     if (d_buf) {
@@ -2487,7 +2584,7 @@ void Vector::dump(ostream &strm) const {
         case dods_byte_c:
         case dods_char_c:
             strm << DapIndent::LMarg << "_buf: ";
-            strm.write(d_buf, d_length);
+            strm.write(d_buf, length());
             strm << endl;
             break;
 
@@ -36,6 +36,7 @@
 #define _vector_h 1
 
 #include <cassert>
+#include <memory>
 
 #ifndef _basetype_h
 #include "BaseType.h"
@@ -89,18 +90,39 @@ private:
     BaseType *d_proto = nullptr; // element prototype for the Vector
 
     // _buf was a pointer to void; delete[] complained. 6/4/2001 jhrg
-    char *d_buf = nullptr;             // storage for cardinal data
-    vector<string> d_str;              // special storage for strings. jhrg 2/11/05
-    vector<BaseType *> d_compound_buf; // storage for data in compound types (e.g., Structure)
+    char *d_buf = nullptr; // storage for cardinal data
+
+    // Storage for strings and for the values of compound types. Only Vectors
+    // of those types need it, so it is made by m_str() or m_compound_buf()
+    // when it is first changed.
+    struct NonCardinalValues {
+        vector<string> str;              // special storage for strings. jhrg 2/11/05
+        vector<BaseType *> compound_buf; // storage for data in compound types (e.g., Structure)
+    };
+    std::unique_ptr<NonCardinalValues> d_values;
 
     // the number of elements we have allocated memory to store.
     // This should be either the sizeof(buf)/width(bool constrained = false) for cardinal data
     // or the capacity of d_str for strings or capacity of _vec.
-    unsigned int d_capacity = 0;
     uint64_t d_capacity_ll = 0;
+    unsigned int d_capacity = 0;
 
     bool d_too_big_for_dap2 = false; /// Conditionally set to true in set_length_ll()
 
+    // The length held in a D4RequestContext
+    struct RequestLength {
+        int64_t length_ll;
+        int length;
+        bool too_big_for_dap2;
+    };
+
+    RequestLength *m_request_length() const;
+
+    vector<string> &m_str();
+    const vector<string> &m_str() const;
+    vector<BaseType *> &m_compound_buf();
+    const vector<BaseType *> &m_compound_buf() const;
+
     friend class MarshallerTest;
 
     // Made these template methods private because they can't be
@@ -115,7 +137,6 @@ private:
     template <typename T> bool set_value_worker(vector<T> &v, int sz);
     template <typename T> bool set_value_ll_worker(vector<T> &v, int64_t sz);
 
-    bool m_is_cardinal_type() const;
     int64_t m_create_cardinal_data_buffer_for_type(int64_t num_elements);
     void m_delete_cardinal_data_buffer();
     template <class CardType> void m_set_cardinal_values_internal(const CardType *src, int64_t num_elements);
@@ -123,6 +144,11 @@ private:
     // This function copies the private members of Vector.
     void m_duplicate(const Vector &v);
 
+protected:
+    bool m_is_cardinal_type() const;
+    void m_serialize_cardinal(D4StreamMarshaller &m, char *buf, int64_t num);
+    void m_set_constrained_length(int64_t l);
+
 public:
     /**
      * @brief Constructs a vector with an element prototype.
@@ -169,7 +195,7 @@ public:
      *
      * @return A reference to a vector of strings
      */
-    vector<string> &get_str() { return d_str; }
+    vector<string> &get_str() { return m_str(); }
 
     /**
      * Provide access to internal data by reference. Callers cannot delete this
@@ -178,7 +204,7 @@ public:
      * @return A reference to a vector of BaseType pointers. Treat with care; never
      * delete these!
      */
-    vector<BaseType *> &get_compound_buf() { return d_compound_buf; }
+    vector<BaseType *> &get_compound_buf() { return m_compound_buf(); }
 
     /**
      * @brief Returns the element prototype used by this vector.
@@ -231,7 +257,10 @@ public:
      * @return The number of elements in the vector
      * @deprecated Use length_ll() instead
      */
-    int length() const override { return d_length; }
+    int length() const override {
+        const RequestLength *l = m_request_length();
+        return l ? l->length : d_length;
+    }
 
     /** @brief Get the number of elements in this Vector/Array
      * This version of the function deprecates length() which is limited to
@@ -239,7 +268,10 @@ public:
      * the Vector/Array holds no values yet (as opposed to zero values).
      * @return The number of elements in this Vector/Array
      */
-    int64_t length_ll() const override { return d_length_ll; }
+    int64_t length_ll() const override {
+        const RequestLength *l = m_request_length();
+        return l ? l->length_ll : d_length_ll;
+    }
 
     void set_length(int64_t l) override;
 
@@ -50,6 +50,7 @@
 
 #include "DapIndent.h"
 #include "InternalErr.h"
+#include "byte_order.h"
 #include "util.h"
 
 namespace libdap {
@@ -137,11 +138,42 @@ void XDRFileUnMarshaller::get_vector(char **val, unsigned int &num, Vector &) {
         throw Error("Network I/O error (1).");
 }
 
+/**
+ * Read an XDR array. Like XDRStreamUnMarshaller::get_vector(), this reads
+ * the block of values with one call (xdr_opaque() is a fread() for an XDR
+ * stdio stream) and swaps or narrows them in bulk instead of decoding one
+ * element at a time with xdr_array().
+ */
 void XDRFileUnMarshaller::get_vector(char **val, unsigned int &num, int width, Vector &vec) {
     BaseType *var = vec.var();
 
-    if (!xdr_array(_source, val, &num, DODS_MAX_ARRAY, width, XDRUtils::xdr_coder(var->type()))) {
+    u_int count;
+    if (!xdr_u_int(_source, &count) || count > (u_int)DODS_MAX_ARRAY || !XDRUtils::xdr_coder(var->type()))
         throw Error("Network I/O error (2).");
+
+    num = count;
+    if (num == 0)
+        return;
+
+    if (!*val)
+        *val = new char[(size_t)num * width];
+
+    // 4 and 8 byte values are read straight into the destination and swapped
+    // in place; narrower values are read into d_vec_buf and narrowed.
+    const unsigned int xdr_width = (width < 4) ? 4 : width;
+    const unsigned int chunk = (width < 4) ? 16384 : (1U << 24); // elements
+    if (width < 4)
+        d_vec_buf.resize(min(num, chunk) * xdr_width);
+
+    for (unsigned int done = 0; done < num;) {
+        unsigned int n = min(num - done, chunk);
+        char *dest = *val + (size_t)done * width;
+        char *src = (width < 4) ? d_vec_buf.data() : dest;
+        if (!xdr_opaque(_source, src, n * xdr_width))
+            throw Error("Network I/O error (2).");
+
+        xdr_decode_vector(dest, src, n, width);
+        done += n;
     }
 }
 
@@ -33,6 +33,8 @@
 #ifndef I_XDRFileUnMarshaller_h
 #define I_XDRFileUnMarshaller_h 1
 
+#include <vector>
+
 #include "UnMarshaller.h"
 #include "XDRUtils.h"
 
@@ -45,6 +47,8 @@ class XDRFileUnMarshaller : public UnMarshaller {
 private:
     XDR *_source;
 
+    std::vector<char> d_vec_buf; // Used to narrow 2-byte values; reused
+
     XDRFileUnMarshaller();
     XDRFileUnMarshaller(const XDRFileUnMarshaller &um);
     XDRFileUnMarshaller &operator=(const XDRFileUnMarshaller &);
@@ -38,6 +38,7 @@
 #endif
 
 #include <cassert>
+#include <cstring>
 
 #include <iomanip>
 #include <iostream>
@@ -49,8 +50,10 @@
 #ifdef USE_POSIX_THREADS
 #include "MarshallerThread.h"
 #endif
+#include "MarshallerStats.h"
 #include "Vector.h"
 #include "XDRUtils.h"
+#include "byte_order.h"
 #include "util.h"
 
 #include "DapIndent.h"
@@ -98,6 +101,8 @@ XDRStreamMarshaller::~XDRStreamMarshaller() {
 }
 
 void XDRStreamMarshaller::put_byte(dods_byte val) {
+    MarshallerTimer timer(d_stats);
+
     if (!xdr_setpos(&d_sink, 0))
         throw Error("Network I/O Error. Could not send byte data - unable to set stream position.");
 
@@ -108,14 +113,19 @@ void XDRStreamMarshaller::put_byte(dods_byte val) {
     if (!bytes_written)
         throw Error("Network I/O Error. Could not send byte data - unable to get stream position.");
 
+    if (d_stats)
+        d_stats->add_bytes(bytes_written);
+
 #ifdef USE_POSIX_THREADS
-    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 #endif
 
     d_out.write(d_buf, bytes_written);
 }
 
 void XDRStreamMarshaller::put_int16(dods_int16 val) {
+    MarshallerTimer timer(d_stats);
+
     if (!xdr_setpos(&d_sink, 0))
         throw Error("Network I/O Error. Could not send int 16 data - unable to set stream position.");
 
@@ -126,14 +136,19 @@ void XDRStreamMarshaller::put_int16(dods_int16 val) {
     if (!bytes_written)
         throw Error("Network I/O Error. Could not send int 16 data - unable to get stream position.");
 
+    if (d_stats)
+        d_stats->add_bytes(bytes_written);
+
 #ifdef USE_POSIX_THREADS
-    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 #endif
 
     d_out.write(d_buf, bytes_written);
 }
 
 void XDRStreamMarshaller::put_int32(dods_int32 val) {
+    MarshallerTimer timer(d_stats);
+
     if (!xdr_setpos(&d_sink, 0))
         throw Error("Network I/O Error. Could not send int 32 data - unable to set stream position.");
 
@@ -144,14 +159,19 @@ void XDRStreamMarshaller::put_int32(dods_int32 val) {
     if (!bytes_written)
         throw Error("Network I/O Error. Could not send int 32 data - unable to get stream position.");
 
+    if (d_stats)
+        d_stats->add_bytes(bytes_written);
+
 #ifdef USE_POSIX_THREADS
-    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 #endif
 
     d_out.write(d_buf, bytes_written);
 }
 
 void XDRStreamMarshaller::put_float32(dods_float32 val) {
+    MarshallerTimer timer(d_stats);
+
     if (!xdr_setpos(&d_sink, 0))
         throw Error("Network I/O Error. Could not send float 32 data - unable to set stream position.");
 
@@ -162,14 +182,19 @@ void XDRStreamMarshaller::put_float32(dods_float32 val) {
     if (!bytes_written)
         throw Error("Network I/O Error. Could not send float 32 data - unable to get stream position.");
 
+    if (d_stats)
+        d_stats->add_bytes(bytes_written);
+
 #ifdef USE_POSIX_THREADS
-    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 #endif
 
     d_out.write(d_buf, bytes_written);
 }
 
 void XDRStreamMarshaller::put_float64(dods_float64 val) {
+    MarshallerTimer timer(d_stats);
+
     if (!xdr_setpos(&d_sink, 0))
         throw Error("Network I/O Error. Could not send float 64 data - unable to set stream position.");
 
@@ -180,14 +205,19 @@ void XDRStreamMarshaller::put_float64(dods_float64 val) {
     if (!bytes_written)
         throw Error("Network I/O Error. Could not send float 64 data - unable to get stream position.");
 
+    if (d_stats)
+        d_stats->add_bytes(bytes_written);
+
 #ifdef USE_POSIX_THREADS
-    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 #endif
 
     d_out.write(d_buf, bytes_written);
 }
 
 void XDRStreamMarshaller::put_uint16(dods_uint16 val) {
+    MarshallerTimer timer(d_stats);
+
     if (!xdr_setpos(&d_sink, 0))
         throw Error("Network I/O Error. Could not send uint 16 data - unable to set stream position.");
 
@@ -198,14 +228,19 @@ void XDRStreamMarshaller::put_uint16(dods_uint16 val) {
     if (!bytes_written)
         throw Error("Network I/O Error. Could not send uint 16 data - unable to get stream position.");
 
+    if (d_stats)
+        d_stats->add_bytes(bytes_written);
+
 #ifdef USE_POSIX_THREADS
-    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 #endif
 
     d_out.write(d_buf, bytes_written);
 }
 
 void XDRStreamMarshaller::put_uint32(dods_uint32 val) {
+    MarshallerTimer timer(d_stats);
+
     if (!xdr_setpos(&d_sink, 0))
         throw Error("Network I/O Error. Could not send uint 32 data - unable to set stream position.");
 
@@ -216,14 +251,19 @@ void XDRStreamMarshaller::put_uint32(dods_uint32 val) {
     if (!bytes_written)
         throw Error("Network I/O Error. Could not send uint 32 data - unable to get stream position.");
 
+    if (d_stats)
+        d_stats->add_bytes(bytes_written);
+
 #ifdef USE_POSIX_THREADS
-    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 #endif
 
     d_out.write(d_buf, bytes_written);
 }
 
 void XDRStreamMarshaller::put_str(const string &val) {
+    MarshallerTimer timer(d_stats);
+
     int size = val.length() + 8;
 
     XDR str_sink;
@@ -243,8 +283,11 @@ void XDRStreamMarshaller::put_str(const string &val) {
         if (!bytes_written)
             throw Error("Network I/O Error. Could not send string data - unable to get stream position.");
 
+        if (d_stats)
+            d_stats->add_bytes(bytes_written);
+
 #ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 #endif
 
         d_out.write(str_buf.data(), bytes_written);
@@ -259,6 +302,8 @@ void XDRStreamMarshaller::put_str(const string &val) {
 void XDRStreamMarshaller::put_url(const string &val) { put_str(val); }
 
 void XDRStreamMarshaller::put_opaque(char *val, unsigned int len) {
+    MarshallerTimer timer(d_stats);
+
     if (len > XDR_DAP_BUFF_SIZE)
         throw Error("Network I/O Error. Could not send opaque data - length of opaque data larger than allowed");
 
@@ -272,14 +317,19 @@ void XDRStreamMarshaller::put_opaque(char *val, unsigned int len) {
     if (!bytes_written)
         throw Error("Network I/O Error. Could not send opaque data - unable to get stream position.");
 
+    if (d_stats)
+        d_stats->add_bytes(bytes_written);
+
 #ifdef USE_POSIX_THREADS
-    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 #endif
 
     d_out.write(d_buf, bytes_written);
 }
 
 void XDRStreamMarshaller::put_int(int val) {
+    MarshallerTimer timer(d_stats);
+
     if (!xdr_setpos(&d_sink, 0))
         throw Error("Network I/O Error. Could not send int data - unable to set stream position.");
 
@@ -290,8 +340,11 @@ void XDRStreamMarshaller::put_int(int val) {
     if (!bytes_written)
         throw Error("Network I/O Error. Could not send int data - unable to get stream position.");
 
+    if (d_stats)
+        d_stats->add_bytes(bytes_written);
+
 #ifdef USE_POSIX_THREADS
-    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 #endif
 
     d_out.write(d_buf, bytes_written);
@@ -322,8 +375,10 @@ void XDRStreamMarshaller::put_vector_start(int num) {
  * @see put_vector_part()
  */
 void XDRStreamMarshaller::put_vector_end() {
+    MarshallerTimer timer(d_stats);
+
 #ifdef USE_POSIX_THREADS
-    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
+    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
 #endif
 
     // Compute the trailing (padding) bytes
@@ -335,6 +390,8 @@ void XDRStreamMarshaller::put_vector_end() {
 
     if (pad) {
         vector<char> padding(4, 0); // 4 zeros
+        if (d_stats)
+            d_stats->add_bytes(pad);
 
         d_out.write(padding.data(), pad);
         if (d_out.fail())
@@ -344,54 +401,105 @@ void XDRStreamMarshaller::put_vector_end() {
 
 // Start of parallel I/O support. jhrg 8/19/15
 void XDRStreamMarshaller::put_vector(char *val, int num, Vector &) {
+    MarshallerTimer timer(d_stats);
+
     if (!val)
         throw InternalErr(__FILE__, __LINE__, "Could not send byte vector data. Buffer pointer is not set.");
 
     // write the number of members of the array being written and then set the position to 0
     put_int(num);
 
-    // this is the word boundary for writing xdr bytes in a vector.
-    const unsigned int add_to = 8;
-    // switch to memory on the heap since the thread will need to access it
-    // after this code returns.
-    char *byte_buf = new char[num + add_to];
-    XDR byte_sink;
-    try {
-        xdrmem_create(&byte_sink, byte_buf, num + add_to, XDR_ENCODE);
-        if (!xdr_setpos(&byte_sink, 0))
-            throw Error("Network I/O Error. Could not send byte vector data - unable to set stream position.");
+    // Encode as xdr_bytes() does: the count, the bytes and zeros to the next
+    // four byte boundary.
+    unsigned int pad = (num & 0x03) ? 4 - (num & 0x03) : 0;
+    unsigned int bytes_written = num + pad + 4;
+    char *byte_buf = m_next_vec_buf(bytes_written);
 
-        if (!xdr_bytes(&byte_sink, (char **)&val, (unsigned int *)&num, num + add_to))
-            throw Error("Network I/O Error(2). Could not send byte vector data - unable to encode data.");
+    dods_uint32 count = num;
+    xdr_encode_vector(byte_buf, reinterpret_cast<char *>(&count), 1, sizeof(count), false);
+    memcpy(byte_buf + 4, val, num);
+    memset(byte_buf + 4 + num, 0, pad);
 
-        unsigned int bytes_written = xdr_getpos(&byte_sink);
-        if (!bytes_written)
-            throw Error("Network I/O Error. Could not send byte vector data - unable to get stream position.");
+    if (d_stats)
+        d_stats->add_bytes(bytes_written);
 
 #ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-        tm->increment_child_thread_count();
-        tm->start_thread(MarshallerThread::write_thread, d_out, byte_buf, bytes_written);
-        xdr_destroy(&byte_sink);
+    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
+    tm->increment_child_thread_count();
+    tm->start_thread(MarshallerThread::write_thread, d_out, byte_buf, bytes_written, false);
+    d_vec_buf_next ^= 1;
 #else
-        d_out.write(byte_buf, bytes_written);
-        xdr_destroy(&byte_sink);
-        delete[] byte_buf;
+    d_out.write(byte_buf, bytes_written);
 #endif
+}
 
-    } catch (...) {
-        DBG(cerr << "Caught an exception in put_vector_thread" << endl);
-        xdr_destroy(&byte_sink);
-        delete[] byte_buf;
-        throw;
+// private
+/**
+ * The reusable buffer to encode the next vector in, grown to at least
+ * 'size' bytes. See m_encode_vector() for when it is free.
+ */
+char *XDRStreamMarshaller::m_next_vec_buf(size_t size) {
+    vector<char> &buf = d_vec_buf[d_vec_buf_next];
+    if (buf.size() < size)
+        buf.resize(size);
+    return buf.data();
+}
+
+// private
+/**
+ * Encode 'num' values the way xdr_array() does: a four byte element count
+ * followed by the values, each widened to at least four bytes and written
+ * big-endian. The encoding goes into one of the reusable vector buffers,
+ * which is returned along with the number of bytes used.
+ *
+ * With the writer thread, the buffer returned was last handed to the thread
+ * two vectors ago and the Locker taken for the previous vector waited for
+ * that write to finish, so it is free. The caller advances d_vec_buf_next
+ * once the buffer has been handed off.
+ *
+ * @param val Pointer to the values to encode
+ * @param num The number of elements in the memory referenced by 'val'
+ * @param width The number of bytes in each element
+ * @param type The DAP type of the elements
+ * @param size Value-result parameter; the number of bytes encoded
+ * @return The buffer holding the encoded values
+ */
+char *XDRStreamMarshaller::m_encode_vector(char *val, unsigned int num, int width, Type type, unsigned int &size) {
+    bool is_signed = false;
+    switch (type) {
+    case dods_int16_c:
+        is_signed = true;
+        break;
+    case dods_uint16_c:
+    case dods_int32_c:
+    case dods_uint32_c:
+    case dods_float32_c:
+    case dods_float64_c:
+        break;
+    default:
+        throw InternalErr(__FILE__, __LINE__, "Could not send vector data - unsupported type: " + type_name(type));
     }
+
+    unsigned int use_width = (width < 4) ? 4 : width;
+
+    // the size is the number of elements num times the width of each
+    // element, then add 4 bytes for the number of elements
+    size = (num * use_width) + 4;
+
+    char *buf = m_next_vec_buf(size);
+
+    dods_uint32 count = num;
+    xdr_encode_vector(buf, reinterpret_cast<char *>(&count), 1, sizeof(count), false);
+    xdr_encode_vector(buf + 4, val, num, width, is_signed);
+
+    return buf;
 }
 
 // private
 /**
  * Write elements of a Vector (i.e. an Array) to the stream using XDR encoding.
  * Encoding is performed on 'num' values that use 'width' bytes. The parameter
- * 'type' is used to choose the XDR encoding function.
+ * 'type' is used to choose the XDR encoding.
  *
  * @param val Pointer to the values to write
  * @param num The number of elements in the memory referenced by 'val'
@@ -399,6 +507,8 @@ void XDRStreamMarshaller::put_vector(char *val, int num, Vector &) {
  * @param type The DAP type of the elements
  */
 void XDRStreamMarshaller::put_vector(char *val, unsigned int num, int width, Type type) {
+    MarshallerTimer timer(d_stats);
+
     assert(val || num == 0);
 
     // write the number of array members being written, then set the position back to 0
@@ -407,49 +517,20 @@ void XDRStreamMarshaller::put_vector(char *val, unsigned int num, int width, Typ
     if (num == 0)
         return;
 
-    int use_width = width;
-    if (use_width < 4)
-        use_width = 4;
+    unsigned int bytes_written;
+    char *vec_buf = m_encode_vector(val, num, width, type, bytes_written);
 
-    // the size is the number of elements num times the width of each
-    // element, then add 4 bytes for the number of elements
-    int size = (num * use_width) + 4;
-
-    // allocate enough memory for the elements
-    // vector<char> vec_buf(size);
-    char *vec_buf = new char[size];
-    XDR vec_sink;
-    try {
-        xdrmem_create(&vec_sink, vec_buf, size, XDR_ENCODE);
-
-        // set the position of the sink to 0, we're starting at the beginning
-        if (!xdr_setpos(&vec_sink, 0))
-            throw Error("Network I/O Error. Could not send vector data - unable to set stream position.");
-
-        // write the array to the buffer
-        if (!xdr_array(&vec_sink, (char **)&val, (unsigned int *)&num, size, width, XDRUtils::xdr_coder(type)))
-            throw Error("Network I/O Error(2). Could not send vector data - unable to encode.");
-
-        // how much was written to the buffer
-        unsigned int bytes_written = xdr_getpos(&vec_sink);
-        if (!bytes_written)
-            throw Error("Network I/O Error. Could not send vector data - unable to get stream position.");
+    if (d_stats)
+        d_stats->add_bytes(bytes_written);
 
 #ifdef USE_POSIX_THREADS
-        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-        tm->increment_child_thread_count();
-        tm->start_thread(MarshallerThread::write_thread, d_out, vec_buf, bytes_written);
-        xdr_destroy(&vec_sink);
+    Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
+    tm->increment_child_thread_count();
+    tm->start_thread(MarshallerThread::write_thread, d_out, vec_buf, bytes_written, false);
+    d_vec_buf_next ^= 1;
 #else
-        d_out.write(vec_buf, bytes_written);
-        xdr_destroy(&vec_sink);
-        delete[] vec_buf;
+    d_out.write(vec_buf, bytes_written);
 #endif
-    } catch (...) {
-        xdr_destroy(&vec_sink);
-        delete[] vec_buf;
-        throw;
-    }
 }
 
 /**
@@ -464,100 +545,62 @@ void XDRStreamMarshaller::put_vector(char *val, unsigned int num, int width, Typ
  * @see put_vector_end()
  */
 void XDRStreamMarshaller::put_vector_part(char *val, unsigned int num, int width, Type type) {
-    if (width == 1) {
-        // Add space for the 4 bytes of length info and 4 bytes for padding, even though
-        // we will not send either of those.
-        const unsigned int add_to = 8;
-        unsigned int bufsiz = num + add_to;
-        // vector<char> byte_buf(bufsiz);
-        char *byte_buf = new char[bufsiz];
-        XDR byte_sink;
-        try {
-            xdrmem_create(&byte_sink, byte_buf, bufsiz, XDR_ENCODE);
-            if (!xdr_setpos(&byte_sink, 0))
-                throw Error("Network I/O Error. Could not send byte vector data - unable to set stream position.");
-
-            if (!xdr_bytes(&byte_sink, (char **)&val, (unsigned int *)&num, bufsiz))
-                throw Error("Network I/O Error(2). Could not send byte vector data - unable to encode data.");
+    MarshallerTimer timer(d_stats);
 
+    if (width == 1) {
+        if (d_stats)
+            d_stats->add_bytes(num);
 #ifdef USE_POSIX_THREADS
-            Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-            tm->increment_child_thread_count();
+        // Copy the bytes so the caller can reuse 'val' (e.g., for the next slab)
+        // while they are written. write_thread_part() skips the first four
+        // bytes, where the other vectors have their count.
+        char *byte_buf = m_next_vec_buf(num + 4);
+        memcpy(byte_buf + 4, val, num);
 
-            // Increment the element count so we can figure out about the padding in put_vector_last()
-            d_partial_put_byte_count += num;
+        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
+        tm->increment_child_thread_count();
 
-            tm->start_thread(MarshallerThread::write_thread_part, d_out, byte_buf, num);
-            xdr_destroy(&byte_sink);
-#else
-            // Only send the num bytes that follow the 4 bytes of length info - we skip the
-            // length info because it's already been sent and we don't send any trailing padding
-            // bytes in this method (see put_vector_last() for that).
-            d_out.write(byte_buf + 4, num);
+        // Increment the element count so we can figure out about the padding in put_vector_last()
+        d_partial_put_byte_count += num;
 
-            if (d_out.fail())
-                throw Error("Network I/O Error. Could not send initial part of byte vector data");
+        tm->start_thread(MarshallerThread::write_thread_part, d_out, byte_buf, num, false);
+        d_vec_buf_next ^= 1;
+#else
+        // Only send the bytes; the length info has already been sent and
+        // put_vector_end() sends any trailing padding.
+        d_out.write(val, num);
 
-            // Now increment the element count so we can figure out about the padding in put_vector_last()
-            d_partial_put_byte_count += num;
+        if (d_out.fail())
+            throw Error("Network I/O Error. Could not send initial part of byte vector data");
 
-            xdr_destroy(&byte_sink);
-            delete[] byte_buf;
+        // Now increment the element count so we can figure out about the padding in put_vector_last()
+        d_partial_put_byte_count += num;
 #endif
-        } catch (...) {
-            xdr_destroy(&byte_sink);
-            delete[] byte_buf;
-            throw;
-        }
     } else {
-        int use_width = (width < 4) ? 4 : width;
-
-        // the size is the number of elements num times the width of each
-        // element, then add 4 bytes for the (int) number of elements
-        int size = (num * use_width) + 4;
-
-        // allocate enough memory for the elements
-        // vector<char> vec_buf(size);
-        char *vec_buf = new char[size];
-        XDR vec_sink;
-        try {
-            xdrmem_create(&vec_sink, vec_buf, size, XDR_ENCODE);
-
-            // set the position of the sink to 0, we're starting at the beginning
-            if (!xdr_setpos(&vec_sink, 0))
-                throw Error("Network I/O Error. Could not send vector data - unable to set stream position.");
-
-            // write the array to the buffer
-            if (!xdr_array(&vec_sink, (char **)&val, (unsigned int *)&num, size, width, XDRUtils::xdr_coder(type)))
-                throw Error("Network I/O Error(2). Could not send vector data -unable to encode data.");
+        unsigned int size;
+        char *vec_buf = m_encode_vector(val, num, width, type, size);
 
+        if (d_stats)
+            d_stats->add_bytes(size - 4);
 #ifdef USE_POSIX_THREADS
-            Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count());
-            tm->increment_child_thread_count();
+        Locker lock(tm->get_mutex(), tm->get_cond(), tm->get_child_thread_count(), d_stats);
+        tm->increment_child_thread_count();
 
-            // Increment the element count so we can figure out about the padding in put_vector_last()
-            d_partial_put_byte_count += (size - 4);
-            tm->start_thread(MarshallerThread::write_thread_part, d_out, vec_buf, size - 4);
-            xdr_destroy(&vec_sink);
+        // Increment the element count so we can figure out about the padding in put_vector_last()
+        d_partial_put_byte_count += (size - 4);
+        tm->start_thread(MarshallerThread::write_thread_part, d_out, vec_buf, size - 4, false);
+        d_vec_buf_next ^= 1;
 #else
-            // write that much out to the output stream, skipping the length data that
-            // XDR writes since we have already written the length info using put_vector_start()
-            d_out.write(vec_buf + 4, size - 4);
+        // write that much out to the output stream, skipping the length data that
+        // XDR writes since we have already written the length info using put_vector_start()
+        d_out.write(vec_buf + 4, size - 4);
 
-            if (d_out.fail())
-                throw Error("Network I/O Error. Could not send part of vector data");
-
-            // Now increment the element count so we can figure out about the padding in put_vector_last()
-            d_partial_put_byte_count += (size - 4);
+        if (d_out.fail())
+            throw Error("Network I/O Error. Could not send part of vector data");
 
-            xdr_destroy(&vec_sink);
-            delete[] vec_buf;
+        // Now increment the element count so we can figure out about the padding in put_vector_last()
+        d_partial_put_byte_count += (size - 4);
 #endif
-        } catch (...) {
-            xdr_destroy(&vec_sink);
-            delete[] vec_buf;
-            throw;
-        }
     }
 }
 
@@ -37,6 +37,7 @@
 #define I_XDRStreamMarshaller_h 1
 
 #include <iostream>
+#include <vector>
 
 #include "Marshaller.h"
 #include "XDRUtils.h"
@@ -60,11 +61,18 @@ private:
 
     MarshallerThread *tm;
 
+    // Reused to encode vectors. When the writer thread is used, the two
+    // buffers alternate so one can be filled while the other is written.
+    std::vector<char> d_vec_buf[2];
+    int d_vec_buf_next = 0;
+
     XDRStreamMarshaller();
     XDRStreamMarshaller(const XDRStreamMarshaller &m);
     XDRStreamMarshaller &operator=(const XDRStreamMarshaller &);
 
     void put_vector(char *val, unsigned int num, int width, Type type);
+    char *m_next_vec_buf(size_t size);
+    char *m_encode_vector(char *val, unsigned int num, int width, Type type, unsigned int &size);
 
     friend class MarshallerTest;
 
@@ -43,6 +43,7 @@
 #include "DapIndent.h"
 #include "InternalErr.h"
 #include "Str.h"
+#include "byte_order.h"
 #include "debug.h"
 #include "util.h"
 
@@ -267,41 +268,51 @@ void XDRStreamUnMarshaller::get_vector(char **val, unsigned int &num, int width,
     get_vector(val, num, width, vec.var()->type());
 }
 
+/**
+ * Read an XDR array of 'type' values. Rather than decoding one element at a
+ * time with xdr_array(), read the whole block of 4 and 8 byte values straight
+ * into the destination and swap it in place. Values narrower than four bytes
+ * (Int16, UInt16) are read in pieces and narrowed into the destination.
+ *
+ * @param val Value-result parameter; the destination. If null, it is
+ * allocated here.
+ * @param num Value-result parameter; the number of elements read
+ * @param width The number of bytes in each (local) element
+ * @param type The DAP type of the elements
+ */
 void XDRStreamUnMarshaller::get_vector(char **val, unsigned int &num, int width, Type type) {
     int i;
-    get_int(i); // This leaves the XDR encoded value in d_buf; used later
+    get_int(i); // the number of elements, as written by xdr_array()
     DBG(std::cerr << "i: " << i << std::endl);
 
-    width += width & 3;
-    DBG(std::cerr << "width: " << width << std::endl);
-
-    int size = i * width; // + 4; // '+ 4' to hold the int already read
-
-    // Must address the case where the string is larger than the buffer
-    if (size > XDR_DAP_BUFF_SIZE) {
-        vector<char> buf(size + 4);
-        XDR source;
-        xdrmem_create(&source, buf.data(), size + 4, XDR_DECODE);
-        DBG(cerr << "size: " << size << endl);
-        memcpy(buf.data(), d_buf, 4);
-
-        d_in.read(buf.data() + 4, size); // +4 for the int already read
-        DBG(cerr << "bytes read: " << d_in.gcount() << endl);
-
-        xdr_setpos(&source, 0);
-        if (!xdr_array(&source, val, &num, DODS_MAX_ARRAY, width, XDRUtils::xdr_coder(type))) {
-            xdr_destroy(&source);
+    if (i < 0 || i > DODS_MAX_ARRAY)
+        throw Error("Network I/O Error. Could not read array data - bad element count.");
+    if (!XDRUtils::xdr_coder(type))
+        throw Error("Network I/O Error. Could not read array data - unsupported type: " + type_name(type));
+
+    num = i;
+    if (num == 0)
+        return;
+
+    if (!*val)
+        *val = new char[(size_t)num * width];
+
+    // 4 and 8 byte values are read straight into the destination and swapped
+    // in place; narrower values are read into d_vec_buf and narrowed.
+    const unsigned int xdr_width = (width < 4) ? 4 : width;
+    const unsigned int chunk = (width < 4) ? 16384 : (1U << 24); // elements
+    if (width < 4)
+        d_vec_buf.resize(min(num, chunk) * xdr_width);
+
+    for (unsigned int done = 0; done < num;) {
+        unsigned int n = min(num - done, chunk);
+        char *dest = *val + (size_t)done * width;
+        char *src = (width < 4) ? d_vec_buf.data() : dest;
+        if (!d_in.read(src, (streamsize)n * xdr_width))
             throw Error("Network I/O Error. Could not read array data.");
-        }
 
-        xdr_destroy(&source);
-    } else {
-        d_in.read(d_buf + 4, size);
-        DBG(cerr << "bytes read (2): " << d_in.gcount() << endl);
-
-        xdr_setpos(&d_source, 0);
-        if (!xdr_array(&d_source, val, &num, DODS_MAX_ARRAY, width, XDRUtils::xdr_coder(type)))
-            throw Error("Network I/O Error. Could not read array data.");
+        xdr_decode_vector(dest, src, n, width);
+        done += n;
     }
 }
 
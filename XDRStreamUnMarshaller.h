@@ -36,6 +36,7 @@
 #include "config.h"
 
 #include <iostream>
+#include <vector>
 
 using std::cin;
 using std::istream;
@@ -56,6 +57,8 @@ private:
     istream &d_in;
     static char *d_buf;
 
+    std::vector<char> d_vec_buf; // Used to narrow 2-byte values; reused
+
     XDRStreamUnMarshaller();
     XDRStreamUnMarshaller(const XDRStreamUnMarshaller &um);
     XDRStreamUnMarshaller &operator=(const XDRStreamUnMarshaller &);
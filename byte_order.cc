@@ -0,0 +1,437 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+/*
+ * Bulk byte-order conversions used to encode arrays of numbers.
+ *
+ * The SSE2 code swaps bytes with 16-bit shifts followed by word shuffles and
+ * widens 1 and 2 byte values by interleaving them with their sign bytes, so
+ * the result lands in memory already big-endian. The AVX2 code uses byte
+ * shuffles (and the sign/zero extending conversions for widening). Both only
+ * handle whole vectors; the remaining elements go through the scalar code.
+ */
+
+#include "config.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <byteswap.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BYTE_ORDER_HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+#include "byte_order.h"
+
+namespace libdap {
+
+namespace {
+
+/// Load a big-endian 32-bit value, regardless of host byte order.
+inline uint32_t load_be32(const char *p) {
+    const unsigned char *u = reinterpret_cast<const unsigned char *>(p);
+    return (uint32_t(u[0]) << 24) | (uint32_t(u[1]) << 16) | (uint32_t(u[2]) << 8) | uint32_t(u[3]);
+}
+
+/// Store a 32-bit value big-endian, regardless of host byte order.
+inline void store_be32(char *p, uint32_t v) {
+    p[0] = char(v >> 24);
+    p[1] = char(v >> 16);
+    p[2] = char(v >> 8);
+    p[3] = char(v);
+}
+
+void swap_scalar(char *dest, const char *src, size_t num, int width) {
+    switch (width) {
+    case 2:
+        for (size_t i = 0; i < num; ++i) {
+            uint16_t v;
+            memcpy(&v, src + i * 2, 2);
+            v = bswap_16(v);
+            memcpy(dest + i * 2, &v, 2);
+        }
+        break;
+    case 4:
+        for (size_t i = 0; i < num; ++i) {
+            uint32_t v;
+            memcpy(&v, src + i * 4, 4);
+            v = bswap_32(v);
+            memcpy(dest + i * 4, &v, 4);
+        }
+        break;
+    case 8:
+        for (size_t i = 0; i < num; ++i) {
+            uint64_t v;
+            memcpy(&v, src + i * 8, 8);
+            v = bswap_64(v);
+            memcpy(dest + i * 8, &v, 8);
+        }
+        break;
+    default:
+        if (dest != src)
+            memmove(dest, src, num * width);
+        break;
+    }
+}
+
+void widen_scalar(char *dest, const char *src, size_t num, int width, bool is_signed) {
+    if (width == 1) {
+        for (size_t i = 0; i < num; ++i)
+            store_be32(dest + i * 4, is_signed ? uint32_t(int32_t(int8_t(src[i]))) : uint32_t(uint8_t(src[i])));
+    } else {
+        for (size_t i = 0; i < num; ++i) {
+            uint16_t v;
+            memcpy(&v, src + i * 2, 2);
+            store_be32(dest + i * 4, is_signed ? uint32_t(int32_t(int16_t(v))) : uint32_t(v));
+        }
+    }
+}
+
+// Like xdr_int16_t() and friends, keep only the low-order bytes of each value.
+// Safe when dest == src since each element is written at or before the place
+// it was read from.
+void narrow_scalar(char *dest, const char *src, size_t num, int width) {
+    if (width == 1) {
+        for (size_t i = 0; i < num; ++i)
+            dest[i] = char(load_be32(src + i * 4));
+    } else {
+        for (size_t i = 0; i < num; ++i) {
+            uint16_t v = uint16_t(load_be32(src + i * 4));
+            memcpy(dest + i * 2, &v, 2);
+        }
+    }
+}
+
+#if BYTE_ORDER_HAVE_X86_KERNELS
+
+#define SSE2_TARGET __attribute__((target("sse2")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+SSE2_TARGET inline __m128i swap16_sse2(__m128i v) { return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)); }
+
+SSE2_TARGET void swap_sse2(char *dest, const char *src, size_t num, int width) {
+    if (width != 2 && width != 4 && width != 8) {
+        swap_scalar(dest, src, num, width);
+        return;
+    }
+
+    const size_t bytes = num * width;
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i v = swap16_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        if (width == 4) {
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+            v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        } else if (width == 8) {
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+            v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), v);
+    }
+
+    swap_scalar(dest + i, src + i, (bytes - i) / width, width);
+}
+
+SSE2_TARGET void widen_sse2(char *dest, const char *src, size_t num, int width, bool is_signed) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    if (width == 1) {
+        for (; i + 16 <= num; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            __m128i sign = is_signed ? _mm_cmpgt_epi8(zero, v) : zero;
+            __m128i ss_lo = _mm_unpacklo_epi8(sign, sign);
+            __m128i ss_hi = _mm_unpackhi_epi8(sign, sign);
+            __m128i w_lo = _mm_unpacklo_epi8(sign, v);
+            __m128i w_hi = _mm_unpackhi_epi8(sign, v);
+            __m128i *out = reinterpret_cast<__m128i *>(dest + i * 4);
+            _mm_storeu_si128(out, _mm_unpacklo_epi16(ss_lo, w_lo));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(ss_lo, w_lo));
+            _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(ss_hi, w_hi));
+            _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(ss_hi, w_hi));
+        }
+    } else {
+        for (; i + 8 <= num; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2));
+            __m128i sign = is_signed ? _mm_srai_epi16(v, 15) : zero;
+            __m128i s = swap16_sse2(v);
+            __m128i *out = reinterpret_cast<__m128i *>(dest + i * 4);
+            _mm_storeu_si128(out, _mm_unpacklo_epi16(sign, s));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(sign, s));
+        }
+    }
+
+    widen_scalar(dest + i * 4, src + i * width, num - i, width, is_signed);
+}
+
+// Swapping the bytes of each 16-bit half puts the low-order half of each
+// big-endian value in the top of its 32-bit lane; the arithmetic shift makes
+// it sign-extended, so the saturating pack is exact.
+SSE2_TARGET void narrow_sse2(char *dest, const char *src, size_t num, int width) {
+    size_t i = 0;
+    if (width == 2) {
+        for (; i + 8 <= num; i += 8) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4 + 16));
+            a = _mm_srai_epi32(swap16_sse2(a), 16);
+            b = _mm_srai_epi32(swap16_sse2(b), 16);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 2), _mm_packs_epi32(a, b));
+        }
+    }
+
+    narrow_scalar(dest + i * width, src + i * 4, num - i, width);
+}
+
+AVX2_TARGET inline __m256i bswap_mask_avx2(int width) {
+    switch (width) {
+    case 2:
+        return _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11,
+                                10, 13, 12, 15, 14);
+    case 4:
+        return _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9,
+                                8, 15, 14, 13, 12);
+    default:
+        return _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14,
+                                13, 12, 11, 10, 9, 8);
+    }
+}
+
+AVX2_TARGET void swap_avx2(char *dest, const char *src, size_t num, int width) {
+    if (width != 2 && width != 4 && width != 8) {
+        swap_scalar(dest, src, num, width);
+        return;
+    }
+
+    const __m256i mask = bswap_mask_avx2(width);
+    const size_t bytes = num * width;
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i), _mm256_shuffle_epi8(v, mask));
+    }
+
+    swap_scalar(dest + i, src + i, (bytes - i) / width, width);
+}
+
+AVX2_TARGET void widen_avx2(char *dest, const char *src, size_t num, int width, bool is_signed) {
+    const __m256i mask = bswap_mask_avx2(4);
+    size_t i = 0;
+    if (width == 1) {
+        for (; i + 8 <= num; i += 8) {
+            __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+            __m256i w = is_signed ? _mm256_cvtepi8_epi32(v) : _mm256_cvtepu8_epi32(v);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 4), _mm256_shuffle_epi8(w, mask));
+        }
+    } else {
+        for (; i + 8 <= num; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2));
+            __m256i w = is_signed ? _mm256_cvtepi16_epi32(v) : _mm256_cvtepu16_epi32(v);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 4), _mm256_shuffle_epi8(w, mask));
+        }
+    }
+
+    widen_scalar(dest + i * 4, src + i * width, num - i, width, is_signed);
+}
+
+AVX2_TARGET void narrow_avx2(char *dest, const char *src, size_t num, int width) {
+    // Gather bytes 3,2 of each value into the low half of each 128-bit lane
+    const __m256i mask = _mm256_setr_epi8(3, 2, 7, 6, 11, 10, 15, 14, -1, -1, -1, -1, -1, -1, -1, -1, 3, 2, 7, 6, 11,
+                                          10, 15, 14, -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t i = 0;
+    if (width == 2) {
+        for (; i + 16 <= num; i += 16) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4 + 32));
+            __m256i v = _mm256_unpacklo_epi64(_mm256_shuffle_epi8(a, mask), _mm256_shuffle_epi8(b, mask));
+            v = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 2), v);
+        }
+    }
+
+    narrow_scalar(dest + i * width, src + i * 4, num - i, width);
+}
+
+// Asking the CPU can be slow, so ask only once.
+bool cpu_has_sse2() {
+    static const bool has_sse2 = __builtin_cpu_supports("sse2");
+    return has_sse2;
+}
+
+bool cpu_has_avx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+#endif // BYTE_ORDER_HAVE_X86_KERNELS
+
+typedef void (*swap_fn)(char *dest, const char *src, size_t num, int width);
+typedef void (*widen_fn)(char *dest, const char *src, size_t num, int width, bool is_signed);
+typedef void (*narrow_fn)(char *dest, const char *src, size_t num, int width);
+
+struct Kernels {
+    swap_fn swap;
+    widen_fn widen;
+    narrow_fn narrow;
+};
+
+bool engine_kernels(ByteOrderEngine engine, Kernels &k) {
+    switch (engine) {
+    case byte_order_scalar:
+        k = Kernels{swap_scalar, widen_scalar, narrow_scalar};
+        return true;
+    case byte_order_sse2:
+#if BYTE_ORDER_HAVE_X86_KERNELS
+        if (cpu_has_sse2()) {
+            k = Kernels{swap_sse2, widen_sse2, narrow_sse2};
+            return true;
+        }
+#endif
+        return false;
+    case byte_order_avx2:
+#if BYTE_ORDER_HAVE_X86_KERNELS
+        if (cpu_has_avx2()) {
+            k = Kernels{swap_avx2, widen_avx2, narrow_avx2};
+            return true;
+        }
+#endif
+        return false;
+    }
+
+    return false;
+}
+
+/// The kernels for an engine, or the scalar ones if it is not available here.
+Kernels usable_kernels(ByteOrderEngine engine) {
+    Kernels k{swap_scalar, widen_scalar, narrow_scalar};
+    (void)engine_kernels(engine, k);
+    return k;
+}
+
+const Kernels &best_kernels() {
+    static const Kernels best = usable_kernels(byte_order_best_engine());
+    return best;
+}
+
+void encode(const Kernels &k, char *dest, const char *src, size_t num, int width, bool is_signed) {
+    if (width < 4) {
+#if WORDS_BIGENDIAN
+        widen_scalar(dest, src, num, width, is_signed);
+#else
+        k.widen(dest, src, num, width, is_signed);
+#endif
+    } else {
+#if WORDS_BIGENDIAN
+        memcpy(dest, src, num * width);
+#else
+        k.swap(dest, src, num, width);
+#endif
+    }
+}
+
+void decode(const Kernels &k, char *dest, const char *src, size_t num, int width) {
+    if (width < 4) {
+        k.narrow(dest, src, num, width);
+    } else {
+#if WORDS_BIGENDIAN
+        if (dest != src)
+            memmove(dest, src, num * width);
+#else
+        k.swap(dest, src, num, width);
+#endif
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Is a given byte-order engine usable on this host?
+ * The scalar engine is always available; the others need an x86 CPU with
+ * the corresponding instructions.
+ */
+bool byte_order_engine_available(ByteOrderEngine engine) {
+    Kernels k;
+    return engine_kernels(engine, k);
+}
+
+/**
+ * @brief The engine used by byte_swap(), xdr_encode_vector() and xdr_decode_vector()
+ * This is chosen once, at the first call, based on the host CPU.
+ */
+ByteOrderEngine byte_order_best_engine() {
+    static const ByteOrderEngine best = byte_order_engine_available(byte_order_avx2)   ? byte_order_avx2
+                                        : byte_order_engine_available(byte_order_sse2) ? byte_order_sse2
+                                                                                       : byte_order_scalar;
+    return best;
+}
+
+/// Name of an engine, for diagnostics and benchmarks.
+const char *byte_order_engine_name(ByteOrderEngine engine) {
+    switch (engine) {
+    case byte_order_scalar:
+        return "scalar";
+    case byte_order_sse2:
+        return "sse2";
+    case byte_order_avx2:
+        return "avx2";
+    }
+
+    return "unknown";
+}
+
+void byte_swap(char *dest, const char *src, size_t num, int width) { best_kernels().swap(dest, src, num, width); }
+
+/**
+ * @brief Swap bytes using a specific engine.
+ * If the engine is not available on this host, the scalar engine is used.
+ * This is meant for tests and benchmarks.
+ */
+void byte_swap(ByteOrderEngine engine, char *dest, const char *src, size_t num, int width) {
+    usable_kernels(engine).swap(dest, src, num, width);
+}
+
+void xdr_encode_vector(char *dest, const char *src, size_t num, int width, bool is_signed) {
+    encode(best_kernels(), dest, src, num, width, is_signed);
+}
+
+/**
+ * @brief XDR-encode a vector using a specific engine.
+ * If the engine is not available on this host, the scalar engine is used.
+ */
+void xdr_encode_vector(ByteOrderEngine engine, char *dest, const char *src, size_t num, int width, bool is_signed) {
+    encode(usable_kernels(engine), dest, src, num, width, is_signed);
+}
+
+void xdr_decode_vector(char *dest, const char *src, size_t num, int width) {
+    decode(best_kernels(), dest, src, num, width);
+}
+
+/**
+ * @brief XDR-decode a vector using a specific engine.
+ * If the engine is not available on this host, the scalar engine is used.
+ */
+void xdr_decode_vector(ByteOrderEngine engine, char *dest, const char *src, size_t num, int width) {
+    decode(usable_kernels(engine), dest, src, num, width);
+}
+
+} // namespace libdap
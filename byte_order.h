@@ -0,0 +1,77 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef BYTE_ORDER_H_
+#define BYTE_ORDER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace libdap {
+
+/**
+ * @brief The implementations of the bulk byte-order conversions below.
+ *
+ * All engines produce identical output; they differ only in speed. The
+ * scalar engine is the reference implementation and is always available.
+ */
+enum ByteOrderEngine {
+    byte_order_scalar, ///< One element per iteration
+    byte_order_sse2,   ///< 16 bytes per iteration using SSE2 shifts and shuffles
+    byte_order_avx2    ///< 32 bytes per iteration using AVX2 byte shuffles
+};
+
+bool byte_order_engine_available(ByteOrderEngine engine);
+ByteOrderEngine byte_order_best_engine();
+const char *byte_order_engine_name(ByteOrderEngine engine);
+
+/**
+ * Reverse the bytes of each of 'num' elements that are 'width' (2, 4 or 8)
+ * bytes wide. The source and destination may be the same buffer; otherwise
+ * they must not overlap.
+ */
+void byte_swap(char *dest, const char *src, size_t num, int width);
+void byte_swap(ByteOrderEngine engine, char *dest, const char *src, size_t num, int width);
+
+/**
+ * Encode 'num' host values that are 'width' bytes wide as XDR does for
+ * arrays: 4 and 8 byte values are written big-endian, 1 and 2 byte values
+ * are widened to 4 byte big-endian integers (sign-extended if 'is_signed').
+ * The result is identical to xdr_array() using the matching xdr filter and
+ * needs num * max(width, 4) bytes in 'dest', which must not overlap 'src'.
+ */
+void xdr_encode_vector(char *dest, const char *src, size_t num, int width, bool is_signed);
+void xdr_encode_vector(ByteOrderEngine engine, char *dest, const char *src, size_t num, int width, bool is_signed);
+
+/**
+ * The inverse of xdr_encode_vector(): decode 'num' XDR array elements in
+ * 'src' (num * max(width, 4) bytes) to host values 'width' bytes wide. Like
+ * the xdr filters, 1 and 2 byte values keep the low-order bytes of each
+ * 4 byte integer. The decoding may be done in place (dest == src).
+ */
+void xdr_decode_vector(char *dest, const char *src, size_t num, int width);
+void xdr_decode_vector(ByteOrderEngine engine, char *dest, const char *src, size_t num, int width);
+
+} // namespace libdap
+
+#endif // BYTE_ORDER_H_
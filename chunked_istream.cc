@@ -29,7 +29,9 @@
 
 #include <arpa/inet.h>
 #include <stdint.h>
+#include <zlib.h>
 
+#include <algorithm>
 #include <cstring>
 #include <vector>
 
@@ -71,6 +73,62 @@ namespace libdap {
 
  */
 
+/**
+ * @brief Read and inflate the body of a CHUNK_COMPRESSED chunk
+ * The body holds the size of the inflated data and then the zlib stream.
+ * @param chunk_size Value-result parameter: the size of the chunk's body;
+ * on return the size of the inflated data.
+ * @param dest If not null and the inflated data fit in dest_size bytes,
+ * inflate into dest; otherwise inflate into the internal buffer (which is
+ * grown if needed), leaving gptr(), ..., for the caller to set.
+ * @param dest_size The size of dest
+ * @return Where the data were inflated, or null if there was an error, in
+ * which case the error flag and message are set.
+ */
+char *chunked_inbuf::m_inflate_chunk(uint32_t &chunk_size, char *dest, std::streamsize dest_size) {
+    if (chunk_size < sizeof(uint32_t)) {
+        d_error = true;
+        d_error_message = "Found a compressed chunk that is too small.";
+        return nullptr;
+    }
+
+    d_zbuf.resize(chunk_size);
+    d_is.read(d_zbuf.data(), chunk_size);
+    if (d_is.bad() || d_is.gcount() != static_cast<std::streamsize>(chunk_size))
+        return nullptr;
+
+    uint32_t raw_size;
+    memcpy(&raw_size, d_zbuf.data(), sizeof(uint32_t));
+    raw_size = ntohl(raw_size);
+    if (raw_size & ~CHUNK_SIZE_MASK) {
+        d_error = true;
+        d_error_message = "Found a compressed chunk that is too large.";
+        return nullptr;
+    }
+
+    if (!dest || raw_size > dest_size) {
+        // Grow the buffer if needed. It is empty, so its pointers are reset too.
+        if (raw_size > d_buf_size) {
+            d_buf_size = raw_size;
+            m_buffer_alloc();
+        }
+        dest = d_buffer;
+    }
+
+    uLongf size = raw_size;
+    int status = uncompress(reinterpret_cast<Bytef *>(dest), &size,
+                            reinterpret_cast<const Bytef *>(d_zbuf.data() + sizeof(uint32_t)),
+                            chunk_size - sizeof(uint32_t));
+    if (status != Z_OK || size != raw_size) {
+        d_error = true;
+        d_error_message = string("Could not inflate a compressed chunk: ") + zError(status);
+        return nullptr;
+    }
+
+    chunk_size = raw_size;
+    return dest;
+}
+
 /**
  * @brief Insert new characters into the buffer
  * This specialization of underflow is called when the gptr() is advanced to
@@ -91,6 +149,18 @@ std::streambuf::int_type chunked_inbuf::underflow() {
 
     // gptr() == egptr() so read more data from the underlying input source.
 
+    // If xsgetn() left part of the current chunk in the stream, read (some of) that.
+    if (d_chunk_left > 0) {
+        uint32_t bytes = std::min(d_chunk_left, d_buf_size);
+        d_is.read(d_buffer, bytes);
+        if (d_is.bad() || d_is.gcount() == 0)
+            return traits_type::eof();
+
+        d_chunk_left -= bytes;
+        setg(d_buffer, d_buffer, d_buffer + bytes);
+        return traits_type::to_int_type(*gptr());
+    }
+
     // To read data from the chunked stream, first read the header
     uint32_t header;
     d_is.read((char *)&header, 4);
@@ -118,22 +188,28 @@ std::streambuf::int_type chunked_inbuf::underflow() {
     DBG(cerr << "underflow: chunk type from header: " << hex << (header & CHUNK_TYPE_MASK) << endl);
     DBG(cerr << "underflow: chunk byte order from header: " << hex << (header & CHUNK_BIG_ENDIAN) << endl);
 
-    // Handle the case where the buffer is not big enough to hold the incoming chunk
-    if (chunk_size > d_buf_size) {
-        d_buf_size = chunk_size;
-        m_buffer_alloc();
-    }
-
     // If the END chunk has zero bytes, return EOF. See above for more information
     if (chunk_size == 0 && (header & CHUNK_TYPE_MASK) == CHUNK_END)
         return traits_type::eof();
 
-    // Read the chunk's data
-    d_is.read(d_buffer, chunk_size);
-    DBG2(cerr << "underflow: size read: " << d_is.gcount() << ", eof: " << d_is.eof() << ", bad: " << d_is.bad()
-              << endl);
-    if (d_is.bad())
-        return traits_type::eof();
+    if (header & CHUNK_COMPRESSED) {
+        // Inflate the chunk's data into the buffer; chunk_size becomes their size
+        if (!m_inflate_chunk(chunk_size))
+            return traits_type::eof();
+    } else {
+        // Handle the case where the buffer is not big enough to hold the incoming chunk
+        if (chunk_size > d_buf_size) {
+            d_buf_size = chunk_size;
+            m_buffer_alloc();
+        }
+
+        // Read the chunk's data
+        d_is.read(d_buffer, chunk_size);
+        DBG2(cerr << "underflow: size read: " << d_is.gcount() << ", eof: " << d_is.eof()
+                  << ", bad: " << d_is.bad() << endl);
+        if (d_is.bad())
+            return traits_type::eof();
+    }
 
     DBG2(cerr << "eback(): " << (void *)eback() << ", gptr(): " << (void *)(gptr() - eback())
               << ", egptr(): " << (void *)(egptr() - eback()) << endl);
@@ -167,18 +243,18 @@ std::streambuf::int_type chunked_inbuf::underflow() {
 /**
  * @brief Read a block of data
  * This specialization of xsgetn() reads \c num bytes and puts them in \c s
- * first reading from the internal beffer and then from the stream. Any
- * characters read from the last chunk that won't fit in to \c s are put
- * in the buffer, otherwise all data are read directly into \c s, bypassing
- * the internal buffer (and the extra copy operation that would imply). If
+ * first reading from the internal beffer and then from the stream. All
+ * data from the stream are read directly into \c s, bypassing the internal
+ * buffer (and the extra copy operation that would imply). Any characters of
+ * the last chunk that won't fit in to \c s are left in the stream for the
+ * next read. If
  * the END chunk is found EOF is not returned and the final read of the
  * underlying stream is not made; the next call to read(), get(), ..., will
  * return EOF.
  * @param s Address of a buffer to hold the data
  * @param num Number of bytes to read
- * @return NUmber of bytes actually transferred into \c s. Note that this
- * number does not include the bytes read from the last chunk that won't
- * fit into \c s so this will never return a number greater than num.
+ * @return NUmber of bytes actually transferred into \c s. This will never
+ * be a number greater than num.
  */
 std::streamsize chunked_inbuf::xsgetn(char *s, std::streamsize num) {
     DBG(cerr << "xsgetn... num: " << num << endl);
@@ -191,18 +267,33 @@ std::streamsize chunked_inbuf::xsgetn(char *s, std::streamsize num) {
         return traits_type::not_eof(num);
     }
 
-    // else they asked for more
-    uint32_t bytes_left_to_read = num;
+    // else they asked for more. This can be more than 4GB for a large vector,
+    // so don't narrow num.
+    std::streamsize bytes_left_to_read = num;
 
     // are there any bytes in the buffer? if so grab them first
     if (gptr() < egptr()) {
-        int bytes_to_transfer = egptr() - gptr();
+        std::streamsize bytes_to_transfer = egptr() - gptr();
         memcpy(s, gptr(), bytes_to_transfer);
         gbump(bytes_to_transfer);
         s += bytes_to_transfer;
         bytes_left_to_read -= bytes_to_transfer;
     }
 
+    // Then whatever a previous call left of the current chunk in the stream
+    if (d_chunk_left > 0) {
+        auto bytes_to_transfer = static_cast<uint32_t>(std::min<std::streamsize>(d_chunk_left, bytes_left_to_read));
+        d_is.read(s, bytes_to_transfer);
+        if (d_is.bad())
+            return traits_type::eof();
+        d_chunk_left -= bytes_to_transfer;
+        s += bytes_to_transfer;
+        bytes_left_to_read -= bytes_to_transfer;
+
+        if (bytes_left_to_read == 0)
+            return traits_type::not_eof(num);
+    }
+
     // We need to get more bytes from the underlying stream; at this
     // point the internal buffer is empty.
 
@@ -254,36 +345,36 @@ std::streamsize chunked_inbuf::xsgetn(char *s, std::streamsize num) {
         else if (chunk_size == 0 && (header & CHUNK_TYPE_MASK) == CHUNK_END) {
             return traits_type::not_eof(num - bytes_left_to_read);
         }
-        // The next case is complicated because we read some data from the current
-        // chunk into 's' an some into the internal buffer.
-        else if (chunk_size > bytes_left_to_read) {
-            d_is.read(s, bytes_left_to_read);
-            if (d_is.bad())
+        // A compressed chunk is inflated straight into 's' if it fits, else into the
+        // buffer, from which the part that fits is copied.
+        else if (header & CHUNK_COMPRESSED) {
+            char *data = m_inflate_chunk(chunk_size, s, bytes_left_to_read);
+            if (!data)
                 return traits_type::eof();
 
-            // Now slurp up the remain part of the chunk and store it in the buffer
-            uint32_t bytes_leftover = chunk_size - bytes_left_to_read;
-            // expand the internal buffer if needed
-            if (bytes_leftover > d_buf_size) {
-                d_buf_size = chunk_size;
-                m_buffer_alloc();
+            if (data == s) {
+                bytes_left_to_read -= chunk_size;
+                s += chunk_size;
+            } else {
+                memcpy(s, d_buffer, bytes_left_to_read);
+                setg(d_buffer, d_buffer + bytes_left_to_read, d_buffer + chunk_size);
+                bytes_left_to_read = 0;
             }
-            // read the remain stuff in to d_buffer
-            d_is.read(d_buffer, bytes_leftover);
+        }
+        // The chunk holds more than was asked for. Read what's needed into 's' and
+        // leave the rest in the stream; the next read takes it from there, straight
+        // into its destination if that is big enough, and only small reads go
+        // through the internal buffer (see underflow()).
+        else if (chunk_size > bytes_left_to_read) {
+            d_is.read(s, bytes_left_to_read);
             if (d_is.bad())
                 return traits_type::eof();
 
-            setg(d_buffer,                                     // beginning of put back area
-                 d_buffer,                                     // read position (gptr() == eback())
-                 d_buffer + bytes_leftover /*d_is.gcount()*/); // end of buffer (egptr())
-
-            bytes_left_to_read = 0 /* -= d_is.gcount()*/;
+            d_chunk_left = static_cast<uint32_t>(chunk_size - bytes_left_to_read);
+            bytes_left_to_read = 0;
         } else {
-            // expand the internal buffer if needed
-            if (chunk_size > d_buf_size) {
-                d_buf_size = chunk_size;
-                m_buffer_alloc();
-            }
+            // The whole chunk goes straight into 's'; the internal buffer is
+            // not used, so there's no need to grow it for large chunks.
             // If we get a chunk that's zero bytes, Don't call read()
             // to save the kernel context switch overhead.
             if (chunk_size > 0) {
@@ -336,6 +427,12 @@ std::streamsize chunked_inbuf::xsgetn(char *s, std::streamsize num) {
  * next chunk in the stream. Returns EOF on error.
  */
 std::streambuf::int_type chunked_inbuf::read_next_chunk() {
+    // Like the data in the buffer, whatever is left of the current chunk is lost
+    if (d_chunk_left > 0) {
+        d_is.ignore(d_chunk_left);
+        d_chunk_left = 0;
+    }
+
     // To read data from the chunked stream, first read the header
     uint32_t header;
     d_is.read((char *)&header, 4);
@@ -361,22 +458,28 @@ std::streambuf::int_type chunked_inbuf::read_next_chunk() {
     DBG(cerr << "read_next_chunk: chunk type from header: " << hex << (header & CHUNK_TYPE_MASK) << endl);
     DBG(cerr << "read_next_chunk: chunk byte order from header: " << hex << (header & CHUNK_BIG_ENDIAN) << endl);
 
-    // Handle the case where the buffer is not big enough to hold the incoming chunk
-    if (chunk_size > d_buf_size) {
-        d_buf_size = chunk_size;
-        m_buffer_alloc();
-    }
-
     // If the END chunk has zero bytes, return EOF. See above for more information
     if (chunk_size == 0 && (header & CHUNK_TYPE_MASK) == CHUNK_END)
         return traits_type::eof();
 
-    // Read the chunk's data
-    d_is.read(d_buffer, chunk_size);
-    DBG2(cerr << "read_next_chunk: size read: " << d_is.gcount() << ", eof: " << d_is.eof() << ", bad: " << d_is.bad()
-              << endl);
-    if (d_is.bad())
-        return traits_type::eof();
+    if (header & CHUNK_COMPRESSED) {
+        // Inflate the chunk's data into the buffer; chunk_size becomes their size
+        if (!m_inflate_chunk(chunk_size))
+            return traits_type::eof();
+    } else {
+        // Handle the case where the buffer is not big enough to hold the incoming chunk
+        if (chunk_size > d_buf_size) {
+            d_buf_size = chunk_size;
+            m_buffer_alloc();
+        }
+
+        // Read the chunk's data
+        d_is.read(d_buffer, chunk_size);
+        DBG2(cerr << "read_next_chunk: size read: " << d_is.gcount() << ", eof: " << d_is.eof()
+                  << ", bad: " << d_is.bad() << endl);
+        if (d_is.bad())
+            return traits_type::eof();
+    }
 
     DBG2(cerr << "eback(): " << (void *)eback() << ", gptr(): " << (void *)(gptr() - eback())
               << ", egptr(): " << (void *)(egptr() - eback()) << endl);
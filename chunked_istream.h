@@ -36,6 +36,7 @@
 #include <stdexcept>
 #include <streambuf>
 #include <string>
+#include <vector>
 
 namespace libdap {
 
@@ -47,6 +48,13 @@ private:
     uint32_t d_buf_size; // Size of the data buffer
     char *d_buffer;      // data buffer
 
+    // Bytes of the current chunk's body not yet read from d_is. Large reads
+    // go straight from d_is to the caller, so a chunk may be read in parts.
+    uint32_t d_chunk_left = 0;
+
+    // The body of a compressed chunk, before it is inflated
+    std::vector<char> d_zbuf;
+
     // In the original implementation of this class, the byte order of the data stream
     // was passed in via constructors. When BYTE_ORDER_PREFIX is defined that is the
     // case. However, when it is not defined, the byte order is read from the chunk
@@ -73,6 +81,8 @@ private:
              d_buffer); // end position
     }
 
+    char *m_inflate_chunk(uint32_t &chunk_size, char *dest = nullptr, std::streamsize dest_size = 0);
+
 public:
     /**
      * @brief Build a chunked input buffer.
@@ -28,9 +28,13 @@
 #include "config.h"
 
 #include <arpa/inet.h>
+#include <zlib.h>
 
+#include <algorithm>
+#include <future>
 #include <streambuf>
 #include <string>
+#include <vector>
 
 #include <cstring>
 
@@ -40,6 +44,166 @@
 
 namespace libdap {
 
+namespace {
+
+/**
+ * @brief Compress the body of a chunk.
+ * @param data The chunk's data
+ * @param size How many bytes of data
+ * @param level The zlib compression level
+ * @param body Value-result parameter; the body of a CHUNK_COMPRESSED chunk
+ * @return False if compressing the data doesn't make them smaller, in which
+ * case the chunk should be sent uncompressed.
+ */
+bool compress_chunk(const char *data, uint32_t size, int level, std::vector<char> &body) {
+    uLongf zsize = compressBound(size);
+    body.resize(sizeof(uint32_t) + zsize);
+
+    uint32_t raw_size = htonl(size);
+    memcpy(body.data(), &raw_size, sizeof(uint32_t));
+    int status = compress2(reinterpret_cast<Bytef *>(body.data() + sizeof(uint32_t)), &zsize,
+                           reinterpret_cast<const Bytef *>(data), size, level);
+    if (status != Z_OK)
+        throw InternalErr(__FILE__, __LINE__, "Could not compress a chunk: " + std::string(zError(status)));
+
+    body.resize(sizeof(uint32_t) + zsize);
+    return body.size() < size;
+}
+
+} // namespace
+
+/**
+ * @brief Write a chunk header
+ * Write out the chunk header: CHUNKTYPE and CHUNKSIZE as a 32-bit unsigned
+ * int in network byte order, with the host's byte order encoded.
+ * @param type CHUNK_DATA, CHUNK_END or CHUNK_ERR, possibly with CHUNK_COMPRESSED
+ * @param size The size of the chunk body; never more than 2^24 - 1.
+ */
+void chunked_outbuf::m_write_header(uint32_t type, uint32_t size) {
+    uint32_t header = size | type;
+
+    // Add encoding of host's byte order. jhrg 11/24/13
+    if (!d_big_endian)
+        header |= CHUNK_LITTLE_ENDIAN;
+
+    // network byte order for the header
+    header = htonl(header);
+
+    d_os.write(reinterpret_cast<const char *>(&header), sizeof(uint32_t));
+}
+
+/**
+ * @brief Write a DATA or END chunk
+ * If compression is on, the chunk is compressed unless that doesn't make it
+ * any smaller. The caller should check the state of d_os.
+ */
+void chunked_outbuf::m_write_chunk(uint32_t type, const char *data, uint32_t size) {
+    std::vector<char> body;
+    if (d_compression > 0 && size > 0 && compress_chunk(data, size, d_compression, body)) {
+        m_write_header(type | CHUNK_COMPRESSED, body.size());
+        d_os.write(body.data(), body.size());
+    } else {
+        m_write_header(type, size);
+        d_os.write(data, size);
+    }
+}
+
+/**
+ * @brief Write several DATA chunks, compressing them in parallel
+ * Each chunk compresses on its own, so up to d_compression_threads chunks
+ * are compressed at once (this thread does the first of each group); the
+ * chunks are written in order. The caller should check the state of d_os.
+ * @param chunks The address and size of each chunk's data
+ */
+void chunked_outbuf::m_write_compressed_chunks(const std::vector<std::pair<const char *, uint32_t>> &chunks) {
+    auto compress = [this](const std::pair<const char *, uint32_t> &chunk) {
+        std::vector<char> body;
+        if (!compress_chunk(chunk.first, chunk.second, d_compression, body))
+            body.clear(); // send this one uncompressed
+        return body;
+    };
+
+    for (size_t first = 0; first < chunks.size(); first += d_compression_threads) {
+        const size_t last = std::min(chunks.size(), first + d_compression_threads);
+
+        std::vector<std::future<std::vector<char>>> bodies;
+        for (size_t i = first + 1; i < last; ++i)
+            bodies.push_back(std::async(std::launch::async, compress, std::cref(chunks[i])));
+
+        for (size_t i = first; i < last; ++i) {
+            std::vector<char> body = (i == first) ? compress(chunks[i]) : bodies[i - first - 1].get();
+            if (body.empty()) {
+                m_write_header(CHUNK_DATA, chunks[i].second);
+                d_os.write(chunks[i].first, chunks[i].second);
+            } else {
+                m_write_header(CHUNK_DATA | CHUNK_COMPRESSED, body.size());
+                d_os.write(body.data(), body.size());
+            }
+        }
+    }
+}
+
+/**
+ * @brief Write bytes to the chunked stream, compressing the chunks
+ * This is xsputn() for when compression is on. The chunks are the same as
+ * without compression, but each chunk must be in contiguous memory to be
+ * compressed, so the first is assembled in the buffer. The whole chunks in
+ * \c s are compressed (in parallel, if so configured) straight from \c s.
+ * @param s
+ * @param num Fills out the buffer at least once
+ * @return The number of bytes written
+ */
+std::streamsize chunked_outbuf::m_compressed_xsputn(const char *s, std::streamsize num) {
+    const auto bytes_in_buffer = static_cast<int_type>(pptr() - pbase());
+    const int bytes_to_fill_out_buffer = d_buf_size - bytes_in_buffer;
+    memcpy(pptr(), s, bytes_to_fill_out_buffer);
+    setp(d_buffer, d_buffer + (d_buf_size - 1));
+
+    m_write_chunk(CHUNK_DATA, d_buffer, d_buf_size);
+    if (d_os.bad())
+        throw InternalErr(__FILE__, __LINE__, "chunked_outbuf::xsputn");
+    if (d_os.eof())
+        return traits_type::not_eof(0);
+
+    s += bytes_to_fill_out_buffer;
+    std::streamsize bytes_still_to_send = num - bytes_to_fill_out_buffer;
+
+    // See xsputn() about the adaptive policy
+    const int old_buf_size = d_buf_size;
+    if (num >= old_buf_size)
+        m_grow();
+
+    std::vector<std::pair<const char *, uint32_t>> chunks;
+    while (bytes_still_to_send >= d_buf_size) {
+        chunks.emplace_back(s, d_buf_size);
+        s += d_buf_size;
+        bytes_still_to_send -= d_buf_size;
+        m_grow();
+
+        // Don't hold on to more of the caller's data than will be compressed at once
+        if (chunks.size() == static_cast<size_t>(d_compression_threads)) {
+            m_write_compressed_chunks(chunks);
+            chunks.clear();
+        }
+    }
+    m_write_compressed_chunks(chunks);
+    if (d_os.bad())
+        throw InternalErr(__FILE__, __LINE__, "chunked_outbuf::xsputn");
+    if (d_os.eof())
+        return traits_type::not_eof(0);
+
+    // The buffer is empty here, so it can be reallocated for the new size.
+    if (d_buf_size != old_buf_size)
+        m_buffer_alloc();
+
+    if (bytes_still_to_send > 0) {
+        memcpy(d_buffer, s, bytes_still_to_send);
+        pbump(bytes_still_to_send);
+    }
+
+    return traits_type::not_eof(num);
+}
+
 // flush the characters in the buffer
 /**
  * @brief Write out the contents of the buffer as a chunk.
@@ -59,26 +223,7 @@ std::streambuf::int_type chunked_outbuf::data_chunk() {
     // Here, write out the chunk headers: CHUNKTYPE and CHUNKSIZE
     // as a 32-bit unsigned int. Here I assume that num is never
     // more than 2^24 because that was tested in the constructor
-
-    // Trick: This method always writes CHUNK_DATA type chunks so
-    // the chunk type is always 0x00, and given that num never has
-    // anything bigger than 24-bits, the high-order byte is always
-    // 0x00. Of course, bit-wise OR with 0x00 isn't going to do
-    // much anyway... Here's the general idea all the same:
-    //
-    // unsigned int chunk_header = (unsigned int)num | CHUNK_type;
-    uint32_t header = num;
-
-    // Add encoding of host's byte order. jhrg 11/24/13
-    if (!d_big_endian)
-        header |= CHUNK_LITTLE_ENDIAN;
-
-    // network byte order for the header
-    header = htonl(header);
-
-    d_os.write(reinterpret_cast<const char *>(&header), sizeof(int32_t));
-
-    d_os.write(d_buffer, num);
+    m_write_chunk(CHUNK_DATA, d_buffer, num);
     if (d_os.bad())
         throw InternalErr(__FILE__, __LINE__, "chunked_outbuf::data_chunk");
     if (d_os.eof())
@@ -107,23 +252,13 @@ std::streambuf::int_type chunked_outbuf::end_chunk() {
 
     // write out the chunk headers: CHUNKTYPE and CHUNKSIZE
     // as a 32-bit unsigned int. Here I assume that num is never
-    // more than 2^24 because that was tested in the constructor
-
-    uint32_t header = num | CHUNK_END;
-
-    // Add encoding of host's byte order. jhrg 11/24/13
-    if (!d_big_endian)
-        header |= CHUNK_LITTLE_ENDIAN;
-
-    // network byte order for the header
-    header = htonl(header);
-
-    // Write out the CHUNK_END header with the byte count.
-    // This should be called infrequently, so it's probably not worth
-    // optimizing away chunk_header
-    d_os.write(reinterpret_cast<const char *>(&header), sizeof(uint32_t));
-
-    d_os.write(d_buffer, num);
+    // more than 2^24 because that was tested in the constructor.
+    // This is called by the destructor, so don't let zlib errors escape.
+    try {
+        m_write_chunk(CHUNK_END, d_buffer, num);
+    } catch (...) {
+        return traits_type::eof();
+    }
     // It seems wrong to return 'eof' when 'bad()' is true, but that's the correct
     // behavior for std::streambuf. jhrg 5/28/25
     if (d_os.eof() || d_os.bad())
@@ -154,19 +289,9 @@ std::streambuf::int_type chunked_outbuf::err_chunk(const std::string &m) {
     if (msg.length() > 0x00'FF'FF'FF)
         msg = "Error message too long";
 
-    uint32_t header = msg.length() | CHUNK_ERR;
-
-    // Add encoding of host's byte order. jhrg 11/24/13
-    if (!d_big_endian)
-        header |= CHUNK_LITTLE_ENDIAN;
-
-    // network byte order for the header
-    header = htonl(header);
-
-    // Write out the CHUNK_ERR header with the byte count.
-    // This should be called infrequently, so it's probably not worth
-    // optimizing away chunk_header
-    d_os.write(reinterpret_cast<const char *>(&header), sizeof(uint32_t));
+    // Write out the CHUNK_ERR header with the byte count. Error chunks are
+    // never compressed.
+    m_write_header(CHUNK_ERR, msg.length());
 
     // Should bad() throw an error?
     d_os.write(msg.data(), msg.length());
@@ -255,6 +380,9 @@ std::streamsize chunked_outbuf::xsputn(const char *s, std::streamsize num) {
         return traits_type::not_eof(num);
     }
 
+    if (d_compression > 0)
+        return m_compressed_xsputn(s, num);
+
     // If here, write a chunk header and a chunk's worth of data by combining the
     // data in the buffer and some data from 's'.
     uint32_t header = d_buf_size;
@@ -288,7 +416,24 @@ std::streamsize chunked_outbuf::xsputn(const char *s, std::streamsize num) {
         return traits_type::not_eof(0);
 
     s += bytes_to_fill_out_buffer;
-    int bytes_still_to_send = num - bytes_to_fill_out_buffer;
+    std::streamsize bytes_still_to_send = num - bytes_to_fill_out_buffer;
+
+    // Adaptive policy: a write that spans whole chunks is (part of) a large
+    // vector, so double the chunk size for the chunks that follow. Those are
+    // sent straight from 's', so the buffer only needs to catch up at the end.
+    const int old_buf_size = d_buf_size;
+    auto grow = [this, &header]() {
+        if (d_buf_size < d_max_buf_size) {
+            m_grow();
+            header = d_buf_size;
+            if (!d_big_endian)
+                header |= CHUNK_LITTLE_ENDIAN;
+            header = htonl(header);
+        }
+    };
+
+    if (num >= old_buf_size)
+        grow();
 
     // Now send all the remaining data in s until the amount remaining doesn't
     // fill a complete chunk and buffer those data.
@@ -303,8 +448,13 @@ std::streamsize chunked_outbuf::xsputn(const char *s, std::streamsize num) {
 
         s += d_buf_size;
         bytes_still_to_send -= d_buf_size;
+        grow();
     }
 
+    // The buffer is empty here, so it can be reallocated for the new size.
+    if (d_buf_size != old_buf_size)
+        m_buffer_alloc();
+
     if (bytes_still_to_send > 0) {
         // If the code is here, one or more chunks have been sent, the
         // buffer is empty, and there are < d_buf_size bytes to send. Buffer them.
@@ -317,6 +467,23 @@ std::streamsize chunked_outbuf::xsputn(const char *s, std::streamsize num) {
     return traits_type::not_eof(num);
 }
 
+/**
+ * @brief Change the size of the write buffer, and so of the data chunks.
+ * Whatever is in the buffer is sent first as a data chunk.
+ * @param size The new size; must be between 1 and 0x00ffffff.
+ */
+void chunked_outbuf::set_chunk_size(int size) {
+    m_check_size(size);
+
+    if (data_chunk() == traits_type::eof())
+        throw InternalErr(__FILE__, __LINE__, "chunked_outbuf::set_chunk_size");
+
+    if (size != d_buf_size) {
+        d_buf_size = size;
+        m_buffer_alloc();
+    }
+}
+
 /**
  * @brief Synchronize the stream with its data sink.
  * @note This method is called by flush() among others
@@ -30,8 +30,11 @@
 
 #include "chunked_stream.h"
 
+#include <cstdint>
 #include <stdexcept> // std::out_of_range
 #include <streambuf>
+#include <utility>
+#include <vector>
 
 #include "util.h"
 
@@ -53,28 +56,48 @@ class chunked_outbuf : public std::streambuf {
     friend class chunked_ostream;
 
 protected:
-    std::ostream &d_os;        ///< Destination stream.
-    int d_buf_size = 0;        ///< Size of the write buffer.
-    char *d_buffer = nullptr;  ///< Write buffer storage.
-    bool d_big_endian = false; ///< True when local host byte order is big-endian.
+    std::ostream &d_os;            ///< Destination stream.
+    int d_buf_size = 0;            ///< Size of the write buffer (and of full data chunks).
+    int d_max_buf_size = 0;        ///< Adaptive policy: largest size d_buf_size may grow to.
+    char *d_buffer = nullptr;      ///< Write buffer storage.
+    bool d_big_endian = false;     ///< True when local host byte order is big-endian.
+    int d_compression = 0;         ///< zlib level (1 - 9) used to compress chunks; 0 for none.
+    int d_compression_threads = 1; ///< How many chunks of a large write to compress at once.
+
+    // A chunk size must fit in the CHUNK_SIZE_MASK bits of a chunk header.
+    static void m_check_size(int size) {
+        if (size <= 0 || size > CHUNK_SIZE_MAX)
+            throw std::out_of_range(
+                "A chunked_outbuf (or chunked_ostream) chunk size must be between 1 and 0x00ffffff bytes");
+    }
+
+    // Reallocate the (empty) write buffer to hold d_buf_size bytes.
+    void m_buffer_alloc() {
+        delete[] d_buffer;
+        d_buffer = new char[d_buf_size];
+        // Trick: making the pointers think the buffer is one char smaller than it
+        // really is ensures that overflow() will be called when there's space for
+        // one more character.
+        setp(d_buffer, d_buffer + (d_buf_size - 1));
+    }
 
 public:
     /**
      * @brief Builds a chunked output buffer.
      * @param os Destination stream.
      * @param buf_size Chunk payload buffer size.
+     * @param max_buf_size If larger than buf_size, grow the chunk size up to
+     * this many bytes while large blocks of data are being written; 0, the
+     * default, for a fixed chunk size.
      */
-    chunked_outbuf(std::ostream &os, int buf_size) : d_os(os), d_buf_size(buf_size) {
-        if (d_buf_size & CHUNK_TYPE_MASK)
-            throw std::out_of_range(
-                "A chunked_outbuf (or chunked_ostream) was built using a buffer larger than 0x00ffffff");
+    chunked_outbuf(std::ostream &os, int buf_size, int max_buf_size = 0)
+        : d_os(os), d_buf_size(buf_size), d_max_buf_size(max_buf_size) {
+        m_check_size(d_buf_size);
+        if (d_max_buf_size != 0)
+            m_check_size(d_max_buf_size);
 
         d_big_endian = is_host_big_endian();
-        d_buffer = new char[buf_size];
-        // Trick: making the pointers think the buffer is one char smaller than it
-        // really is ensures that overflow() will be called when there's space for
-        // one more character.
-        setp(d_buffer, d_buffer + (buf_size - 1));
+        m_buffer_alloc();
     }
 
     ~chunked_outbuf() noexcept override {
@@ -92,6 +115,19 @@ protected:
 
     int_type err_chunk(const std::string &msg);
 
+    void set_chunk_size(int size);
+
+    // The adaptive policy: double d_buf_size, up to d_max_buf_size.
+    void m_grow() {
+        if (d_buf_size < d_max_buf_size)
+            d_buf_size = (d_buf_size > d_max_buf_size / 2) ? d_max_buf_size : d_buf_size * 2;
+    }
+
+    void m_write_header(uint32_t type, uint32_t size);
+    void m_write_chunk(uint32_t type, const char *data, uint32_t size);
+    void m_write_compressed_chunks(const std::vector<std::pair<const char *, uint32_t>> &chunks);
+    std::streamsize m_compressed_xsputn(const char *s, std::streamsize num);
+
     std::streamsize xsputn(const char *s, std::streamsize num) override;
     // Manipulate the buffer pointers using pbump() after filling the buffer
     // and then call data_chunk(). Leave remainder in buffer. Or copy logic
@@ -136,6 +172,69 @@ public:
      */
     chunked_ostream(std::ostream &os, int buf_size) : std::ostream(&d_cbuf), d_cbuf(os, buf_size) {}
 
+    /**
+     * Get a chunked_ostream that adapts its chunk size to the data.
+     * The stream starts with chunks of buf_size bytes. Each time a single write
+     * spans one or more whole chunks (e.g., a large vector is being serialized)
+     * the chunk size doubles, up to max_chunk_size, so that large responses are
+     * sent with far fewer chunks. Small writes never change the chunk size.
+     * Readers need no configuration: chunked_istream grows its buffer to fit
+     * whatever chunk size it reads.
+     * @note Neither size may be more than 2^24 bytes (0x00ffffff); see
+     * CHUNK_SIZE_ADAPTIVE_MAX for a reasonable upper bound.
+     * @param os Destination stream.
+     * @param buf_size The initial size of the buffer in bytes.
+     * @param max_chunk_size The largest chunk size the stream will grow to.
+     */
+    chunked_ostream(std::ostream &os, int buf_size, int max_chunk_size)
+        : std::ostream(&d_cbuf), d_cbuf(os, buf_size, max_chunk_size) {}
+
+    /** @brief The current chunk (and buffer) size in bytes. */
+    int chunk_size() const { return d_cbuf.d_buf_size; }
+
+    /**
+     * @brief Change the chunk size.
+     * Any data already buffered are first sent as a data chunk. If the adaptive
+     * policy is in use it continues from the new size.
+     * @param size The new size in bytes; not more than 0x00ffffff.
+     */
+    void set_chunk_size(int size) { d_cbuf.set_chunk_size(size); }
+
+    /** @brief The largest size the adaptive policy may grow chunks to. */
+    int max_chunk_size() const { return d_cbuf.d_max_buf_size; }
+
+    /**
+     * @brief Set the upper bound for the adaptive chunk size.
+     * A value not larger than the current chunk size turns the adaptive
+     * policy off.
+     * @param size The largest chunk size in bytes; not more than 0x00ffffff.
+     */
+    void set_max_chunk_size(int size) {
+        chunked_outbuf::m_check_size(size);
+        d_cbuf.d_max_buf_size = size;
+    }
+
+    /** @brief The zlib compression level used for chunks; 0 if they are not compressed. */
+    int compression() const { return d_cbuf.d_compression; }
+
+    /**
+     * @brief Compress the data chunks that follow.
+     * Each DATA and END chunk is compressed on its own with zlib and marked
+     * with CHUNK_COMPRESSED; a chunk that doesn't get smaller is sent as it
+     * is. Only use this when the client can read compressed chunks (it sends
+     * the CHUNK_COMPRESSION_HEADER request header); chunked_istream inflates
+     * them transparently.
+     * @param level zlib compression level, 1 (fastest) to 9 (smallest); 0
+     * turns compression off.
+     * @param threads Compress up to this many chunks of a large write at once.
+     */
+    void set_compression(int level, int threads = 1) {
+        if (level < 0 || level > 9)
+            throw std::out_of_range("A chunked_ostream compression level must be between 0 and 9");
+        d_cbuf.d_compression = level;
+        d_cbuf.d_compression_threads = threads < 1 ? 1 : threads;
+    }
+
     /**
      * @brief Send an end chunk.
      * Normally, an end chunk is sent by closing the chunked_ostream, but this
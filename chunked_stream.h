@@ -17,6 +17,15 @@
 // not the byte order of the chunk. The chunk is always in network byte order.
 #define CHUNK_LITTLE_ENDIAN 0x04'00'00'00
 
+// This bit marks a DATA or END chunk whose body is compressed. The body is the
+// size of the uncompressed data (four bytes, network byte order) followed by
+// those data compressed with zlib. Older readers don't know this bit, so a
+// sender must only use it when the client has said it can read such chunks.
+#define CHUNK_COMPRESSED 0x08'00'00'00
+
+// The value of the request header a client sends to say it can read compressed chunks.
+#define CHUNK_COMPRESSION_HEADER "X-DAP-Chunk-Encoding: deflate"
+
 // Chunk type mask masks off the low bytes and the little endian bit.
 // The three chunk types (DATA, END and ERR) are mutually exclusive.
 #define CHUNK_TYPE_MASK 0x03'00'00'00
@@ -24,6 +33,14 @@
 
 #define CHUNK_SIZE 4096
 
+// The largest chunk body a header can describe.
+#define CHUNK_SIZE_MAX CHUNK_SIZE_MASK
+
+// The default upper bound for chunked_ostream's adaptive chunk size. Past
+// about 1MB the per-chunk overhead is lost in the noise and larger chunks
+// only cost the reader memory.
+#define CHUNK_SIZE_ADAPTIVE_MAX 0x00'10'00'00
+
 #define BYTE_ORDER_PREFIX 0
 #define HEADER_IN_NETWORK_BYTE_ORDER 1
 
@@ -12,6 +12,7 @@ check_include_files("sys/stat.h" HAVE_SYS_STAT_H)
 check_include_files("sys/types.h;sys/stat.h" HAVE_SYS_TYPES_H_AND_SYS_STAT_H)
 check_include_files("string.h" HAVE_STRING_H)
 check_include_files("stdlib.h" HAVE_STDLIB_H)
+check_include_files("linux/io_uring.h" HAVE_LINUX_IO_URING_H)
 
 # --- Library headers (set CMAKE_REQUIRED_INCLUDES as needed) ---
 
@@ -27,6 +27,7 @@
 #cmakedefine HAVE_SYS_TYPES_H_AND_SYS_STAT_H
 #cmakedefine HAVE_STRING_H
 #cmakedefine HAVE_STDLIB_H
+#cmakedefine HAVE_LINUX_IO_URING_H
 #cmakedefine HAVE_REGEX_H 1
 
 /* Build options */
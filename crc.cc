@@ -0,0 +1,433 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+// Author: James Gallagher <jgallagher@opendap.org>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+/*
+ * The CRC-32 engines used by Crc32::AddData().
+ *
+ * The slice-by-N code follows the well-known Intel 'slicing-by-8' method.
+ * The PCLMUL code folds 64-byte blocks with carry-less multiplies and then
+ * reduces with a Barrett reduction; the constants are those given for the
+ * bit-reflected CRC-32 polynomial in 'Fast CRC Computation for Generic
+ * Polynomials Using PCLMULQDQ Instruction' (Gopal, et al., Intel, 2009).
+ *
+ * All of the functions here work on the 'raw' CRC register; the pre- and
+ * post-conditioning (~crc) is done by the Crc32 class.
+ *
+ * crc32_combine() uses the GF(2) polynomial arithmetic of zlib's function of
+ * the same name (Mark Adler): appending len2 bytes to a message multiplies
+ * its CRC by x^(8 * len2) modulo the CRC polynomial.
+ */
+
+#include "config.h"
+
+#include <cstring>
+#include <future>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CRC32_HAVE_PCLMUL_KERNEL 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#include "crc.h"
+
+namespace libdap {
+
+namespace {
+
+/// The slice-by-N lookup tables; table 0 is kCrc32Table.
+struct SliceTables {
+    uint32_t t[16][256];
+
+    SliceTables() {
+        for (int i = 0; i < 256; ++i)
+            t[0][i] = kCrc32Table[i];
+
+        for (int i = 0; i < 256; ++i)
+            for (int k = 1; k < 16; ++k)
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+    }
+};
+
+const SliceTables &slice_tables() {
+    static const SliceTables tables;
+    return tables;
+}
+
+/// Load four bytes as a little-endian word, regardless of host byte order.
+inline uint32_t load_le32(const uint8_t *p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+uint32_t update_bytewise(uint32_t crc, const uint8_t *data, size_t length) {
+    while (length--)
+        crc = (crc >> 8) ^ kCrc32Table[(crc ^ *data++) & 0xff];
+    return crc;
+}
+
+uint32_t update_slice8(uint32_t crc, const uint8_t *data, size_t length) {
+    const uint32_t(*t)[256] = slice_tables().t;
+
+    while (length >= 8) {
+        uint32_t one = load_le32(data) ^ crc;
+        uint32_t two = load_le32(data + 4);
+        crc = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^ t[5][(one >> 16) & 0xff] ^ t[4][one >> 24] ^
+              t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^ t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+        data += 8;
+        length -= 8;
+    }
+
+    return update_bytewise(crc, data, length);
+}
+
+uint32_t update_slice16(uint32_t crc, const uint8_t *data, size_t length) {
+    const uint32_t(*t)[256] = slice_tables().t;
+
+    while (length >= 16) {
+        uint32_t one = load_le32(data) ^ crc;
+        uint32_t two = load_le32(data + 4);
+        uint32_t three = load_le32(data + 8);
+        uint32_t four = load_le32(data + 12);
+        crc = t[15][one & 0xff] ^ t[14][(one >> 8) & 0xff] ^ t[13][(one >> 16) & 0xff] ^ t[12][one >> 24] ^
+              t[11][two & 0xff] ^ t[10][(two >> 8) & 0xff] ^ t[9][(two >> 16) & 0xff] ^ t[8][two >> 24] ^
+              t[7][three & 0xff] ^ t[6][(three >> 8) & 0xff] ^ t[5][(three >> 16) & 0xff] ^ t[4][three >> 24] ^
+              t[3][four & 0xff] ^ t[2][(four >> 8) & 0xff] ^ t[1][(four >> 16) & 0xff] ^ t[0][four >> 24];
+        data += 16;
+        length -= 16;
+    }
+
+    return update_slice8(crc, data, length);
+}
+
+#if CRC32_HAVE_PCLMUL_KERNEL
+
+bool query_cpu_pclmul() {
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+
+    return (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+}
+
+// cpuid can be slow (it traps under some hypervisors), so ask only once.
+bool cpu_has_pclmul() {
+    static const bool has_pclmul = query_cpu_pclmul();
+    return has_pclmul;
+}
+
+/**
+ * Fold a buffer whose length is a multiple of 16 and at least 64 bytes.
+ */
+__attribute__((target("pclmul,sse4.1"))) uint32_t fold_pclmul(uint32_t crc, const uint8_t *buf, size_t len) {
+    alignas(16) static const uint64_t k1k2[] = {0x0154442bd4, 0x01c6e41596};
+    alignas(16) static const uint64_t k3k4[] = {0x01751997d0, 0x00ccaa009e};
+    alignas(16) static const uint64_t k5k0[] = {0x0163cd6124, 0x0000000000};
+    alignas(16) static const uint64_t poly[] = {0x01db710641, 0x01f7011641};
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 0x00));
+    x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 0x10));
+    x3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 0x20));
+    x4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 0x30));
+
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(k1k2));
+
+    buf += 64;
+    len -= 64;
+
+    // Fold four 128-bit lanes in parallel, 64 bytes at a time.
+    while (len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+        y5 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 0x00));
+        y6 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 0x10));
+        y7 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 0x20));
+        y8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 0x30));
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+        buf += 64;
+        len -= 64;
+    }
+
+    // Fold the four lanes into one.
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(k3k4));
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // Single folds for any remaining 16-byte blocks.
+    while (len >= 16) {
+        x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf));
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+        buf += 16;
+        len -= 16;
+    }
+
+    // 128 -> 64 bits.
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+
+    x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(k5k0));
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits.
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(poly));
+
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+uint32_t update_pclmul(uint32_t crc, const uint8_t *data, size_t length) {
+    if (length >= 64) {
+        size_t chunk = length & ~size_t(15);
+        crc = fold_pclmul(crc, data, chunk);
+        data += chunk;
+        length -= chunk;
+    }
+
+    return update_slice8(crc, data, length);
+}
+
+#endif // CRC32_HAVE_PCLMUL_KERNEL
+
+/// Multiply a and b modulo the (reflected) CRC-32 polynomial.
+uint32_t multmodp(uint32_t a, uint32_t b) {
+    uint32_t m = 1U << 31;
+    uint32_t p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ 0xedb88320 : b >> 1;
+    }
+    return p;
+}
+
+/// x^(2^k) modulo the CRC-32 polynomial, for k = 0, ..., 31.
+struct X2nTable {
+    uint32_t t[32];
+
+    X2nTable() {
+        uint32_t p = 1U << 30; // x^1
+        t[0] = p;
+        for (int n = 1; n < 32; ++n)
+            t[n] = p = multmodp(p, p);
+    }
+};
+
+/// x^(n * 2^k) modulo the CRC-32 polynomial.
+uint32_t x2nmodp(uint64_t n, unsigned int k) {
+    static const X2nTable x2n;
+    uint32_t p = 1U << 31; // x^0
+    while (n) {
+        if (n & 1)
+            p = multmodp(x2n.t[k & 31], p);
+        n >>= 1;
+        k++;
+    }
+    return p;
+}
+
+typedef uint32_t (*crc32_update_fn)(uint32_t, const uint8_t *, size_t);
+
+crc32_update_fn engine_function(Crc32Engine engine) {
+    switch (engine) {
+    case crc32_bytewise:
+        return update_bytewise;
+    case crc32_slice8:
+        return update_slice8;
+    case crc32_slice16:
+        return update_slice16;
+    case crc32_pclmul:
+#if CRC32_HAVE_PCLMUL_KERNEL
+        if (cpu_has_pclmul())
+            return update_pclmul;
+#endif
+        return nullptr;
+    }
+
+    return nullptr;
+}
+
+} // namespace
+
+/**
+ * @brief Is a given CRC-32 engine usable on this host?
+ * The table-driven engines are always available; the PCLMUL engine needs an
+ * x86 CPU with the PCLMULQDQ and SSE4.1 instructions.
+ */
+bool crc32_engine_available(Crc32Engine engine) { return engine_function(engine) != nullptr; }
+
+/**
+ * @brief The engine Crc32::AddData() uses
+ * This is chosen once, at the first call, based on the host CPU.
+ */
+Crc32Engine crc32_best_engine() {
+    static const Crc32Engine best = crc32_engine_available(crc32_pclmul) ? crc32_pclmul : crc32_slice16;
+    return best;
+}
+
+/// Name of an engine, for diagnostics and benchmarks.
+const char *crc32_engine_name(Crc32Engine engine) {
+    switch (engine) {
+    case crc32_bytewise:
+        return "bytewise";
+    case crc32_slice8:
+        return "slice-by-8";
+    case crc32_slice16:
+        return "slice-by-16";
+    case crc32_pclmul:
+        return "pclmul";
+    }
+
+    return "unknown";
+}
+
+/**
+ * @brief Update a raw CRC-32 register using the fastest available engine.
+ *
+ * @param crc The CRC register. This is the un-inverted value; Crc32 starts
+ * it at ~0 and inverts it again when the checksum is read.
+ * @param data The bytes to add
+ * @param length The number of bytes
+ * @return The new value of the register.
+ */
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t length) {
+    static const crc32_update_fn update = engine_function(crc32_best_engine());
+    return update(crc, data, length);
+}
+
+/**
+ * @brief Update a raw CRC-32 register using a specific engine.
+ *
+ * If the engine is not available on this host, the slice-by-16 engine is
+ * used. This is meant for tests and benchmarks.
+ */
+uint32_t crc32_update(Crc32Engine engine, uint32_t crc, const uint8_t *data, size_t length) {
+    crc32_update_fn update = engine_function(engine);
+    if (!update)
+        update = update_slice16;
+    return update(crc, data, length);
+}
+
+/**
+ * @brief Combine the checksums of two consecutive blocks of data.
+ *
+ * @param crc1 The checksum (Crc32::GetCrc32()) of the first block
+ * @param crc2 The checksum of the second block
+ * @param len2 The length of the second block in bytes
+ * @return The checksum of the first block followed by the second.
+ */
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2) { return multmodp(x2nmodp(len2, 3), crc1) ^ crc2; }
+
+/**
+ * @brief Update a raw CRC-32 register using several threads.
+ *
+ * The data are split into at most 'threads' segments, each at least
+ * 'min_segment' bytes long. The CRC of each segment is computed on its own
+ * thread and the results are joined with crc32_combine(). The value is the
+ * same as crc32_update() returns; data too small to split are done by
+ * crc32_update() on the calling thread.
+ *
+ * @param crc The CRC register (see crc32_update())
+ * @param data The bytes to add
+ * @param length The number of bytes
+ * @param threads The most threads to use, including the calling thread
+ * @param min_segment The smallest segment worth a thread
+ * @return The new value of the register.
+ */
+uint32_t crc32_update_parallel(uint32_t crc, const uint8_t *data, size_t length, unsigned int threads,
+                               size_t min_segment) {
+    size_t segments = min_segment > 0 ? length / min_segment : length;
+    if (segments > threads)
+        segments = threads;
+    if (segments < 2)
+        return crc32_update(crc, data, length);
+
+    const size_t seg_len = length / segments;
+
+    // Segments 1, ..., n-1 go to other threads; the last one holds the remainder.
+    std::vector<std::future<uint32_t>> partial;
+    partial.reserve(segments - 1);
+    for (size_t i = 1; i < segments; ++i) {
+        const uint8_t *start = data + i * seg_len;
+        size_t len = i + 1 < segments ? seg_len : length - i * seg_len;
+        partial.emplace_back(
+            std::async(std::launch::async, [start, len]() { return ~crc32_update(~0U, start, len); }));
+    }
+
+    // The calling thread does the first segment, which continues from 'crc'.
+    uint32_t result = ~crc32_update(crc, data, seg_len);
+    for (size_t i = 1; i < segments; ++i) {
+        size_t len = i + 1 < segments ? seg_len : length - i * seg_len;
+        result = crc32_combine(result, partial[i - 1].get(), len);
+    }
+
+    return ~result;
+}
+
+} // namespace libdap
@@ -6,6 +6,7 @@
 #ifndef CRC_H_
 #define CRC_H_
 
+#include <cstddef>
 #include <cstdint>
 
 static const uint32_t kCrc32Table[256] = {
@@ -40,6 +41,38 @@ static const uint32_t kCrc32Table[256] = {
     0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d,
 }; // kCrc32Table
 
+namespace libdap {
+
+/**
+ * @brief The CRC-32 implementations that can sit behind Crc32::AddData().
+ *
+ * All of these compute the same (IEEE 802.3, reflected) CRC-32; they differ
+ * only in speed. The byte-at-a-time engine is the original algorithm and is
+ * kept as the reference implementation.
+ */
+enum Crc32Engine {
+    crc32_bytewise, ///< One byte per iteration using kCrc32Table
+    crc32_slice8,   ///< Slice-by-8, eight bytes per iteration
+    crc32_slice16,  ///< Slice-by-16, sixteen bytes per iteration
+    crc32_pclmul    ///< Carry-less multiply folding (x86 PCLMULQDQ + SSE4.1)
+};
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t length);
+uint32_t crc32_update(Crc32Engine engine, uint32_t crc, const uint8_t *data, size_t length);
+
+/// Below this many bytes per segment, crc32_update_parallel() does not start another thread.
+const size_t CRC32_PARALLEL_MIN_SEGMENT = 4 * 1024 * 1024;
+
+uint32_t crc32_update_parallel(uint32_t crc, const uint8_t *data, size_t length, unsigned int threads,
+                               size_t min_segment = CRC32_PARALLEL_MIN_SEGMENT);
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+bool crc32_engine_available(Crc32Engine engine);
+Crc32Engine crc32_best_engine();
+const char *crc32_engine_name(Crc32Engine engine);
+
+} // namespace libdap
+
 /** @brief Incremental CRC-32 checksum calculator. */
 class Crc32 {
 public:
@@ -59,15 +92,27 @@ public:
      */
     void Reset() { _crc = (uint32_t)~0; }
 
+    /**
+     * Use up to 'threads' threads for large calls to AddData(). The checksum
+     * is the same; see libdap::crc32_update_parallel(). Reset() does not
+     * change this.
+     * @param threads The number of threads; 0 or 1 computes the CRC serially.
+     */
+    void SetThreads(unsigned int threads) { _threads = threads; }
+
+    /// The number of threads AddData() may use.
+    unsigned int GetThreads() const { return _threads; }
+
     /**
      * Add new data, incrementally computing the CRC 32 checksum. If
      * length is zero, calling this has no effect on the checksum.
+     *
+     * @note The work is done by the fastest engine the host CPU supports;
+     * see libdap::crc32_best_engine().
      */
-    void AddData(const uint8_t *pData, const uint32_t length) {
-        uint8_t *pCur = (uint8_t *)pData;
-        uint32_t remaining = length;
-        for (; remaining--; ++pCur)
-            _crc = (_crc >> 8) ^ kCrc32Table[(_crc ^ *pCur) & 0xff];
+    void AddData(const uint8_t *pData, const size_t length) {
+        _crc = _threads > 1 ? libdap::crc32_update_parallel(_crc, pData, length, _threads)
+                            : libdap::crc32_update(_crc, pData, length);
     }
 
     /**
@@ -78,6 +123,7 @@ public:
 
 private:
     uint32_t _crc;
+    unsigned int _threads = 1;
 };
 
 #endif /* CRC_H_ */
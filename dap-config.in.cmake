@@ -10,7 +10,7 @@ libdir="${prefix}/lib"
 libdir64=${prefix}/lib64
 
 cflags="-I${includedir} -I${includedir}/libdap @CURL_PKG_CFLAGS@ @XML2_PKG_CFLAGS@ @TIRPC_PKG_CFLAGS@"
-libs="-L${libdir} -L${libdir64} -ldap -ldapclient -ldapserver @CURL_PKG_LIBS@ @XML2_PKG_LIBS@ @TIRPC_PKG_LIBS@"
+libs="-L${libdir} -L${libdir64} -ldap -ldapclient -ldapserver @CURL_PKG_LIBS@ @XML2_PKG_LIBS@ @TIRPC_PKG_LIBS@ -lz"
 
 # may need to add  @PTHREAD_LIBRARIES@ @UUID_LIB@ 6/25/25 jhrg
 
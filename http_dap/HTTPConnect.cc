@@ -51,6 +51,7 @@
 #include "HTTPConnect.h"
 #include "HTTPResponse.h"
 #include "RCReader.h"
+#include "chunked_stream.h"
 #include "debug.h"
 #include "mime_util.h"
 
@@ -902,6 +903,27 @@ void HTTPConnect::set_accept_deflate(bool deflate) {
     }
 }
 
+/** Set the <em>accept chunk compression</em> property. When set, requests
+    include the CHUNK_COMPRESSION_HEADER header, telling a DAP4 server that
+    this client can read chunked responses whose chunks are compressed (see
+    chunked_stream.h). Unlike <em>accept deflate</em>, this does not compress
+    the response as a whole.
+
+    @param compression True sets the property, False clears it. */
+void HTTPConnect::set_accept_chunk_compression(bool compression) {
+    lock_guard<mutex> lock(d_connect_mutex);
+
+    d_accept_chunk_compression = compression;
+
+    vector<string>::iterator i = find(d_request_headers.begin(), d_request_headers.end(), CHUNK_COMPRESSION_HEADER);
+    if (d_accept_chunk_compression) {
+        if (i == d_request_headers.end())
+            d_request_headers.emplace_back(CHUNK_COMPRESSION_HEADER);
+    } else if (i != d_request_headers.end()) {
+        d_request_headers.erase(i);
+    }
+}
+
 /** Set the <em>xdap_accept</em> property/HTTP-header. This sets the value
     of the DAP which the client advertises to servers that it understands.
     The information (client protocol major and minor versions) are recorded
@@ -58,7 +58,8 @@ private:
     char d_error_buffer[CURL_ERROR_SIZE]{}; // A human-readable message.
     std::string d_content_type;             // apparently read by libcurl; this is valid only after curl_easy_perform()
 
-    bool d_accept_deflate = false; // Use deflate encoding for HTTP requests
+    bool d_accept_deflate = false;           // Use deflate encoding for HTTP requests
+    bool d_accept_chunk_compression = false; // Accept compressed DAP4 chunks
 
     std::string d_username; // extracted from URL
     std::string d_password; // extracted from URL
@@ -126,6 +127,8 @@ public:
 
     void set_accept_deflate(bool deflate);
 
+    void set_accept_chunk_compression(bool compression);
+
     void set_xdap_protocol(int major, int minor);
 
     /** @brief Returns whether responses should be materialized as C++ streams. */
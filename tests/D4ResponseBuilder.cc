@@ -139,8 +139,9 @@ void D4ResponseBuilder::send_dap(ostream &out, DMR &dmr, bool with_mime_headers,
 
         // now make the chunked output stream; set the size to be at least chunk_size
         // but make sure that the whole of the xml plus the CRLF can fit in the first
-        // chunk. (+2 for the CRLF bytes).
-        chunked_ostream cos(out, max((unsigned int)CHUNK_SIZE, xml.get_doc_size() + 2));
+        // chunk. (+2 for the CRLF bytes). Let the chunks grow while large vectors
+        // are written so big responses don't pay for millions of chunk headers.
+        chunked_ostream cos(out, max((unsigned int)CHUNK_SIZE, xml.get_doc_size() + 2), CHUNK_SIZE_ADAPTIVE_MAX);
 
         // using flush means that the DMR and CRLF are in the first chunk.
         cos << xml.get_doc() << CRLF << flush;
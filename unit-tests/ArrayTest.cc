@@ -26,7 +26,9 @@
 #include <cppunit/extensions/HelperMacros.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
 
+#include <cstdio>
 #include <cstring>
+#include <sstream>
 #include <string>
 
 #include <unistd.h>
@@ -34,13 +36,20 @@
 #include "GNURegex.h"
 
 #include "Array.h"
+#include "Byte.h"
+#include "ConstraintEvaluator.h"
 #include "D4Dimensions.h"
 #include "D4Enum.h"
+#include "D4StreamMarshaller.h"
+#include "DDS.h"
+#include "DMR.h"
 #include "Float32.h"
+#include "Float64.h"
 #include "Int16.h"
 #include "Int64.h"
 #include "Str.h"
 #include "Structure.h"
+#include "XDRStreamMarshaller.h"
 
 #include "run_tests_cppunit.h"
 #include "test_config.h"
@@ -50,6 +59,36 @@ using namespace std;
 
 namespace libdap {
 
+// The bytes of the values of the SlabArray below, starting with byte 'first'
+static void slab_pattern(char *buf, int64_t first, int64_t num_bytes) {
+    for (int64_t i = 0; i < num_bytes; ++i)
+        buf[i] = static_cast<char>((first + i) * 31 % 251);
+}
+
+// An Array whose values are only available a slab at a time. It returns at
+// most 'd_max_per_call' values per call, fewer than it is asked for.
+class SlabArray : public Array {
+    int64_t d_max_per_call;
+
+public:
+    SlabArray(const string &n, BaseType *proto, int64_t size, int64_t max_per_call, bool is_dap4 = true)
+        : Array(n, proto, is_dap4), d_max_per_call(max_per_call) {
+        append_dim_ll(size);
+    }
+
+    BaseType *ptr_duplicate() override { return new SlabArray(*this); }
+
+    bool read() override { throw InternalErr(__FILE__, __LINE__, "read() should not be called."); }
+
+    int64_t read_slab(char *buf, int64_t start, int64_t max_elements) override {
+        int64_t n = std::min(max_elements, d_max_per_call);
+        slab_pattern(buf, start * var()->width_ll(), n * var()->width_ll());
+        return n;
+    }
+
+    void set_max_per_call(int64_t max_per_call) { d_max_per_call = max_per_call; }
+};
+
 class ArrayTest : public TestFixture {
 private:
     Array *d_cardinal = nullptr;
@@ -151,9 +190,46 @@ public:
     CPPUNIT_TEST(duplicate_structure_test);
     CPPUNIT_TEST(zero_length_array_test);
     CPPUNIT_TEST(deep_copy_cardinal_test);
+    CPPUNIT_TEST(slab_serialize_test);
+    CPPUNIT_TEST(slab_serialize_fd_test);
+    CPPUNIT_TEST(slab_serialize_error_test);
+    CPPUNIT_TEST(slab_serialize_dap2_test);
 
     CPPUNIT_TEST_SUITE_END();
 
+    // Serialize 'a' as D4Group does for a top-level variable
+    string serialize_with_checksum(Array &a) {
+        DMR dmr;
+        ostringstream oss;
+        D4StreamMarshaller m(oss, true, true);
+        m.reset_checksum();
+        a.serialize(m, dmr);
+        m.put_checksum();
+        return oss.str();
+    }
+
+    string serialize_dap2(Array &a) {
+        ConstraintEvaluator eval;
+        DDS dds(nullptr);
+        ostringstream oss;
+        {
+            XDRStreamMarshaller m(oss);
+            a.serialize(eval, dds, m, false);
+        } // wait for the writer thread
+        return oss.str();
+    }
+
+    // The same values, all read at once
+    string expected_response(BaseType *proto, int64_t size, bool is_dap4 = true) {
+        Array a("a", proto, is_dap4);
+        a.append_dim_ll(size);
+        vector<char> vals(size * proto->width_ll());
+        slab_pattern(vals.data(), 0, vals.size());
+        a.val2buf(vals.data());
+        a.set_read_p(true);
+        return is_dap4 ? serialize_with_checksum(a) : serialize_dap2(a);
+    }
+
     void cons_test() {
         Array a1 = Array("a", "b", d_int16, true);
         CPPUNIT_ASSERT(a1.name() == "a");
@@ -416,6 +492,80 @@ public:
         delete[] b2;
         b2 = 0;
     }
+
+    void slab_serialize_test() {
+        const string expected = expected_response(new Float32("a"), 1000);
+
+        SlabArray a("a", new Float32("a"), 1000, 37);
+        a.set_slab_size(64);
+        CPPUNIT_ASSERT_EQUAL(static_cast<int64_t>(64), a.get_slab_size());
+        CPPUNIT_ASSERT(serialize_with_checksum(a) == expected);
+
+        // Slabs larger than the array
+        a.set_slab_size(5000);
+        a.set_max_per_call(5000);
+        CPPUNIT_ASSERT(serialize_with_checksum(a) == expected);
+
+        // The copy streams too; its read() would throw
+        SlabArray b(a);
+        CPPUNIT_ASSERT_EQUAL(static_cast<int64_t>(5000), b.get_slab_size());
+        CPPUNIT_ASSERT(serialize_with_checksum(b) == expected);
+    }
+
+    // A marshaller writing to a file descriptor must not see the reused slab buffer change
+    void slab_serialize_fd_test() {
+        const string expected = expected_response(new Float32("a"), 1000);
+
+        FILE *fp = tmpfile();
+        CPPUNIT_ASSERT(fp);
+        {
+            SlabArray a("a", new Float32("a"), 1000, 100);
+            a.set_slab_size(100);
+            DMR dmr;
+            D4StreamMarshaller m(fileno(fp), true, true);
+            m.reset_checksum();
+            a.serialize(m, dmr);
+            m.put_checksum();
+        }
+        rewind(fp);
+        vector<char> buf(expected.size() + 1);
+        size_t n = fread(buf.data(), 1, buf.size(), fp);
+        fclose(fp);
+        CPPUNIT_ASSERT_EQUAL(expected.size(), n);
+        CPPUNIT_ASSERT(string(buf.data(), n) == expected);
+    }
+
+    void slab_serialize_error_test() {
+        SlabArray a("a", new Float32("a"), 10, 0);
+        a.set_slab_size(4);
+        CPPUNIT_ASSERT_THROW(serialize_with_checksum(a), InternalErr);
+
+        Array plain("plain", new Float32("plain"), true);
+        plain.append_dim(10);
+        plain.set_slab_size(4);
+        CPPUNIT_ASSERT_THROW(serialize_with_checksum(plain), InternalErr);
+    }
+
+    // Byte vectors are padded; Int16 values are widened. Odd sizes and slabs test both.
+    void slab_serialize_dap2_test() {
+        for (int64_t size : {1, 1001}) {
+            DBG(cerr << "slab_serialize_dap2_test, size: " << size << endl);
+            const string bytes = expected_response(new Byte("a"), size, false);
+            SlabArray b("a", new Byte("a"), size, 33, false);
+            b.set_slab_size(100);
+            CPPUNIT_ASSERT(serialize_dap2(b) == bytes);
+
+            const string shorts = expected_response(new Int16("a"), size, false);
+            SlabArray s("a", new Int16("a"), size, 33, false);
+            s.set_slab_size(100);
+            CPPUNIT_ASSERT(serialize_dap2(s) == shorts);
+
+            const string doubles = expected_response(new Float64("a"), size, false);
+            SlabArray d("a", new Float64("a"), size, 1000, false);
+            d.set_slab_size(7);
+            CPPUNIT_ASSERT(serialize_dap2(d) == doubles);
+        }
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(ArrayTest);
@@ -137,6 +137,7 @@ public:
     CPPUNIT_TEST(get_attr_iter_test);
     CPPUNIT_TEST(del_attr_table_test);
     CPPUNIT_TEST(append_attr_vector_test);
+    CPPUNIT_TEST(large_table_test);
     CPPUNIT_TEST(print_xml_test);
     CPPUNIT_TEST(print_simple_test);
 
@@ -432,6 +433,37 @@ String longer%20name \"\\\"second test\\\"\";";
         CPPUNIT_ASSERT(cont_a->get_attr_num("size") == 3);
     }
 
+    // Large tables are searched with an index; the results must be the
+    // same as the linear search's.
+    void large_table_test() {
+        AttrTable at;
+        for (int i = 0; i < 100; ++i)
+            at.append_attr("x" + to_string(i), "Int32", to_string(i));
+        AttrTable *sub = at.append_container("sub");
+        sub->append_attr("x5", "Int32", "-5");
+        sub->append_attr("only_sub", "String", "s");
+
+        CPPUNIT_ASSERT_EQUAL(string("42"), at.get_attr("x42"));
+        CPPUNIT_ASSERT_EQUAL(string("x99"), (*at.simple_find("x99"))->name);
+        CPPUNIT_ASSERT(at.simple_find("x100") == at.attr_end());
+        CPPUNIT_ASSERT(at.simple_find_container("sub") == sub);
+        CPPUNIT_ASSERT(!at.simple_find_container("x7"));
+
+        AttrTable::Attr_iter i;
+        CPPUNIT_ASSERT(at.recurrsive_find("x5", &i) == &at);
+        CPPUNIT_ASSERT_EQUAL(string("5"), (*i)->attr->at(0));
+        CPPUNIT_ASSERT(at.recurrsive_find("only_sub", &i) == sub);
+        CPPUNIT_ASSERT(!at.recurrsive_find("missing", &i));
+
+        at.append_attr("x42", "Int32", "43"); // adds a value to the existing attribute
+        CPPUNIT_ASSERT_EQUAL(2U, at.get_attr_num("x42"));
+
+        at.del_attr("x10");
+        CPPUNIT_ASSERT(at.simple_find("x10") == at.attr_end());
+        at.append_attr("x10", "Int32", "10");
+        CPPUNIT_ASSERT(at.simple_find("x10") == at.attr_end() - 1);
+    }
+
     void print_xml_test() {
         ostringstream sof;
         at1->print_xml(sof);
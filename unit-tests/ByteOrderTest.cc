@@ -0,0 +1,263 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Array.h"
+#include "Float64.h"
+#include "Int16.h"
+#include "XDRFileUnMarshaller.h"
+#include "XDRStreamMarshaller.h"
+#include "XDRStreamUnMarshaller.h"
+#include "XDRUtils.h"
+#include "byte_order.h"
+#include "util.h"
+
+#include "run_tests_cppunit.h"
+
+using namespace CppUnit;
+using namespace libdap;
+using namespace std;
+
+class ByteOrderTest : public TestFixture {
+    vector<char> d_data;
+
+    // Encode with the xdr library; the result includes xdr_array()'s element count.
+    static vector<char> xdr_reference(const char *val, unsigned int num, int width, Type type) {
+        unsigned int size = num * (width < 4 ? 4 : width) + 4;
+        vector<char> buf(size);
+        XDR sink;
+        xdrmem_create(&sink, buf.data(), size, XDR_ENCODE);
+        char *v = const_cast<char *>(val);
+        bool ok = xdr_array(&sink, &v, &num, size, width, XDRUtils::xdr_coder(type));
+        xdr_destroy(&sink);
+        CPPUNIT_ASSERT(ok);
+        return buf;
+    }
+
+    static bool is_signed(Type type) { return type == dods_int16_c || type == dods_int32_c; }
+
+    CPPUNIT_TEST_SUITE(ByteOrderTest);
+    CPPUNIT_TEST(test_encode_matches_xdr);
+    CPPUNIT_TEST(test_widen_bytes);
+    CPPUNIT_TEST(test_byte_swap_in_place);
+    CPPUNIT_TEST(test_marshaller_matches_xdr);
+    CPPUNIT_TEST(test_decode_matches_xdr);
+    CPPUNIT_TEST(test_unmarshallers_round_trip);
+    CPPUNIT_TEST(test_best_engine_is_available);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp() override {
+        d_data.resize(8 * 1100);
+        uint32_t x = 0x9e3779b9;
+        for (auto &b : d_data) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            b = static_cast<char>(x);
+        }
+    }
+
+    // Every engine, for every type xdr_coder() knows, over lengths that leave
+    // tails and from unaligned starts, must produce exactly what xdr does.
+    void test_encode_matches_xdr() {
+        const unsigned int lengths[] = {1, 3, 7, 8, 9, 15, 16, 17, 33, 1000};
+        const Type types[] = {dods_int16_c, dods_uint16_c, dods_int32_c, dods_uint32_c, dods_float32_c, dods_float64_c};
+        const int widths[] = {2, 2, 4, 4, 4, 8};
+
+        for (ByteOrderEngine engine : {byte_order_scalar, byte_order_sse2, byte_order_avx2}) {
+            if (!byte_order_engine_available(engine))
+                continue;
+            for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); ++t) {
+                for (size_t offset = 0; offset < 3; ++offset) {
+                    for (unsigned int num : lengths) {
+                        DBG(cerr << byte_order_engine_name(engine) << ", " << type_name(types[t]) << ", offset: "
+                                 << offset << ", num: " << num << endl);
+                        const char *val = d_data.data() + offset;
+                        vector<char> expected = xdr_reference(val, num, widths[t], types[t]);
+
+                        vector<char> actual(expected.size() - 4);
+                        xdr_encode_vector(engine, actual.data(), val, num, widths[t], is_signed(types[t]));
+                        CPPUNIT_ASSERT(memcmp(expected.data() + 4, actual.data(), actual.size()) == 0);
+                    }
+                }
+            }
+        }
+    }
+
+    // There is no xdr filter for Byte arrays; check the widening against xdr_int/xdr_u_int.
+    void test_widen_bytes() {
+        const unsigned int num = 100;
+        for (bool sign : {true, false}) {
+            vector<char> expected(num * 4);
+            XDR sink;
+            xdrmem_create(&sink, expected.data(), expected.size(), XDR_ENCODE);
+            for (unsigned int i = 0; i < num; ++i) {
+                if (sign) {
+                    int v = static_cast<signed char>(d_data[i]);
+                    CPPUNIT_ASSERT(xdr_int(&sink, &v));
+                } else {
+                    unsigned int v = static_cast<unsigned char>(d_data[i]);
+                    CPPUNIT_ASSERT(xdr_u_int(&sink, &v));
+                }
+            }
+            xdr_destroy(&sink);
+
+            for (ByteOrderEngine engine : {byte_order_scalar, byte_order_sse2, byte_order_avx2}) {
+                vector<char> actual(num * 4);
+                xdr_encode_vector(engine, actual.data(), d_data.data(), num, 1, sign);
+                CPPUNIT_ASSERT(expected == actual);
+            }
+        }
+    }
+
+    void test_byte_swap_in_place() {
+        for (int width : {2, 4, 8}) {
+            for (ByteOrderEngine engine : {byte_order_scalar, byte_order_sse2, byte_order_avx2}) {
+                const size_t num = 77;
+                vector<char> buf(d_data.begin(), d_data.begin() + num * width);
+                byte_swap(engine, buf.data(), buf.data(), num, width);
+                for (size_t i = 0; i < num; ++i)
+                    for (int b = 0; b < width; ++b)
+                        CPPUNIT_ASSERT_EQUAL(d_data[i * width + b], buf[i * width + width - 1 - b]);
+            }
+        }
+    }
+
+    // The marshaller reuses its vector buffers; several vectors of different
+    // sizes, in order, must still come out as xdr would write them.
+    void test_marshaller_matches_xdr() {
+        Int16 i16_proto("i16");
+        Array i16("i16", &i16_proto);
+        Float64 f64_proto("f64");
+        Array f64("f64", &f64_proto);
+
+        const unsigned int sizes[] = {1000, 17, 600, 3};
+        string expected;
+        ostringstream oss;
+        {
+            XDRStreamMarshaller m(oss);
+            for (unsigned int num : sizes) {
+                m.put_vector(d_data.data(), num, 2, i16);
+                m.put_vector(d_data.data() + 1, num, 8, f64);
+
+                for (auto args : {make_pair(2, dods_int16_c), make_pair(8, dods_float64_c)}) {
+                    const char *val = args.first == 2 ? d_data.data() : d_data.data() + 1;
+                    vector<char> count(4);
+                    XDR sink;
+                    xdrmem_create(&sink, count.data(), 4, XDR_ENCODE);
+                    int n = num;
+                    CPPUNIT_ASSERT(xdr_int(&sink, &n));
+                    xdr_destroy(&sink);
+                    expected.append(count.data(), 4);
+                    vector<char> body = xdr_reference(val, num, args.first, args.second);
+                    expected.append(body.data(), body.size());
+                }
+            }
+        } // The marshaller's dtor waits for the writer thread
+
+        CPPUNIT_ASSERT_EQUAL(expected.size(), oss.str().size());
+        CPPUNIT_ASSERT(expected == oss.str());
+    }
+
+    // Decode what xdr_array() wrote, both into a separate buffer and in place.
+    void test_decode_matches_xdr() {
+        const unsigned int lengths[] = {1, 7, 8, 9, 16, 17, 33, 1000};
+        const Type types[] = {dods_int16_c, dods_uint16_c, dods_int32_c, dods_float64_c};
+        const int widths[] = {2, 2, 4, 8};
+
+        for (ByteOrderEngine engine : {byte_order_scalar, byte_order_sse2, byte_order_avx2}) {
+            for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); ++t) {
+                for (unsigned int num : lengths) {
+                    const char *val = d_data.data() + 1;
+                    vector<char> encoded = xdr_reference(val, num, widths[t], types[t]);
+
+                    vector<char> actual(num * widths[t]);
+                    xdr_decode_vector(engine, actual.data(), encoded.data() + 4, num, widths[t]);
+                    CPPUNIT_ASSERT(memcmp(val, actual.data(), actual.size()) == 0);
+
+                    xdr_decode_vector(engine, encoded.data() + 4, encoded.data() + 4, num, widths[t]);
+                    CPPUNIT_ASSERT(memcmp(val, encoded.data() + 4, actual.size()) == 0);
+                }
+            }
+        }
+    }
+
+    // Both unmarshallers read the vectors XDRStreamMarshaller writes. The
+    // Int16 vector is big enough to be narrowed in several pieces.
+    void test_unmarshallers_round_trip() {
+        Int16 i16_proto("i16");
+        Array i16("i16", &i16_proto);
+        Float64 f64_proto("f64");
+        Array f64("f64", &f64_proto);
+        const unsigned int n16 = 40000, n64 = 1000;
+        vector<char> data16(n16 * 2);
+        for (size_t i = 0; i < data16.size(); ++i)
+            data16[i] = d_data[i % d_data.size()];
+
+        ostringstream oss;
+        {
+            XDRStreamMarshaller m(oss);
+            m.put_vector(data16.data(), n16, 2, i16);
+            m.put_vector(d_data.data(), n64, 8, f64);
+        }
+        const string encoded = oss.str();
+
+        vector<char> buf16(n16 * 2), buf64(n64 * 8);
+        {
+            istringstream iss(encoded);
+            XDRStreamUnMarshaller um(iss);
+            int n;
+            unsigned int num;
+            char *p16 = buf16.data(), *p64 = buf64.data();
+            um.get_int(n);
+            um.get_vector(&p16, num, 2, i16);
+            CPPUNIT_ASSERT_EQUAL(n16, num);
+            um.get_int(n);
+            um.get_vector(&p64, num, 8, f64);
+            CPPUNIT_ASSERT_EQUAL(n64, num);
+            CPPUNIT_ASSERT(memcmp(data16.data(), buf16.data(), buf16.size()) == 0);
+            CPPUNIT_ASSERT(memcmp(d_data.data(), buf64.data(), buf64.size()) == 0);
+        }
+
+        buf16.assign(buf16.size(), 0);
+        buf64.assign(buf64.size(), 0);
+        {
+            FILE *fp = tmpfile();
+            CPPUNIT_ASSERT(fp);
+            CPPUNIT_ASSERT_EQUAL(encoded.size(), fwrite(encoded.data(), 1, encoded.size(), fp));
+            rewind(fp);
+            {
+                XDRFileUnMarshaller um(fp);
+                int n;
+                unsigned int num;
+                char *p16 = buf16.data(), *p64 = buf64.data();
+                um.get_int(n);
+                um.get_vector(&p16, num, 2, i16);
+                CPPUNIT_ASSERT_EQUAL(n16, num);
+                um.get_int(n);
+                um.get_vector(&p64, num, 8, f64);
+                CPPUNIT_ASSERT_EQUAL(n64, num);
+            }
+            fclose(fp);
+            CPPUNIT_ASSERT(memcmp(data16.data(), buf16.data(), buf16.size()) == 0);
+            CPPUNIT_ASSERT(memcmp(d_data.data(), buf64.data(), buf64.size()) == 0);
+        }
+    }
+
+    void test_best_engine_is_available() { CPPUNIT_ASSERT(byte_order_engine_available(byte_order_best_engine())); }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ByteOrderTest);
+
+int main(int argc, char *argv[]) { return run_tests<ByteOrderTest>(argc, argv) ? 0 : 1; }
@@ -0,0 +1,139 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "crc.h"
+#include "run_tests_cppunit.h"
+
+using namespace CppUnit;
+using namespace libdap;
+using namespace std;
+
+class Crc32Test : public TestFixture {
+    vector<uint8_t> d_data;
+
+    static uint32_t reference(const uint8_t *data, size_t len) {
+        return ~crc32_update(crc32_bytewise, ~0U, data, len);
+    }
+
+    CPPUNIT_TEST_SUITE(Crc32Test);
+    CPPUNIT_TEST(test_check_value);
+    CPPUNIT_TEST(test_empty);
+    CPPUNIT_TEST(test_engines_match_bytewise);
+    CPPUNIT_TEST(test_incremental_matches_whole);
+    CPPUNIT_TEST(test_best_engine_is_available);
+    CPPUNIT_TEST(test_combine);
+    CPPUNIT_TEST(test_parallel_matches_serial);
+    CPPUNIT_TEST(test_threads);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp() override {
+        d_data.resize(70000);
+        uint32_t x = 0x12345678;
+        for (auto &b : d_data) {
+            // xorshift; any deterministic non-trivial pattern will do
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            b = static_cast<uint8_t>(x);
+        }
+    }
+
+    // The standard CRC-32 check value.
+    void test_check_value() {
+        const string s = "123456789";
+        Crc32 crc;
+        crc.AddData(reinterpret_cast<const uint8_t *>(s.data()), s.size());
+        CPPUNIT_ASSERT_EQUAL(static_cast<Crc32::checksum>(0xCBF43926), crc.GetCrc32());
+    }
+
+    void test_empty() {
+        Crc32 crc;
+        crc.AddData(d_data.data(), 0);
+        CPPUNIT_ASSERT_EQUAL(static_cast<Crc32::checksum>(0), crc.GetCrc32());
+    }
+
+    // Every engine, over odd lengths and unaligned starts, must match the original algorithm.
+    void test_engines_match_bytewise() {
+        const size_t lengths[] = {1, 3, 7, 8, 15, 16, 17, 63, 64, 65, 127, 128, 200, 4096, 4099, 65536};
+        for (Crc32Engine engine : {crc32_slice8, crc32_slice16, crc32_pclmul}) {
+            if (!crc32_engine_available(engine))
+                continue;
+            for (size_t offset = 0; offset < 8; ++offset) {
+                for (size_t len : lengths) {
+                    DBG(cerr << crc32_engine_name(engine) << ", offset: " << offset << ", length: " << len << endl);
+                    uint32_t expected = reference(d_data.data() + offset, len);
+                    uint32_t actual = ~crc32_update(engine, ~0U, d_data.data() + offset, len);
+                    CPPUNIT_ASSERT_EQUAL(expected, actual);
+                }
+            }
+        }
+    }
+
+    void test_incremental_matches_whole() {
+        Crc32 whole;
+        whole.AddData(d_data.data(), d_data.size());
+        CPPUNIT_ASSERT_EQUAL(reference(d_data.data(), d_data.size()), whole.GetCrc32());
+
+        Crc32 parts;
+        size_t pos = 0, step = 1;
+        while (pos < d_data.size()) {
+            size_t len = min(step, d_data.size() - pos);
+            parts.AddData(d_data.data() + pos, len);
+            pos += len;
+            step = step * 3 + 1;
+        }
+        CPPUNIT_ASSERT_EQUAL(whole.GetCrc32(), parts.GetCrc32());
+    }
+
+    void test_best_engine_is_available() { CPPUNIT_ASSERT(crc32_engine_available(crc32_best_engine())); }
+
+    void test_combine() {
+        for (size_t split : {size_t(0), size_t(1), size_t(5), size_t(4096), size_t(69999), size_t(70000)}) {
+            uint32_t crc1 = reference(d_data.data(), split);
+            uint32_t crc2 = reference(d_data.data() + split, d_data.size() - split);
+            CPPUNIT_ASSERT_EQUAL(reference(d_data.data(), d_data.size()),
+                                 crc32_combine(crc1, crc2, d_data.size() - split));
+        }
+    }
+
+    // Small segments so the test data are split many ways, including an uneven last segment.
+    void test_parallel_matches_serial() {
+        for (unsigned int threads : {0, 1, 2, 3, 7, 64}) {
+            for (size_t len : {size_t(10), size_t(2999), size_t(3000), size_t(d_data.size() - 1)}) {
+                DBG(cerr << "threads: " << threads << ", length: " << len << endl);
+                uint32_t expected = crc32_update(0x1234, d_data.data() + 1, len);
+                CPPUNIT_ASSERT_EQUAL(expected, crc32_update_parallel(0x1234, d_data.data() + 1, len, threads, 1000));
+            }
+        }
+    }
+
+    void test_threads() {
+        Crc32 serial;
+        serial.AddData(d_data.data(), 100);
+        serial.AddData(d_data.data() + 100, d_data.size() - 100);
+
+        Crc32 parallel;
+        parallel.SetThreads(4);
+        parallel.AddData(d_data.data(), 100);
+        parallel.AddData(d_data.data() + 100, d_data.size() - 100);
+        CPPUNIT_ASSERT_EQUAL(serial.GetCrc32(), parallel.GetCrc32());
+
+        parallel.Reset();
+        CPPUNIT_ASSERT_EQUAL(4U, parallel.GetThreads());
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Crc32Test);
+
+int main(int argc, char *argv[]) { return run_tests<Crc32Test>(argc, argv) ? 0 : 1; }
@@ -412,6 +412,81 @@ public:
         CPPUNIT_ASSERT_MESSAGE("The attribute should not be present after calling erase()", color == nullptr);
     }
 
+    // Copies of frozen attributes share them until one is changed.
+    void test_freeze() {
+        attrs->add_attribute(&a);
+        attrs->add_attribute(&c2);
+        attrs->freeze();
+        CPPUNIT_ASSERT(attrs->frozen());
+        attrs->print_dap4(*xml);
+        string before = xml->get_doc();
+
+        D4Attributes copy(*attrs);
+        CPPUNIT_ASSERT(copy.frozen());
+        CPPUNIT_ASSERT(copy.attributes()[0] == attrs->attributes()[0]);
+
+        copy.find("first")->add_value("3");
+        CPPUNIT_ASSERT(!copy.frozen());
+        CPPUNIT_ASSERT(copy.attributes()[0] != attrs->attributes()[0]);
+        CPPUNIT_ASSERT_EQUAL(3U, copy.get("first")->num_values());
+        CPPUNIT_ASSERT(attrs->frozen());
+
+        // The nested container is still shared until it is changed
+        CPPUNIT_ASSERT(copy.attributes()[1]->attributes()->frozen());
+        copy.get("container_2.control")->set_name("changed");
+        CPPUNIT_ASSERT(copy.get("container_2.changed"));
+        CPPUNIT_ASSERT(!attrs->attributes()[1]->attributes()->find("changed"));
+
+        XMLWriter after;
+        attrs->print_dap4(after);
+        CPPUNIT_ASSERT_EQUAL(before, string(after.get_doc()));
+    }
+
+    // Changing frozen attributes that are not shared does not copy them.
+    void test_freeze_unshared() {
+        attrs->add_attribute(&a);
+        attrs->freeze();
+        D4Attribute *first = attrs->attributes()[0];
+        CPPUNIT_ASSERT(attrs->find("first") == first);
+        CPPUNIT_ASSERT(!attrs->frozen());
+
+        // Copies of attributes that are not frozen are deep copies
+        D4Attributes copy(*attrs);
+        CPPUNIT_ASSERT(copy.attributes()[0] != first);
+    }
+
+    // Large containers are searched with an index; the results must be the
+    // same as the linear search's.
+    void test_many_attributes() {
+        for (int i = 0; i < 100; ++i) {
+            if (i == 50) {
+                auto c = new D4Attribute("c", attr_container_c);
+                c->attributes()->add_attribute_nocopy(new D4Attribute("a70", attr_str_c));
+                c->attributes()->add_attribute_nocopy(new D4Attribute("inner", attr_str_c));
+                attrs->add_attribute_nocopy(c);
+            }
+            attrs->add_attribute_nocopy(new D4Attribute("a" + to_string(i), attr_int32_c));
+        }
+
+        CPPUNIT_ASSERT(attrs->find("a10") == attrs->attributes()[10]);
+        // find() ends in the first container that comes before a match
+        CPPUNIT_ASSERT(attrs->find("a70") == attrs->get("c.a70"));
+        CPPUNIT_ASSERT(!attrs->find("a80"));
+
+        CPPUNIT_ASSERT(attrs->get("a80") == attrs->attributes()[81]);
+        CPPUNIT_ASSERT_EQUAL(string("inner"), attrs->get("c.inner")->name());
+        CPPUNIT_ASSERT(!attrs->get("a80.inner"));
+        CPPUNIT_ASSERT(!attrs->get("a100"));
+
+        attrs->get("a5")->set_name("renamed");
+        CPPUNIT_ASSERT(attrs->get("renamed") == attrs->attributes()[5]);
+        CPPUNIT_ASSERT(!attrs->get("a5"));
+
+        attrs->erase_named_attribute("a3");
+        CPPUNIT_ASSERT(!attrs->get("a3"));
+        CPPUNIT_ASSERT(attrs->get("a4") == attrs->attributes()[3]);
+    }
+
     CPPUNIT_TEST_SUITE(D4AttributesTest);
 
     CPPUNIT_TEST(test_type_to_string);
@@ -438,6 +513,10 @@ public:
     CPPUNIT_TEST(test_erase_3);
     CPPUNIT_TEST(test_erase_4);
 
+    CPPUNIT_TEST(test_freeze);
+    CPPUNIT_TEST(test_freeze_unshared);
+    CPPUNIT_TEST(test_many_attributes);
+
     CPPUNIT_TEST_SUITE_END();
 };
 
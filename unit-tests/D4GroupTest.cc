@@ -29,10 +29,19 @@
 #include <cppunit/extensions/TestFactoryRegistry.h>
 
 #include "D4Attributes.h"
+#include "D4BaseTypeFactory.h"
 #include "D4Group.h"
+#include "D4StreamMarshaller.h"
+#include "DMR.h"
+#include "MarshallerStats.h"
 
+#include "Array.h"
 #include "Byte.h"
+#include "Float64.h"
+#include "Int16.h"
+#include "Int32.h"
 #include "Int64.h"
+#include "Str.h"
 #include "Structure.h"
 #include "XMLWriter.h"
 #include "crc.h"
@@ -409,6 +418,150 @@ public:
         CPPUNIT_ASSERT(btp && btp->FQN() == "/child/p.c.b");
     }
 
+    // The FQN is kept, so it must change when a parent is renamed or a
+    // variable is moved.
+    void test_fqn_changes() {
+        D4Group *local = new D4Group("child");
+        load_group_with_nested_constructors_and_scalars(local);
+        root->add_group_nocopy(local);
+
+        BaseType *btp = root->find_var("/child/p.c.b");
+        string fqn = btp->FQN();
+        CPPUNIT_ASSERT_EQUAL(string("/child/p.c.b"), fqn);
+        CPPUNIT_ASSERT_EQUAL(fqn, btp->FQN()); // from the cache
+
+        local->set_name("renamed");
+        CPPUNIT_ASSERT_EQUAL(string("/renamed/p.c.b"), btp->FQN());
+        CPPUNIT_ASSERT_EQUAL(string("/child/p.c.b"), fqn); // a copy
+        root->find_var("/renamed/p")->set_name("q");
+        CPPUNIT_ASSERT_EQUAL(string("/renamed/q.c.b"), btp->FQN());
+
+        auto c = static_cast<Structure *>(root->find_var("/renamed/q.c"));
+        CPPUNIT_ASSERT_EQUAL(string("/renamed/q.c"), c->FQN());
+        auto s = new Structure("s");
+        root->add_var_nocopy(s);
+        s->add_var(c); // a copy
+        CPPUNIT_ASSERT_EQUAL(string("/s.c.b"), s->var("c")->var("b")->FQN());
+        CPPUNIT_ASSERT_EQUAL(string("/renamed/q.c.b"), btp->FQN());
+
+        // A Structure that is the prototype of an Array has the Array's FQN
+        auto a = new Array("a", nullptr);
+        a->add_var_nocopy(new Structure("a"));
+        static_cast<Structure *>(a->var())->add_var_nocopy(new Int32("i"));
+        local->add_var_nocopy(a);
+        CPPUNIT_ASSERT_EQUAL(string("/renamed/a.i"), static_cast<Structure *>(a->var())->var("i")->FQN());
+    }
+
+    // Build a DMR whose variables already hold their values
+    void load_dmr_for_serialize(DMR &dmr) {
+        D4Group *g = dmr.root();
+
+        Int32 *i32 = new Int32("i32");
+        i32->set_value(42);
+        g->add_var_nocopy(i32);
+
+        Array *f64 = new Array("f64", new Float64("f64"));
+        f64->append_dim(1000);
+        vector<dods_float64> f64_vals(1000);
+        for (size_t i = 0; i < f64_vals.size(); ++i)
+            f64_vals[i] = i * 0.5;
+        f64->set_value(f64_vals, f64_vals.size());
+        g->add_var_nocopy(f64);
+
+        Structure *s = new Structure("s");
+        Byte *b = new Byte("b");
+        b->set_value(7);
+        s->add_var_nocopy(b);
+        g->add_var_nocopy(s);
+
+        Str *str = new Str("str");
+        str->set_value("a string");
+        g->add_var_nocopy(str);
+
+        D4Group *child = new D4Group("child");
+        Array *i16 = new Array("i16", new Int16("i16"));
+        i16->append_dim(300);
+        vector<dods_int16> i16_vals(300);
+        for (size_t i = 0; i < i16_vals.size(); ++i)
+            i16_vals[i] = -static_cast<dods_int16>(i);
+        i16->set_value(i16_vals, i16_vals.size());
+        child->add_var_nocopy(i16);
+        child->add_var_nocopy(new Int32(*i32));
+        g->add_group_nocopy(child);
+
+        dmr.use_checksums(true);
+        dmr.root()->set_send_p(true);
+        dmr.root()->set_read_p(true);
+    }
+
+    string serialize_dmr(DMR &dmr) {
+        ostringstream oss;
+        D4StreamMarshaller m(oss, true, dmr.use_checksums());
+        dmr.root()->serialize(m, dmr);
+        return oss.str();
+    }
+
+    // Reading ahead must not change a byte of the response, checksums included
+    void test_serialize_read_ahead() {
+        D4BaseTypeFactory factory;
+        DMR dmr(&factory);
+        load_dmr_for_serialize(dmr);
+        const string expected = serialize_dmr(dmr);
+        CPPUNIT_ASSERT(!expected.empty());
+
+        for (unsigned int threads : {1, 2, 8}) {
+            for (uint64_t bytes : {uint64_t(1), uint64_t(1024), uint64_t(1024 * 1024)}) {
+                DBG(cerr << "test_serialize_read_ahead: threads: " << threads << ", bytes: " << bytes << endl);
+                dmr.set_read_ahead(threads, bytes);
+                CPPUNIT_ASSERT(serialize_dmr(dmr) == expected);
+            }
+        }
+
+        dmr.use_checksums(false);
+        dmr.set_read_ahead(0);
+        const string no_crc = serialize_dmr(dmr);
+        dmr.set_read_ahead(4);
+        CPPUNIT_ASSERT(serialize_dmr(dmr) == no_crc);
+    }
+
+    // Counting must not change the response; every byte is counted against
+    // a top-level variable, with or without reading ahead.
+    void test_serialize_stats() {
+        D4BaseTypeFactory factory;
+        DMR dmr(&factory);
+        load_dmr_for_serialize(dmr);
+        const string expected = serialize_dmr(dmr);
+        const vector<string> names = {"/i32", "/f64", "/s", "/str", "/child/i16", "/child/i32"};
+
+        for (unsigned int threads : {0, 2}) {
+            dmr.set_read_ahead(threads);
+            MarshallerStats stats;
+            ostringstream oss;
+            {
+                D4StreamMarshaller m(oss, true, true);
+                m.set_stats(&stats);
+                dmr.root()->serialize(m, dmr);
+            }
+            CPPUNIT_ASSERT(oss.str() == expected);
+
+            CPPUNIT_ASSERT_EQUAL(names.size(), stats.variables().size());
+            for (size_t i = 0; i < names.size(); ++i) {
+                const MarshallerStats::Variable &v = stats.variables()[i];
+                DBG(cerr << v.name << ": " << v.bytes << " bytes, " << v.read_seconds << " read, " << v.encode_seconds
+                         << " encode, " << v.wait_seconds << " wait" << endl);
+                CPPUNIT_ASSERT_EQUAL(names[i], v.name);
+                CPPUNIT_ASSERT(v.read_seconds >= 0 && v.encode_seconds >= 0 && v.wait_seconds >= 0);
+            }
+            CPPUNIT_ASSERT_EQUAL(uint64_t(4 + 4), stats.variables()[0].bytes);
+            CPPUNIT_ASSERT_EQUAL(uint64_t(1000 * 8 + 4), stats.variables()[1].bytes);
+            CPPUNIT_ASSERT_EQUAL(uint64_t(expected.size()), stats.totals().bytes);
+
+            ostringstream json;
+            stats.dump_json(json);
+            CPPUNIT_ASSERT(json.str().find("{\"name\": \"/f64\", \"bytes\": 8004, ") != string::npos);
+        }
+    }
+
     CPPUNIT_TEST_SUITE(D4GroupTest);
 
     CPPUNIT_TEST(test_assignment);
@@ -442,6 +595,10 @@ public:
     CPPUNIT_TEST(test_fqn_2);
     CPPUNIT_TEST(test_fqn_3);
     CPPUNIT_TEST(test_fqn_4);
+    CPPUNIT_TEST(test_fqn_changes);
+
+    CPPUNIT_TEST(test_serialize_read_ahead);
+    CPPUNIT_TEST(test_serialize_stats);
 
     CPPUNIT_TEST_SUITE_END();
 };
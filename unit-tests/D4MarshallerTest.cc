@@ -44,6 +44,8 @@
 #include <sstream>
 
 #include "D4StreamMarshaller.h"
+#include "MarshallerSpool.h"
+#include "UringSink.h"
 
 #include "debug.h"
 #include "run_tests_cppunit.h"
@@ -80,7 +82,15 @@ class D4MarshallerTest : public CppUnit::TestFixture {
     CPPUNIT_TEST(test_opaque_with_checksums);
     CPPUNIT_TEST(test_vector_no_checksums);
     CPPUNIT_TEST(test_vector_with_checksums);
+    CPPUNIT_TEST(test_vector_fd_no_checksums);
+    CPPUNIT_TEST(test_vector_fd_with_checksums);
+    CPPUNIT_TEST(test_mixed_fd_with_checksums);
+    CPPUNIT_TEST(test_vector_fd_uring);
+    CPPUNIT_TEST(test_mixed_fd_uring);
+    CPPUNIT_TEST(test_many_pieces_fd);
+    CPPUNIT_TEST(test_spool);
     CPPUNIT_TEST(checksum_speed_test);
+    CPPUNIT_TEST(test_checksum_threads);
 
     CPPUNIT_TEST_SUITE_END();
 
@@ -155,6 +165,32 @@ public:
     }
 
     // -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- --
+    // A checksum-only marshaller using several threads for a vector large
+    // enough to be split must get the same checksum as a serial one.
+    void test_checksum_threads() {
+        vector<dods_float64> vals(3 * CRC32_PARALLEL_MIN_SEGMENT / sizeof(dods_float64) + 3);
+        for (size_t i = 0; i < vals.size(); ++i)
+            vals[i] = i * 0.25;
+        char *buf = reinterpret_cast<char *>(vals.data());
+
+        ostringstream oss;
+        D4StreamMarshaller serial(oss, false, true);
+        serial.reset_checksum();
+        serial.put_vector_float64(buf, vals.size());
+
+        D4StreamMarshaller parallel(oss, false, true);
+        parallel.set_checksum_threads(4);
+        CPPUNIT_ASSERT_EQUAL(4U, parallel.checksum_threads());
+        parallel.reset_checksum();
+        parallel.put_vector_float64(buf, vals.size());
+
+        CPPUNIT_ASSERT_EQUAL(serial.get_checksum(), parallel.get_checksum());
+        CPPUNIT_ASSERT_EQUAL(serial.get_checksum_value(), parallel.get_checksum_value());
+        CPPUNIT_ASSERT_EQUAL(std::stoul(serial.get_checksum(), nullptr, 16),
+                             static_cast<unsigned long>(serial.get_checksum_value()));
+        CPPUNIT_ASSERT(oss.str().empty());
+    }
+
     void checksum_speed_test() {
 
         // long element_count = 2100000007;
@@ -431,6 +467,200 @@ public:
             CPPUNIT_FAIL("Caught an exception.");
         }
     }
+
+    // -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- -- --
+    // The file descriptor (writev) version must produce the same bytes as the ostream version.
+
+    static string read_file(const string &file) {
+        ifstream ifs(file, ios::binary);
+        stringstream content;
+        content << ifs.rdbuf();
+        return content.str();
+    }
+
+    void test_vector_fd_no_checksums() { test_vector_fd(false, path + "/test_vector_1_no_checksums_bin.dat"); }
+
+    void test_vector_fd_with_checksums() { test_vector_fd(true, path + "/test_vector_1_bin.dat"); }
+
+    // The io_uring version must too; when the host can't use io_uring, writev() is used.
+    void test_vector_fd_uring() { test_vector_fd(true, path + "/test_vector_1_bin.dat", true); }
+
+    void test_vector_fd(const bool checksums, const string &baseline_file, bool uring = false) {
+        const long num_elements = 32768;
+        const string file = string(TEST_BUILD_DIR) + "/test_vector_fd.bin";
+        int fd = creat(file.c_str(), 0644);
+        CPPUNIT_ASSERT(fd != -1);
+
+        try {
+            D4StreamMarshaller dsm(fd, true, checksums);
+            if (uring)
+                CPPUNIT_ASSERT_EQUAL(UringSink::available(), dsm.use_uring());
+
+            vector<unsigned char> buf1(num_elements);
+            for (int i = 0; i < num_elements; ++i)
+                buf1[i] = i % (1 << 7);
+            dsm.reset_checksum();
+            dsm.put_vector(reinterpret_cast<char *>(buf1.data()), num_elements);
+            if (checksums) {
+                dsm.put_checksum();
+                dsm.reset_checksum();
+            }
+
+            vector<dods_int32> buf2(num_elements);
+            for (int i = 0; i < num_elements; ++i)
+                buf2[i] = i % (1 << 9);
+            dsm.put_vector(reinterpret_cast<char *>(buf2.data()), num_elements, sizeof(dods_int32));
+            if (checksums) {
+                dsm.put_checksum();
+                dsm.reset_checksum();
+            }
+
+            vector<dods_float64> buf3(num_elements);
+            for (int i = 0; i < num_elements; ++i)
+                buf3[i] = i % (1 << 9);
+            dsm.put_vector_float64(reinterpret_cast<char *>(buf3.data()), num_elements);
+            if (checksums)
+                dsm.put_checksum();
+            dsm.flush();
+        } catch (Error &e) {
+            close(fd);
+            cerr << "Error: " << e.get_error_message() << endl;
+            CPPUNIT_FAIL("Caught an exception.");
+        }
+        close(fd);
+
+        const string data = read_file(file);
+        CPPUNIT_ASSERT(cmp(data.data(), data.length(), baseline_file));
+    }
+
+    void test_mixed_fd_with_checksums() { test_mixed_fd(false); }
+
+    void test_mixed_fd_uring() { test_mixed_fd(true); }
+
+    void test_mixed_fd(bool uring) {
+        const string file = string(TEST_BUILD_DIR) + "/test_mixed_fd.bin";
+        int fd = creat(file.c_str(), 0644);
+        CPPUNIT_ASSERT(fd != -1);
+
+        vector<dods_float32> floats(1000);
+        for (size_t i = 0; i < floats.size(); ++i)
+            floats[i] = i * 0.5;
+        const string big_str(100 * 1024, 'x'); // bigger than the staging buffer
+
+        auto marshal = [&](D4StreamMarshaller &dsm) {
+            dsm.reset_checksum();
+            dsm.put_int32(17);
+            dsm.put_str("a string");
+            dsm.put_vector_float32(reinterpret_cast<char *>(floats.data()), floats.size());
+            dsm.put_str(big_str);
+            dsm.put_opaque_dap4(big_str.data(), 1000);
+            dsm.put_checksum();
+            dsm.put_count(3);
+            dsm.put_float64(3.1415);
+        };
+
+        ostringstream oss;
+        {
+            D4StreamMarshaller dsm(oss, true, true);
+            marshal(dsm);
+        }
+        {
+            D4StreamMarshaller dsm(fd, true, true);
+            if (uring)
+                CPPUNIT_ASSERT_EQUAL(UringSink::available(), dsm.use_uring());
+            marshal(dsm); // the dtor writes the last values
+        }
+        close(fd);
+
+        CPPUNIT_ASSERT(oss.str() == read_file(file));
+    }
+
+    // More pieces than fit in one writev() call; values staged when the list
+    // of pieces is full must not be lost.
+    void test_many_pieces_fd() {
+        const string file = string(TEST_BUILD_DIR) + "/test_many_pieces_fd.bin";
+        int fd = creat(file.c_str(), 0644);
+        CPPUNIT_ASSERT(fd != -1);
+
+        const int n = 3000; // each value and vector is a piece; more than IOV_MAX
+        vector<vector<dods_int32>> vectors(n);
+        for (int i = 0; i < n; ++i)
+            vectors[i] = {i, -i, 2 * i};
+
+        auto marshal = [&](D4StreamMarshaller &dsm) {
+            dsm.reset_checksum();
+            for (int i = 0; i < n; ++i) {
+                dsm.put_int32(i);
+                dsm.put_vector(reinterpret_cast<char *>(vectors[i].data()), vectors[i].size(), sizeof(dods_int32));
+            }
+            dsm.put_checksum();
+        };
+
+        ostringstream oss;
+        {
+            D4StreamMarshaller dsm(oss, true, true);
+            marshal(dsm);
+        }
+        {
+            D4StreamMarshaller dsm(fd, true, true);
+            marshal(dsm);
+        }
+        close(fd);
+
+        CPPUNIT_ASSERT(oss.str() == read_file(file));
+    }
+
+    // Values spooled and then written after their count match values written
+    // directly, including the checksum, whether or not the spool spills to a
+    // file and whether or not spools nest.
+    void test_spool() {
+        vector<dods_float64> floats(1000);
+        for (size_t i = 0; i < floats.size(); ++i)
+            floats[i] = i * 0.25;
+
+        auto values = [&](D4StreamMarshaller &dsm) {
+            dsm.put_int32(17);
+            dsm.put_str("a string");
+            dsm.put_vector_float64(reinterpret_cast<char *>(floats.data()), floats.size());
+        };
+
+        ostringstream direct;
+        {
+            D4StreamMarshaller dsm(direct, true, true);
+            dsm.reset_checksum();
+            dsm.put_count(2);
+            values(dsm);
+            dsm.put_count(1);
+            values(dsm);
+            dsm.put_checksum();
+        }
+
+        for (size_t limit : {size_t(0), size_t(100), MarshallerSpool::default_memory_limit}) {
+            ostringstream spooled;
+            {
+                D4StreamMarshaller dsm(spooled, true, true);
+                dsm.reset_checksum();
+                MarshallerSpool outer(limit);
+                CPPUNIT_ASSERT(dsm.set_spool(&outer) == nullptr);
+                values(dsm);
+                {
+                    MarshallerSpool inner(limit);
+                    CPPUNIT_ASSERT(dsm.set_spool(&inner) == &outer);
+                    values(dsm);
+                    CPPUNIT_ASSERT_THROW(dsm.put_spool(inner), InternalErr);
+                    dsm.set_spool(&outer);
+                    dsm.put_count(1);
+                    dsm.put_spool(inner);
+                }
+                dsm.set_spool(nullptr);
+                CPPUNIT_ASSERT_EQUAL(limit < 1000, outer.spilled());
+                dsm.put_count(2);
+                dsm.put_spool(outer);
+                dsm.put_checksum();
+            }
+            CPPUNIT_ASSERT(direct.str() == spooled.str());
+        }
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(D4MarshallerTest);
@@ -0,0 +1,269 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+#include "config.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "Array.h"
+#include "D4BaseTypeFactory.h"
+#include "D4Dimensions.h"
+#include "D4Group.h"
+#include "D4ParserSax2.h"
+#include "D4RequestContext.h"
+#include "DMR.h"
+#include "Int32.h"
+#include "XMLWriter.h"
+
+#include "debug.h"
+#include "run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace CppUnit;
+using namespace libdap;
+using namespace std;
+
+class D4RequestContextTest : public TestFixture {
+    CPPUNIT_TEST_SUITE(D4RequestContextTest);
+    CPPUNIT_TEST(test_state);
+    CPPUNIT_TEST(test_variables);
+    CPPUNIT_TEST(test_reused_address);
+    CPPUNIT_TEST(test_building);
+    CPPUNIT_TEST(test_array_constraint);
+    CPPUNIT_TEST(test_shared_dimension);
+    CPPUNIT_TEST(test_threads);
+    CPPUNIT_TEST_SUITE_END();
+
+    D4BaseTypeFactory d_factory;
+    DMR *d_dmr = nullptr;
+
+    string print_constrained() {
+        XMLWriter xml;
+        d_dmr->print_dap4(xml, true);
+        return xml.get_doc();
+    }
+
+    // Project SST with a slice of its first dimension and AIRT with a slice
+    // of the shared dimension COADSX, the way D4ConstraintEvaluator does.
+    void project_sst() {
+        auto sst = static_cast<Array *>(d_dmr->root()->var("SST"));
+        sst->set_send_p(true);
+        sst->add_constraint_ll(sst->dim_begin(), 0, 1, 0);
+    }
+
+    void project_airt() {
+        auto airt = static_cast<Array *>(d_dmr->root()->var("AIRT"));
+        D4Dimension *x = d_dmr->root()->dims()->find_dim("COADSX");
+        x->set_constraint(0, 2, 9);
+        airt->set_send_p(true);
+        for (auto d = airt->dim_begin(), e = airt->dim_end(); d != e; ++d) {
+            if (airt->dimension_D4dim(d) == x)
+                airt->add_constraint(d, x);
+        }
+    }
+
+public:
+    void setUp() override {
+        d_dmr = new DMR(&d_factory, "coads");
+        ifstream ifs(string(TEST_SRC_DIR) + "/D4-xml/coads_climatology.nc.xml");
+        D4ParserSax2 parser;
+        parser.intern(ifs, d_dmr);
+    }
+
+    void tearDown() override {
+        delete d_dmr;
+        d_dmr = nullptr;
+    }
+
+    void test_state() {
+        D4RequestContext context;
+        int object;
+        D4RequestContext::Serial serial;
+        CPPUNIT_ASSERT(!context.find<int>(&object, serial));
+        context.get(&object, serial, 3) += 1;
+        CPPUNIT_ASSERT_EQUAL(4, *context.find<int>(&object, serial));
+        CPPUNIT_ASSERT(!context.find<long>(&object, serial)); // state is kept by type, too
+        CPPUNIT_ASSERT_EQUAL(4, context.get(&object, serial, 0));
+
+        // and by serial number, which is new for a copy
+        D4RequestContext::Serial copy(serial);
+        CPPUNIT_ASSERT(copy.value() != serial.value());
+        CPPUNIT_ASSERT(!context.find<int>(&object, copy));
+
+        context.erase<int>(&object, serial);
+        CPPUNIT_ASSERT_EQUAL(size_t(0), context.size());
+
+        CPPUNIT_ASSERT(!D4RequestContext::current());
+        {
+            D4RequestContext::Scope scope(&context);
+            CPPUNIT_ASSERT(D4RequestContext::current() == &context);
+        }
+        CPPUNIT_ASSERT(!D4RequestContext::current());
+    }
+
+    void test_variables() {
+        BaseType *sst = d_dmr->root()->var("SST");
+        D4RequestContext context;
+        {
+            D4RequestContext::Scope scope(&context);
+            sst->set_send_p(true);
+            sst->set_read_p(true);
+            sst->set_in_selection(true);
+            d_dmr->set_ce_empty(true);
+            CPPUNIT_ASSERT(sst->send_p() && sst->read_p() && sst->is_in_selection());
+            CPPUNIT_ASSERT(d_dmr->get_ce_empty());
+
+            // A copy made in the context gets the context's state
+            unique_ptr<BaseType> copy(sst->ptr_duplicate());
+            CPPUNIT_ASSERT(copy->send_p());
+        }
+
+        CPPUNIT_ASSERT(!sst->send_p() && !sst->read_p() && !sst->is_in_selection());
+        CPPUNIT_ASSERT(!d_dmr->get_ce_empty());
+    }
+
+    // A variable made where a deleted one was does not get its state
+    void test_reused_address() {
+        D4RequestContext context;
+        alignas(Int32) char memory[sizeof(Int32)];
+
+        auto a = new (memory) Int32("a");
+        {
+            D4RequestContext::Scope scope(&context);
+            a->set_send_p(true);
+        }
+        a->~Int32(); // outside the scope, so its state stays in the context
+
+        auto b = new (memory) Int32("b");
+        {
+            D4RequestContext::Scope scope(&context);
+            CPPUNIT_ASSERT(!b->send_p());
+        }
+        b->~Int32();
+    }
+
+    // Dimensions and lengths set while a context is active belong to the
+    // variable; only constraints stay in the context.
+    void test_building() {
+        D4RequestContext context;
+        unique_ptr<Array> a;
+        unique_ptr<Array> b(new Array("b", new Int32("b")));
+        b->append_dim(4, "x");
+        {
+            D4RequestContext::Scope scope(&context);
+            a.reset(new Array("a", new Int32("a")));
+            a->append_dim(10, "x");
+            a->add_constraint(a->dim_begin(), 0, 1, 4);
+            a->append_dim(3, "y");
+            CPPUNIT_ASSERT_EQUAL(2U, a->dimensions());
+            CPPUNIT_ASSERT_EQUAL(15, a->length());
+
+            b->add_constraint(b->dim_begin(), 1, 1, 2);
+            b->append_dim(5, "y");
+            b->rename_dim("x", "z");
+            CPPUNIT_ASSERT_EQUAL(10, b->length());
+            CPPUNIT_ASSERT_EQUAL(string("z"), b->dimension_name(b->dim_begin()));
+        }
+
+        CPPUNIT_ASSERT_EQUAL(2U, a->dimensions());
+        CPPUNIT_ASSERT_EQUAL(30, a->length());
+        CPPUNIT_ASSERT_EQUAL(int64_t(10), a->dimension_size_ll(a->dim_begin(), true));
+
+        CPPUNIT_ASSERT_EQUAL(2U, b->dimensions());
+        CPPUNIT_ASSERT_EQUAL(20, b->length());
+        CPPUNIT_ASSERT_EQUAL(string("z"), b->dimension_name(b->dim_begin()));
+
+        // A copy made in the context has its constraints
+        {
+            D4RequestContext::Scope scope(&context);
+            unique_ptr<Array> copy(static_cast<Array *>(b->ptr_duplicate()));
+            CPPUNIT_ASSERT_EQUAL(10, copy->length());
+        }
+    }
+
+    void test_array_constraint() {
+        auto sst = static_cast<Array *>(d_dmr->root()->var("SST"));
+        string unconstrained = print_constrained();
+        int64_t length = sst->length_ll();
+
+        D4RequestContext context;
+        string constrained;
+        {
+            D4RequestContext::Scope scope(&context);
+            project_sst();
+            CPPUNIT_ASSERT_EQUAL(int64_t(1), sst->dimension_size_ll(sst->dim_begin(), true));
+            CPPUNIT_ASSERT_EQUAL(length / 12, sst->length_ll());
+            constrained = print_constrained();
+            DBG(cerr << constrained << endl);
+        }
+
+        CPPUNIT_ASSERT(constrained != unconstrained);
+        CPPUNIT_ASSERT(constrained.find("name=\"AIRT\"") == string::npos);
+        CPPUNIT_ASSERT_EQUAL(int64_t(12), sst->dimension_size_ll(sst->dim_begin(), true));
+        CPPUNIT_ASSERT_EQUAL(length, sst->length_ll());
+        CPPUNIT_ASSERT_EQUAL(unconstrained, print_constrained());
+
+        // The same constraint without a context gives the same response
+        project_sst();
+        CPPUNIT_ASSERT_EQUAL(constrained, print_constrained());
+    }
+
+    void test_shared_dimension() {
+        D4Dimension *x = d_dmr->root()->dims()->find_dim("COADSX");
+        D4RequestContext context;
+        {
+            D4RequestContext::Scope scope(&context);
+            project_airt();
+            CPPUNIT_ASSERT(x->constrained());
+            CPPUNIT_ASSERT_EQUAL(int64_t(2), x->c_stride());
+            CPPUNIT_ASSERT(x->used_by_projected_var());
+        }
+
+        CPPUNIT_ASSERT(!x->constrained());
+        CPPUNIT_ASSERT(!x->used_by_projected_var());
+    }
+
+    // Two threads build different responses from one DMR at the same time.
+    void test_threads() {
+        project_sst();
+        string sst_response = print_constrained();
+        tearDown();
+        setUp();
+        project_airt();
+        string airt_response = print_constrained();
+        tearDown();
+        setUp();
+
+        string results[2][50];
+        auto request = [this](void (D4RequestContextTest::*project)(), string *responses) {
+            for (int i = 0; i < 50; ++i) {
+                D4RequestContext context;
+                D4RequestContext::Scope scope(&context);
+                (this->*project)();
+                responses[i] = print_constrained();
+            }
+        };
+
+        thread t1(request, &D4RequestContextTest::project_sst, results[0]);
+        thread t2(request, &D4RequestContextTest::project_airt, results[1]);
+        t1.join();
+        t2.join();
+
+        for (int i = 0; i < 50; ++i) {
+            CPPUNIT_ASSERT_EQUAL(sst_response, results[0][i]);
+            CPPUNIT_ASSERT_EQUAL(airt_response, results[1][i]);
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(D4RequestContextTest);
+
+int main(int argc, char *argv[]) { return run_tests<D4RequestContextTest>(argc, argv) ? 0 : 1; }
@@ -26,6 +26,10 @@
 #include <cppunit/extensions/HelperMacros.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fstream>
 #include <sstream>
 #include <string>
 
@@ -34,9 +38,16 @@
 #include "D4FilterClause.h"
 #include "D4Group.h"
 #include "D4RValue.h"
+#include "D4SeqColumns.h"
+#include "D4StreamMarshaller.h"
+#include "D4StreamUnMarshaller.h"
 #include "DMR.h"
+#include "Float64.h"
+#include "Int32.h"
+#include "Str.h"
 
 #include "../tests/D4TestTypeFactory.h"
+#include "../tests/TestArray.h"
 #include "../tests/TestD4Sequence.h"
 #include "../tests/TestFloat32.h"
 #include "../tests/TestInt32.h"
@@ -63,10 +74,84 @@ const static string two_clause_txt = "TestD4Sequence_two_clause.txt";
 
 namespace libdap {
 
+// A data store that knows how many rows it will return.
+class CountedD4Sequence : public TestD4Sequence {
+    int64_t d_count;
+
+public:
+    CountedD4Sequence(const TestD4Sequence &rhs, int64_t count) : TestD4Sequence(rhs), d_count(count) {}
+    int64_t filtered_length(bool) override { return d_count; }
+};
+
+// A data store that returns 'rows' rows each time it is read to the end, with
+// its first member set to 1, 2, ... times 'scale'. Used for nested sequences.
+class RepeatingD4Sequence : public D4Sequence {
+    int d_rows;
+    int d_scale;
+    int d_current = 0;
+
+public:
+    RepeatingD4Sequence(const string &n, int rows, int scale) : D4Sequence(n), d_rows(rows), d_scale(scale) {}
+    BaseType *ptr_duplicate() override { return new RepeatingD4Sequence(*this); }
+
+    bool read() override {
+        if (read_p())
+            return true;
+        if (d_current == d_rows) {
+            d_current = 0;
+            return true;
+        }
+        static_cast<Int32 *>(*var_begin())->set_value(++d_current * d_scale);
+        return false;
+    }
+};
+
 class D4SequenceTest : public TestFixture {
 private:
     TestD4Sequence *s;
 
+    static string serialize(D4Sequence &seq, bool filter = false) {
+        D4TestTypeFactory factory;
+        DMR dmr(&factory);
+        ostringstream oss;
+        D4StreamMarshaller m(oss, true, true);
+        m.reset_checksum();
+        seq.serialize(m, dmr, filter);
+        m.put_checksum();
+        m.flush();
+        return oss.str();
+    }
+
+    // The same, written to a file descriptor; optionally return the number of writes
+    static string serialize_fd(D4Sequence &seq, uint64_t *syscalls = nullptr) {
+        D4TestTypeFactory factory;
+        DMR dmr(&factory);
+        const string file = string(TEST_BUILD_DIR) + "/D4SequenceTest_fd.bin";
+        int fd = creat(file.c_str(), 0644);
+        CPPUNIT_ASSERT(fd != -1);
+        {
+            D4StreamMarshaller m(fd, true, true);
+            m.reset_checksum();
+            seq.serialize(m, dmr);
+            m.put_checksum();
+            m.flush();
+            if (syscalls)
+                *syscalls = m.write_syscalls();
+        }
+        close(fd);
+
+        ifstream ifs(file, ios::binary);
+        ostringstream oss;
+        oss << ifs.rdbuf();
+        return oss.str();
+    }
+
+    static void add_clause(TestD4Sequence &seq) {
+        D4RValue *arg1 = new D4RValue(seq.var("i32"));
+        D4RValue *arg2 = new D4RValue((long long)1024);
+        seq.clauses().add_clause(new D4FilterClause(D4FilterClause::greater_equal, arg1, arg2));
+    }
+
 public:
     D4SequenceTest() : s(0) {}
     ~D4SequenceTest() {}
@@ -189,6 +274,223 @@ public:
         CPPUNIT_ASSERT(oss.str() == read_test_baseline(prefix + one_clause_txt));
     }
 
+    void columnar_test() {
+        s->set_columnar(true);
+        s->intern_data();
+        CPPUNIT_ASSERT(s->length() == 7);
+        CPPUNIT_ASSERT(s->value_ref().empty());
+
+        const D4SeqColumns &cols = s->columns();
+        CPPUNIT_ASSERT_EQUAL(size_t(3), cols.num_columns());
+        CPPUNIT_ASSERT_EQUAL(uint64_t(7), cols.rows());
+        CPPUNIT_ASSERT_EQUAL(1024, cols.values<dods_int32>(0)[1]);
+        CPPUNIT_ASSERT_EQUAL(string("Silly test string: 3"), cols.string_value(1, 2));
+
+        CPPUNIT_ASSERT_EQUAL(1048576, static_cast<Int32 *>(s->var_value(3, "i32"))->value());
+        CPPUNIT_ASSERT(s->var_value(7, "i32") == nullptr);
+
+        ostringstream oss;
+        s->output_values(oss);
+        DBG(cerr << "s: " << oss.str() << endl);
+        CPPUNIT_ASSERT(oss.str() == read_test_baseline(prefix + s_txt));
+
+        // A copy holds its own columns
+        unique_ptr<TestD4Sequence> ts(new TestD4Sequence(*s));
+        CPPUNIT_ASSERT(ts->columnar());
+        ostringstream oss2;
+        ts->output_values(oss2);
+        CPPUNIT_ASSERT(oss2.str() == oss.str());
+    }
+
+    void columnar_clause_test() {
+        D4RValue *arg1 = new D4RValue(s->var("i32"));
+        D4RValue *arg2 = new D4RValue((long long)1024);
+        s->clauses().add_clause(new D4FilterClause(D4FilterClause::equal, arg1, arg2));
+
+        s->set_columnar(true);
+        s->intern_data();
+
+        ostringstream oss;
+        s->output_values(oss);
+        CPPUNIT_ASSERT(s->length() == 1);
+        CPPUNIT_ASSERT(oss.str() == read_test_baseline(prefix + one_clause_txt));
+    }
+
+    // Rows and columns are the same on the wire.
+    void columnar_serialize_test() {
+        D4TestTypeFactory factory;
+        DMR dmr(&factory);
+        unique_ptr<TestD4Sequence> cs(new TestD4Sequence(*s));
+        cs->set_columnar(true);
+        cs->set_send_p(true);
+
+        ostringstream rows, columns;
+        {
+            D4StreamMarshaller m(rows, true, true);
+            s->serialize(m, dmr);
+            m.put_checksum();
+        }
+        {
+            D4StreamMarshaller m(columns, true, true);
+            cs->serialize(m, dmr);
+            m.put_checksum();
+        }
+        CPPUNIT_ASSERT(rows.str() == columns.str());
+
+        unique_ptr<TestD4Sequence> ds(new TestD4Sequence(*s));
+        ds->set_columnar(true);
+        istringstream iss(columns.str());
+        D4StreamUnMarshaller um(iss, false);
+        ds->deserialize(um, dmr);
+        CPPUNIT_ASSERT(ds->length() == 7);
+
+        ostringstream oss;
+        ds->output_values(oss);
+        CPPUNIT_ASSERT(oss.str() == read_test_baseline(prefix + s_txt));
+    }
+
+    // Fill the columns in batches, including a nested sequence, and read them
+    // back as rows.
+    void columnar_batch_test() {
+        D4Sequence outer("outer");
+        outer.add_var_nocopy(new Int32("i"));
+        outer.add_var_nocopy(new Str("s"));
+        auto inner = new D4Sequence("inner");
+        inner->add_var_nocopy(new Float64("f"));
+        outer.add_var_nocopy(inner);
+        outer.set_send_p(true);
+        unique_ptr<BaseType> row_copy(outer.ptr_duplicate());
+        outer.set_columnar(true);
+
+        D4SeqColumns &cols = outer.columns();
+        const dods_int32 ints[] = {1, 2, 3};
+        cols.append_values(0, ints, 3);
+        cols.append_string(1, "one");
+        cols.append_string(1, "");
+        cols.append_string(1, "three");
+        const dods_float64 floats[] = {1.5, 2.5, 3.5};
+        cols.child(2).append_values(0, floats, 2);
+        cols.end_sequence(2);
+        cols.end_sequence(2); // row 2 has no inner rows
+        cols.child(2).append_values(0, floats + 2, 1);
+        cols.end_sequence(2);
+        CPPUNIT_ASSERT_EQUAL(uint64_t(3), cols.rows());
+        CPPUNIT_ASSERT_THROW(cols.append_values(0, floats, 1), InternalErr);
+        outer.set_read_p(true);
+
+        D4TestTypeFactory factory;
+        DMR dmr(&factory);
+        ostringstream oss;
+        {
+            D4StreamMarshaller m(oss, true, false);
+            outer.serialize(m, dmr);
+        }
+
+        auto &rs = static_cast<D4Sequence &>(*row_copy);
+        istringstream iss(oss.str());
+        D4StreamUnMarshaller um(iss, false);
+        rs.deserialize(um, dmr);
+        CPPUNIT_ASSERT_EQUAL(3, rs.length());
+        CPPUNIT_ASSERT_EQUAL(3, static_cast<Int32 *>(rs.var_value(2, "i"))->value());
+        CPPUNIT_ASSERT_EQUAL(string("three"), static_cast<Str *>(rs.var_value(2, "s"))->value());
+        CPPUNIT_ASSERT_EQUAL(2, static_cast<D4Sequence *>(rs.var_value(0, "inner"))->length());
+        CPPUNIT_ASSERT_EQUAL(0, static_cast<D4Sequence *>(rs.var_value(1, "inner"))->length());
+
+        ostringstream by_rows, by_columns;
+        rs.print_val(by_rows, "", false);
+        outer.print_val(by_columns, "", false);
+        DBG(cerr << "rows: " << by_rows.str() << endl << "columns: " << by_columns.str() << endl);
+        CPPUNIT_ASSERT(by_rows.str() == by_columns.str());
+
+        auto nested = static_cast<D4Sequence *>(outer.var_value(2, "inner"));
+        CPPUNIT_ASSERT(nested->columnar());
+        CPPUNIT_ASSERT_EQUAL(3.5, static_cast<Float64 *>(nested->var_value(0, "f"))->value());
+    }
+
+    // A nested sequence read into columns holds the same values as one read
+    // into rows; each row of the outer sequence reads the inner one again.
+    void columnar_nested_read_test() {
+        auto outer = [](bool columnar) {
+            auto seq = new RepeatingD4Sequence("outer", 3, 1);
+            seq->add_var_nocopy(new Int32("i"));
+            auto inner = new RepeatingD4Sequence("inner", 2, 10);
+            inner->add_var_nocopy(new Int32("j"));
+            seq->add_var_nocopy(inner);
+            seq->set_send_p(true);
+            seq->set_columnar(columnar);
+            inner->set_columnar(columnar);
+            return unique_ptr<D4Sequence>(seq);
+        };
+        auto rows = outer(false);
+        auto columns = outer(true);
+        rows->intern_data();
+        columns->intern_data();
+        CPPUNIT_ASSERT_EQUAL(3, columns->length());
+
+        ostringstream by_rows, by_columns;
+        rows->print_val(by_rows, "", false);
+        columns->print_val(by_columns, "", false);
+        DBG(cerr << "rows: " << by_rows.str() << endl << "columns: " << by_columns.str() << endl);
+        CPPUNIT_ASSERT_EQUAL(by_rows.str(), by_columns.str());
+        CPPUNIT_ASSERT_EQUAL(2, static_cast<D4Sequence *>(columns->var_value(2, "inner"))->length());
+        CPPUNIT_ASSERT(serialize(*rows) == serialize(*columns));
+    }
+
+    // The rows are written as they are read, after being spooled or after
+    // the count from filtered_length(); the bytes sent are the same.
+    void streaming_test() {
+        unique_ptr<TestD4Sequence> ss(new TestD4Sequence(*s));
+        unique_ptr<CountedD4Sequence> cs(new CountedD4Sequence(*s, 7));
+        unique_ptr<CountedD4Sequence> bad(new CountedD4Sequence(*s, 6));
+        const string rows = serialize(*s);
+
+        ss->set_streaming(true);
+        CPPUNIT_ASSERT(serialize(*ss) == rows);
+        CPPUNIT_ASSERT_EQUAL(7, ss->length());
+        CPPUNIT_ASSERT(ss->value_ref().empty());
+
+        cs->set_streaming(true);
+        CPPUNIT_ASSERT(serialize(*cs) == rows);
+
+        bad->set_streaming(true);
+        CPPUNIT_ASSERT_THROW(serialize(*bad), InternalErr);
+    }
+
+    void streaming_clause_test() {
+        unique_ptr<TestD4Sequence> ss(new TestD4Sequence(*s));
+        add_clause(*s);
+        add_clause(*ss);
+        ss->set_streaming(true);
+
+        const string rows = serialize(*s, true);
+        CPPUNIT_ASSERT_EQUAL(5, s->length());
+        CPPUNIT_ASSERT(serialize(*ss, true) == rows);
+        CPPUNIT_ASSERT_EQUAL(5, ss->length());
+    }
+
+    // Writing to a file descriptor, the values of an array are sent from
+    // its buffer; each row must be written before read() replaces them.
+    void streaming_fd_test() {
+        // Rows of scalars are copied, so they are written together
+        unique_ptr<TestD4Sequence> plain(new TestD4Sequence(*s));
+        unique_ptr<CountedD4Sequence> scalars(new CountedD4Sequence(*s, 7));
+        scalars->set_streaming(true);
+        uint64_t syscalls = 0;
+        CPPUNIT_ASSERT(serialize_fd(*scalars, &syscalls) == serialize(*plain));
+        CPPUNIT_ASSERT_EQUAL(uint64_t(1), syscalls);
+
+        s->add_var_nocopy(new TestArray("a", new TestInt32("a")));
+        static_cast<Array *>(s->var("a"))->append_dim(3);
+        s->set_series_values(true);
+        s->set_send_p(true);
+        unique_ptr<CountedD4Sequence> cs(new CountedD4Sequence(*s, 7));
+        const string rows = serialize(*s);
+
+        cs->set_streaming(true);
+        CPPUNIT_ASSERT(serialize_fd(*cs, &syscalls) == rows);
+        CPPUNIT_ASSERT_EQUAL(uint64_t(8), syscalls); // one per row, then the checksum
+    }
+
     CPPUNIT_TEST_SUITE(D4SequenceTest);
 
     CPPUNIT_TEST(ctor_test);
@@ -199,6 +501,16 @@ public:
     CPPUNIT_TEST(two_clause_test);
     CPPUNIT_TEST(two_variable_test);
 
+    CPPUNIT_TEST(columnar_test);
+    CPPUNIT_TEST(columnar_clause_test);
+    CPPUNIT_TEST(columnar_serialize_test);
+    CPPUNIT_TEST(columnar_batch_test);
+    CPPUNIT_TEST(columnar_nested_read_test);
+
+    CPPUNIT_TEST(streaming_test);
+    CPPUNIT_TEST(streaming_clause_test);
+    CPPUNIT_TEST(streaming_fd_test);
+
     CPPUNIT_TEST_SUITE_END();
 };
 
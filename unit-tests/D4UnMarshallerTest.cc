@@ -35,6 +35,7 @@
 #include <unistd.h>
 #endif
 #include <fcntl.h>
+#include <byteswap.h>
 #include <stdint.h>
 
 #include <cstring>
@@ -69,6 +70,7 @@ class D4UnMarshallerTest : public CppUnit::TestFixture {
     CPPUNIT_TEST(test_str);
     CPPUNIT_TEST(test_opaque);
     CPPUNIT_TEST(test_vector);
+    CPPUNIT_TEST(test_vector_twiddle);
 
     CPPUNIT_TEST_SUITE_END();
 
@@ -309,6 +311,46 @@ public:
             CPPUNIT_FAIL("Caught an exception.");
         }
     }
+
+    // Read the same file as test_vector() but claim the sender's byte order is
+    // not ours. The vectors are larger than the pieces that are read and then
+    // swapped, so this covers the joins.
+    void test_vector_twiddle() {
+        fstream in;
+        in.exceptions(ostream::failbit | ostream::badbit);
+
+        try {
+            string file = path + "/test_vector_1_bin.dat";
+            in.open(file.c_str(), fstream::binary | fstream::in);
+            D4StreamUnMarshaller dsm(in, true);
+
+            vector<unsigned char> buf1(32768);
+            dsm.get_vector(reinterpret_cast<char *>(buf1.data()), 32768);
+            dsm.get_checksum_str();
+
+            vector<dods_int32> buf2(32768);
+            dsm.get_vector(reinterpret_cast<char *>(buf2.data()), 32768, sizeof(dods_int32));
+            for (int i = 0; i < 32768; ++i)
+                CPPUNIT_ASSERT(buf2[i] == (dods_int32)bswap_32(i % (1 << 9)));
+            dsm.get_checksum_str();
+
+            vector<dods_float64> buf3(32768);
+            dsm.get_vector_float64(reinterpret_cast<char *>(buf3.data()), 32768);
+            for (int i = 0; i < 32768; ++i) {
+                dods_float64 expected = i % (1 << 9);
+                uint64_t bits;
+                memcpy(&bits, &expected, sizeof(bits));
+                bits = bswap_64(bits);
+                CPPUNIT_ASSERT(memcmp(&bits, &buf3[i], sizeof(bits)) == 0);
+            }
+        } catch (Error &e) {
+            cerr << "Error: " << e.get_error_message() << endl;
+            CPPUNIT_FAIL("Caught an exception.");
+        } catch (istream::failure &e) {
+            cerr << "File error: " << e.what() << endl;
+            CPPUNIT_FAIL("Caught an exception.");
+        }
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(D4UnMarshallerTest);
@@ -33,6 +33,7 @@
 
 #include "Array.h"
 #include "Byte.h"
+#include "D4Attributes.h"
 #include "D4Dimensions.h"
 #include "D4Group.h"
 #include "Float32.h"
@@ -159,6 +160,7 @@ public:
     CPPUNIT_TEST(test_copy_ctor_2);
     CPPUNIT_TEST(test_copy_ctor_3);
     CPPUNIT_TEST(test_copy_ctor_4);
+    CPPUNIT_TEST(test_copy_ctor_frozen);
     CPPUNIT_TEST(test_copy_ctor_group_d4dim);
     CPPUNIT_TEST(test_copy_ctor_group_d4dim_complex);
     CPPUNIT_TEST(test_copy_ctor_group_d4dim_complex_2);
@@ -329,6 +331,45 @@ public:
         DBG(cerr << __func__ << "() - END" << endl);
     }
 
+    // Copies of a frozen DMR share its attributes; changing them in a copy
+    // does not change the original.
+    void test_copy_ctor_frozen() {
+        D4BaseTypeFactory factory;
+        DMR *dmr = new DMR(&factory, "coads");
+
+        string prefix = string(TEST_SRC_DIR) + "/D4-xml/coads_climatology.nc.xml";
+        ifstream ifs(prefix.c_str());
+        D4ParserSax2 parser;
+        parser.intern(ifs, dmr);
+        dmr->freeze();
+
+        XMLWriter xml;
+        dmr->print_dap4(xml);
+        string dmr_src = string(xml.get_doc());
+
+        DMR *dmr_2 = new DMR(*dmr);
+        D4Attributes *src_attrs = dmr->root()->var("SST")->attributes();
+        D4Attributes *attrs = dmr_2->root()->var("SST")->attributes();
+        CPPUNIT_ASSERT(attrs->attributes()[0] == src_attrs->attributes()[0]);
+
+        attrs->find("missing_value")->set_name("fill_value");
+
+        XMLWriter xml2;
+        dmr->print_dap4(xml2);
+        CPPUNIT_ASSERT(dmr_src == string(xml2.get_doc()));
+
+        delete dmr;
+
+        XMLWriter xml3;
+        dmr_2->print_dap4(xml3);
+        string dmr_dest = string(xml3.get_doc());
+        DBG(cerr << "DMR DEST: " << endl << dmr_dest << endl);
+        CPPUNIT_ASSERT(dmr_dest.find("fill_value") != string::npos);
+        CPPUNIT_ASSERT(dmr_dest.find("SEA SURFACE TEMPERATURE") != string::npos);
+
+        delete dmr_2;
+    }
+
     // Test when the DAP4 dimension is not under the same group as the variable.
     // The DAP4 dimension "dim" is under the root; the variable "var" is under the group /g.
     void test_copy_ctor_group_d4dim() {
@@ -0,0 +1,184 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+#include "config.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BaseTypeFactory.h"
+#include "D4BaseTypeFactory.h"
+#include "D4Dimensions.h"
+#include "D4Group.h"
+#include "D4ParserSax2.h"
+#include "DDS.h"
+#include "DMR.h"
+#include "DapArena.h"
+#include "Int32.h"
+#include "XMLWriter.h"
+
+#include "debug.h"
+#include "run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace CppUnit;
+using namespace libdap;
+using namespace std;
+
+class DapArenaTest : public TestFixture {
+    CPPUNIT_TEST_SUITE(DapArenaTest);
+    CPPUNIT_TEST(test_allocate);
+    CPPUNIT_TEST(test_scope);
+    CPPUNIT_TEST(test_heap_objects);
+    CPPUNIT_TEST(test_threads);
+    CPPUNIT_TEST(test_dmr);
+    CPPUNIT_TEST(test_dds);
+    CPPUNIT_TEST_SUITE_END();
+
+    string print(DMR &dmr) {
+        XMLWriter xml;
+        dmr.print_dap4(xml);
+        return xml.get_doc();
+    }
+
+    void parse(const string &file, DMR &dmr) {
+        ifstream in(string(TEST_SRC_DIR) + "/dmr-testsuite/" + file);
+        D4ParserSax2 parser;
+        parser.intern(in, &dmr);
+    }
+
+public:
+    void test_allocate() {
+        DapArena arena(1024);
+        char *a = static_cast<char *>(arena.allocate(3, 1));
+        auto b = static_cast<int64_t *>(arena.allocate(sizeof(int64_t), alignof(int64_t)));
+        CPPUNIT_ASSERT(reinterpret_cast<uintptr_t>(b) % alignof(int64_t) == 0);
+        CPPUNIT_ASSERT(reinterpret_cast<char *>(b) > a);
+        CPPUNIT_ASSERT_EQUAL(size_t(65536), arena.capacity()); // blocks are made of 64k granules
+
+        arena.allocate(65530); // a block of its own
+        CPPUNIT_ASSERT_EQUAL(size_t(131072), arena.capacity());
+        arena.allocate(100); // still fits in the first block
+        CPPUNIT_ASSERT_EQUAL(size_t(131072), arena.capacity());
+    }
+
+    void test_scope() {
+        DapArena arena;
+        CPPUNIT_ASSERT(DapArena::current() == nullptr);
+        {
+            DapArena::Scope scope(&arena);
+            CPPUNIT_ASSERT(DapArena::current() == &arena);
+            {
+                DapArena::Scope heap(nullptr);
+                CPPUNIT_ASSERT(DapArena::current() == nullptr);
+                delete new Int32("heap");
+            }
+
+            Int32 *i = new Int32("i");
+            D4Dimension *d = new D4Dimension("d", 10);
+            CPPUNIT_ASSERT_EQUAL(size_t(2), arena.objects());
+            delete i; // runs the destructor; the memory goes with the arena
+            delete d;
+        }
+        CPPUNIT_ASSERT(DapArena::current() == nullptr);
+        CPPUNIT_ASSERT_EQUAL(size_t(2), arena.objects());
+    }
+
+    // Objects made on the heap before or while there are arenas are freed
+    // as heap objects whenever they are deleted.
+    void test_heap_objects() {
+        Int32 *before = new Int32("before");
+        {
+            DapArena arena;
+            Int32 *during = new Int32("during");
+            Int32 *in_arena;
+            {
+                DapArena::Scope scope(&arena);
+                in_arena = new Int32("in_arena");
+            }
+            delete before;
+            delete in_arena;
+            before = new Int32("before");
+            delete during;
+            CPPUNIT_ASSERT_EQUAL(size_t(1), arena.objects());
+        }
+        delete before;
+    }
+
+    // Threads tell heap objects from arena objects without the arena.
+    void test_threads() {
+        DapArena arena;
+        vector<Int32 *> in_arena;
+        {
+            DapArena::Scope scope(&arena);
+            for (int i = 0; i < 4000; ++i)
+                in_arena.push_back(new Int32("in_arena"));
+        }
+
+        vector<thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&in_arena, t]() {
+                for (int i = 0; i < 1000; ++i) {
+                    delete new Int32("heap");
+                    delete in_arena[t * 1000 + i];
+                }
+            });
+        }
+        for (auto &t : threads)
+            t.join();
+        CPPUNIT_ASSERT_EQUAL(size_t(4000), arena.objects());
+    }
+
+    // A DMR parsed into an arena is the same as one parsed onto the heap,
+    // and so are copies of its variables, which outlive it.
+    void test_dmr() {
+        D4BaseTypeFactory factory;
+        DMR heap_dmr(&factory);
+        parse("coads_climatology.nc.full.dmr", heap_dmr);
+
+        BaseType *copy;
+        {
+            DMR arena_dmr(&factory);
+            arena_dmr.use_arena();
+            parse("coads_climatology.nc.full.dmr", arena_dmr);
+            DBG(cerr << "arena: " << arena_dmr.arena()->objects() << " objects, " << arena_dmr.arena()->capacity()
+                     << " bytes" << endl);
+            CPPUNIT_ASSERT(arena_dmr.arena()->objects() > 0);
+            CPPUNIT_ASSERT_EQUAL(print(heap_dmr), print(arena_dmr));
+
+            copy = arena_dmr.root()->var("SST")->ptr_duplicate();
+        }
+        CPPUNIT_ASSERT_EQUAL(string("SST"), copy->name());
+        delete copy;
+    }
+
+    void test_dds() {
+        BaseTypeFactory factory;
+        string file = string(TEST_SRC_DIR) + "/dds-testsuite/fnoc1.nc.dds";
+        DDS heap_dds(&factory);
+        heap_dds.parse(file);
+
+        DDS arena_dds(&factory);
+        arena_dds.use_arena();
+        arena_dds.parse(file);
+        CPPUNIT_ASSERT(arena_dds.arena()->objects() > 0);
+
+        ostringstream heap_out, arena_out;
+        heap_dds.print(heap_out);
+        arena_dds.print(arena_out);
+        CPPUNIT_ASSERT_EQUAL(heap_out.str(), arena_out.str());
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DapArenaTest);
+
+int main(int argc, char *argv[]) { return run_tests<DapArenaTest>(argc, argv) ? 0 : 1; }
@@ -0,0 +1,147 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+#include "config.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Array.h"
+#include "Float64.h"
+#include "MarshallerStats.h"
+#include "XDRStreamMarshaller.h"
+
+#include "debug.h"
+#include "run_tests_cppunit.h"
+
+using namespace CppUnit;
+using namespace libdap;
+using namespace std;
+
+class MarshallerStatsTest : public TestFixture {
+    CPPUNIT_TEST_SUITE(MarshallerStatsTest);
+    CPPUNIT_TEST(test_variables);
+    CPPUNIT_TEST(test_timers);
+    CPPUNIT_TEST(test_null_timer);
+    CPPUNIT_TEST(test_json);
+    CPPUNIT_TEST(test_xdr_marshaller);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void test_variables() {
+        MarshallerStats stats;
+        stats.add_bytes(10); // outside any variable
+        stats.start_variable("a");
+        stats.add_bytes(100);
+        stats.start_variable("b"); // ends "a"
+        stats.add_bytes(20);
+        stats.end_variable();
+        stats.end_variable(); // no-op
+
+        CPPUNIT_ASSERT_EQUAL(size_t(2), stats.variables().size());
+        CPPUNIT_ASSERT_EQUAL(string("a"), stats.variables()[0].name);
+        CPPUNIT_ASSERT_EQUAL(uint64_t(100), stats.variables()[0].bytes);
+        CPPUNIT_ASSERT_EQUAL(uint64_t(20), stats.variables()[1].bytes);
+        CPPUNIT_ASSERT_EQUAL(uint64_t(130), stats.totals().bytes);
+
+        stats.clear();
+        CPPUNIT_ASSERT(stats.variables().empty());
+        CPPUNIT_ASSERT_EQUAL(uint64_t(0), stats.totals().bytes);
+    }
+
+    // Time outside the marshaller is read time; nested marshaller timers
+    // count once and the wait inside them is not encode time.
+    void test_timers() {
+        MarshallerStats stats;
+        stats.start_variable("v");
+        this_thread::sleep_for(chrono::milliseconds(20));
+        {
+            MarshallerTimer outer(&stats);
+            {
+                MarshallerTimer inner(&stats);
+                MarshallerTimer wait(&stats, MarshallerStats::wait_time);
+                this_thread::sleep_for(chrono::milliseconds(20));
+            }
+            this_thread::sleep_for(chrono::milliseconds(20));
+        }
+        stats.end_variable();
+
+        const MarshallerStats::Variable &v = stats.variables()[0];
+        DBG(cerr << "seconds: " << v.seconds << ", read: " << v.read_seconds << ", encode: " << v.encode_seconds
+                 << ", wait: " << v.wait_seconds << endl);
+        CPPUNIT_ASSERT(v.seconds >= 0.060);
+        CPPUNIT_ASSERT(v.read_seconds >= 0.020 && v.read_seconds < v.seconds - 0.035);
+        CPPUNIT_ASSERT(v.wait_seconds >= 0.020 && v.wait_seconds < v.seconds - 0.035);
+        CPPUNIT_ASSERT(v.encode_seconds >= 0.020 && v.encode_seconds < v.seconds - 0.035);
+    }
+
+    void test_null_timer() {
+        MarshallerTimer timer(nullptr);
+        timer.stop();
+    }
+
+    void test_json() {
+        MarshallerStats stats;
+        stats.start_variable("a \"b\"\\\n");
+        stats.add_bytes(12);
+        stats.end_variable();
+
+        ostringstream oss;
+        stats.dump_json(oss);
+        DBG(cerr << oss.str() << endl);
+        CPPUNIT_ASSERT(oss.str().find("{\"variables\": [{\"name\": \"a \\\"b\\\"\\\\\\n\", \"bytes\": 12, ") == 0);
+        CPPUNIT_ASSERT(oss.str().find("], \"totals\": {\"bytes\": 12, ") != string::npos);
+    }
+
+    // Every byte written by the DAP2 marshaller is counted, including the
+    // vectors handed to the writer thread.
+    void test_xdr_marshaller() {
+        Float64 proto("f");
+        Array a("a", &proto);
+        vector<dods_float64> values(1000, 2.5);
+        vector<char> bytes(7, 'x');
+
+        MarshallerStats stats;
+        ostringstream oss;
+        {
+            XDRStreamMarshaller m(oss);
+            m.set_stats(&stats);
+            CPPUNIT_ASSERT(m.get_stats() == &stats);
+
+            stats.start_variable("scalars");
+            m.put_int32(1);
+            m.put_float64(2.0);
+            m.put_str("three");
+            stats.start_variable("a");
+            m.put_vector(reinterpret_cast<char *>(values.data()), values.size(), sizeof(dods_float64), a);
+            stats.start_variable("bytes");
+            m.put_vector(bytes.data(), bytes.size(), a);
+            stats.start_variable("parts");
+            m.put_vector_start(bytes.size());
+            m.put_vector_part(bytes.data(), bytes.size(), 1, dods_byte_c);
+            m.put_vector_end();
+            stats.end_variable();
+        }
+
+        const vector<MarshallerStats::Variable> &vars = stats.variables();
+        CPPUNIT_ASSERT_EQUAL(size_t(4), vars.size());
+        CPPUNIT_ASSERT_EQUAL(uint64_t(4 + 8 + 12), vars[0].bytes);
+        CPPUNIT_ASSERT_EQUAL(uint64_t(4 + 4 + 8000), vars[1].bytes);
+        CPPUNIT_ASSERT_EQUAL(uint64_t(4 + 4 + 8), vars[2].bytes);
+        CPPUNIT_ASSERT_EQUAL(uint64_t(4 + 4 + 8), vars[3].bytes);
+        CPPUNIT_ASSERT_EQUAL(uint64_t(oss.str().size()), stats.totals().bytes);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MarshallerStatsTest);
+
+int main(int argc, char *argv[]) { return run_tests<MarshallerStatsTest>(argc, argv) ? 0 : 1; }
@@ -20,8 +20,17 @@ using namespace std;
 class MarshallerThreadTest : public TestFixture {
     CPPUNIT_TEST_SUITE(MarshallerThreadTest);
     CPPUNIT_TEST(test_write_thread_to_stream);
+    CPPUNIT_TEST(test_many_writes_keep_order);
+    CPPUNIT_TEST(test_write_thread_part);
+    CPPUNIT_TEST(test_write_error_is_recorded);
     CPPUNIT_TEST_SUITE_END();
 
+    static char *make_buf(const string &s) {
+        char *buf = new char[s.size()];
+        memcpy(buf, s.data(), s.size());
+        return buf;
+    }
+
 public:
     void test_write_thread_to_stream() {
         MarshallerThread mt;
@@ -42,6 +51,65 @@ public:
 
         CPPUNIT_ASSERT_EQUAL(payload, out.str());
     }
+
+    // Interleave writes made by the main thread with buffers written by the
+    // child; the output must be in the order the calls were made.
+    void test_many_writes_keep_order() {
+        stringstream out(ios::in | ios::out | ios::binary);
+        string expected;
+        {
+            MarshallerThread mt;
+            for (int i = 0; i < 2000; ++i) {
+                {
+                    Locker lock(mt.get_mutex(), mt.get_cond(), mt.get_child_thread_count());
+                    out << "<" << i << ">";
+                }
+                expected += "<" + to_string(i) + ">";
+
+                const string payload = "data-" + to_string(i) + ";";
+                Locker lock(mt.get_mutex(), mt.get_cond(), mt.get_child_thread_count());
+                mt.increment_child_thread_count();
+                mt.start_thread(&MarshallerThread::write_thread, out, make_buf(payload), payload.size());
+                expected += payload;
+            }
+            // The dtor waits for the writer to finish.
+        }
+
+        CPPUNIT_ASSERT_EQUAL(expected, out.str());
+    }
+
+    // write_thread_part() skips the four-byte XDR length prefix.
+    void test_write_thread_part() {
+        MarshallerThread mt;
+        stringstream out(ios::in | ios::out | ios::binary);
+
+        const string payload = "LLLLpart";
+        {
+            Locker lock(mt.get_mutex(), mt.get_cond(), mt.get_child_thread_count());
+            mt.increment_child_thread_count();
+            mt.start_thread(&MarshallerThread::write_thread_part, out, make_buf(payload), payload.size() - 4);
+        }
+
+        { Locker wait(mt.get_mutex(), mt.get_cond(), mt.get_child_thread_count()); }
+
+        CPPUNIT_ASSERT_EQUAL(string("part"), out.str());
+    }
+
+    void test_write_error_is_recorded() {
+        MarshallerThread mt;
+        stringstream out(ios::in | ios::out | ios::binary);
+        out.setstate(ios::badbit);
+
+        const string payload = "lost";
+        {
+            Locker lock(mt.get_mutex(), mt.get_cond(), mt.get_child_thread_count());
+            mt.increment_child_thread_count();
+            mt.start_thread(&MarshallerThread::write_thread, out, make_buf(payload), payload.size());
+        }
+
+        Locker wait(mt.get_mutex(), mt.get_cond(), mt.get_child_thread_count());
+        CPPUNIT_ASSERT(!mt.get_thread_error().empty());
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(MarshallerThreadTest);
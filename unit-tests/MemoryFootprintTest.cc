@@ -0,0 +1,185 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+#include "config.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Array.h"
+#include "D4Group.h"
+#include "Float64.h"
+#include "Grid.h"
+#include "Int32.h"
+#include "Str.h"
+#include "Structure.h"
+#include "XMLWriter.h"
+
+#include "debug.h"
+#include "run_tests_cppunit.h"
+
+using namespace CppUnit;
+using namespace libdap;
+using namespace std;
+
+// Count the allocations made by this program so the tests can check how
+// many a copy of a variable takes.
+static atomic<size_t> allocations(0);
+
+void *operator new(size_t size) {
+    ++allocations;
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+/**
+ * There can be millions of variables in memory at once (e.g., the rows of a
+ * Sequence or the elements of an Array of Structures), so the size of the
+ * variable classes and the allocations made to copy them are tracked here.
+ * The limits are the sizes when the DAP2 attribute table and the storage
+ * for string and compound values were made lazily; raise them only on
+ * purpose.
+ */
+class MemoryFootprintTest : public TestFixture {
+    CPPUNIT_TEST_SUITE(MemoryFootprintTest);
+    CPPUNIT_TEST(test_sizes);
+    CPPUNIT_TEST(test_attribute_tables);
+    CPPUNIT_TEST(test_no_attribute_tables);
+    CPPUNIT_TEST(test_scalar_copies);
+    CPPUNIT_TEST(test_vector_storage);
+    CPPUNIT_TEST_SUITE_END();
+
+    static size_t words(size_t bytes) { return bytes / sizeof(void *); }
+
+public:
+    void test_sizes() {
+        DBG(cerr << "BaseType: " << sizeof(BaseType) << ", Int32: " << sizeof(Int32) << ", Str: " << sizeof(Str)
+                 << ", Structure: " << sizeof(Structure) << ", Vector: " << sizeof(Vector)
+                 << ", Array: " << sizeof(Array) << endl);
+
+        CPPUNIT_ASSERT(words(sizeof(BaseType)) <= 11);
+        CPPUNIT_ASSERT(words(sizeof(Int32)) <= 12);
+        CPPUNIT_ASSERT(words(sizeof(Vector)) <= 18);
+    }
+
+    void test_attribute_tables() {
+        Int32 i("i");
+        CPPUNIT_ASSERT(!i.has_attr_table());
+        CPPUNIT_ASSERT(!i.has_attributes());
+
+        i.attributes()->add_attribute_nocopy(new D4Attribute("units", attr_str_c));
+        unique_ptr<BaseType> dap4_copy(i.ptr_duplicate());
+        CPPUNIT_ASSERT(!dap4_copy->has_attr_table());
+        CPPUNIT_ASSERT(dap4_copy->has_attributes());
+
+        i.get_attr_table().append_attr("units", "String", "m");
+        CPPUNIT_ASSERT(i.has_attr_table());
+        unique_ptr<BaseType> dap2_copy(i.ptr_duplicate());
+        CPPUNIT_ASSERT(dap2_copy->has_attr_table());
+        CPPUNIT_ASSERT_EQUAL(string("m"), dap2_copy->get_attr_table().get_attr("units"));
+
+        // Assignment keeps the table of the target
+        Int32 j("j");
+        AttrTable &table = j.get_attr_table();
+        j = Int32("k");
+        CPPUNIT_ASSERT(&j.get_attr_table() == &table);
+        CPPUNIT_ASSERT_EQUAL(0U, table.get_size());
+    }
+
+    // Printing or converting a variable without DAP2 attributes does not
+    // make a table for it.
+    void test_no_attribute_tables() {
+        Int32 i("i");
+        CPPUNIT_ASSERT(i.toString().find("d_attr: 0x0") != string::npos);
+        CPPUNIT_ASSERT(!i.has_attr_table());
+
+        Grid g("g");
+        Array *a = new Array("a", new Float64("a"));
+        a->append_dim(2, "x");
+        g.set_array(a);
+        Array *x = new Array("x", new Float64("x"));
+        x->append_dim(2, "x");
+        g.add_map(x, false);
+        XMLWriter xml;
+        g.print_xml_writer(xml, false);
+        g.print_xml_writer(xml, true);
+        CPPUNIT_ASSERT(!g.has_attr_table());
+
+        D4Group root("/");
+        g.transform_to_dap4(&root, &root);
+        CPPUNIT_ASSERT(!g.has_attr_table() && !a->has_attr_table());
+    }
+
+    // A copy of a scalar without attributes is one allocation: the copy itself.
+    void test_scalar_copies() {
+        Int32 i("a_variable_with_a_long_name");
+        i.set_value(42);
+        size_t before = allocations;
+        unique_ptr<BaseType> copy(i.ptr_duplicate());
+        CPPUNIT_ASSERT_EQUAL(size_t(1), allocations - before);
+
+        Structure s("s");
+        s.add_var_nocopy(new Int32("a"));
+        s.add_var_nocopy(new Int32("b"));
+        before = allocations;
+        unique_ptr<BaseType> s_copy(s.ptr_duplicate());
+        DBG(cerr << "Structure copy: " << allocations - before << " allocations" << endl);
+        CPPUNIT_ASSERT(allocations - before <= 4); // the Structure, two Int32s and d_vars
+    }
+
+    // Only Vectors of strings or compound types make storage for them.
+    void test_vector_storage() {
+        Array numbers("numbers", new Float64("numbers"));
+        numbers.append_dim(4);
+        vector<dods_float64> values{1, 2, 3, 4};
+        numbers.set_value(values, values.size());
+
+        Array strings("strings", new Str("strings"));
+        strings.append_dim(4);
+        vector<string> text{"a", "b", "c", "d"};
+        strings.set_value(text, text.size());
+
+        size_t before = allocations;
+        unique_ptr<BaseType> numbers_copy(numbers.ptr_duplicate());
+        size_t numbers_allocations = allocations - before;
+
+        before = allocations;
+        unique_ptr<BaseType> strings_copy(strings.ptr_duplicate());
+        size_t strings_allocations = allocations - before;
+
+        DBG(cerr << "Array copies: " << numbers_allocations << " and " << strings_allocations << " allocations"
+                 << endl);
+        // The Array, its prototype, its dimensions and the values
+        CPPUNIT_ASSERT(numbers_allocations <= 4);
+        // The same, but the values are the storage for strings and its vector
+        CPPUNIT_ASSERT(strings_allocations <= 5);
+
+        vector<dods_float64> copied(values.size());
+        static_cast<Array *>(numbers_copy.get())->value(copied.data());
+        CPPUNIT_ASSERT(copied == values);
+        vector<string> copied_text;
+        static_cast<Array *>(strings_copy.get())->value(copied_text);
+        CPPUNIT_ASSERT(copied_text == text);
+
+        numbers.clear_local_data();
+        strings.clear_local_data();
+        CPPUNIT_ASSERT_EQUAL(0U, strings.get_value_capacity());
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MemoryFootprintTest);
+
+int main(int argc, char *argv[]) { return run_tests<MemoryFootprintTest>(argc, argv) ? 0 : 1; }
@@ -0,0 +1,294 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+#include "config.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Array.h"
+#include "BaseTypeFactory.h"
+#include "D4Attributes.h"
+#include "D4Group.h"
+#include "DDS.h"
+#include "Int32.h"
+#include "NameIndex.h"
+#include "Structure.h"
+
+#include "debug.h"
+#include "run_tests_cppunit.h"
+
+using namespace CppUnit;
+using namespace libdap;
+using namespace std;
+
+class NameIndexTest : public TestFixture {
+    CPPUNIT_TEST_SUITE(NameIndexTest);
+    CPPUNIT_TEST(test_find);
+    CPPUNIT_TEST(test_changes);
+    CPPUNIT_TEST(test_rename);
+    CPPUNIT_TEST(test_rename_other_tree);
+    CPPUNIT_TEST(test_rename_attribute);
+    CPPUNIT_TEST(test_rename_dds_variable);
+    CPPUNIT_TEST(test_leaf_match_order);
+    CPPUNIT_TEST(test_group_paths);
+    CPPUNIT_TEST(test_dds);
+    CPPUNIT_TEST(test_many_variables);
+    CPPUNIT_TEST(test_add_and_find);
+    CPPUNIT_TEST(test_move_and_rename);
+    CPPUNIT_TEST_SUITE_END();
+
+    static string v(int i) { return "v" + to_string(i); }
+
+    // A Structure that shows the generation its name indexes are built for
+    struct Tree : public Structure {
+        explicit Tree(const string &name) : Structure(name) {}
+        uint64_t generation() const { return m_path_generation(); }
+    };
+
+    // A Structure with n Int32 variables named v0, v1, ...
+    static Structure *make_structure(const string &name, int n) {
+        auto s = new Structure(name);
+        for (int i = 0; i < n; ++i)
+            s->add_var_nocopy(new Int32(v(i)));
+        return s;
+    }
+
+public:
+    void test_find() {
+        unique_ptr<Structure> s(make_structure("s", 100));
+        CPPUNIT_ASSERT_EQUAL(string("v42"), s->var("v42")->name());
+        CPPUNIT_ASSERT(s->find_child("v99") == s->get_var_index(99));
+        CPPUNIT_ASSERT(s->find_child("v420xyz", 3) == s->get_var_index(42));
+        CPPUNIT_ASSERT(!s->var("v100"));
+
+        // Like a linear search, the index finds the first of two variables with a name
+        s->add_var_nocopy(new Int32("v7"));
+        CPPUNIT_ASSERT(s->var("v7") == s->get_var_index(7));
+    }
+
+    void test_changes() {
+        unique_ptr<Structure> s(make_structure("s", 40));
+        CPPUNIT_ASSERT(s->var("v3"));
+
+        s->del_var("v3");
+        CPPUNIT_ASSERT(!s->var("v3"));
+        CPPUNIT_ASSERT(s->var("v4") == s->get_var_index(3));
+
+        s->add_var_nocopy(new Int32("v3"));
+        CPPUNIT_ASSERT(s->var("v3") == s->get_var_index(39));
+
+        auto replacement = new Int32("new");
+        BaseType *old = s->get_var_index(0);
+        s->set_var_index(replacement, 0);
+        delete old;
+        CPPUNIT_ASSERT(s->var("new") == replacement);
+        CPPUNIT_ASSERT(!s->var("v0"));
+
+        s->del_var(s->var_begin());
+        CPPUNIT_ASSERT(!s->var("new"));
+        CPPUNIT_ASSERT(s->var("v1") == s->get_var_index(0));
+    }
+
+    void test_rename() {
+        unique_ptr<Structure> s(make_structure("s", 40));
+        CPPUNIT_ASSERT(s->var("v5"));
+        s->var("v5")->set_name("renamed");
+        CPPUNIT_ASSERT(!s->var("v5"));
+        CPPUNIT_ASSERT(s->var("renamed") == s->get_var_index(5));
+    }
+
+    // Renaming a variable in one tree leaves the indexes of another alone.
+    void test_rename_other_tree() {
+        Tree a("a"), b("b");
+        a.add_var_nocopy(make_structure("inner", 40));
+        b.add_var_nocopy(make_structure("inner", 40));
+        CPPUNIT_ASSERT(a.var("inner.v5") && b.var("inner.v5"));
+
+        // An index built the way b's Structure builds its own
+        auto inner = static_cast<Structure *>(b.var("inner"));
+        vector<BaseType *> items(inner->var_begin(), inner->var_end());
+        shared_ptr<NameIndex<BaseType>> index;
+        CPPUNIT_ASSERT_EQUAL(size_t(5), NameIndex<BaseType>::find(index, items, "v5", 2, b.generation()));
+        auto built = index;
+
+        uint64_t a_generation = a.generation();
+        a.var("inner.v5")->set_name("renamed");
+
+        CPPUNIT_ASSERT(a.generation() != a_generation);
+        CPPUNIT_ASSERT_EQUAL(size_t(5), NameIndex<BaseType>::find(index, items, "v5", 2, b.generation()));
+        CPPUNIT_ASSERT(index == built);
+        CPPUNIT_ASSERT(a.var("inner.renamed"));
+        CPPUNIT_ASSERT(!a.var("inner.v5"));
+        CPPUNIT_ASSERT(b.var("inner.v5"));
+        CPPUNIT_ASSERT(!b.var("inner.renamed"));
+    }
+
+    void test_rename_attribute() {
+        D4Attributes attrs;
+        for (int i = 0; i < 40; ++i)
+            attrs.add_attribute_nocopy(new D4Attribute(v(i), attr_int32_c));
+        CPPUNIT_ASSERT(attrs.get("v5"));
+
+        attrs.get("v5")->set_name("renamed");
+        CPPUNIT_ASSERT(!attrs.get("v5"));
+        CPPUNIT_ASSERT(attrs.get("renamed") == attrs.attributes()[5]);
+
+        // A copy has its own index
+        D4Attributes copy(attrs);
+        copy.get("v6")->set_name("copy_renamed");
+        CPPUNIT_ASSERT(copy.get("copy_renamed"));
+        CPPUNIT_ASSERT(attrs.get("v6") == attrs.attributes()[6]);
+    }
+
+    void test_rename_dds_variable() {
+        BaseTypeFactory factory;
+        DDS dds(&factory, "test");
+        for (int i = 0; i < 50; ++i)
+            dds.add_var_nocopy(new Int32(v(i)));
+        CPPUNIT_ASSERT(dds.var("v5"));
+
+        dds.var("v5")->set_name("renamed");
+        CPPUNIT_ASSERT(!dds.var("v5"));
+        CPPUNIT_ASSERT(dds.var("renamed") == dds.get_var_index(5));
+    }
+
+    // A leaf match in a Structure that comes first wins over a later variable
+    // at the top level, as it did before the index.
+    void test_leaf_match_order() {
+        unique_ptr<Structure> s(make_structure("s", 40));
+        Structure *inner = make_structure("inner", 3);
+        delete s->get_var_index(0);
+        s->set_var_index(inner, 0);
+
+        CPPUNIT_ASSERT(s->var("v2", false) == inner->var("v2"));
+        CPPUNIT_ASSERT(s->var("v2", true) == s->get_var_index(2));
+        CPPUNIT_ASSERT(s->var("v30", false) == s->get_var_index(30));
+        CPPUNIT_ASSERT(s->var("inner.v1") == inner->var("v1"));
+    }
+
+    void test_group_paths() {
+        D4Group root("/");
+        for (int i = 0; i < 30; ++i) {
+            auto g = new D4Group("g" + to_string(i));
+            for (int j = 0; j < 20; ++j)
+                g->add_var_nocopy(new Int32(v(j)));
+            root.add_group_nocopy(g);
+        }
+        D4Group *g7 = root.find_child_grp("g7");
+        CPPUNIT_ASSERT(g7 && g7->name() == "g7");
+        g7->add_group_nocopy(new D4Group("inner"));
+        root.find_child_grp("g29")->add_var_nocopy(new Int32("x"));
+
+        CPPUNIT_ASSERT(root.find_var("/g7/v19") == g7->var("v19"));
+        CPPUNIT_ASSERT(root.find_var("g7/v19") == g7->var("v19"));
+        CPPUNIT_ASSERT(root.find_var("/g7/inner") == g7->find_child_grp("inner"));
+        CPPUNIT_ASSERT(root.find_var("/g7/inner/") == g7->find_child_grp("inner"));
+        CPPUNIT_ASSERT(root.find_var("/g7") == g7);
+        CPPUNIT_ASSERT_EQUAL(string("x"), root.find_var("/g29/x")->name());
+        CPPUNIT_ASSERT(!root.find_var("/g30/x"));
+        CPPUNIT_ASSERT(!root.find_var("/g7/nothing/v1"));
+        CPPUNIT_ASSERT_THROW(g7->find_var("/g7/v1"), InternalErr);
+    }
+
+    void test_dds() {
+        BaseTypeFactory factory;
+        DDS dds(&factory, "test");
+        for (int i = 0; i < 50; ++i)
+            dds.add_var_nocopy(new Int32(v(i)));
+        Structure *s = make_structure("s", 3);
+        dds.add_var_nocopy(s);
+
+        CPPUNIT_ASSERT_EQUAL(string("v49"), dds.var("v49")->name());
+        CPPUNIT_ASSERT(dds.var("s.v1") == s->var("v1"));
+        CPPUNIT_ASSERT(dds.var("v1") == dds.get_var_index(1)); // top level before s
+        CPPUNIT_ASSERT(!dds.var("v50"));
+
+        dds.del_var("v49");
+        CPPUNIT_ASSERT(!dds.var("v49"));
+        dds.insert_var_nocopy(dds.var_begin(), new Int32("v49"));
+        CPPUNIT_ASSERT(dds.var("v49") == dds.get_var_index(0));
+    }
+
+    // Finding every variable of a large Structure must not take time
+    // quadratic in the number of variables.
+    void test_many_variables() {
+        const int n = 30000;
+        unique_ptr<Structure> s(make_structure("s", n));
+
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < n; ++i)
+            CPPUNIT_ASSERT(s->var(v(i)) == s->get_var_index(i));
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+        DBG(cerr << "Found " << n << " variables in " << elapsed << " ms" << endl);
+
+        // Allow lots of slack for slow machines
+        CPPUNIT_ASSERT(elapsed < 2000);
+    }
+
+    // The DMR parser looks up map sources between adding variables, so
+    // adding a variable must not make the group's index be built again.
+    void test_add_and_find() {
+        const int n = 16000;
+        D4Group root("/");
+        auto g = new D4Group("g");
+        root.add_group_nocopy(g);
+
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < n; ++i) {
+            auto a = new Array(v(i), new Int32(v(i)));
+            a->append_dim(2);
+            g->add_var_nocopy(a);
+            CPPUNIT_ASSERT(root.find_map_source("/g/" + v(i / 2)));
+            CPPUNIT_ASSERT(g->var(v(i)) == g->get_var_index(i));
+            if (i % 100 == 0) {
+                auto s = make_structure("s" + to_string(i), 2);
+                g->add_var_nocopy(s);
+                CPPUNIT_ASSERT(root.find_var("/g/s" + to_string(i) + ".v1") == s->var("v1"));
+                g->del_var(g->var_end() - 1);
+            }
+            if (i % 1000 == 0)
+                root.add_group_nocopy(new D4Group("h" + to_string(i)));
+            CPPUNIT_ASSERT(root.find_child_grp("h0"));
+        }
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+        DBG(cerr << "Added and found " << n << " variables in " << elapsed << " ms" << endl);
+
+        // Allow lots of slack for slow machines
+        CPPUNIT_ASSERT(elapsed < 4000);
+    }
+
+    // Moves and renames that do not add a variable still rebuild the names.
+    void test_move_and_rename() {
+        Tree a("a");
+        Structure *s = make_structure("s", 40);
+        Structure *inner = make_structure("inner", 40);
+        s->add_var_nocopy(inner);
+        a.add_var_nocopy(s);
+        CPPUNIT_ASSERT(a.var("s.inner.v5"));
+        CPPUNIT_ASSERT_EQUAL(string("a.s.inner.v5"), a.var("s.inner.v5")->FQN());
+
+        // Take inner out, rename one of its variables and put it back
+        CPPUNIT_ASSERT(s->get_var_index(40) == inner);
+        s->set_var_index(new Int32("placeholder"), 40);
+        inner->set_parent(nullptr);
+        inner->var("v5")->set_name("renamed");
+        a.add_var_nocopy(inner);
+
+        CPPUNIT_ASSERT(!a.var("inner.v5"));
+        CPPUNIT_ASSERT(a.var("inner.renamed"));
+        CPPUNIT_ASSERT_EQUAL(string("a.inner.renamed"), a.var("inner.renamed")->FQN());
+        CPPUNIT_ASSERT_EQUAL(string("a.inner.v6"), inner->var("v6")->FQN());
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(NameIndexTest);
+
+int main(int argc, char *argv[]) { return run_tests<NameIndexTest>(argc, argv) ? 0 : 1; }
@@ -0,0 +1,168 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+#include "config.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "D4Attributes.h"
+#include "Int32.h"
+#include "StringPool.h"
+
+#include "debug.h"
+#include "run_tests_cppunit.h"
+
+using namespace CppUnit;
+using namespace libdap;
+using namespace std;
+
+class StringPoolTest : public TestFixture {
+    CPPUNIT_TEST_SUITE(StringPoolTest);
+    CPPUNIT_TEST(test_sharing);
+    CPPUNIT_TEST(test_release);
+    CPPUNIT_TEST(test_empty);
+    CPPUNIT_TEST(test_variables);
+    CPPUNIT_TEST(test_attributes);
+    CPPUNIT_TEST(test_threads);
+    CPPUNIT_TEST(test_many_names);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void test_sharing() {
+        InternedString a(string("temperature"));
+        InternedString b(string("temp") + "erature");
+        InternedString c("pressure");
+
+        CPPUNIT_ASSERT(a == b);
+        CPPUNIT_ASSERT(&a.str() == &b.str()); // one copy of the text
+        CPPUNIT_ASSERT(a != c);
+        CPPUNIT_ASSERT(a == string("temperature"));
+        CPPUNIT_ASSERT_EQUAL(string("pressure"), c.str());
+
+        InternedString d = a;
+        CPPUNIT_ASSERT(&d.str() == &a.str());
+        d = c;
+        CPPUNIT_ASSERT(&d.str() == &c.str());
+        InternedString e = std::move(d);
+        CPPUNIT_ASSERT(d.empty() && e == c);
+    }
+
+    void test_release() {
+        size_t before = StringPool::size();
+        {
+            InternedString a("a name used only by test_release");
+            InternedString b = a;
+            CPPUNIT_ASSERT_EQUAL(before + 1, StringPool::size());
+        }
+        CPPUNIT_ASSERT_EQUAL(before, StringPool::size());
+    }
+
+    void test_empty() {
+        size_t before = StringPool::size();
+        InternedString a;
+        InternedString b("");
+        CPPUNIT_ASSERT(a.empty() && b.empty() && a == b);
+        CPPUNIT_ASSERT_EQUAL(string(), a.str());
+        CPPUNIT_ASSERT_EQUAL(before, StringPool::size());
+    }
+
+    void test_variables() {
+        Int32 a("time");
+        unique_ptr<BaseType> b(a.ptr_duplicate());
+        CPPUNIT_ASSERT_EQUAL(string("time"), b->name());
+        b->set_name("lat");
+        CPPUNIT_ASSERT_EQUAL(string("time"), a.name());
+        CPPUNIT_ASSERT_EQUAL(string("lat"), b->name());
+
+        // A variable costs no more than it did with a std::string name
+        CPPUNIT_ASSERT(sizeof(InternedString) == sizeof(void *));
+        CPPUNIT_ASSERT(sizeof(InternedString) < sizeof(string));
+    }
+
+    void test_attributes() {
+        D4Attributes attrs;
+        for (int i = 0; i < 100; ++i) {
+            auto a = new D4Attribute(i % 2 ? "units" : "long_name", attr_str_c);
+            a->add_value(to_string(i));
+            auto container = new D4Attribute("c" + to_string(i), attr_container_c);
+            container->attributes()->add_attribute_nocopy(a);
+            attrs.add_attribute_nocopy(container);
+        }
+
+        size_t before = StringPool::size();
+        D4Attributes copy(attrs);
+        CPPUNIT_ASSERT_EQUAL(before, StringPool::size());
+        CPPUNIT_ASSERT_EQUAL(string("units"), copy.get("c99.units")->name());
+    }
+
+    // Threads that make and drop the same few names do not lose or share
+    // text they should not.
+    void test_threads() {
+        size_t before = StringPool::size();
+        auto work = [](int seed) {
+            for (int i = 0; i < 20000; ++i) {
+                string text = "name" + to_string((i + seed) % 7);
+                InternedString s(text);
+                InternedString copy = s;
+                if (copy.str() != text)
+                    throw std::runtime_error("Wrong text for " + text);
+            }
+        };
+
+        vector<thread> threads;
+        vector<exception_ptr> errors(4);
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t]() {
+                try {
+                    work(t);
+                }
+                catch (...) {
+                    errors[t] = current_exception();
+                }
+            });
+        }
+        for (auto &t : threads)
+            t.join();
+
+        for (auto &e : errors)
+            CPPUNIT_ASSERT(!e);
+        CPPUNIT_ASSERT_EQUAL(before, StringPool::size());
+    }
+
+    // Names spread over the shards of the pool are each held once, however
+    // many threads make them.
+    void test_many_names() {
+        size_t before = StringPool::size();
+        vector<vector<InternedString>> names(4);
+        vector<thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&names, t]() {
+                for (int i = 0; i < 1000; ++i)
+                    names[t].emplace_back("a name in many shards " + to_string((i + 250 * t) % 1000));
+            });
+        }
+        for (auto &t : threads)
+            t.join();
+
+        CPPUNIT_ASSERT_EQUAL(before + 1000, StringPool::size());
+        for (int i = 0; i < 1000; ++i)
+            CPPUNIT_ASSERT(&names[0][i].str() == &names[1][(i + 750) % 1000].str());
+
+        names.clear();
+        CPPUNIT_ASSERT_EQUAL(before, StringPool::size());
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StringPoolTest);
+
+int main(int argc, char *argv[]) { return run_tests<StringPoolTest>(argc, argv) ? 0 : 1; }
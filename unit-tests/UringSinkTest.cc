@@ -0,0 +1,164 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+#include "config.h"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Error.h"
+#include "UringSink.h"
+
+#include "debug.h"
+#include "run_tests_cppunit.h"
+#include "test_config.h"
+
+using namespace CppUnit;
+using namespace libdap;
+using namespace std;
+
+class UringSinkTest : public TestFixture {
+    string d_data;
+    const string d_file = string(TEST_BUILD_DIR) + "/uring_sink_test.bin";
+
+    static string read_file(const string &file) {
+        ifstream ifs(file, ios::binary);
+        stringstream content;
+        content << ifs.rdbuf();
+        return content.str();
+    }
+
+    // Write d_data in pieces of assorted sizes, some bigger than a buffer.
+    void write_pieces(UringSink &sink) {
+        size_t pos = 0, n = 1;
+        while (pos < d_data.size()) {
+            size_t len = min(n, d_data.size() - pos);
+            sink.write(d_data.data() + pos, len);
+            pos += len;
+            n = (n * 7 + 3) % 5000;
+        }
+    }
+
+    CPPUNIT_TEST_SUITE(UringSinkTest);
+    CPPUNIT_TEST(test_file);
+    CPPUNIT_TEST(test_file_offset);
+    CPPUNIT_TEST(test_pipe);
+    CPPUNIT_TEST(test_write_error);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp() override {
+        d_data.resize(300000);
+        uint32_t x = 0xdeadbeef;
+        for (auto &c : d_data) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            c = static_cast<char>(x);
+        }
+    }
+
+    void tearDown() override { unlink(d_file.c_str()); }
+
+    // Buffers written out of order must still land at the right offsets.
+    void test_file() {
+        DBG(cerr << "io_uring available: " << UringSink::available() << endl);
+        for (unsigned int depth : {1, 2, 4, 8}) {
+            for (size_t buffer_size : {1000, 4096, 65536, 1 << 20}) {
+                int fd = creat(d_file.c_str(), 0644);
+                CPPUNIT_ASSERT(fd != -1);
+                {
+                    UringSink sink(fd, depth, buffer_size);
+                    CPPUNIT_ASSERT_EQUAL(UringSink::available(), sink.using_uring());
+                    write_pieces(sink);
+                    sink.flush();
+                    CPPUNIT_ASSERT(sink.syscalls() > 0);
+                }
+                close(fd);
+                CPPUNIT_ASSERT(read_file(d_file) == d_data);
+            }
+        }
+    }
+
+    // After flush() the file offset is where write(2) would have left it,
+    // so the caller and the sink can take turns.
+    void test_file_offset() {
+        int fd = creat(d_file.c_str(), 0644);
+        CPPUNIT_ASSERT(fd != -1);
+        CPPUNIT_ASSERT_EQUAL(static_cast<ssize_t>(3), write(fd, "abc", 3));
+        {
+            UringSink sink(fd, 4, 1000);
+            sink.write(d_data.data(), 10000);
+            sink.flush();
+            CPPUNIT_ASSERT_EQUAL(static_cast<off_t>(10003), lseek(fd, 0, SEEK_CUR));
+            CPPUNIT_ASSERT_EQUAL(static_cast<ssize_t>(3), write(fd, "xyz", 3));
+            sink.write(d_data.data() + 10000, 500);
+        } // the dtor flushes
+        close(fd);
+
+        string expected = "abc" + d_data.substr(0, 10000) + "xyz" + d_data.substr(10000, 500);
+        CPPUNIT_ASSERT(read_file(d_file) == expected);
+    }
+
+    // A pipe cannot be written at an offset; the bytes must arrive in order.
+    void test_pipe() {
+        int p[2];
+        CPPUNIT_ASSERT(pipe(p) == 0);
+        pid_t pid = fork();
+        CPPUNIT_ASSERT(pid != -1);
+        if (pid == 0) {
+            close(p[1]);
+            string received;
+            char buf[4096];
+            ssize_t n;
+            while ((n = read(p[0], buf, sizeof(buf))) > 0)
+                received.append(buf, n);
+            _exit(received == d_data ? 0 : 1);
+        }
+
+        close(p[0]);
+        {
+            UringSink sink(p[1], 4, 1000);
+            write_pieces(sink);
+        }
+        close(p[1]);
+
+        int status;
+        CPPUNIT_ASSERT(waitpid(pid, &status, 0) == pid);
+        CPPUNIT_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    void test_write_error() {
+        int fd = creat(d_file.c_str(), 0644);
+        CPPUNIT_ASSERT(fd != -1);
+        close(fd);
+        fd = open(d_file.c_str(), O_RDONLY);
+        CPPUNIT_ASSERT(fd != -1);
+        try {
+            UringSink sink(fd, 2, 1000);
+            sink.write(d_data.data(), 5000);
+            sink.flush();
+            CPPUNIT_FAIL("Expected an Error");
+        } catch (Error &e) {
+            DBG(cerr << e.get_error_message() << endl);
+            CPPUNIT_ASSERT(e.get_error_message().find("Could not write data") != string::npos);
+        }
+        close(fd);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(UringSinkTest);
+
+int main(int argc, char *argv[]) { return run_tests<UringSinkTest>(argc, argv) ? 0 : 1; }
@@ -24,13 +24,17 @@
 
 #include <cppunit/TextTestRunner.h>
 #include <cppunit/extensions/HelperMacros.h>
-#include <cstdlib>
 
+#include <arpa/inet.h>
+
+#include <cstdlib>
+#include <cstring>
 #include <exception> // std::exception
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "chunked_istream.h"
 #include "chunked_ostream.h"
@@ -393,6 +397,207 @@ public:
         CPPUNIT_ASSERT(roundtrip_in_memory(off_by_one, 8) == off_by_one);
     }
 
+    // Return the body sizes of the chunks in 'encoded', in order.
+    static vector<uint32_t> chunk_sizes(const string &encoded) {
+        vector<uint32_t> sizes;
+        size_t pos = 0;
+        while (pos + 4 <= encoded.size()) {
+            uint32_t header;
+            memcpy(&header, encoded.data() + pos, 4);
+            header = ntohl(header);
+            sizes.push_back(header & CHUNK_SIZE_MASK);
+            pos += 4 + (header & CHUNK_SIZE_MASK);
+        }
+        CPPUNIT_ASSERT_EQUAL(encoded.size(), pos);
+        return sizes;
+    }
+
+    // Small writes leave the chunk size alone; a large write makes it grow,
+    // up to the maximum, and a reader with a small buffer still gets the data.
+    void test_adaptive_chunk_size() {
+        string payload;
+        for (int i = 0; payload.size() < 200000; ++i)
+            payload.append(to_string(i)).push_back(' ');
+
+        stringstream ss(ios::in | ios::out | ios::binary);
+        {
+            chunked_ostream out(ss, 64, 4096);
+            for (int i = 0; i < 100; ++i)
+                out.write(payload.data() + i * 10, 10);
+            CPPUNIT_ASSERT_EQUAL(64, out.chunk_size());
+
+            out.write(payload.data() + 1000, payload.size() - 1000);
+            CPPUNIT_ASSERT_EQUAL(4096, out.chunk_size());
+        }
+
+        vector<uint32_t> sizes = chunk_sizes(ss.str());
+        CPPUNIT_ASSERT(sizes.size() > 2);
+        for (size_t i = 0; i < sizes.size() - 1; ++i) // the last is the end chunk
+            CPPUNIT_ASSERT(sizes[i] <= 4096);
+        CPPUNIT_ASSERT(sizes.size() < payload.size() / 2048);
+
+        ss.seekg(0, ios::beg);
+        chunked_istream in(ss, 16);
+        vector<char> result(payload.size());
+        in.read(result.data(), result.size());
+        CPPUNIT_ASSERT_EQUAL((streamsize)payload.size(), in.gcount());
+        CPPUNIT_ASSERT(payload == string(result.data(), result.size()));
+    }
+
+    void test_set_chunk_size() {
+        stringstream ss(ios::in | ios::out | ios::binary);
+        {
+            chunked_ostream out(ss, 8);
+            CPPUNIT_ASSERT_EQUAL(0, out.max_chunk_size());
+            out.write("ABC", 3);
+            out.set_chunk_size(16); // sends "ABC"
+            CPPUNIT_ASSERT_EQUAL(16, out.chunk_size());
+            out.write("ABCDEFGHIJKLMNOPQRSTUVWXYZ", 26);
+
+            CPPUNIT_ASSERT_THROW(out.set_chunk_size(0), std::out_of_range);
+            CPPUNIT_ASSERT_THROW(out.set_chunk_size(CHUNK_SIZE_MAX + 1), std::out_of_range);
+            CPPUNIT_ASSERT_THROW(out.set_max_chunk_size(CHUNK_SIZE_MAX + 1), std::out_of_range);
+            CPPUNIT_ASSERT_THROW(out.set_max_chunk_size(0x08000000), std::out_of_range);
+            CPPUNIT_ASSERT_THROW(out.set_max_chunk_size(0), std::out_of_range);
+            CPPUNIT_ASSERT_EQUAL(0, out.max_chunk_size());
+        }
+
+        vector<uint32_t> sizes = chunk_sizes(ss.str());
+        CPPUNIT_ASSERT_EQUAL((size_t)3, sizes.size());
+        CPPUNIT_ASSERT_EQUAL(3U, sizes[0]);
+        CPPUNIT_ASSERT_EQUAL(16U, sizes[1]);
+        CPPUNIT_ASSERT_EQUAL(10U, sizes[2]);
+    }
+
+    // A size that does not fit in the 24 size bits of a chunk header would
+    // run into its type and flag bits, so it is refused.
+    void test_oversized_chunk_sizes() {
+        stringstream ss(ios::in | ios::out | ios::binary);
+        CPPUNIT_ASSERT_THROW(chunked_ostream(ss, 8, 0x08000000), std::out_of_range);
+        CPPUNIT_ASSERT_THROW(chunked_ostream(ss, 8, CHUNK_SIZE_MAX + 1), std::out_of_range);
+        CPPUNIT_ASSERT_THROW(chunked_ostream(ss, 8, -1), std::out_of_range);
+        CPPUNIT_ASSERT_THROW(chunked_ostream(ss, 0x08000000), std::out_of_range);
+        CPPUNIT_ASSERT_THROW(chunked_ostream(ss, 0), std::out_of_range);
+
+        {
+            chunked_ostream out(ss, 8, CHUNK_SIZE_MAX);
+            CPPUNIT_ASSERT_EQUAL(CHUNK_SIZE_MAX, out.max_chunk_size());
+            out.write("ABC", 3);
+        }
+        vector<uint32_t> sizes = chunk_sizes(ss.str());
+        CPPUNIT_ASSERT_EQUAL((size_t)1, sizes.size()); // the end chunk
+        CPPUNIT_ASSERT_EQUAL(3U, sizes[0]);
+    }
+
+    // Large writes and reads go straight between the caller's memory and the
+    // underlying stream; that must not change the chunks on the wire or the
+    // data read back.
+    void test_large_transfer_framing() {
+        const int buf_size = 100;
+        string payload(1234, 0);
+        for (size_t i = 0; i < payload.size(); ++i)
+            payload[i] = static_cast<char>(i * 31);
+
+        stringstream by_char(ios::in | ios::out | ios::binary);
+        {
+            chunked_ostream out(by_char, buf_size);
+            for (char c : payload)
+                out.put(c);
+        }
+
+        stringstream mixed(ios::in | ios::out | ios::binary);
+        {
+            chunked_ostream out(mixed, buf_size);
+            out.write(payload.data(), 7);          // buffered
+            out.write(payload.data() + 7, 1000);   // a partial chunk, then whole ones
+            out.write(payload.data() + 1007, 193); // the buffer and 's' fill exactly two chunks
+            out.write(payload.data() + 1200, 34);
+        }
+        CPPUNIT_ASSERT(by_char.str() == mixed.str());
+
+        vector<uint32_t> sizes = chunk_sizes(mixed.str());
+        CPPUNIT_ASSERT_EQUAL((size_t)13, sizes.size());
+        CPPUNIT_ASSERT_EQUAL(34U, sizes.back()); // the end chunk holds the rest
+
+        mixed.seekg(0, ios::beg);
+        chunked_istream in(mixed, buf_size);
+        string result(payload.size(), 0);
+        in.read(&result[0], 3);      // fills the buffer with the first chunk
+        in.read(&result[3], 1000);   // the rest of the buffer, then chunks straight into 'result'
+        result[1003] = in.get();     // buffers the part of the chunk the last read left
+        in.read(&result[1004], 230); // reads the end chunk
+        CPPUNIT_ASSERT_EQUAL((streamsize)230, in.gcount());
+        CPPUNIT_ASSERT(payload == result);
+    }
+
+    // Compressed chunks read back the same whichever way they're read: by large
+    // reads inflated straight into the destination, by reads that end inside a
+    // chunk, and one character at a time.
+    void test_compressed_chunks() {
+        string text;
+        for (int i = 0; text.size() < 50000; ++i)
+            text.append("value ").append(to_string(i % 100)).push_back('\n');
+        string noise(5000, 0);
+        uint32_t x = 0x9e3779b9;
+        for (auto &c : noise) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            c = static_cast<char>(x);
+        }
+        const string payload = text + noise + text;
+
+        for (int threads : {1, 4}) {
+            stringstream ss(ios::in | ios::out | ios::binary);
+            {
+                chunked_ostream out(ss, 1000);
+                out.set_compression(6, threads);
+                CPPUNIT_ASSERT_EQUAL(6, out.compression());
+                out.write(payload.data(), 10);
+                out.write(payload.data() + 10, payload.size() - 10);
+            }
+
+            // The text compresses; the noise doesn't, so its chunks are sent as is.
+            const string encoded = ss.str();
+            CPPUNIT_ASSERT(encoded.size() < payload.size() / 2);
+            size_t compressed = 0, plain = 0;
+            for (size_t pos = 0; pos + 4 <= encoded.size();) {
+                uint32_t header;
+                memcpy(&header, encoded.data() + pos, 4);
+                header = ntohl(header);
+                if (header & CHUNK_COMPRESSED)
+                    ++compressed;
+                else
+                    ++plain;
+                pos += 4 + (header & CHUNK_SIZE_MASK);
+            }
+            CPPUNIT_ASSERT(compressed > 0);
+            CPPUNIT_ASSERT(plain > 0);
+
+            istringstream big(encoded);
+            chunked_istream in(big, 16);
+            string result(payload.size(), 0);
+            in.read(&result[0], 5);
+            in.read(&result[5], 60000);
+            in.read(&result[60005], payload.size() - 60005);
+            CPPUNIT_ASSERT_EQUAL((streamsize)(payload.size() - 60005), in.gcount());
+            CPPUNIT_ASSERT(payload == result);
+
+            istringstream small(encoded);
+            chunked_istream in2(small, 16);
+            result.clear();
+            char c;
+            while (in2.get(c))
+                result.push_back(c);
+            CPPUNIT_ASSERT(payload == result);
+
+            istringstream first(encoded);
+            chunked_istream in3(first, 16);
+            CPPUNIT_ASSERT_EQUAL(1000, in3.read_next_chunk());
+            CPPUNIT_ASSERT_EQUAL(1000, in3.bytes_in_buffer());
+        }
+    }
+
     // these are the tests
     void test_write_1_read_1_small_file() {
         single_char_write(small_file, 32);
@@ -705,6 +910,11 @@ public:
 
     CPPUNIT_TEST(test_write_9000_read_5000_big_file_3);
     CPPUNIT_TEST(test_roundtrip_exact_and_off_by_one_in_memory);
+    CPPUNIT_TEST(test_adaptive_chunk_size);
+    CPPUNIT_TEST(test_set_chunk_size);
+    CPPUNIT_TEST(test_oversized_chunk_sizes);
+    CPPUNIT_TEST(test_large_transfer_framing);
+    CPPUNIT_TEST(test_compressed_chunks);
 
     CPPUNIT_TEST_SUITE_END();
 };
@@ -0,0 +1,117 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+// Throughput of chunked_ostream and chunked_istream for different chunk
+// sizes, including the adaptive policy, and with compressed chunks. The data are written as a series of
+// vectors, the way D4StreamMarshaller writes an Array. Not a unit test; build
+// with -DBUILD_BENCHMARKS=ON (cmake) or 'make benchmarks' (autotools) and run
+// by hand.
+//
+// Usage: chunked_stream_benchmark [total MB, default 512] [vector KB, default 1024]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "chunked_istream.h"
+#include "chunked_ostream.h"
+
+using namespace libdap;
+using namespace std;
+
+int main(int argc, char *argv[]) {
+    size_t total = (argc > 1 ? strtoul(argv[1], nullptr, 10) : 512) * 1024 * 1024;
+    size_t vector_size = (argc > 2 ? strtoul(argv[2], nullptr, 10) : 1024) * 1024;
+    size_t vectors = total / vector_size > 0 ? total / vector_size : 1;
+
+    vector<char> data(vector_size);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>(i * 2654435761U >> 24);
+
+    struct Config {
+        const char *name;
+        int size;
+        int max_size;
+        int compression;
+        int threads;
+    };
+    const Config configs[] = {{"fixed", CHUNK_SIZE, 0, 0, 1},
+                              {"fixed", 64 * 1024, 0, 0, 1},
+                              {"fixed", 1024 * 1024, 0, 0, 1},
+                              {"fixed", CHUNK_SIZE_MAX, 0, 0, 1},
+                              {"adaptive", CHUNK_SIZE, CHUNK_SIZE_ADAPTIVE_MAX, 0, 1},
+                              {"zlib-1", CHUNK_SIZE, CHUNK_SIZE_ADAPTIVE_MAX, 1, 1},
+                              {"zlib-1x4", CHUNK_SIZE, CHUNK_SIZE_ADAPTIVE_MAX, 1, 4}};
+
+    printf("%zu vectors of %zu bytes\n", vectors, vector_size);
+    printf("%-10s %10s %10s %12s %12s\n", "policy", "chunk", "chunks", "write MB/s", "read MB/s");
+
+    for (const Config &config : configs) {
+        double mb = double(vectors) * vector_size / (1024.0 * 1024.0);
+
+        // Writing to /dev/null keeps the per-chunk system calls and drops the I/O.
+        ofstream null_os("/dev/null", ios::binary);
+        auto start = chrono::steady_clock::now();
+        {
+            chunked_ostream cos(null_os, config.size, config.max_size);
+            cos.set_compression(config.compression, config.threads);
+            for (size_t i = 0; i < vectors; ++i)
+                cos.write(data.data(), data.size());
+        }
+        chrono::duration<double> write_time = chrono::steady_clock::now() - start;
+
+        // Read back from memory; encode a copy first (not timed).
+        stringstream ss(ios::in | ios::out | ios::binary);
+        {
+            chunked_ostream cos(ss, config.size, config.max_size);
+            cos.set_compression(config.compression, config.threads);
+            for (size_t i = 0; i < vectors; ++i)
+                cos.write(data.data(), data.size());
+        }
+        size_t chunks = 0;
+        const string encoded = ss.str();
+        for (size_t pos = 0; pos + 4 <= encoded.size(); ++chunks) {
+            uint32_t header = (uint8_t)encoded[pos] << 24 | (uint8_t)encoded[pos + 1] << 16 |
+                              (uint8_t)encoded[pos + 2] << 8 | (uint8_t)encoded[pos + 3];
+            pos += 4 + (header & CHUNK_SIZE_MASK);
+        }
+
+        vector<char> result(vector_size);
+        start = chrono::steady_clock::now();
+        {
+            chunked_istream cis(ss, CHUNK_SIZE);
+            for (size_t i = 0; i < vectors; ++i)
+                cis.read(result.data(), result.size());
+        }
+        chrono::duration<double> read_time = chrono::steady_clock::now() - start;
+
+        printf("%-10s %10d %10zu %12.1f %12.1f\n", config.name, config.size, chunks, mb / write_time.count(),
+               mb / read_time.count());
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+// Throughput of the CRC-32 engines behind Crc32::AddData() across buffer
+// sizes, and of crc32_update_parallel() for the largest buffer. Not a unit test; build with -DBUILD_BENCHMARKS=ON (cmake) or
+// 'make benchmarks' (autotools) and run by hand.
+//
+// Usage: crc32_benchmark [total MB per measurement, default 256]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "crc.h"
+
+using namespace libdap;
+using namespace std;
+
+int main(int argc, char *argv[]) {
+    size_t total = (argc > 1 ? strtoul(argv[1], nullptr, 10) : 256) * 1024 * 1024;
+    const size_t sizes[] = {64, 512, 4096, 65536, 1 << 20, 16 << 20};
+
+    vector<uint8_t> buf(sizes[sizeof(sizes) / sizeof(sizes[0]) - 1]);
+    for (size_t i = 0; i < buf.size(); ++i)
+        buf[i] = static_cast<uint8_t>(i * 2654435761U >> 24);
+
+    printf("best engine: %s\n", crc32_engine_name(crc32_best_engine()));
+    printf("%-12s %12s %12s\n", "engine", "buffer", "MB/s");
+
+    for (Crc32Engine engine : {crc32_bytewise, crc32_slice8, crc32_slice16, crc32_pclmul}) {
+        if (!crc32_engine_available(engine))
+            continue;
+        for (size_t size : sizes) {
+            size_t iterations = total / size > 0 ? total / size : 1;
+            uint32_t crc = ~0U;
+            auto start = chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; ++i)
+                crc = crc32_update(engine, crc, buf.data(), size);
+            chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+            double mb = double(iterations) * size / (1024.0 * 1024.0);
+            // Print the crc so the loop cannot be optimized away.
+            printf("%-12s %12zu %12.1f  (%08x)\n", crc32_engine_name(engine), size, mb / elapsed.count(), ~crc);
+        }
+    }
+
+    const size_t size = buf.size();
+    for (unsigned int threads : {1, 2, 4, 8}) {
+        size_t iterations = total / size > 0 ? total / size : 1;
+        uint32_t crc = ~0U;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+            crc = crc32_update_parallel(crc, buf.data(), size, threads);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+        double mb = double(iterations) * size / (1024.0 * 1024.0);
+        printf("%-9s x%-2u %12zu %12.1f  (%08x)\n", "parallel", threads, size, mb / elapsed.count(), ~crc);
+    }
+
+    return 0;
+}
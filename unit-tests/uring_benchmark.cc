@@ -0,0 +1,128 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+// Throughput and system calls of D4StreamMarshaller writing a file three
+// ways: to an ostream with the MarshallerThread child thread, to a file
+// descriptor with writev(2), and to a file descriptor with io_uring. Each
+// variable is a vector plus its checksum, like D4Group::serialize() sends
+// them. The ostream count is the write(2)-family calls from /proc/self/io
+// (made by the child thread); the others are the marshaller's own counts of
+// writev(2) and io_uring_enter(2) calls. Not a unit test; build with
+// -DBUILD_BENCHMARKS=ON (cmake) or 'make benchmarks' (autotools) and run by
+// hand.
+//
+// Usage: uring_benchmark [output file, default ./uring_benchmark.out] [total MB, default 512]
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "D4StreamMarshaller.h"
+#include "UringSink.h"
+
+using namespace libdap;
+using namespace std;
+
+// The write(2), writev(2) and pwrite(2) calls made by this process, or 0 if unknown.
+static unsigned long write_calls() {
+    unsigned long syscw = 0;
+    FILE *fp = fopen("/proc/self/io", "r");
+    if (!fp)
+        return 0;
+    char line[128];
+    while (fgets(line, sizeof(line), fp))
+        if (sscanf(line, "syscw: %lu", &syscw) == 1)
+            break;
+    fclose(fp);
+    return syscw;
+}
+
+static void marshal(D4StreamMarshaller &m, const vector<char> &data, size_t vectors) {
+    for (size_t i = 0; i < vectors; ++i) {
+        m.reset_checksum();
+        m.put_vector(const_cast<char *>(data.data()), data.size());
+        m.put_checksum();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    string file = argc > 1 ? argv[1] : "uring_benchmark.out";
+    size_t total = (argc > 2 ? strtoul(argv[2], nullptr, 10) : 512) * 1024 * 1024;
+    const size_t sizes[] = {4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+
+    vector<char> data(sizes[sizeof(sizes) / sizeof(sizes[0]) - 1]);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>(i * 2654435761U >> 24);
+
+    printf("io_uring available: %s\n", UringSink::available() ? "yes" : "no");
+    printf("%-10s %10s %10s %12s %12s\n", "path", "vector", "vectors", "MB/s", "syscalls");
+
+    for (size_t size : sizes) {
+        size_t vectors = total / size > 0 ? total / size : 1;
+        vector<char> values(data.begin(), data.begin() + size);
+        double mb = double(vectors) * size / (1024.0 * 1024.0);
+
+        for (const char *path : {"pthread", "writev", "io_uring"}) {
+            const string name = path;
+            unsigned long calls = write_calls();
+            auto start = chrono::steady_clock::now();
+            if (name == "pthread") {
+                ofstream out(file, ios::binary | ios::trunc);
+                {
+                    D4StreamMarshaller m(out, true, true);
+                    marshal(m, values, vectors);
+                }
+                out.close();
+                calls = write_calls() - calls;
+            } else {
+                int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                if (fd == -1) {
+                    perror(file.c_str());
+                    return 1;
+                }
+                {
+                    D4StreamMarshaller m(fd, true, true);
+                    if (name == "io_uring" && !m.use_uring()) {
+                        close(fd);
+                        continue;
+                    }
+                    marshal(m, values, vectors);
+                    m.flush();
+                    calls = m.write_syscalls();
+                }
+                close(fd);
+            }
+            chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+            printf("%-10s %10zu %10zu %12.0f %12lu\n", path, size, vectors, mb / elapsed.count(), calls);
+        }
+    }
+
+    unlink(file.c_str());
+    return 0;
+}